@@ -1,19 +1,175 @@
 #include "App.h"
 
+//std
+#include <iostream>
+#include <random>
+
 namespace Engine
 {
 	void App::Run() {
+		if (assetArchivePath[0] != '\0') {
+			assetArchive = std::make_unique<AssetArchive>(assetArchivePath);
+			textureCache.Mount(*assetArchive);
+		}
+
+		if (textureBudget != 0) {
+			textureCache.EnableStreaming(textureBudget);
+		}
+
+		if (postProcessing && postQuarterResolution) {
+			PostProcessor::Settings postSettings = renderer.GetPostSettings();
+			postSettings.downscale = 4;
+			renderer.SetPostSettings(postSettings);
+		}
+
 		Camera camera{ device, static_cast<int>(renderer.GetSwapchainExtent().width), static_cast<int>(renderer.GetSwapchainExtent().height), glm::vec3(0.0f, 0.0f, 2.0f) };
-		SimpleRenderereSystem simpleRenderSystem{ device, renderer.GetSwapchainRenderPass(), camera};
+		Scene scene{ device, textureCache.Workers() };
+		MaterialSystem materials{ device };
+		ClusteredLights lights{ device, camera };
+		ShadowRenderSystem shadows{ device, camera, scene };
+		SimpleRenderereSystem simpleRenderSystem{ device, textureCache, renderer.GetSwapchainRenderPass(), camera, scene, materials, lights, shadows, vertexInputMode, meshPath, assetArchive.get() };
+
+		if (occlusionCulling) {
+			simpleRenderSystem.EnableOcclusionCulling();
+		}
+
+		if (softwareOcclusion) {
+			simpleRenderSystem.EnableSoftwareOcclusion();
+		}
+
+		if (depthPrepass) {
+			simpleRenderSystem.EnableDepthPrepass(renderer.GetDepthPrepassRenderPass());
+		}
+
+		std::unique_ptr<DeferredLightingSystem> deferredLighting;
+		if (deferredShading) {
+			simpleRenderSystem.EnableDeferredShading(renderer.GetDeferredRenderPass());
+			deferredLighting = std::make_unique<DeferredLightingSystem>(device, camera, lights, shadows, renderer.GetDeferredRenderPass());
+		}
+
+		if (instanceGridSize > 1) {
+			// Moving the grid's root moves every instance on it
+			Entity grid = scene.Create();
+			float offset = (instanceGridSize - 1) * instanceSpacing * 0.5f;
+			for (int z = 0; z < instanceGridSize; z++) {
+				for (int x = 0; x < instanceGridSize; x++) {
+					glm::vec3 position = glm::vec3(x * instanceSpacing - offset, 0.0f, -z * instanceSpacing);
+					Entity instance = softwareOcclusion ? simpleRenderSystem.AddOccluder(position, 1.0f, grid) : simpleRenderSystem.AddInstance(position, 1.0f, grid);
+					if (sunShadows) {
+						shadows.AddCaster(simpleRenderSystem.GetModel(), instance);
+					}
+				}
+			}
+		}
+		else {
+			Entity instance = simpleRenderSystem.AddInstance(glm::vec3(0.0f));
+			if (sunShadows) {
+				shadows.AddCaster(simpleRenderSystem.GetModel(), instance);
+			}
+		}
+
+		if (pointLightCount > 0 || sunShadows) {
+			// Only Lit materials are shaded by the lights and the sun
+			MaterialSystem::Material lit = materials.Get(MaterialSystem::DefaultMaterial);
+			lit.features |= MaterialSystem::Lit;
+			materials.Set(MaterialSystem::DefaultMaterial, lit);
+		}
+
+		if (pointLightCount > 0) {
+			// Fixed seed so every run lights the scene the same way
+			std::mt19937 random{ 1 };
+			std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+			float halfWidth = (instanceGridSize - 1) * instanceSpacing * 0.5f + 1.0f;
+			float depth = (instanceGridSize - 1) * instanceSpacing + 2.0f;
+			for (uint32_t i = 0; i < pointLightCount; i++) {
+				glm::vec3 position = glm::vec3((unit(random) * 2.0f - 1.0f) * halfWidth, unit(random) * 2.0f - 1.0f, 1.0f - unit(random) * depth);
+				glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+				lights.Add(ClusteredLights::Light::Point(position, 1.0f + unit(random), color / glm::max(color.r, glm::max(color.g, color.b))));
+			}
+		}
 
 		while (!window.ShouldClose()) {
 			glfwPollEvents();
+			textureCache.Update();
+
+			bool prepassKey = glfwGetKey(window.WindowHandler(), GLFW_KEY_P) == GLFW_PRESS;
+			if (prepassKey && !prepassKeyHeld && !deferredShading) {
+				if (simpleRenderSystem.DepthPrepassEnabled()) {
+					simpleRenderSystem.DisableDepthPrepass();
+				}
+				else {
+					simpleRenderSystem.EnableDepthPrepass(renderer.GetDepthPrepassRenderPass());
+				}
+				std::cout << "Depth prepass " << (simpleRenderSystem.DepthPrepassEnabled() ? "on" : "off") << std::endl;
+			}
+			prepassKeyHeld = prepassKey;
+
+			// Before anything culls or fits to the view, so they see the matrices camera.Matrix uploads for this frame
+			camera.Inputs(window.WindowHandler());
+
+			glm::vec3 pickOrigin;
+			glm::vec3 pickDirection;
+			if (camera.ConsumePickRay(pickOrigin, pickDirection)) {
+				uint32_t picked = simpleRenderSystem.PickInstance(pickOrigin, pickDirection);
+				if (picked != Bvh::InvalidObject) {
+					std::cout << "Picked instance " << picked << std::endl;
+				}
+			}
 
 			if (auto commandBuffer = renderer.StartFrame()) {
-				renderer.StartSwapchainRenderPass(commandBuffer);
-				simpleRenderSystem.RenderObject(commandBuffer, currentFrame);
+				// The frame's fence was waited on, the scene and materials can write their buffers
+				scene.Update(currentFrame);
+				materials.Update(currentFrame);
+				simpleRenderSystem.CullOccluded();
+
+				if (sunShadows) {
+					shadows.Render(commandBuffer, currentFrame);
+					renderer.MarkGpuTime(commandBuffer, "shadow maps");
+				}
+
+				// Compute work has to be recorded outside of the render pass
+				simpleRenderSystem.PrepareFrame(commandBuffer, currentFrame, renderer.GetDepthPyramid());
+				lights.Cull(commandBuffer, currentFrame, renderer.GetSwapchainExtent());
+				if (simpleRenderSystem.DepthPrepassEnabled()) {
+					renderer.StartDepthPrepass(commandBuffer);
+					simpleRenderSystem.RenderDepthPrepass(commandBuffer, currentFrame);
+					renderer.EndSwapchainRenderPass(commandBuffer);
+				}
+				if (deferredLighting) {
+					renderer.StartDeferredRenderPass(commandBuffer);
+					simpleRenderSystem.RenderObject(commandBuffer, currentFrame);
+					renderer.NextSubpass(commandBuffer);
+					deferredLighting->Render(commandBuffer, currentFrame, renderer.GetGBuffer(), renderer.GetSwapchainExtent());
+				}
+				else {
+					renderer.StartSwapchainRenderPass(commandBuffer);
+					simpleRenderSystem.RenderObject(commandBuffer, currentFrame);
+				}
 				renderer.EndSwapchainRenderPass(commandBuffer);
-				camera.Inputs(window.WindowHandler());
+
+				// What was hidden last frame is tested against the depth drawn so far and drawn on top when it shows up
+				if (occlusionCulling) {
+					renderer.BuildDepthPyramid(commandBuffer);
+					simpleRenderSystem.CullLate(commandBuffer, currentFrame, *renderer.GetDepthPyramid());
+					renderer.ResumeSwapchainRenderPass(commandBuffer);
+					simpleRenderSystem.RenderLate(commandBuffer, currentFrame);
+					renderer.EndSwapchainRenderPass(commandBuffer);
+				}
+				statsFrame++;
+				if (printRenderStats && statsFrame % 300 == 0) {
+					const RenderQueue::Stats& stats = simpleRenderSystem.GetRenderStats();
+					std::cout << stats.draws << " draws, " << stats.pipelineBinds << " pipeline binds, " << stats.setBinds << " descriptor set binds, "
+						<< stats.meshBinds << " mesh binds, " << stats.bindsSkipped << " binds skipped" << std::endl;
+				}
+
+				if (printGpuTimings && statsFrame % 300 == 0) {
+					std::cout << "GPU, depth prepass " << (simpleRenderSystem.DepthPrepassEnabled() ? "on" : "off") << ":";
+					for (const GpuTimer::Timing& timing : renderer.GetGpuTimings()) {
+						std::cout << " " << timing.label << " " << timing.milliseconds << " ms";
+					}
+					std::cout << std::endl;
+				}
+
 				camera.Matrix(currentFrame);
 				renderer.EndFrame();
 			}
@@ -3,6 +3,13 @@
 #include "Window.h"
 #include "Device.h"
 #include "Camera.h"
+#include "TextureCache.h"
+#include "AssetArchive.h"
+#include "Scene.h"
+#include "MaterialSystem.h"
+#include "ClusteredLights.h"
+#include "ShadowRenderSystem.h"
+#include "DeferredLightingSystem.h"
 
 #include "Renderer.h"
 #include "SimpleRenderereSystem.h"
@@ -19,15 +26,63 @@ namespace Engine
 		static constexpr int width = 800;
 		static constexpr int height = 800;
 
+		// VertexPulling fetches vertices from a storage buffer (Res/Shaders/VertexPulling.vert) instead of the fixed-function vertex input
+		static constexpr VertexInputMode vertexInputMode = VertexInputMode::FixedFunction;
+
+		// .obj / .gltf / .glb to render instead of the built-in pyramid, empty keeps the pyramid
+		static constexpr const char* meshPath = "";
+
+		// .vkpa archive written by Tools/AssetPacker, assets found in it skip decoding and parsing. Empty loads everything from Res
+		static constexpr const char* assetArchivePath = "";
+
+		// Copies of the model on a square grid in the XZ plane (e.g. 64 for a forest), far ones are drawn as impostors
+		static constexpr int instanceGridSize = 1;
+		static constexpr float instanceSpacing = 1.5f;
+
+		// Device memory textures may use together, textures are streamed by mip level when non zero
+		static constexpr VkDeviceSize textureBudget = 256ull * 1024 * 1024;
+
+		// Two phase Hi-Z occlusion culling of whole mesh draws, for scenes where most instances hide behind others
+		static constexpr bool occlusionCulling = false;
+		// Grid instances become occluders and hidden ones are skipped on the CPU before any command is recorded
+		static constexpr bool softwareOcclusion = false;
+		// Prints the render queue's draw and bind counts every few hundred frames
+		static constexpr bool printRenderStats = false;
+		// Depth only pass before the color pass so opaque fragments are shaded once per pixel, P toggles it while running
+		static constexpr bool depthPrepass = false;
+		// Prints how long the GPU spent on each render pass every few hundred frames
+		static constexpr bool printGpuTimings = false;
+		// Point lights scattered over the instance grid, the default material becomes Lit to show them and the sun's shadows
+		static constexpr uint32_t pointLightCount = 0;
+		// Cascaded shadow maps of the sun on Lit materials, every instance casts and is static
+		static constexpr bool sunShadows = false;
+		/*
+			G-buffer subpass then a lighting subpass reading it as input attachments, so each pixel is lit once however
+			many triangles cover it. Far instances stay meshes instead of impostors
+		*/
+		static constexpr bool deferredShading = false;
+		static_assert(!(deferredShading && (depthPrepass || occlusionCulling)), "the depth prepass and occlusion culling only work with forward shading");
+		/*
+			Bloom, sharpening and tonemapping in compute after the frame is drawn into an HDR target, on the async compute
+			queue where there is one. Bloom runs at half resolution, or quarter with postQuarterResolution
+		*/
+		static constexpr bool postProcessing = false;
+		static constexpr bool postQuarterResolution = false;
+
 		void Run();
 
 	private:
 
 		uint32_t currentFrame = 0;
+		uint32_t statsFrame = 0;
+		bool prepassKeyHeld = false;
 
 		Window window{ width, height };
 		Device device{ window };
-		Renderer renderer{ device, window };
+		Renderer renderer{ device, window, occlusionCulling, deferredShading, postProcessing };
+		// Before the texture cache so it outlives the cache's workers
+		std::unique_ptr<AssetArchive> assetArchive;
+		TextureCache textureCache{ device };
 
 		std::unique_ptr<Model> model;
 	};
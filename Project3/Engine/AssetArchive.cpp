@@ -0,0 +1,246 @@
+#include "AssetArchive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//std
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+namespace Engine {
+	AssetArchive::AssetArchive(const std::string& FilePath) {
+		map(FilePath);
+
+		try
+		{
+			validate(FilePath);
+		}
+		catch (...)
+		{
+			unmap();
+			throw;
+		}
+	}
+
+	AssetArchive::~AssetArchive() {
+		unmap();
+	}
+
+	void AssetArchive::unmap() {
+#ifdef _WIN32
+		if (base) UnmapViewOfFile(base);
+		if (mappingHandle) CloseHandle(mappingHandle);
+		if (fileHandle) CloseHandle(fileHandle);
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		if (base) munmap(const_cast<char*>(base), size);
+		if (fileDescriptor >= 0) close(fileDescriptor);
+		fileDescriptor = -1;
+#endif
+		base = nullptr;
+	}
+
+	void AssetArchive::map(const std::string& FilePath) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("failed to open asset archive: " + FilePath);
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			unmap();
+			throw std::runtime_error("failed to read the size of asset archive: " + FilePath);
+		}
+		size = static_cast<size_t>(fileSize.QuadPart);
+
+		mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mappingHandle) {
+			unmap();
+			throw std::runtime_error("failed to map asset archive: " + FilePath);
+		}
+
+		base = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!base) {
+			unmap();
+			throw std::runtime_error("failed to map asset archive: " + FilePath);
+		}
+#else
+		fileDescriptor = open(FilePath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			throw std::runtime_error("failed to open asset archive: " + FilePath);
+		}
+
+		struct stat fileInfo;
+		if (fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0) {
+			unmap();
+			throw std::runtime_error("failed to read the size of asset archive: " + FilePath);
+		}
+		size = static_cast<size_t>(fileInfo.st_size);
+
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED) {
+			unmap();
+			throw std::runtime_error("failed to map asset archive: " + FilePath);
+		}
+		base = static_cast<const char*>(mapping);
+
+		// Most of the archive is read right at startup, let the kernel read ahead
+		madvise(mapping, size, MADV_WILLNEED);
+#endif
+	}
+
+	void AssetArchive::validate(const std::string& FilePath) {
+		if (size < sizeof(ArchiveHeader)) {
+			throw std::runtime_error(FilePath + " is too small to be an asset archive");
+		}
+
+		header = reinterpret_cast<const ArchiveHeader*>(base);
+		if (memcmp(header->magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0) {
+			throw std::runtime_error(FilePath + " is not an asset archive");
+		}
+		if (header->version != ArchiveVersion) {
+			throw std::runtime_error(FilePath + " was packed with an unsupported archive version");
+		}
+
+		if (header->entriesOffset % alignof(ArchiveEntry) != 0 || header->entriesOffset > size || (size - header->entriesOffset) / sizeof(ArchiveEntry) < header->entryCount ||
+			header->namesOffset > size || size - header->namesOffset < header->namesSize) {
+			throw std::runtime_error(FilePath + " has a corrupt table of contents");
+		}
+
+		entries = reinterpret_cast<const ArchiveEntry*>(base + header->entriesOffset);
+		names = base + header->namesOffset;
+
+		for (uint32_t i = 0; i < header->entryCount; i++) {
+			const ArchiveEntry& entry = entries[i];
+			uint32_t type = static_cast<uint32_t>(entry.type);
+
+			if (type == 0 || type > static_cast<uint32_t>(AssetType::Shader) ||
+				static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header->namesSize ||
+				entry.offset % ArchiveBlobAlignment != 0 || entry.offset > size || size - entry.offset < entry.size) {
+				throw std::runtime_error(FilePath + " has a corrupt table of contents entry");
+			}
+
+			lookup[type].emplace(Name(entry), i);
+		}
+	}
+
+	const ArchiveEntry* AssetArchive::Find(const std::string& name, AssetType type) const {
+		std::string normalized = name;
+		std::replace(normalized.begin(), normalized.end(), '\\', '/');
+
+		const auto& table = lookup[static_cast<uint32_t>(type)];
+		std::string_view remaining = normalized;
+
+		// Exact name first, then drop one leading directory at a time
+		for (;;) {
+			auto found = table.find(remaining);
+			if (found != table.end()) {
+				return &entries[found->second];
+			}
+
+			size_t slash = remaining.find('/');
+			if (slash == std::string_view::npos) {
+				return nullptr;
+			}
+			remaining.remove_prefix(slash + 1);
+		}
+	}
+
+	ArchiveMesh AssetArchive::Mesh(const ArchiveEntry& entry) const {
+		const char* blob = base + entry.offset;
+
+		MeshBlobHeader mesh;
+		if (entry.size < sizeof(mesh)) {
+			throw std::runtime_error("corrupt mesh in asset archive");
+		}
+		memcpy(&mesh, blob, sizeof(mesh));
+
+		if (mesh.vertexStride != sizeof(Model::Vertex)) {
+			throw std::runtime_error("mesh in asset archive was packed with a different vertex layout, repack it");
+		}
+		if (mesh.verticesOffset % alignof(Model::Vertex) != 0 || mesh.indicesOffset % alignof(uint32_t) != 0 || mesh.lodsOffset % alignof(Model::Lod) != 0 || mesh.meshletsOffset % alignof(Model::Meshlet) != 0 ||
+			mesh.verticesOffset > entry.size || (entry.size - mesh.verticesOffset) / sizeof(Model::Vertex) < mesh.vertexCount ||
+			mesh.indicesOffset > entry.size || (entry.size - mesh.indicesOffset) / sizeof(uint32_t) < mesh.indexCount ||
+			mesh.lodsOffset > entry.size || (entry.size - mesh.lodsOffset) / sizeof(Model::Lod) < mesh.lodCount || mesh.lodCount > Model::MaxLods ||
+			mesh.meshletsOffset > entry.size || (entry.size - mesh.meshletsOffset) / sizeof(Model::Meshlet) < mesh.meshletCount ||
+			mesh.textureNameOffset > entry.size || entry.size - mesh.textureNameOffset < mesh.textureNameLength) {
+			throw std::runtime_error("corrupt mesh in asset archive");
+		}
+
+		ArchiveMesh result;
+		result.vertices = reinterpret_cast<const Model::Vertex*>(blob + mesh.verticesOffset);
+		result.vertexCount = mesh.vertexCount;
+		result.indices = reinterpret_cast<const uint32_t*>(blob + mesh.indicesOffset);
+		result.indexCount = mesh.indexCount;
+		result.lods = reinterpret_cast<const Model::Lod*>(blob + mesh.lodsOffset);
+		result.lodCount = mesh.lodCount;
+		result.meshlets = reinterpret_cast<const Model::Meshlet*>(blob + mesh.meshletsOffset);
+		result.meshletCount = mesh.meshletCount;
+		result.textureName = std::string_view(blob + mesh.textureNameOffset, mesh.textureNameLength);
+
+		for (uint32_t i = 0; i < result.lodCount; i++) {
+			if (result.lods[i].firstIndex > result.indexCount || result.indexCount - result.lods[i].firstIndex < result.lods[i].indexCount) {
+				throw std::runtime_error("corrupt mesh LOD in asset archive");
+			}
+		}
+		for (uint32_t i = 0; i < result.meshletCount; i++) {
+			const Model::Meshlet& meshlet = result.meshlets[i];
+			if (meshlet.triangleCount > Model::MaxMeshletTriangles || meshlet.firstIndex > result.indexCount || (result.indexCount - meshlet.firstIndex) / 3 < meshlet.triangleCount) {
+				throw std::runtime_error("corrupt meshlet in asset archive");
+			}
+		}
+		return result;
+	}
+
+	TextureData AssetArchive::Texture(const ArchiveEntry& entry) const {
+		const char* blob = base + entry.offset;
+
+		TextureBlobHeader texture;
+		if (entry.size < sizeof(texture)) {
+			throw std::runtime_error("corrupt texture in asset archive");
+		}
+		memcpy(&texture, blob, sizeof(texture));
+
+		if (texture.levelCount == 0 || texture.levelsOffset > entry.size || (entry.size - texture.levelsOffset) / sizeof(TextureData::Level) < texture.levelCount ||
+			texture.dataOffset > entry.size || entry.size - texture.dataOffset < texture.dataSize) {
+			throw std::runtime_error("corrupt texture in asset archive");
+		}
+
+		TextureData data;
+		data.format = texture.format;
+		data.width = texture.width;
+		data.height = texture.height;
+		data.mipLevels = texture.levelCount;
+		data.levels.resize(texture.levelCount);
+		memcpy(data.levels.data(), blob + texture.levelsOffset, sizeof(TextureData::Level) * texture.levelCount);
+
+		for (const auto& level : data.levels) {
+			if (level.offset > texture.dataSize || texture.dataSize - level.offset < level.size) {
+				throw std::runtime_error("corrupt texture level in asset archive");
+			}
+		}
+
+		data.mappedBytes = reinterpret_cast<const unsigned char*>(blob + texture.dataOffset);
+		data.mappedSize = static_cast<size_t>(texture.dataSize);
+		return data;
+	}
+
+	ArchiveBlob AssetArchive::Shader(const ArchiveEntry& entry) const {
+		if (entry.size % sizeof(uint32_t) != 0) {
+			throw std::runtime_error("corrupt SPIR-V in asset archive");
+		}
+		return { base + entry.offset, static_cast<size_t>(entry.size) };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Model.h"
+#include "TextureData.h"
+
+//std
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		.vkpa packed asset archive, written by Tools/AssetPacker and memory mapped by the engine.
+
+		[ArchiveHeader][blobs...][ArchiveEntry table][name strings]
+
+		Every blob starts on an ArchiveBlobAlignment boundary so vertex, index and SPIR-V data can be
+		used in place. Blobs are already in their GPU ready form (deduplicated meshes, textures with their
+		full mip chain, SPIR-V), loading is a copy from the mapping into staging memory.
+		All offsets are in bytes, from the start of the file for entries and from the start of the blob inside blobs.
+	*/
+	constexpr char ArchiveMagic[4] = { 'V', 'K', 'P', 'A' };
+	constexpr uint32_t ArchiveVersion = 3;
+	constexpr uint64_t ArchiveBlobAlignment = 64;
+
+	enum class AssetType : uint32_t {
+		Mesh = 1,
+		Texture = 2,
+		Shader = 3
+	};
+
+	struct ArchiveHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t namesSize;
+		uint64_t entriesOffset;
+		uint64_t namesOffset;
+	};
+
+	struct ArchiveEntry {
+		AssetType type;
+		uint32_t nameOffset;	// into the name strings
+		uint32_t nameLength;
+		uint32_t reserved;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// Followed by the Model::Vertex array, the uint32_t indices of every LOD, the Model::Lod ranges, the LOD 0 Model::Meshlet array and the texture name
+	struct MeshBlobHeader {
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t vertexStride;	// sizeof(Model::Vertex) at pack time
+		uint32_t textureNameLength;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+		uint64_t lodsOffset;
+		uint64_t meshletsOffset;
+		uint64_t textureNameOffset;
+	};
+
+	// Followed by levelCount TextureData::Level and the level bytes (level offsets are relative to dataOffset)
+	struct TextureBlobHeader {
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint64_t levelsOffset;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+	};
+
+	static_assert(sizeof(ArchiveHeader) == 32 && sizeof(ArchiveEntry) == 32, "archive structures are written as-is");
+	static_assert(sizeof(MeshBlobHeader) == 64 && sizeof(TextureBlobHeader) == 40 && sizeof(TextureData::Level) == 24 && sizeof(Model::Lod) == 12 && sizeof(Model::Meshlet) == 64, "archive structures are written as-is");
+
+	// Points into the mapping, valid as long as the archive is
+	struct ArchiveMesh {
+		const Model::Vertex* vertices;
+		uint32_t vertexCount;
+		const uint32_t* indices;
+		uint32_t indexCount;
+		const Model::Lod* lods;
+		uint32_t lodCount;
+		const Model::Meshlet* meshlets;
+		uint32_t meshletCount;
+		std::string_view textureName;
+	};
+
+	struct ArchiveBlob {
+		const char* data;
+		size_t size;
+	};
+
+	class AssetArchive
+	{
+		public:
+			// Maps the whole file read-only and validates the table of contents, throws std::runtime_error on failure
+			AssetArchive(const std::string& FilePath);
+			~AssetArchive();
+
+			AssetArchive(const AssetArchive&) = delete;
+			AssetArchive& operator=(const AssetArchive&) = delete;
+
+			/*
+				Names are stored relative to the packed root (e.g. "Res/Textures/brick.png"), a lookup with a full path
+				matches the longest stored name it ends with, so the engine's absolute paths find their packed asset.
+			*/
+			const ArchiveEntry* Find(const std::string& name, AssetType type) const;
+
+			ArchiveMesh Mesh(const ArchiveEntry& entry) const;
+			// mappedBytes points into the archive, nothing is copied
+			TextureData Texture(const ArchiveEntry& entry) const;
+			ArchiveBlob Shader(const ArchiveEntry& entry) const;
+
+			std::string_view Name(const ArchiveEntry& entry) const { return std::string_view(names + entry.nameOffset, entry.nameLength); }
+			uint32_t EntryCount() const { return header->entryCount; }
+			const ArchiveEntry& Entry(uint32_t index) const { return entries[index]; }
+
+		private:
+			void map(const std::string& FilePath);
+			void unmap();
+			void validate(const std::string& FilePath);
+
+			const char* base = nullptr;
+			size_t size = 0;
+
+#ifdef _WIN32
+			void* fileHandle = nullptr;
+			void* mappingHandle = nullptr;
+#else
+			int fileDescriptor = -1;
+#endif
+
+			const ArchiveHeader* header = nullptr;
+			const ArchiveEntry* entries = nullptr;
+			const char* names = nullptr;
+
+			// One table per AssetType, names point into the mapping
+			std::unordered_map<std::string_view, uint32_t> lookup[4];
+	};
+}
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include "Bvh.h"
+
+//std
+#include <algorithm>
+#include <numeric>
+
+namespace Engine
+{
+	namespace
+	{
+		using Aabb = Bvh::Aabb;
+
+		// Split candidates per axis, more barely improve the tree and make every build step slower
+		constexpr uint32_t BinCount = 12;
+
+		Aabb emptyAabb() {
+			return { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		}
+
+		void grow(Aabb& bounds, const Aabb& other) {
+			bounds.min = glm::min(bounds.min, other.min);
+			bounds.max = glm::max(bounds.max, other.max);
+		}
+
+		void grow(Aabb& bounds, glm::vec3 point) {
+			bounds.min = glm::min(bounds.min, point);
+			bounds.max = glm::max(bounds.max, point);
+		}
+
+		// Half the surface area, the heuristic only compares them
+		float area(const Aabb& bounds) {
+			glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+			return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+		}
+
+		bool overlaps(const Aabb& a, const Aabb& b) {
+			return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+				a.min.y <= b.max.y && a.max.y >= b.min.y &&
+				a.min.z <= b.max.z && a.max.z >= b.min.z;
+		}
+
+		bool contains(const Aabb& outer, const Aabb& inner) {
+			return outer.min.x <= inner.min.x && outer.max.x >= inner.max.x &&
+				outer.min.y <= inner.min.y && outer.max.y >= inner.max.y &&
+				outer.min.z <= inner.min.z && outer.max.z >= inner.max.z;
+		}
+
+		bool equal(const Aabb& a, const Aabb& b) {
+			return a.min == b.min && a.max == b.max;
+		}
+
+		// Distance the ray enters the box at, FLT_MAX when it misses it before maxDistance
+		float intersect(const Aabb& bounds, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance) {
+			glm::vec3 t0 = (bounds.min - origin) * inverseDirection;
+			glm::vec3 t1 = (bounds.max - origin) * inverseDirection;
+			glm::vec3 closest = glm::min(t0, t1);
+			glm::vec3 farthest = glm::max(t0, t1);
+
+			float enter = std::max(std::max(closest.x, closest.y), std::max(closest.z, 0.0f));
+			float exit = std::min(std::min(farthest.x, farthest.y), std::min(farthest.z, maxDistance));
+			return enter <= exit ? enter : FLT_MAX;
+		}
+
+		enum class Containment {
+			Outside,
+			Intersecting,
+			Inside
+		};
+
+		Containment classify(const glm::vec4 (&planes)[6], const Aabb& bounds) {
+			Containment result = Containment::Inside;
+			for (const glm::vec4& plane : planes) {
+				glm::vec3 normal = glm::vec3(plane);
+				// Corners farthest along and against the plane normal
+				glm::vec3 positive = glm::mix(bounds.min, bounds.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+				glm::vec3 negative = glm::mix(bounds.max, bounds.min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+				if (glm::dot(normal, positive) + plane.w < 0.0f) {
+					return Containment::Outside;
+				}
+				if (glm::dot(normal, negative) + plane.w < 0.0f) {
+					result = Containment::Intersecting;
+				}
+			}
+			return result;
+		}
+	}
+
+	void Bvh::Build(const Aabb* bounds, uint32_t count) {
+		objectBounds.assign(bounds, bounds + count);
+		objectIndices.resize(count);
+		std::iota(objectIndices.begin(), objectIndices.end(), 0u);
+		objectLeaves.assign(count, 0);
+		nodes.clear();
+		parents.clear();
+		builtCost = 0.0f;
+
+		if (count == 0) {
+			return;
+		}
+
+		std::vector<glm::vec3> centroids(count);
+		for (uint32_t i = 0; i < count; i++) {
+			centroids[i] = (bounds[i].min + bounds[i].max) * 0.5f;
+		}
+
+		nodes.reserve(2 * (count / MaxLeafObjects + 1));
+		parents.reserve(nodes.capacity());
+		nodes.push_back({ emptyAabb(), 0, count });
+		parents.push_back(0);
+
+		struct Bin {
+			Aabb bounds;
+			uint32_t count;
+		};
+
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+
+			uint32_t first = nodes[node].first;
+			uint32_t objectCount = nodes[node].count;
+
+			Aabb nodeBounds = emptyAabb();
+			Aabb centroidBounds = emptyAabb();
+			for (uint32_t i = first; i < first + objectCount; i++) {
+				grow(nodeBounds, objectBounds[objectIndices[i]]);
+				grow(centroidBounds, centroids[objectIndices[i]]);
+			}
+			nodes[node].bounds = nodeBounds;
+
+			if (objectCount <= MaxLeafObjects) {
+				for (uint32_t i = first; i < first + objectCount; i++) {
+					objectLeaves[objectIndices[i]] = node;
+				}
+				continue;
+			}
+
+			// Cheapest split over every axis, the cost being what the two halves would cost to test if they were leaves
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			uint32_t bestSplit = 0;
+
+			for (int axis = 0; axis < 3; axis++) {
+				float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+				if (extent <= 0.0f) {
+					continue;
+				}
+				float binScale = BinCount / extent;
+
+				Bin bins[BinCount];
+				for (Bin& bin : bins) {
+					bin = { emptyAabb(), 0 };
+				}
+				for (uint32_t i = first; i < first + objectCount; i++) {
+					uint32_t object = objectIndices[i];
+					uint32_t bin = std::min(static_cast<uint32_t>((centroids[object][axis] - centroidBounds.min[axis]) * binScale), BinCount - 1);
+					bins[bin].count++;
+					grow(bins[bin].bounds, objectBounds[object]);
+				}
+
+				float leftCost[BinCount - 1];
+				Aabb accumulated = emptyAabb();
+				uint32_t accumulatedCount = 0;
+				for (uint32_t bin = 0; bin < BinCount - 1; bin++) {
+					grow(accumulated, bins[bin].bounds);
+					accumulatedCount += bins[bin].count;
+					leftCost[bin] = accumulatedCount ? area(accumulated) * accumulatedCount : -1.0f;
+				}
+
+				accumulated = emptyAabb();
+				accumulatedCount = 0;
+				for (uint32_t bin = BinCount - 1; bin > 0; bin--) {
+					grow(accumulated, bins[bin].bounds);
+					accumulatedCount += bins[bin].count;
+					if (!accumulatedCount || leftCost[bin - 1] < 0.0f) {
+						continue;
+					}
+
+					float splitCost = leftCost[bin - 1] + area(accumulated) * accumulatedCount;
+					if (splitCost < bestCost) {
+						bestCost = splitCost;
+						bestAxis = axis;
+						bestSplit = bin;
+					}
+				}
+			}
+
+			uint32_t middle;
+			if (bestAxis >= 0) {
+				float binScale = BinCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+				auto begin = objectIndices.begin() + first;
+				auto split = std::partition(begin, begin + objectCount, [&](uint32_t object) {
+					uint32_t bin = std::min(static_cast<uint32_t>((centroids[object][bestAxis] - centroidBounds.min[bestAxis]) * binScale), BinCount - 1);
+					return bin < bestSplit;
+				});
+				middle = static_cast<uint32_t>(split - objectIndices.begin());
+			}
+			// Every centroid in the same place, nothing to choose between
+			else {
+				middle = first + objectCount / 2;
+			}
+
+			uint32_t left = static_cast<uint32_t>(nodes.size());
+			nodes.push_back({ emptyAabb(), first, middle - first });
+			nodes.push_back({ emptyAabb(), middle, first + objectCount - middle });
+			parents.push_back(node);
+			parents.push_back(node);
+
+			nodes[node].first = left;
+			nodes[node].count = 0;
+
+			stack.push_back(left + 1);
+			stack.push_back(left);
+		}
+
+		builtCost = cost();
+	}
+
+	void Bvh::Update(uint32_t object, const Aabb& bounds) {
+		objectBounds[object] = bounds;
+
+		uint32_t node = objectLeaves[object];
+		refitLeaf(node);
+
+		// Once a node keeps its bounds the ones above it do too
+		while (node != 0) {
+			node = parents[node];
+			Aabb previous = nodes[node].bounds;
+			refitNode(node);
+			if (equal(previous, nodes[node].bounds)) {
+				break;
+			}
+		}
+	}
+
+	void Bvh::Refit(const Aabb* bounds) {
+		std::copy(bounds, bounds + objectBounds.size(), objectBounds.begin());
+
+		for (uint32_t node = static_cast<uint32_t>(nodes.size()); node-- > 0;) {
+			if (nodes[node].count) {
+				refitLeaf(node);
+			}
+			else {
+				refitNode(node);
+			}
+		}
+	}
+
+	float Bvh::Degradation() const {
+		return builtCost > 0.0f ? cost() / builtCost : 1.0f;
+	}
+
+	float Bvh::cost() const {
+		if (nodes.empty() || area(nodes[0].bounds) <= 0.0f) {
+			return 0.0f;
+		}
+
+		// Expected number of nodes and objects a ray through the root tests
+		float total = 0.0f;
+		for (const Node& node : nodes) {
+			total += area(node.bounds) * (node.count ? node.count : 1);
+		}
+		return total / area(nodes[0].bounds);
+	}
+
+	void Bvh::refitLeaf(uint32_t node) {
+		Aabb bounds = emptyAabb();
+		for (uint32_t i = nodes[node].first; i < nodes[node].first + nodes[node].count; i++) {
+			grow(bounds, objectBounds[objectIndices[i]]);
+		}
+		nodes[node].bounds = bounds;
+	}
+
+	void Bvh::refitNode(uint32_t node) {
+		Aabb bounds = nodes[nodes[node].first].bounds;
+		grow(bounds, nodes[nodes[node].first + 1].bounds);
+		nodes[node].bounds = bounds;
+	}
+
+	void Bvh::appendObjects(uint32_t node, std::vector<uint32_t>& objects) const {
+		std::vector<uint32_t> stack{ node };
+		while (!stack.empty()) {
+			const Node& current = nodes[stack.back()];
+			stack.pop_back();
+
+			if (current.count) {
+				objects.insert(objects.end(), objectIndices.begin() + current.first, objectIndices.begin() + current.first + current.count);
+			}
+			else {
+				stack.push_back(current.first + 1);
+				stack.push_back(current.first);
+			}
+		}
+	}
+
+	void Bvh::QueryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& objects) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		// Gribb-Hartmann, rows of the matrix combined into the six planes facing inwards
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+		const glm::vec4 planes[6] = {
+			rows[3] + rows[0],
+			rows[3] - rows[0],
+			rows[3] + rows[1],
+			rows[3] - rows[1],
+			rows[2],
+			rows[3] - rows[2]
+		};
+
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			uint32_t index = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[index];
+
+			Containment containment = classify(planes, node.bounds);
+			if (containment == Containment::Outside) {
+				continue;
+			}
+			if (containment == Containment::Inside) {
+				appendObjects(index, objects);
+				continue;
+			}
+
+			if (node.count) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					if (classify(planes, objectBounds[objectIndices[i]]) != Containment::Outside) {
+						objects.push_back(objectIndices[i]);
+					}
+				}
+			}
+			else {
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+			}
+		}
+	}
+
+	void Bvh::QueryRange(const Aabb& range, std::vector<uint32_t>& objects) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty()) {
+			uint32_t index = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[index];
+
+			if (!overlaps(range, node.bounds)) {
+				continue;
+			}
+			if (contains(range, node.bounds)) {
+				appendObjects(index, objects);
+				continue;
+			}
+
+			if (node.count) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					if (overlaps(range, objectBounds[objectIndices[i]])) {
+						objects.push_back(objectIndices[i]);
+					}
+				}
+			}
+			else {
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+			}
+		}
+	}
+
+	Bvh::RayHit Bvh::Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+		RayHit hit{ InvalidObject, maxDistance };
+		if (nodes.empty() || glm::dot(direction, direction) <= 0.0f) {
+			return hit;
+		}
+
+		direction = glm::normalize(direction);
+		glm::vec3 inverseDirection = 1.0f / direction;
+
+		struct Entry {
+			uint32_t node;
+			float distance;
+		};
+
+		float rootDistance = intersect(nodes[0].bounds, origin, inverseDirection, maxDistance);
+		if (rootDistance == FLT_MAX) {
+			return hit;
+		}
+
+		std::vector<Entry> stack{ { 0, rootDistance } };
+		while (!stack.empty()) {
+			Entry entry = stack.back();
+			stack.pop_back();
+
+			// Something nearer was hit since the node was pushed
+			if (entry.distance >= hit.distance) {
+				continue;
+			}
+
+			const Node& node = nodes[entry.node];
+			if (node.count) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					float distance = intersect(objectBounds[objectIndices[i]], origin, inverseDirection, hit.distance);
+					if (distance < hit.distance) {
+						hit = { objectIndices[i], distance };
+					}
+				}
+				continue;
+			}
+
+			Entry left{ node.first, intersect(nodes[node.first].bounds, origin, inverseDirection, hit.distance) };
+			Entry right{ node.first + 1, intersect(nodes[node.first + 1].bounds, origin, inverseDirection, hit.distance) };
+			if (left.distance > right.distance) {
+				std::swap(left, right);
+			}
+
+			// Nearer child on top so it is visited first
+			if (right.distance != FLT_MAX) {
+				stack.push_back(right);
+			}
+			if (left.distance != FLT_MAX) {
+				stack.push_back(left);
+			}
+		}
+
+		return hit;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+
+namespace Engine
+{
+	/*
+		Bounding volume hierarchy over object bounds, for the scene queries that would otherwise walk every object:
+		frustum culling, picking with a ray and gathering what overlaps a box.
+
+		Build splits with the surface area heuristic evaluated over a few bins per axis, which is cheap enough to run on
+		a million objects and gives trees close to a full sweep. Objects that move are handled by refitting: the tree
+		keeps its topology and only the node bounds grow or shrink, either up from one object with Update or over the
+		whole tree with Refit. Refitted trees get worse as objects drift away from where they were built, Degradation
+		says by how much so the caller can decide when a rebuild pays off.
+
+		Nodes are stored depth first in one array with the two children of a node next to each other, children always
+		after their parent.
+	*/
+	class Bvh
+	{
+	public:
+		struct Aabb {
+			glm::vec3 min;
+			glm::vec3 max;
+		};
+
+		struct RayHit {
+			uint32_t object;
+			float distance;
+		};
+
+		static constexpr uint32_t InvalidObject = UINT32_MAX;
+		static constexpr uint32_t MaxLeafObjects = 4;
+
+		// Objects are referred to by their index in bounds
+		void Build(const Aabb* bounds, uint32_t count);
+		// One object moved, cheap when only a few of them do
+		void Update(uint32_t object, const Aabb& bounds);
+		// Every object moved, bounds has the count Build was given
+		void Refit(const Aabb* bounds);
+		// SAH cost of the tree relative to right after Build, 1 when nothing moved
+		float Degradation() const;
+
+		// Objects whose bounds intersect the frustum, viewProjection with zero to one depth
+		void QueryFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& objects) const;
+		// Objects whose bounds overlap range
+		void QueryRange(const Aabb& range, std::vector<uint32_t>& objects) const;
+		// Nearest object whose bounds the ray enters before maxDistance, InvalidObject when none, direction doesn't have to be normalized
+		RayHit Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance = FLT_MAX) const;
+
+		uint32_t GetObjectCount() const { return static_cast<uint32_t>(objectBounds.size()); }
+		uint32_t GetNodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+		const Aabb& GetBounds(uint32_t object) const { return objectBounds[object]; }
+
+	private:
+		struct Node {
+			Aabb bounds;
+			// Leaves: first of their objects in objectIndices, other nodes: left child, the right one follows it
+			uint32_t first;
+			// 0 for nodes that aren't leaves
+			uint32_t count;
+		};
+
+		float cost() const;
+		void refitLeaf(uint32_t node);
+		void refitNode(uint32_t node);
+		// Every object below node, for nodes entirely inside a query
+		void appendObjects(uint32_t node, std::vector<uint32_t>& objects) const;
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> objectIndices;
+		std::vector<Aabb> objectBounds;
+		// Leaf each object is in
+		std::vector<uint32_t> objectLeaves;
+
+		float builtCost = 0.0f;
+	};
+}
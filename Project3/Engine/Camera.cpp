@@ -15,15 +15,44 @@ namespace Engine {
 	}
 
 	void Camera::Matrix(uint32_t currentFrame)
+	{
+		CameraUBO ubo = GetMatrices();
+	
+		memcpy(UniformData[currentFrame], &ubo, sizeof(ubo));
+	}
+
+	Camera::CameraUBO Camera::GetMatrices()
 	{
 		CameraUBO ubo{};
-		
+
 		ubo.view = glm::lookAt(Position, Position + Orientation, Up);
-		ubo.proj = glm::perspective(glm::radians(FOV), (float)(width/height), nearPlane, farPlane);;
+		float aspect = GetAspect();
+		if (REVERSE_Z) {
+			// Infinite far plane, depth is nearPlane / distance: 1 at the near plane and 0 at infinity
+			float focal = 1.0f / glm::tan(glm::radians(FOV) / 2.0f);
+			ubo.proj = glm::mat4(0.0f);
+			ubo.proj[0][0] = focal / aspect;
+			ubo.proj[1][1] = focal;
+			ubo.proj[2][3] = -1.0f;
+			ubo.proj[3][2] = nearPlane;
+		}
+		else {
+			ubo.proj = glm::perspective(glm::radians(FOV), aspect, nearPlane, farPlane);
+		}
 
 		ubo.proj[1][1] *= -1;
-	
-		memcpy(UniformData[currentFrame], &ubo, sizeof(ubo));
+
+		return ubo;
+	}
+
+	float Camera::ProjectedSize(glm::vec3 center, float radius)
+	{
+		float distance = glm::length(center - Position);
+		if (distance <= radius) {
+			return static_cast<float>(height);
+		}
+
+		return radius / (distance * std::tan(glm::radians(FOV) * 0.5f)) * height;
 	}
 
 	/*
@@ -87,6 +116,38 @@ namespace Engine {
 			glfwSetCursorPos(window, (width / 2), (height / 2));
 		}
 
+		bool pickDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+		if (pickDown && !pickHeld) {
+			double MouseX;
+			double MouseY;
+			glfwGetCursorPos(window, &MouseX, &MouseY);
+
+			// Vulkan's y points down like the cursor's, the flipped projection already matches them
+			glm::vec2 ndc = glm::vec2(MouseX / width * 2.0 - 1.0, MouseY / height * 2.0 - 1.0);
+
+			CameraUBO matrices = GetMatrices();
+			glm::mat4 inverseViewProjection = glm::inverse(matrices.proj * matrices.view);
+			// Reverse Z has no far plane to unproject, any depth behind the near plane gives the direction
+			glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, REVERSE_Z ? 1.0f : 0.0f, 1.0f);
+			glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 0.5f, 1.0f);
+
+			pickOrigin = glm::vec3(nearPoint) / nearPoint.w;
+			pickDirection = glm::normalize(glm::vec3(farPoint) / farPoint.w - pickOrigin);
+			pickPending = true;
+		}
+		pickHeld = pickDown;
+	}
+
+	bool Camera::ConsumePickRay(glm::vec3& origin, glm::vec3& direction)
+	{
+		if (!pickPending) {
+			return false;
+		}
+
+		origin = pickOrigin;
+		direction = pickDirection;
+		pickPending = false;
+		return true;
 	}
 
 	void Camera::createUniformBuffers()
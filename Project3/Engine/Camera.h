@@ -30,13 +30,33 @@ namespace Engine
 			VkBuffer GetCameraBuffer(uint32_t currentFrame) { return UniformBuffers[currentFrame]; }
 			
 			void Matrix(uint32_t currentFrame);
+			// What Matrix uploads, for culling on the CPU
+			CameraUBO GetMatrices();
 			void Inputs(GLFWwindow* window);
+			// True once per right click, with the world space ray from the camera through the cursor
+			bool ConsumePickRay(glm::vec3& origin, glm::vec3& direction);
+
+			glm::vec3 GetPosition() { return Position; }
+			// Still bounds distances when REVERSE_Z leaves the projection without a far plane
+			float GetFarPlane() { return farPlane; }
+			float GetNearPlane() { return nearPlane; }
+			// Vertical, in degrees
+			float GetFov() { return FOV; }
+			float GetAspect() { return static_cast<float>(width) / static_cast<float>(height); }
+
+			// Approximate height in pixels a sphere covers on screen
+			float ProjectedSize(glm::vec3 center, float radius);
 
 		private:
 
 			bool cursorOn = false;
 			bool firstClick = true;
 
+			bool pickHeld = false;
+			bool pickPending = false;
+			glm::vec3 pickOrigin;
+			glm::vec3 pickDirection;
+
 			glm::vec3 Position;
 			glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
 			glm::vec3 Up = glm::vec3(0.0f, -1.0f, 0.0f);
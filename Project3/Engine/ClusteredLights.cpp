@@ -0,0 +1,207 @@
+#include "ClusteredLights.h"
+
+//std
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+	ClusteredLights::Light ClusteredLights::Light::Point(glm::vec3 position, float range, glm::vec3 color, float intensity) {
+		Light light{};
+		light.position = position;
+		light.range = range;
+		light.color = color;
+		light.intensity = intensity;
+		light.type = PointLight;
+		return light;
+	}
+
+	ClusteredLights::Light ClusteredLights::Light::Spot(glm::vec3 position, glm::vec3 direction, float range, float innerAngle, float outerAngle, glm::vec3 color, float intensity) {
+		Light light = Point(position, range, color, intensity);
+		light.direction = glm::normalize(direction);
+		light.cosOuter = glm::cos(outerAngle);
+		light.cosInner = glm::cos(glm::min(innerAngle, outerAngle));
+		light.type = SpotLight;
+		return light;
+	}
+
+	ClusteredLights::ClusteredLights(Device& device, Camera& Camera, uint32_t capacity) : capacity{ capacity }, device{ device }, camera{ Camera } {
+		createBuffers();
+		createDescriptorSetLayout();
+		createDescriptorSets(Camera);
+		createPipelineLayout();
+		createComputePipeline();
+	}
+
+	ClusteredLights::~ClusteredLights() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), LightBuffers[i], nullptr);
+			vkFreeMemory(device.device(), LightBuffersMemory[i], nullptr);
+			vkDestroyBuffer(device.device(), ClusterBuffers[i], nullptr);
+			vkFreeMemory(device.device(), ClusterBuffersMemory[i], nullptr);
+		}
+
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	}
+
+	uint32_t ClusteredLights::Add(const Light& light) {
+		if (lights.size() >= capacity) {
+			throw std::runtime_error("light buffer is full");
+		}
+
+		lights.push_back(light);
+		version++;
+		return static_cast<uint32_t>(lights.size() - 1);
+	}
+
+	void ClusteredLights::Set(uint32_t id, const Light& light) {
+		if (id >= lights.size()) {
+			throw std::runtime_error("setting a light that doesn't exist");
+		}
+
+		lights[id] = light;
+		version++;
+	}
+
+	void ClusteredLights::createBuffers() {
+		LightBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		LightBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		LightBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+		ClusterBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		ClusterBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		uploadedVersions.resize(MAX_FRAME_IN_FLIGHT, 0);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				LightBuffers[i],
+				GetLightBufferSize(),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				LightBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), LightBuffersMemory[i], 0, GetLightBufferSize(), 0, &LightBuffersMapped[i]);
+
+			// Only ever written by LightCull.comp
+			device.createBuffer(
+				ClusterBuffers[i],
+				GetClusterBufferSize(),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				ClusterBuffersMemory[i]
+			);
+		}
+	}
+
+	void ClusteredLights::createDescriptorSetLayout() {
+		// 0 camera, 1 lights, 2 clusters
+		std::array<VkDescriptorSetLayoutBinding, 3> bindingInfo{};
+		for (uint32_t i = 0; i < bindingInfo.size(); i++) {
+			bindingInfo[i].binding = i;
+			bindingInfo[i].descriptorCount = 1;
+			bindingInfo[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindingInfo[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingInfo[i].pImmutableSamplers = nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create light culling descriptor set layout");
+		}
+	}
+
+	void ClusteredLights::createDescriptorSets(Camera& Camera) {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = device.DescriptorPool();
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate light culling descriptor sets");
+		}
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			std::array<VkDescriptorBufferInfo, 3> bufferInfo{};
+			bufferInfo[0] = { Camera.GetCameraBuffer(static_cast<uint32_t>(i)), 0, sizeof(Camera::CameraUBO) };
+			bufferInfo[1] = { LightBuffers[i], 0, GetLightBufferSize() };
+			bufferInfo[2] = { ClusterBuffers[i], 0, GetClusterBufferSize() };
+
+			std::array<VkWriteDescriptorSet, 3> WriteSet{};
+			for (uint32_t b = 0; b < WriteSet.size(); b++) {
+				WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteSet[b].dstSet = DescriptorSets[i];
+				WriteSet[b].dstBinding = b;
+				WriteSet[b].dstArrayElement = 0;
+				WriteSet[b].descriptorCount = 1;
+				WriteSet[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				WriteSet[b].pBufferInfo = &bufferInfo[b];
+			}
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void ClusteredLights::createPipelineLayout() {
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 0;
+		layoutInfo.pPushConstantRanges = nullptr;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create light culling pipeline layout");
+		}
+	}
+
+	void ClusteredLights::createComputePipeline() {
+		pipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/LightCull.comp.spv",
+			pipelineLayout
+		);
+	}
+
+	void ClusteredLights::Cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, VkExtent2D screen) {
+		/*
+			Slices are spaced exponentially between the near and far plane so froxels stay roughly cubic, the last one
+			reaches on to infinity for REVERSE_Z's projection without a far plane.
+		*/
+		float nearPlane = camera.GetNearPlane();
+		float farPlane = camera.GetFarPlane();
+		float tanHalf = glm::tan(glm::radians(camera.GetFov()) / 2.0f);
+		float logRange = std::log(farPlane / nearPlane);
+
+		Header header{};
+		header.grid = glm::uvec4(GridX, GridY, GridZ, static_cast<uint32_t>(lights.size()));
+		header.projection = glm::vec4(tanHalf * camera.GetAspect(), tanHalf, nearPlane, farPlane);
+		header.slicing = glm::vec4(GridZ / logRange, GridZ * std::log(nearPlane) / logRange, static_cast<float>(screen.width), static_cast<float>(screen.height));
+
+		char* mapped = static_cast<char*>(LightBuffersMapped[currentFrame]);
+		memcpy(mapped, &header, sizeof(header));
+		if (uploadedVersions[currentFrame] != version) {
+			memcpy(mapped + sizeof(Header), lights.data(), sizeof(Light) * lights.size());
+			uploadedVersions[currentFrame] = version;
+		}
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+		// One invocation per cluster, even without lights so every count is written
+		vkCmdDispatch(commandBuffer, (ClusterCount + 63) / 64, 1, 1);
+
+		VkMemoryBarrier culledBarrier{};
+		culledBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		culledBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		culledBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &culledBarrier, 0, nullptr, 0, nullptr);
+	}
+}
\ No newline at end of file
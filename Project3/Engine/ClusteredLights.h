@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Camera.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Clustered forward lighting. The view frustum is split into a GridX * GridY * GridZ grid of froxels, screen tiles
+		with exponential depth slices, and Cull() runs LightCull.comp to list the lights reaching each one. Lighting.glsl
+		finds a fragment's froxel from gl_FragCoord and its depth and only loops over that list, so a fragment's cost follows the
+		lights around it instead of every light in the scene.
+	*/
+	class ClusteredLights
+	{
+	public:
+		enum Type : uint32_t {
+			PointLight = 0,
+			SpotLight = 1
+		};
+
+		// World space, matches the Light struct of LightCull.comp and Lighting.glsl
+		struct Light {
+			glm::vec3 position{ 0.0f };
+			float range = 1.0f;	// the light fades to nothing there, it's what the clusters are tested against
+			glm::vec3 color{ 1.0f };
+			float intensity = 1.0f;
+			glm::vec3 direction{ 0.0f, 0.0f, -1.0f };	// spot lights only
+			float cosOuter = -1.0f;
+			float cosInner = -1.0f;
+			uint32_t type = PointLight;
+			uint32_t padding[2] = {};
+
+			static Light Point(glm::vec3 position, float range, glm::vec3 color, float intensity = 1.0f);
+			// Angles in radians from the direction to the edge of the cone, falling off from inner to outer
+			static Light Spot(glm::vec3 position, glm::vec3 direction, float range, float innerAngle, float outerAngle, glm::vec3 color, float intensity = 1.0f);
+		};
+		static_assert(sizeof(Light) == 64, "Light has to match its std430 layout");
+
+		static constexpr uint32_t GridX = 16;
+		static constexpr uint32_t GridY = 16;
+		static constexpr uint32_t GridZ = 24;
+		static constexpr uint32_t ClusterCount = GridX * GridY * GridZ;
+		// Lights past it are dropped from the cluster, has to match LightCull.comp and Lighting.glsl
+		static constexpr uint32_t MaxLightsPerCluster = 128;
+
+		ClusteredLights(Device& device, Camera& Camera, uint32_t capacity = 4096);
+		~ClusteredLights();
+
+		ClusteredLights(const ClusteredLights&) = delete;
+		ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+		uint32_t Add(const Light& light);
+		void Set(uint32_t id, const Light& light);
+		const Light& Get(uint32_t id) const { return lights[id]; }
+		uint32_t GetCount() const { return static_cast<uint32_t>(lights.size()); }
+
+		// Outside of a render pass, before anything shades with currentFrame's clusters
+		void Cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, VkExtent2D screen);
+
+		VkBuffer GetLightBuffer(uint32_t currentFrame) { return LightBuffers[currentFrame]; }
+		VkDeviceSize GetLightBufferSize() const { return sizeof(Header) + sizeof(Light) * capacity; }
+		VkBuffer GetClusterBuffer(uint32_t currentFrame) { return ClusterBuffers[currentFrame]; }
+		static VkDeviceSize GetClusterBufferSize() { return sizeof(uint32_t) * ClusterCount * (1 + MaxLightsPerCluster); }
+
+	private:
+		// Start of the light buffer, the lights follow it
+		struct Header {
+			glm::uvec4 grid;		// cluster counts, then the light count
+			glm::vec4 projection;	// view space half extents at a depth of 1, then the near and far plane the slices span
+			glm::vec4 slicing;		// slice = log(depth) * x - y, then the screen size
+		};
+		static_assert(sizeof(Header) == 48, "Header has to match its std430 layout");
+
+		void createBuffers();
+		void createDescriptorSetLayout();
+		void createDescriptorSets(Camera& Camera);
+		void createPipelineLayout();
+		void createComputePipeline();
+
+		uint32_t capacity;
+		std::vector<Light> lights;
+		// Goes up with every change, each frame's buffer remembers the one it holds
+		uint32_t version = 1;
+		std::vector<uint32_t> uploadedVersions;
+
+		// Host visible and written every frame, the header follows the camera
+		std::vector<VkBuffer> LightBuffers;
+		std::vector<VkDeviceMemory> LightBuffersMemory;
+		std::vector<void*> LightBuffersMapped;
+		// Light count of every cluster, then MaxLightsPerCluster indices per cluster
+		std::vector<VkBuffer> ClusterBuffers;
+		std::vector<VkDeviceMemory> ClusterBuffersMemory;
+
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+
+		Device& device;
+		Camera& camera;
+		std::unique_ptr<CPipeline> pipeline;
+	};
+}
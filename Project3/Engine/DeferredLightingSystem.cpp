@@ -0,0 +1,198 @@
+#include "DeferredLightingSystem.h"
+
+//std
+#include <array>
+
+namespace Engine {
+	namespace {
+		// Albedo, normal and depth, at the bindings after the camera's
+		constexpr uint32_t InputAttachmentCount = 3;
+	}
+
+	DeferredLightingSystem::DeferredLightingSystem(Device& device, Camera& Camera, ClusteredLights& lights, ShadowRenderSystem& shadows, VkRenderPass deferredRenderPass)
+		: device{ device }, camera{ Camera }, lights{ lights }, shadows{ shadows } {
+		createDescriptorPool();
+		createDescriptorSetLayout();
+		createDescriptorSets();
+		createPipelineLayout();
+		createGraphicsPipeline(deferredRenderPass);
+	}
+
+	DeferredLightingSystem::~DeferredLightingSystem() {
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device.device(), DescriptorPool, nullptr);
+	}
+
+	void DeferredLightingSystem::createDescriptorPool() {
+		// The device's pool has no input attachments
+		std::array<VkDescriptorPoolSize, 4> PoolSize{};
+		PoolSize[0] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * MAX_FRAME_IN_FLIGHT };
+		PoolSize[1] = { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, InputAttachmentCount * MAX_FRAME_IN_FLIGHT };
+		PoolSize[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * MAX_FRAME_IN_FLIGHT };
+		PoolSize[3] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAME_IN_FLIGHT };
+
+		VkDescriptorPoolCreateInfo PoolInfo{};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		PoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSize.size());
+		PoolInfo.pPoolSizes = PoolSize.data();
+		PoolInfo.maxSets = MAX_FRAME_IN_FLIGHT;
+
+		if (vkCreateDescriptorPool(device.device(), &PoolInfo, nullptr, &DescriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create deferred lighting descriptor pool");
+		}
+	}
+
+	void DeferredLightingSystem::createDescriptorSetLayout() {
+		// Bindings 5 to 8 are the ones Lighting.glsl declares, SimpleRenderereSystem has them at the same numbers
+		std::array<VkDescriptorSetLayoutBinding, 8> bindingInfo{};
+		bindingInfo[0] = { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[1] = { 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[2] = { 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[3] = { 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[4] = { 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[5] = { 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[6] = { 7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindingInfo[7] = { 8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create deferred lighting descriptor set layout");
+		}
+	}
+
+	void DeferredLightingSystem::createDescriptorSets() {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = DescriptorPool;
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate deferred lighting descriptor sets");
+		}
+
+		// The input attachments are written by Render, once the swapchain's G-buffer is known
+		GBufferVersions.resize(MAX_FRAME_IN_FLIGHT, 0);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			uint32_t frame = static_cast<uint32_t>(i);
+
+			std::array<VkDescriptorBufferInfo, 4> bufferInfo{};
+			bufferInfo[0] = { camera.GetCameraBuffer(frame), 0, sizeof(Camera::CameraUBO) };
+			bufferInfo[1] = { lights.GetLightBuffer(frame), 0, lights.GetLightBufferSize() };
+			bufferInfo[2] = { lights.GetClusterBuffer(frame), 0, ClusteredLights::GetClusterBufferSize() };
+			bufferInfo[3] = { shadows.GetShadowBuffer(frame), 0, shadows.GetShadowBufferSize() };
+
+			VkDescriptorImageInfo shadowMapInfo{};
+			shadowMapInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			shadowMapInfo.imageView = shadows.GetShadowMapView();
+			shadowMapInfo.sampler = shadows.GetShadowSampler();
+
+			const uint32_t bindings[4] = { 0, 5, 6, 7 };
+			std::array<VkWriteDescriptorSet, 5> WriteSet{};
+			for (uint32_t b = 0; b < WriteSet.size(); b++) {
+				WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteSet[b].dstSet = DescriptorSets[i];
+				WriteSet[b].dstArrayElement = 0;
+				WriteSet[b].descriptorCount = 1;
+			}
+			for (uint32_t b = 0; b < 4; b++) {
+				WriteSet[b].dstBinding = bindings[b];
+				WriteSet[b].descriptorType = bindings[b] == 5 || bindings[b] == 6 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				WriteSet[b].pBufferInfo = &bufferInfo[b];
+			}
+			WriteSet[4].dstBinding = 8;
+			WriteSet[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			WriteSet[4].pImageInfo = &shadowMapInfo;
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void DeferredLightingSystem::updateInputAttachments(uint32_t currentFrame, const GBuffer& gbuffer) {
+		// The frame's fence was waited on in StartFrame so its descriptor set isn't in use anymore
+		std::array<VkDescriptorImageInfo, InputAttachmentCount> imageInfo{};
+		imageInfo[0] = { VK_NULL_HANDLE, gbuffer.albedo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfo[1] = { VK_NULL_HANDLE, gbuffer.normal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		imageInfo[2] = { VK_NULL_HANDLE, gbuffer.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+		std::array<VkWriteDescriptorSet, InputAttachmentCount> WriteSet{};
+		for (uint32_t b = 0; b < WriteSet.size(); b++) {
+			WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[b].dstSet = DescriptorSets[currentFrame];
+			WriteSet[b].dstBinding = b + 1;
+			WriteSet[b].dstArrayElement = 0;
+			WriteSet[b].descriptorCount = 1;
+			WriteSet[b].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			WriteSet[b].pImageInfo = &imageInfo[b];
+		}
+
+		vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		GBufferVersions[currentFrame] = gbuffer.version;
+	}
+
+	void DeferredLightingSystem::createPipelineLayout() {
+		VkPushConstantRange pushRange{};
+		pushRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushRange.offset = 0;
+		pushRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &pushRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create deferred lighting pipeline layout");
+		}
+	}
+
+	void DeferredLightingSystem::createGraphicsPipeline(VkRenderPass deferredRenderPass) {
+		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
+		fixedFunctions.layout = pipelineLayout;
+		fixedFunctions.renderPass = deferredRenderPass;
+		fixedFunctions.subpass = 1;
+		// The triangle comes from gl_VertexIndex alone
+		fixedFunctions.vertexInput = VertexInputMode::VertexPulling;
+		fixedFunctions.Rasterization.cullMode = VK_CULL_MODE_NONE;
+		// The triangle lies at the clear depth, it only passes where subpass 0 drew something nearer
+		fixedFunctions.DepthStencil.depthWriteEnable = VK_FALSE;
+		fixedFunctions.DepthStencil.depthCompareOp = REVERSE_Z ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_GREATER;
+
+		// constant_id 0 tells DeferredLighting.vert where the clear depth is
+		VkBool32 reverseZ = REVERSE_Z;
+		VkSpecializationMapEntry reverseZEntry{ 0, 0, sizeof(VkBool32) };
+		VkSpecializationInfo specialization{ 1, &reverseZEntry, sizeof(VkBool32), &reverseZ };
+		fixedFunctions.specialization = &specialization;
+
+		pipeline = std::make_unique<GPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/DeferredLighting.vert.spv",
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/DeferredLighting.frag.spv",
+			fixedFunctions
+		);
+	}
+
+	void DeferredLightingSystem::Render(VkCommandBuffer commandBuffer, uint32_t currentFrame, const GBuffer& gbuffer, VkExtent2D screen) {
+		if (GBufferVersions[currentFrame] != gbuffer.version) {
+			updateInputAttachments(currentFrame, gbuffer);
+		}
+
+		PushConstants push{};
+		push.screenSize = glm::vec2(static_cast<float>(screen.width), static_cast<float>(screen.height));
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &push);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Camera.h"
+#include "SwapChain.h"
+#include "ClusteredLights.h"
+#include "ShadowRenderSystem.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Lighting subpass of SwapChain::deferredRenderPass(). A fullscreen triangle reads the G-buffer SimpleRenderereSystem
+		drew in subpass 0 through input attachments, puts each pixel back in the world from its depth and the camera's
+		matrices, and shades it with the sun and the clustered lights of Lighting.glsl, the same ones Triangle.frag uses.
+		The triangle lies at the depth's clear value, so only pixels something was drawn on pass the depth test.
+	*/
+	class DeferredLightingSystem
+	{
+	public:
+		struct PushConstants {
+			glm::vec2 screenSize;
+		};
+
+		DeferredLightingSystem(Device& device, Camera& Camera, ClusteredLights& lights, ShadowRenderSystem& shadows, VkRenderPass deferredRenderPass);
+		~DeferredLightingSystem();
+
+		DeferredLightingSystem(const DeferredLightingSystem&) = delete;
+		DeferredLightingSystem& operator=(const DeferredLightingSystem&) = delete;
+
+		// After Renderer::NextSubpass, gbuffer is Renderer::GetGBuffer() of the frame
+		void Render(VkCommandBuffer commandBuffer, uint32_t currentFrame, const GBuffer& gbuffer, VkExtent2D screen);
+
+	private:
+		void createDescriptorPool();
+		void createDescriptorSetLayout();
+		void createDescriptorSets();
+		void createPipelineLayout();
+		void createGraphicsPipeline(VkRenderPass deferredRenderPass);
+		// Points the frame's set at the G-buffer of the current swapchain
+		void updateInputAttachments(uint32_t currentFrame, const GBuffer& gbuffer);
+
+		VkDescriptorPool DescriptorPool;
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+		// GBuffer::version each frame's set was written with, 0 before the first one
+		std::vector<uint32_t> GBufferVersions;
+
+		Device& device;
+		Camera& camera;
+		ClusteredLights& lights;
+		ShadowRenderSystem& shadows;
+		std::unique_ptr<GPipeline> pipeline;
+	};
+}
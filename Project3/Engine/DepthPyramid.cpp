@@ -0,0 +1,278 @@
+#include "DepthPyramid.h"
+
+//std
+#include <array>
+
+namespace Engine {
+	namespace {
+		uint32_t NextVersion = 1;
+	}
+
+	DepthPyramid::DepthPyramid(Device& device, SwapChain& swapchain) : extent{ swapchain.Extent() }, version{ NextVersion++ }, device{ device }, swapchain{ swapchain } {
+		assert(swapchain.resumeRenderPass() != VK_NULL_HANDLE && "the depth pyramid needs a swapchain that keeps its depth");
+
+		createImage();
+		createSampler();
+		createDescriptors();
+		createPipeline();
+	}
+
+	DepthPyramid::~DepthPyramid() {
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device.device(), DescriptorPool, nullptr);
+
+		vkDestroySampler(device.device(), Sampler, nullptr);
+		for (VkImageView view : LevelViews) {
+			vkDestroyImageView(device.device(), view, nullptr);
+		}
+		vkDestroyImageView(device.device(), ImageView, nullptr);
+		vkDestroyImage(device.device(), Image, nullptr);
+		vkFreeMemory(device.device(), ImageMemory, nullptr);
+	}
+
+	void DepthPyramid::createImage() {
+		VkExtent2D level = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+		while (true) {
+			LevelExtents.push_back(level);
+			if (level.width == 1 && level.height == 1) {
+				break;
+			}
+			level = { (level.width + 1) / 2, (level.height + 1) / 2 };
+		}
+		const uint32_t levelCount = static_cast<uint32_t>(LevelExtents.size());
+
+		device.createImage(
+			Image,
+			LevelExtents[0],
+			levelCount,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_R32_SFLOAT,
+			0,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			ImageMemory
+		);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = levelCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device.device(), &viewInfo, nullptr, &ImageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid image view");
+		}
+
+		// Storage image views can only have one level
+		LevelViews.resize(levelCount);
+		for (uint32_t i = 0; i < levelCount; i++) {
+			viewInfo.subresourceRange.baseMipLevel = i;
+			viewInfo.subresourceRange.levelCount = 1;
+			if (vkCreateImageView(device.device(), &viewInfo, nullptr, &LevelViews[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create depth pyramid level view");
+			}
+		}
+
+		VkCommandBuffer commandBuffer = device.StartOneTimeCommand();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = Image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		device.EndOneTimeCommand(commandBuffer);
+	}
+
+	void DepthPyramid::createSampler() {
+		// Only ever read with texelFetch, which ignores filtering
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		samplerInfo.compareEnable = VK_FALSE;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = static_cast<float>(GetLevelCount());
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+		if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &Sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid sampler");
+		}
+	}
+
+	void DepthPyramid::createDescriptors() {
+		const uint32_t levelCount = GetLevelCount();
+
+		// A set per level, the pyramid is remade with the swapchain so it gets a pool of its own instead of the device's
+		std::array<VkDescriptorPoolSize, 2> PoolSize{};
+		PoolSize[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		PoolSize[0].descriptorCount = levelCount;
+		PoolSize[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		PoolSize[1].descriptorCount = levelCount * 2;
+
+		VkDescriptorPoolCreateInfo PoolInfo{};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		PoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSize.size());
+		PoolInfo.pPoolSizes = PoolSize.data();
+		PoolInfo.maxSets = levelCount;
+
+		if (vkCreateDescriptorPool(device.device(), &PoolInfo, nullptr, &DescriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid descriptor pool");
+		}
+
+		// 0 depth attachment, 1 previous level, 2 level written
+		std::array<VkDescriptorSetLayoutBinding, 3> bindingInfo{};
+		for (uint32_t i = 0; i < bindingInfo.size(); i++) {
+			bindingInfo[i].binding = i;
+			bindingInfo[i].descriptorCount = 1;
+			bindingInfo[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			bindingInfo[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingInfo[i].pImmutableSamplers = nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid descriptor set layout");
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(levelCount, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = levelCount;
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = DescriptorPool;
+
+		DescriptorSets.resize(levelCount);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate depth pyramid descriptor sets");
+		}
+
+		for (uint32_t i = 0; i < levelCount; i++) {
+			std::array<VkDescriptorImageInfo, 3> imageInfo{};
+			imageInfo[0] = { Sampler, swapchain.GetDepthImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+			// Level 0 never reads binding 1, it still needs something valid there
+			imageInfo[1] = { VK_NULL_HANDLE, LevelViews[i == 0 ? 0 : i - 1], VK_IMAGE_LAYOUT_GENERAL };
+			imageInfo[2] = { VK_NULL_HANDLE, LevelViews[i], VK_IMAGE_LAYOUT_GENERAL };
+
+			std::array<VkWriteDescriptorSet, 3> WriteSet{};
+			for (uint32_t b = 0; b < WriteSet.size(); b++) {
+				WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteSet[b].dstSet = DescriptorSets[i];
+				WriteSet[b].dstBinding = b;
+				WriteSet[b].dstArrayElement = 0;
+				WriteSet[b].descriptorCount = 1;
+				WriteSet[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				WriteSet[b].pImageInfo = &imageInfo[b];
+			}
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void DepthPyramid::createPipeline() {
+		VkPushConstantRange paramsRange{};
+		paramsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		paramsRange.offset = 0;
+		paramsRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &paramsRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create depth pyramid pipeline layout");
+		}
+
+		// constant_id 0 picks which way depth goes
+		VkBool32 reverseZ = REVERSE_Z;
+		VkSpecializationMapEntry reverseZEntry{ 0, 0, sizeof(VkBool32) };
+		VkSpecializationInfo specialization{ 1, &reverseZEntry, sizeof(VkBool32), &reverseZ };
+
+		pipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/DepthPyramid.comp.spv",
+			pipelineLayout,
+			&specialization
+		);
+	}
+
+	void DepthPyramid::Build(VkCommandBuffer commandBuffer) {
+		VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (device.isStencilTestSupported(swapchain.GetDepthFormat())) {
+			depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		/*
+			Depth writes of the render pass before reads here, and the previous frame's occlusion tests read the
+			pyramid before it is overwritten, which the compute source stage takes care of
+		*/
+		VkImageMemoryBarrier depthBarrier{};
+		depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		depthBarrier.image = swapchain.GetDepthImage();
+		depthBarrier.subresourceRange = { depthAspect, 0, 1, 0, 1 };
+		depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &depthBarrier
+		);
+
+		pipeline->bind(commandBuffer);
+
+		VkImageMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.image = Image;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkExtent2D source = extent;
+		for (uint32_t i = 0; i < GetLevelCount(); i++) {
+			PushConstants params{ { static_cast<int32_t>(source.width), static_cast<int32_t>(source.height) }, i == 0 ? 1u : 0u };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &DescriptorSets[i], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+			vkCmdDispatch(commandBuffer, (LevelExtents[i].width + 7) / 8, (LevelExtents[i].height + 7) / 8, 1);
+
+			// The next level reads this one, the last one is read by the occlusion tests
+			levelBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+			source = LevelExtents[i];
+		}
+	}
+}
\ No newline at end of file
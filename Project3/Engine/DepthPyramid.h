@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "SwapChain.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Hierarchical-Z of the swapchain's depth attachment, built by DepthPyramid.comp. Level 0 is half the framebuffer
+		rounded up and every level halves again down to 1x1, each texel keeping the farthest depth of the 2x2 texels it
+		covers. Sizes round up, so texel i of level n covers exactly pixels [i * 2^(n+1), (i+1) * 2^(n+1)) of the framebuffer.
+		The image stays in VK_IMAGE_LAYOUT_GENERAL, it's written as storage and read with texelFetch.
+	*/
+	class DepthPyramid
+	{
+	public:
+		struct PushConstants {
+			int32_t sourceSize[2];
+			uint32_t fromDepth;	// level 0 reads the depth attachment instead of the previous level
+		};
+
+		// Needs a swapchain made with keepDepth
+		DepthPyramid(Device& device, SwapChain& swapchain);
+		~DepthPyramid();
+
+		DepthPyramid(const DepthPyramid&) = delete;
+		DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+		/*
+			Outside of a render pass, after the pass that wrote the depth. Leaves the depth attachment in
+			DEPTH_STENCIL_READ_ONLY_OPTIMAL, which is what SwapChain::resumeRenderPass() starts from.
+		*/
+		void Build(VkCommandBuffer commandBuffer);
+
+		VkImageView GetImageView() { return ImageView; }
+		VkSampler GetSampler() { return Sampler; }
+		VkExtent2D GetExtent() { return extent; }
+		uint32_t GetLevelCount() { return static_cast<uint32_t>(LevelViews.size()); }
+		// Different for every pyramid ever made, descriptor sets compare it to know when to be rewritten
+		uint32_t GetVersion() { return version; }
+
+	private:
+		void createImage();
+		void createSampler();
+		void createDescriptors();
+		void createPipeline();
+
+		VkImage Image;
+		VkDeviceMemory ImageMemory;
+		VkImageView ImageView;
+		std::vector<VkImageView> LevelViews;
+		std::vector<VkExtent2D> LevelExtents;
+		VkSampler Sampler;
+
+		VkDescriptorPool DescriptorPool;
+		VkDescriptorSetLayout DescriptorSetLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<CPipeline> pipeline;
+
+		// Framebuffer size
+		VkExtent2D extent;
+		uint32_t version;
+
+		Device& device;
+		SwapChain& swapchain;
+	};
+}
\ No newline at end of file
@@ -14,6 +14,9 @@ namespace Engine {
 	Device::~Device() {
 		vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
 		vkDestroyCommandPool(_device, _commandPool, nullptr);
+		if (_computeCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(_device, _computeCommandPool, nullptr);
+		}
 
 		vkDestroyDevice(_device, nullptr);
 
@@ -221,6 +224,13 @@ namespace Engine {
 		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamiliesCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, queueFamilies.data());
 
+		for (uint32_t family = 0; family < queueFamiliesCount; family++) {
+			if ((queueFamilies[family].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				indices.computeQueue = family;
+				break;
+			}
+		}
+
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies) {
 			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
@@ -249,6 +259,9 @@ namespace Engine {
 		float Priority = 1.0f;
 		std::vector <VkDeviceQueueCreateInfo> DeviceQueuesInfo;
 		std::set<uint32_t> DeviceQueuesValues = { indices.graphicsQueue.value(), indices.presentQueue.value() };
+		if (indices.computeQueue.has_value()) {
+			DeviceQueuesValues.insert(indices.computeQueue.value());
+		}
 
 		for (uint32_t queueValue : DeviceQueuesValues)
 		{
@@ -260,8 +273,18 @@ namespace Engine {
 			DeviceQueuesInfo.push_back(queueInfos);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(PhysicalDevice, &supportedFeatures);
+
 		VkPhysicalDeviceFeatures features{};
 		features.samplerAnisotropy = VK_TRUE;
+		// Block compressed textures (KTX2), whichever families the GPU has
+		features.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		features.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+		features.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+		// Post processing writes the swapchain image from compute
+		features.shaderStorageImageWriteWithoutFormat = supportedFeatures.shaderStorageImageWriteWithoutFormat;
+		enabledFeatures = features;
 
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -287,6 +310,13 @@ namespace Engine {
 
 		vkGetDeviceQueue(_device, indices.graphicsQueue.value(), 0, &_GraphicsQueue);
 		vkGetDeviceQueue(_device, indices.presentQueue.value(), 0, &_PresentQueue);
+		asyncCompute = indices.computeQueue.has_value();
+		if (asyncCompute) {
+			vkGetDeviceQueue(_device, indices.computeQueue.value(), 0, &_ComputeQueue);
+		}
+		else {
+			_ComputeQueue = _GraphicsQueue;
+		}
 
 		std::cout << "Device has been created\n" << std::endl;
 	}
@@ -341,6 +371,13 @@ namespace Engine {
 		if (vkCreateCommandPool(_device, &PoolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create the command pool");
 		}
+
+		if (asyncCompute) {
+			PoolInfo.queueFamilyIndex = indices.computeQueue.value();
+			if (vkCreateCommandPool(_device, &PoolInfo, nullptr, &_computeCommandPool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create the compute command pool");
+			}
+		}
 	}
 
 	void Device::createBuffer(
@@ -389,18 +426,36 @@ namespace Engine {
 		throw std::runtime_error("failed to find suitable memory type");
 	}
 
+	bool Device::hasMemType(uint32_t TypeFilter, VkMemoryPropertyFlags properties) {
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((TypeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	void Device::createDescriptorPool() {
-		std::array<VkDescriptorPoolSize, 2> PoolSize{};
-		PoolSize[0].descriptorCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		const uint32_t SetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT * MAX_RENDER_SYSTEMS);
+
+		std::array<VkDescriptorPoolSize, 3> PoolSize{};
+		PoolSize[0].descriptorCount = SetCount;
 		PoolSize[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		PoolSize[1].descriptorCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		PoolSize[1].descriptorCount = SetCount;
 		PoolSize[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		// Compute passes bind several storage buffers per set (cluster culling uses four)
+		PoolSize[2].descriptorCount = SetCount * 4;
+		PoolSize[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 
 		VkDescriptorPoolCreateInfo PoolInfo{};
 		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		PoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSize.size());
 		PoolInfo.pPoolSizes = PoolSize.data();
-		PoolInfo.maxSets = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		PoolInfo.maxSets = SetCount;
 
 		if (vkCreateDescriptorPool(_device, &PoolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create descriptor pool");
@@ -411,25 +466,30 @@ namespace Engine {
 	void Device::createImage(
 		VkImage& Image,
 		VkExtent2D TexExtent,
+		uint32_t MipLevels,
 		VkImageTiling ImageTiling,
 		VkFormat ColorFormat,
 		VkDeviceSize ImageSize,
 		VkImageUsageFlags Usage,
 		VkMemoryPropertyFlags properties,
-		VkDeviceMemory& ImageMemory
+		VkDeviceMemory& ImageMemory,
+		uint32_t ArrayLayers,
+		const std::vector<uint32_t>& QueueFamilies
 	) {
 		VkImageCreateInfo ImageInfo{};
 		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		ImageInfo.extent.width = TexExtent.width;
 		ImageInfo.extent.height = TexExtent.height;
 		ImageInfo.extent.depth = 1;
-		ImageInfo.mipLevels = 1;
-		ImageInfo.arrayLayers = 1;
+		ImageInfo.mipLevels = MipLevels;
+		ImageInfo.arrayLayers = ArrayLayers;
 
 		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		ImageInfo.format = ColorFormat;
 		ImageInfo.imageType = VK_IMAGE_TYPE_2D;
-		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.sharingMode = QueueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.queueFamilyIndexCount = QueueFamilies.size() > 1 ? static_cast<uint32_t>(QueueFamilies.size()) : 0;
+		ImageInfo.pQueueFamilyIndices = QueueFamilies.size() > 1 ? QueueFamilies.data() : nullptr;
 		ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		ImageInfo.usage = Usage;
 		ImageInfo.tiling = ImageTiling;
@@ -444,6 +504,10 @@ namespace Engine {
 		VkMemoryAllocateInfo AllocInfo{};
 		AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		AllocInfo.allocationSize = memRequirements.size;
+		// Lazily allocated memory only exists on tiled GPUs, elsewhere transient attachments get ordinary device memory
+		if ((properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && !hasMemType(memRequirements.memoryTypeBits, properties)) {
+			properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		}
 		AllocInfo.memoryTypeIndex = findMemType(memRequirements.memoryTypeBits, properties);
 
 		if (vkAllocateMemory(_device, &AllocInfo, nullptr, &ImageMemory) != VK_SUCCESS) {
@@ -468,4 +532,43 @@ namespace Engine {
 
 		throw std::runtime_error("failed to find supported depth format");
 	}
+
+	VkCommandBuffer Device::StartOneTimeCommand() {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.commandPool = _commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate command buffer");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recordin the one time command buffer");
+		}
+
+		return commandBuffer;
+	}
+
+	void Device::EndOneTimeCommand(VkCommandBuffer& CommandBuffer) {
+		if (vkEndCommandBuffer(CommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to end recordin the one time command buffer");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &CommandBuffer;
+
+		vkQueueSubmit(_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(_GraphicsQueue);
+
+		vkFreeCommandBuffers(_device, _commandPool, 1, &CommandBuffer);
+	}
 }
\ No newline at end of file
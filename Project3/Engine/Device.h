@@ -14,6 +14,13 @@
 namespace Engine
 {
 	const int MAX_FRAME_IN_FLIGHT = 2;
+	// Every render system allocates one descriptor set per frame in flight from the shared pool
+	const int MAX_RENDER_SYSTEMS = 8;
+	/*
+		Depth 1 at the near plane going to 0 at an infinitely far one, compared with GREATER into a float depth buffer.
+		Float precision is densest near 0, which reverse Z spends on the distance instead of on what is close.
+	*/
+	const bool REVERSE_Z = true;
 
 	#define DEBUG
 	#ifdef  DEBUG
@@ -33,6 +40,8 @@ namespace Engine
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicsQueue;
 		std::optional<uint32_t> presentQueue;
+		// A family that computes but doesn't draw, its queue runs beside the graphics one. Not needed to pick a device
+		std::optional<uint32_t> computeQueue;
 
 		bool isComplete() {
 			return graphicsQueue.has_value() && presentQueue.has_value();
@@ -66,7 +75,16 @@ namespace Engine
 
 			VkQueue GraphicsQueue() { return _GraphicsQueue; }
 			VkQueue PresentQueue() { return _PresentQueue; }
+			// Without a compute only family these are the graphics queue and pool
+			bool HasAsyncCompute() { return asyncCompute; }
+			VkQueue ComputeQueue() { return _ComputeQueue; }
+			VkCommandPool ComputeCommandPool() { return asyncCompute ? _computeCommandPool : _commandPool; }
+			// Storage images without a format in the shader, the only way to write a swapchain image of any format
+			bool SupportsStorageWriteWithoutFormat() { return enabledFeatures.shaderStorageImageWriteWithoutFormat == VK_TRUE; }
 			float GetMaxAntisotropy() { return deviceProperites.limits.maxSamplerAnisotropy; }
+			// Every graphics and compute queue can write timestamps, GetTimestampPeriod() nanoseconds apart
+			bool SupportsTimestamps() { return deviceProperites.limits.timestampComputeAndGraphics == VK_TRUE; }
+			float GetTimestampPeriod() { return deviceProperites.limits.timestampPeriod; }
 
 			void createBuffer(
 				VkBuffer& VertexBuffer,
@@ -76,25 +94,44 @@ namespace Engine
 				VkDeviceMemory& VertexBufferMemory
 			);
 
+			// Records into a fresh command buffer, End submits it and waits for the graphics queue to go idle
+			VkCommandBuffer StartOneTimeCommand();
+			void EndOneTimeCommand(VkCommandBuffer& CommandBuffer);
+
 			void createImage(
 				VkImage& Image,
 				VkExtent2D TexExtent,
+				uint32_t MipLevels,
 				VkImageTiling ImageTiling,
 				VkFormat ColorFormat,
 				VkDeviceSize ImageSize,
 				VkImageUsageFlags Usage,
 				VkMemoryPropertyFlags properties,
-				VkDeviceMemory& ImageMemory
+				VkDeviceMemory& ImageMemory,
+				uint32_t ArrayLayers = 1,
+				// Shared concurrently when more than one queue family uses it
+				const std::vector<uint32_t>& QueueFamilies = {}
 			);
 
 			VkFormat findDepthFormat() {
+				// A fixed point format would throw away what reverse Z gains
 				return findSupportedDepthFormats(
-					{VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+					REVERSE_Z ? std::vector<VkFormat>{VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT} : std::vector<VkFormat>{VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
 					VK_IMAGE_TILING_OPTIMAL,
 					VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
 				);
 			}
 
+			VkFormatProperties GetFormatProperties(VkFormat format) {
+				VkFormatProperties Prop;
+				vkGetPhysicalDeviceFormatProperties(PhysicalDevice, format, &Prop);
+				return Prop;
+			}
+
+			bool isSampledFormatSupported(VkFormat format) {
+				return (GetFormatProperties(format).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+			}
+
 			bool isStencilTestSupported(VkFormat format) {
 				return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 			}
@@ -127,6 +164,7 @@ namespace Engine
 			SwapChainSupportDetails findSwapchainDetails(VkPhysicalDevice device);
 
 			uint32_t findMemType(uint32_t TypeFilter, VkMemoryPropertyFlags properties);
+			bool hasMemType(uint32_t TypeFilter, VkMemoryPropertyFlags properties);
 
 			VkFormat findSupportedDepthFormats(const std::vector<VkFormat> candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -134,14 +172,18 @@ namespace Engine
 			VkDebugUtilsMessengerEXT debugMessenger;
 			VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
 			VkPhysicalDeviceProperties deviceProperites;
+			VkPhysicalDeviceFeatures enabledFeatures{};
 			VkDevice _device;
 
 			VkDescriptorPool _descriptorPool;
 			VkCommandPool _commandPool;
+			VkCommandPool _computeCommandPool = VK_NULL_HANDLE;
 
 			//Queues
 			VkQueue _GraphicsQueue;
 			VkQueue _PresentQueue;
+			VkQueue _ComputeQueue;
+			bool asyncCompute = false;
 
 			VkSurfaceKHR _surface;
 
@@ -19,20 +19,26 @@ namespace Engine {
 	}
 
 	GPipeline::GPipeline(Device& dev, std::string VertexPath, std::string FragmentPath, const GraphicsPipelineDetails& fixedFunctions): device {dev}{
-		createPipeline(VertexPath, FragmentPath, fixedFunctions);
+		auto VertexCode = ReadFile(VertexPath);
+		auto FragmentCode = ReadFile(FragmentPath);
+
+		createPipeline({ VertexCode.data(), VertexCode.size() }, { FragmentCode.data(), FragmentCode.size() }, fixedFunctions);
+	}
+
+	GPipeline::GPipeline(Device& dev, ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions) : device{ dev } {
+		createPipeline(VertexCode, FragmentCode, fixedFunctions);
 	}
 
 	GPipeline::~GPipeline() {
 		vkDestroyPipeline(device.device(), GraphicsPipeline, nullptr);
 	}
 
-	void GPipeline::createPipeline(std::string VertexPath, std::string FragmentPath, const GraphicsPipelineDetails& fixedFunctions) {
-		auto VertexCode = ReadFile(VertexPath);
-		auto FragmentCode = ReadFile(FragmentPath);
-
-		VkShaderModule VertexModule, FragmentModule;
+	void GPipeline::createPipeline(ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions) {
+		VkShaderModule VertexModule, FragmentModule = VK_NULL_HANDLE;
 		createShaderModule(VertexCode, &VertexModule);
-		createShaderModule(FragmentCode, &FragmentModule);
+		if (FragmentCode.code != nullptr) {
+			createShaderModule(FragmentCode, &FragmentModule);
+		}
 
 		VkPipelineShaderStageCreateInfo ShaderStage[2];
 		ShaderStage[0] = {};
@@ -40,22 +46,41 @@ namespace Engine {
 		ShaderStage[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
 		ShaderStage[0].module = VertexModule;
 		ShaderStage[0].pName = "main";
+		ShaderStage[0].pSpecializationInfo = fixedFunctions.specialization;
 
 		ShaderStage[1] = {};
 		ShaderStage[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		ShaderStage[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		ShaderStage[1].module = FragmentModule;
 		ShaderStage[1].pName = "main";
+		ShaderStage[1].pSpecializationInfo = fixedFunctions.specialization;
 
 		auto AttributeDescriptions = Model::Vertex::AttributeDescriptions();
 		auto BindingDescriptions = Model::Vertex::BindingDescriptions();
+		auto PositionAttributeDescriptions = Model::Vertex::PositionAttributeDescriptions();
+		auto PositionBindingDescriptions = Model::Vertex::PositionBindingDescriptions();
 
 		VkPipelineVertexInputStateCreateInfo VertexInput{};
 		VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(AttributeDescriptions.size());
-		VertexInput.pVertexAttributeDescriptions = AttributeDescriptions.data();
-		VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(BindingDescriptions.size());
-		VertexInput.pVertexBindingDescriptions = BindingDescriptions.data();
+		if (fixedFunctions.vertexInput == VertexInputMode::FixedFunction) {
+			VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(AttributeDescriptions.size());
+			VertexInput.pVertexAttributeDescriptions = AttributeDescriptions.data();
+			VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(BindingDescriptions.size());
+			VertexInput.pVertexBindingDescriptions = BindingDescriptions.data();
+		}
+		else if (fixedFunctions.vertexInput == VertexInputMode::PositionOnly) {
+			VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(PositionAttributeDescriptions.size());
+			VertexInput.pVertexAttributeDescriptions = PositionAttributeDescriptions.data();
+			VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(PositionBindingDescriptions.size());
+			VertexInput.pVertexBindingDescriptions = PositionBindingDescriptions.data();
+		}
+		else {
+			// Vertices are pulled from a storage buffer in the vertex shader
+			VertexInput.vertexAttributeDescriptionCount = 0;
+			VertexInput.pVertexAttributeDescriptions = nullptr;
+			VertexInput.vertexBindingDescriptionCount = 0;
+			VertexInput.pVertexBindingDescriptions = nullptr;
+		}
 
 		VkPipelineDynamicStateCreateInfo dynamicStates{};
 		dynamicStates.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -69,21 +94,9 @@ namespace Engine {
 		viewState.scissorCount = 1;
 		//viewState.pScissors = &fixedFunctions.scissor;
 
-		VkPipelineDepthStencilStateCreateInfo DepthStencil{};
-		DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		DepthStencil.depthWriteEnable = VK_TRUE;
-		DepthStencil.depthTestEnable = VK_TRUE;
-		DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-		DepthStencil.depthBoundsTestEnable = VK_FALSE;
-		DepthStencil.minDepthBounds = 0.0f;
-		DepthStencil.maxDepthBounds = 1.0f;
-		DepthStencil.stencilTestEnable = VK_FALSE;
-		DepthStencil.front = {};
-		DepthStencil.back = {};
-
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
+		pipelineInfo.stageCount = FragmentModule != VK_NULL_HANDLE ? 2 : 1;
 		pipelineInfo.pStages = ShaderStage;
 		
 		pipelineInfo.pVertexInputState = &VertexInput;
@@ -94,7 +107,7 @@ namespace Engine {
 		pipelineInfo.pRasterizationState = &fixedFunctions.Rasterization;
 		pipelineInfo.pMultisampleState = &fixedFunctions.MultiSample;
 		pipelineInfo.pColorBlendState = &fixedFunctions.ColorBlending;
-		pipelineInfo.pDepthStencilState = &DepthStencil;
+		pipelineInfo.pDepthStencilState = &fixedFunctions.DepthStencil;
 
 		pipelineInfo.layout = fixedFunctions.layout;
 		pipelineInfo.renderPass = fixedFunctions.renderPass;
@@ -103,26 +116,32 @@ namespace Engine {
 		pipelineInfo.basePipelineIndex = 0;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &GraphicsPipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(device.device(), fixedFunctions.cache, 1, &pipelineInfo, nullptr, &GraphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create graphics pipeline");
 		}
 		//std::cout << "Pipeline created" << std::endl;
 
 		vkDestroyShaderModule(device.device(), VertexModule, nullptr);
-		vkDestroyShaderModule(device.device(), FragmentModule, nullptr);
+		if (FragmentModule != VK_NULL_HANDLE) {
+			vkDestroyShaderModule(device.device(), FragmentModule, nullptr);
+		}
 	}
 
-	void GPipeline::createShaderModule(const std::vector<char>& Code, VkShaderModule* pShaderModule) {
+	static void CreateShaderModule(Device& device, ShaderBytecode Code, VkShaderModule* pShaderModule) {
 		VkShaderModuleCreateInfo ModuleInfo{};
 		ModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		ModuleInfo.codeSize = Code.size();
-		ModuleInfo.pCode = reinterpret_cast<const uint32_t*>(Code.data());
+		ModuleInfo.codeSize = Code.size;
+		ModuleInfo.pCode = reinterpret_cast<const uint32_t*>(Code.code);
 
 		if (vkCreateShaderModule(device.device(), &ModuleInfo, nullptr, pShaderModule) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create the shader module");
 		}
 	}
 
+	void GPipeline::createShaderModule(ShaderBytecode Code, VkShaderModule* pShaderModule) {
+		CreateShaderModule(device, Code, pShaderModule);
+	}
+
 
 	//uint32_t width, uint32_t height
 	GraphicsPipelineDetails GPipeline::PipelineDefaultDetails() {
@@ -176,6 +195,58 @@ namespace Engine {
 		pipeline.ColorBlending.blendConstants[2] = 0.0f;
 		pipeline.ColorBlending.blendConstants[3] = 0.0f;
 
+		pipeline.DepthStencil = {};
+		pipeline.DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		pipeline.DepthStencil.depthWriteEnable = VK_TRUE;
+		pipeline.DepthStencil.depthTestEnable = VK_TRUE;
+		pipeline.DepthStencil.depthCompareOp = REVERSE_Z ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+		pipeline.DepthStencil.depthBoundsTestEnable = VK_FALSE;
+		pipeline.DepthStencil.minDepthBounds = 0.0f;
+		pipeline.DepthStencil.maxDepthBounds = 1.0f;
+		pipeline.DepthStencil.stencilTestEnable = VK_FALSE;
+		pipeline.DepthStencil.front = {};
+		pipeline.DepthStencil.back = {};
+
+		pipeline.vertexInput = VertexInputMode::FixedFunction;
+		pipeline.specialization = nullptr;
+		pipeline.cache = VK_NULL_HANDLE;
+
 		return pipeline;
 	}
+
+	CPipeline::CPipeline(Device& dev, std::string ComputePath, VkPipelineLayout layout, const VkSpecializationInfo* specialization) : device{ dev } {
+		auto ComputeCode = ReadFile(ComputePath);
+
+		createPipeline({ ComputeCode.data(), ComputeCode.size() }, layout, specialization);
+	}
+
+	CPipeline::CPipeline(Device& dev, ShaderBytecode ComputeCode, VkPipelineLayout layout, const VkSpecializationInfo* specialization) : device{ dev } {
+		createPipeline(ComputeCode, layout, specialization);
+	}
+
+	CPipeline::~CPipeline() {
+		vkDestroyPipeline(device.device(), ComputePipeline, nullptr);
+	}
+
+	void CPipeline::createPipeline(ShaderBytecode ComputeCode, VkPipelineLayout layout, const VkSpecializationInfo* specialization) {
+		VkShaderModule ComputeModule;
+		CreateShaderModule(device, ComputeCode, &ComputeModule);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = ComputeModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.stage.pSpecializationInfo = specialization;
+		pipelineInfo.layout = layout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = -1;
+
+		if (vkCreateComputePipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &ComputePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+
+		vkDestroyShaderModule(device.device(), ComputeModule, nullptr);
+	}
 }
\ No newline at end of file
@@ -12,19 +12,43 @@
 
 namespace Engine
 {
+	/*
+		FixedFunction - vertices are described to the pipeline through Model::Vertex binding/attribute descriptions
+		VertexPulling - no vertex input state, the vertex shader fetches vertices from a storage buffer by gl_VertexIndex
+						so meshes with different packed layouts can share one pipeline
+		PositionOnly  - a single vec3 per vertex from Model's position buffer, for depth only passes
+	*/
+	enum class VertexInputMode {
+		FixedFunction,
+		VertexPulling,
+		PositionOnly
+	};
+
 	struct GraphicsPipelineDetails {
 		VkPipelineInputAssemblyStateCreateInfo InputAssembly;
 		VkPipelineRasterizationStateCreateInfo Rasterization;
 		VkPipelineMultisampleStateCreateInfo MultiSample;
 		VkPipelineColorBlendAttachmentState Attachment;
 		VkPipelineColorBlendStateCreateInfo ColorBlending;
+		VkPipelineDepthStencilStateCreateInfo DepthStencil;
 		VkPipelineLayout layout;
 		VkRenderPass renderPass;
 		uint32_t subpass;
+		VertexInputMode vertexInput;
+		// Given to both stages when not null, constants a stage doesn't declare are ignored by it
+		const VkSpecializationInfo* specialization;
+		// Pipelines created through the same cache reuse what the driver already compiled for each other
+		VkPipelineCache cache;
 	};
 
 	std::vector<char> ReadFile(std::string FilePath);
 
+	// SPIR-V owned by someone else, size in bytes
+	struct ShaderBytecode {
+		const char* code;
+		size_t size;
+	};
+
 	const std::vector<VkDynamicState> DynamicStates = {
 		VK_DYNAMIC_STATE_VIEWPORT,
 		VK_DYNAMIC_STATE_SCISSOR
@@ -34,6 +58,8 @@ namespace Engine
 	{
 		public:
 			GPipeline(Device& dev, std::string VertexPath, std::string FragmentPath, const GraphicsPipelineDetails& fixedFunctions);
+			// Without fragment code (null) only the vertex stage runs, e.g. to write depth alone
+			GPipeline(Device& dev, ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions);
 			~GPipeline();
 
 			GPipeline(const GPipeline&) = delete;
@@ -42,15 +68,37 @@ namespace Engine
 			static GraphicsPipelineDetails PipelineDefaultDetails();
 
 			void bind(VkCommandBuffer commandBuffer) { vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline); }
+			VkPipeline GetPipeline() { return GraphicsPipeline; }
 
 		private:
-			void createPipeline(std::string VertexPath, std::string FragmentPath, const GraphicsPipelineDetails& fixedFunctions);
+			void createPipeline(ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions);
 
-			void createShaderModule(const std::vector<char>& Code, VkShaderModule* pShaderModule);
+			void createShaderModule(ShaderBytecode Code, VkShaderModule* pShaderModule);
 
 			VkPipeline GraphicsPipeline = VK_NULL_HANDLE;
 
 			Device& device;
 	};
+
+	// Single compute stage, the layout is owned by the caller like with GPipeline
+	class CPipeline
+	{
+		public:
+			CPipeline(Device& dev, std::string ComputePath, VkPipelineLayout layout, const VkSpecializationInfo* specialization = nullptr);
+			CPipeline(Device& dev, ShaderBytecode ComputeCode, VkPipelineLayout layout, const VkSpecializationInfo* specialization = nullptr);
+			~CPipeline();
+
+			CPipeline(const CPipeline&) = delete;
+			CPipeline& operator=(const CPipeline&) = delete;
+
+			void bind(VkCommandBuffer commandBuffer) { vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ComputePipeline); }
+
+		private:
+			void createPipeline(ShaderBytecode ComputeCode, VkPipelineLayout layout, const VkSpecializationInfo* specialization);
+
+			VkPipeline ComputePipeline = VK_NULL_HANDLE;
+
+			Device& device;
+	};
 }
 
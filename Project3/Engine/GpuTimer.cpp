@@ -0,0 +1,88 @@
+#include "GpuTimer.h"
+
+//std
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+	GpuTimer::GpuTimer(Device& device) : device{ device } {
+		if (!device.SupportsTimestamps()) {
+			return;
+		}
+		period = device.GetTimestampPeriod();
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = MaxTimestamps;
+
+		QueryPools.resize(MAX_FRAME_IN_FLIGHT);
+		labels.resize(MAX_FRAME_IN_FLIGHT);
+		for (uint32_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &QueryPools[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create timestamp query pool");
+			}
+		}
+	}
+
+	GpuTimer::~GpuTimer() {
+		for (VkQueryPool pool : QueryPools) {
+			vkDestroyQueryPool(device.device(), pool, nullptr);
+		}
+	}
+
+	void GpuTimer::Begin(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+		if (QueryPools.empty()) {
+			return;
+		}
+
+		resolve(currentFrame);
+		labels[currentFrame].clear();
+
+		vkCmdResetQueryPool(commandBuffer, QueryPools[currentFrame], 0, MaxTimestamps);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPools[currentFrame], 0);
+	}
+
+	void GpuTimer::Mark(VkCommandBuffer commandBuffer, uint32_t currentFrame, const char* label) {
+		if (QueryPools.empty() || labels[currentFrame].size() + 1 >= MaxTimestamps) {
+			return;
+		}
+
+		labels[currentFrame].push_back(label);
+		// Once everything recorded before it has finished
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPools[currentFrame], static_cast<uint32_t>(labels[currentFrame].size()));
+	}
+
+	void GpuTimer::resolve(uint32_t currentFrame) {
+		const std::vector<const char*>& frameLabels = labels[currentFrame];
+		if (frameLabels.empty()) {
+			return;
+		}
+
+		uint64_t ticks[MaxTimestamps];
+		uint32_t count = static_cast<uint32_t>(frameLabels.size()) + 1;
+		// Not ready only when the frame's command buffer never made it to the queue, the last timings stay then
+		if (vkGetQueryPoolResults(device.device(), QueryPools[currentFrame], 0, count, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+			return;
+		}
+
+		timings.clear();
+		for (uint32_t i = 0; i < frameLabels.size(); i++) {
+			double milliseconds = ticks[i + 1] >= ticks[i] ? static_cast<double>(ticks[i + 1] - ticks[i]) * period / 1e6 : 0.0;
+
+			Timing* timing = nullptr;
+			for (Timing& existing : timings) {
+				if (std::strcmp(existing.label, frameLabels[i]) == 0) {
+					timing = &existing;
+					break;
+				}
+			}
+			if (timing) {
+				timing->milliseconds += milliseconds;
+			}
+			else {
+				timings.push_back({ frameLabels[i], milliseconds });
+			}
+		}
+	}
+}
\ No newline at end of file
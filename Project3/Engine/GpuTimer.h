@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Device.h"
+
+//std
+#include <vector>
+
+namespace Engine
+{
+	/*
+		GPU time spent between points of a frame's command buffer, from timestamp queries. Every frame in flight has its
+		own query pool, read back when the frame comes around again and its fence was waited on so nothing stalls. The
+		time since the previous mark is added to the mark's label, several spans can share one.
+	*/
+	class GpuTimer
+	{
+	public:
+		struct Timing {
+			const char* label;
+			double milliseconds;
+		};
+
+		static constexpr uint32_t MaxTimestamps = 32;
+
+		GpuTimer(Device& device);
+		~GpuTimer();
+
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+
+		// First thing in the frame's command buffer, outside of a render pass
+		void Begin(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+		// label is kept as is, e.g. a string literal
+		void Mark(VkCommandBuffer commandBuffer, uint32_t currentFrame, const char* label);
+
+		// By label in the order they were first marked, from the last frame read back. Empty without timestamp support
+		const std::vector<Timing>& GetTimings() const { return timings; }
+
+	private:
+		void resolve(uint32_t currentFrame);
+
+		std::vector<VkQueryPool> QueryPools;
+		// Label of every timestamp after the one Begin writes
+		std::vector<std::vector<const char*>> labels;
+		std::vector<Timing> timings;
+		// Nanoseconds per tick
+		double period = 0.0;
+
+		Device& device;
+	};
+}
@@ -0,0 +1,238 @@
+#include "ImpostorBaker.h"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+namespace Engine {
+	static float SignNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	glm::vec2 OctahedralEncode(glm::vec3 direction) {
+		float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		glm::vec2 p{ direction.x / sum, direction.z / sum };
+
+		// The lower hemisphere is folded over the diagonals
+		if (direction.y < 0.0f) {
+			p = glm::vec2{ (1.0f - std::abs(p.y)) * SignNotZero(p.x), (1.0f - std::abs(p.x)) * SignNotZero(p.y) };
+		}
+		return p;
+	}
+
+	glm::vec3 OctahedralDecode(glm::vec2 p) {
+		glm::vec3 direction{ p.x, 1.0f - std::abs(p.x) - std::abs(p.y), p.y };
+		if (direction.y < 0.0f) {
+			direction = glm::vec3{ (1.0f - std::abs(p.y)) * SignNotZero(p.x), direction.y, (1.0f - std::abs(p.x)) * SignNotZero(p.y) };
+		}
+		return glm::normalize(direction);
+	}
+
+	void ImpostorFrameBasis(glm::vec3 direction, glm::vec3& right, glm::vec3& up) {
+		glm::vec3 worldUp = std::abs(direction.y) > 0.999f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, 1.0f, 0.0f };
+		right = glm::normalize(glm::cross(worldUp, direction));
+		up = glm::cross(direction, right);
+	}
+
+	namespace {
+		struct FrameVertex {
+			float x, y, depth;
+			glm::vec2 texCoord;
+			glm::vec3 color;
+		};
+
+		struct AlbedoSampler {
+			const unsigned char* texels = nullptr;
+			uint32_t width = 0;
+			uint32_t height = 0;
+
+			AlbedoSampler(const TextureData& albedo) {
+				bool rgba8 = albedo.format == VK_FORMAT_R8G8B8A8_SRGB || albedo.format == VK_FORMAT_R8G8B8A8_UNORM;
+				if (rgba8 && !albedo.levels.empty() && albedo.ByteSize() >= albedo.levels[0].offset + albedo.levels[0].size) {
+					texels = albedo.Bytes() + albedo.levels[0].offset;
+					width = albedo.levels[0].width;
+					height = albedo.levels[0].height;
+				}
+			}
+
+			void Sample(glm::vec2 uv, const glm::vec3& color, unsigned char* out) const {
+				if (!texels) {
+					out[0] = static_cast<unsigned char>(std::clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+					out[1] = static_cast<unsigned char>(std::clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+					out[2] = static_cast<unsigned char>(std::clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+					return;
+				}
+
+				// Repeat addressing like the engine's default sampler
+				float u = uv.x - std::floor(uv.x);
+				float v = uv.y - std::floor(uv.y);
+				uint32_t x = std::min(static_cast<uint32_t>(u * width), width - 1);
+				uint32_t y = std::min(static_cast<uint32_t>(v * height), height - 1);
+				memcpy(out, texels + (static_cast<size_t>(y) * width + x) * 4, 3);
+			}
+		};
+
+		// Empty texels take the average of their covered neighbours so bilinear filtering and mips don't pull in black
+		void DilateFrame(unsigned char* atlas, uint32_t atlasWidth, uint32_t originX, uint32_t originY, uint32_t frameSize, uint32_t passes) {
+			std::vector<unsigned char> filled(static_cast<size_t>(frameSize) * frameSize);
+			for (uint32_t y = 0; y < frameSize; y++) {
+				for (uint32_t x = 0; x < frameSize; x++) {
+					filled[y * frameSize + x] = atlas[((originY + y) * atlasWidth + originX + x) * 4 + 3] != 0;
+				}
+			}
+
+			std::vector<unsigned char> next;
+			for (uint32_t pass = 0; pass < passes; pass++) {
+				next = filled;
+				for (uint32_t y = 0; y < frameSize; y++) {
+					for (uint32_t x = 0; x < frameSize; x++) {
+						if (filled[y * frameSize + x]) {
+							continue;
+						}
+
+						uint32_t sum[3] = { 0, 0, 0 };
+						uint32_t count = 0;
+						for (int dy = -1; dy <= 1; dy++) {
+							for (int dx = -1; dx <= 1; dx++) {
+								int nx = static_cast<int>(x) + dx;
+								int ny = static_cast<int>(y) + dy;
+								if (nx < 0 || ny < 0 || nx >= static_cast<int>(frameSize) || ny >= static_cast<int>(frameSize) || !filled[ny * frameSize + nx]) {
+									continue;
+								}
+
+								const unsigned char* texel = atlas + ((originY + ny) * atlasWidth + originX + nx) * 4;
+								sum[0] += texel[0];
+								sum[1] += texel[1];
+								sum[2] += texel[2];
+								count++;
+							}
+						}
+
+						if (count > 0) {
+							unsigned char* texel = atlas + ((originY + y) * atlasWidth + originX + x) * 4;
+							texel[0] = static_cast<unsigned char>(sum[0] / count);
+							texel[1] = static_cast<unsigned char>(sum[1] / count);
+							texel[2] = static_cast<unsigned char>(sum[2] / count);
+							next[y * frameSize + x] = 1;
+						}
+					}
+				}
+				std::swap(filled, next);
+			}
+		}
+	}
+
+	ImpostorAtlas BakeImpostor(const Model::Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TextureData& albedo, ThreadPool& workers, uint32_t framesPerSide, uint32_t frameSize) {
+		assert(framesPerSide >= 2 && frameSize > 0 && vertexCount > 0);
+
+		ImpostorAtlas result;
+		result.framesPerSide = framesPerSide;
+		result.frameSize = frameSize;
+
+		// Same bounding sphere as Model so the impostor lines up with the mesh it replaces
+		glm::vec3 Min = vertices[0].position;
+		glm::vec3 Max = vertices[0].position;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			Min = glm::min(Min, vertices[i].position);
+			Max = glm::max(Max, vertices[i].position);
+		}
+		result.center = (Min + Max) * 0.5f;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			result.radius = std::max(result.radius, glm::length(vertices[i].position - result.center));
+		}
+		if (result.radius == 0.0f) {
+			result.radius = 1.0f;
+		}
+
+		const uint32_t atlasSize = framesPerSide * frameSize;
+		TextureData& atlas = result.texture;
+		atlas.format = VK_FORMAT_R8G8B8A8_SRGB;
+		atlas.width = atlasSize;
+		atlas.height = atlasSize;
+		// Stop while a frame is still 4 texels wide, smaller mips would blend neighbouring frames
+		atlas.mipLevels = std::max(MipLevelCount(frameSize, frameSize), 3u) - 2;
+		atlas.levels.push_back({ 0, static_cast<uint64_t>(atlasSize) * atlasSize * 4, atlasSize, atlasSize });
+		atlas.bytes.assign(static_cast<size_t>(atlas.levels[0].size), 0);
+
+		const AlbedoSampler sampler{ albedo };
+		const uint32_t triangleCount = indexCount / 3;
+
+		workers.ParallelFor(framesPerSide * framesPerSide, [&](uint32_t frame) {
+			uint32_t frameX = frame % framesPerSide;
+			uint32_t frameY = frame / framesPerSide;
+			uint32_t originX = frameX * frameSize;
+			uint32_t originY = frameY * frameSize;
+
+			glm::vec2 grid{ frameX / static_cast<float>(framesPerSide - 1) * 2.0f - 1.0f, frameY / static_cast<float>(framesPerSide - 1) * 2.0f - 1.0f };
+			glm::vec3 direction = OctahedralDecode(grid);
+			glm::vec3 right, up;
+			ImpostorFrameBasis(direction, right, up);
+
+			// Orthographic projection onto the frame, depth grows towards the viewer
+			std::vector<FrameVertex> projected(vertexCount);
+			float scale = frameSize * 0.5f / result.radius;
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				glm::vec3 local = vertices[i].position - result.center;
+				projected[i].x = glm::dot(local, right) * scale + frameSize * 0.5f;
+				projected[i].y = glm::dot(local, up) * scale + frameSize * 0.5f;
+				projected[i].depth = glm::dot(local, direction);
+				projected[i].texCoord = vertices[i].texCoord;
+				projected[i].color = vertices[i].color;
+			}
+
+			std::vector<float> depth(static_cast<size_t>(frameSize) * frameSize, -FLT_MAX);
+			unsigned char* texels = atlas.bytes.data();
+
+			for (uint32_t t = 0; t < triangleCount; t++) {
+				const FrameVertex& a = projected[indices[t * 3]];
+				const FrameVertex& b = projected[indices[t * 3 + 1]];
+				const FrameVertex& c = projected[indices[t * 3 + 2]];
+
+				float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+				if (std::abs(area) < 1e-12f) {
+					continue;
+				}
+				float inverseArea = 1.0f / area;
+
+				int minX = std::max(static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))), 0);
+				int minY = std::max(static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))), 0);
+				int maxX = std::min(static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))), static_cast<int>(frameSize) - 1);
+				int maxY = std::min(static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))), static_cast<int>(frameSize) - 1);
+
+				// Both windings are drawn, the depth test decides
+				for (int y = minY; y <= maxY; y++) {
+					float py = y + 0.5f;
+					for (int x = minX; x <= maxX; x++) {
+						float px = x + 0.5f;
+						float w0 = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * inverseArea;
+						float w1 = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * inverseArea;
+						float w2 = 1.0f - w0 - w1;
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+							continue;
+						}
+
+						float z = a.depth * w0 + b.depth * w1 + c.depth * w2;
+						float& stored = depth[y * frameSize + x];
+						if (z <= stored) {
+							continue;
+						}
+						stored = z;
+
+						glm::vec2 uv = a.texCoord * w0 + b.texCoord * w1 + c.texCoord * w2;
+						glm::vec3 color = a.color * w0 + b.color * w1 + c.color * w2;
+						unsigned char* out = texels + ((originY + y) * static_cast<size_t>(atlasSize) + originX + x) * 4;
+						sampler.Sample(uv, color, out);
+						out[3] = 255;
+					}
+				}
+			}
+
+			DilateFrame(texels, atlasSize, originX, originY, frameSize, 4);
+		});
+
+		GenerateMipmapsCPU(atlas);
+		return result;
+	}
+}
\ No newline at end of file
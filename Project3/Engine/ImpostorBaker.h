@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Model.h"
+#include "TextureData.h"
+#include "ThreadPool.h"
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Octahedral impostor: the object rendered orthographically from framesPerSide x framesPerSide directions spread over
+		the whole sphere, every frame framed on the bounding sphere. Frame (x, y) looks from OctahedralDecode of its grid
+		position, the impostor shader picks the frame closest to the view direction the same way.
+	*/
+	struct ImpostorAtlas {
+		TextureData texture;	// RGBA8 sRGB, alpha is coverage
+		uint32_t framesPerSide = 0;
+		uint32_t frameSize = 0;
+
+		// Model space bounding sphere the frames were rendered around
+		glm::vec3 center{ 0.0f };
+		float radius = 0.0f;
+	};
+
+	// Unit direction <-> [-1, 1]^2 on an octahedron with +Y at the center, matches Impostor.vert
+	glm::vec2 OctahedralEncode(glm::vec3 direction);
+	glm::vec3 OctahedralDecode(glm::vec2 p);
+	// Axes of the frame looking from direction, matches Impostor.vert
+	void ImpostorFrameBasis(glm::vec3 direction, glm::vec3& right, glm::vec3& up);
+
+	/*
+		Rasterizes the mesh into every frame on the CPU, one frame per job. albedo is sampled with the mesh's texture
+		coordinates (nearest, repeat) when it is RGBA8, otherwise the vertex colors are used. Pass a coarse LOD, frames are small.
+	*/
+	ImpostorAtlas BakeImpostor(const Model::Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TextureData& albedo, ThreadPool& workers, uint32_t framesPerSide = 8, uint32_t frameSize = 64);
+}
\ No newline at end of file
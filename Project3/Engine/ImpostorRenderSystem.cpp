@@ -0,0 +1,206 @@
+#include "ImpostorRenderSystem.h"
+
+namespace Engine {
+	ImpostorRenderSystem::ImpostorRenderSystem(Device& device, TextureCache& textures, VkRenderPass renderPass, Camera& Camera, const ImpostorAtlas& atlas) : device{ device }, textures{ textures }, camera{ Camera } {
+		boundsCenterRadius = glm::vec4(atlas.center, atlas.radius);
+		framesPerSide = atlas.framesPerSide;
+		frameSize = atlas.frameSize;
+
+		// Small and baked once, not worth going through the cache
+		atlasTexture = Texture::CreateImmediate(device, atlas.texture);
+		instances.reserve(MaxInstances);
+
+		createInstanceBuffers();
+		createDescriptorSetLayout();
+		createDescriptorSets(Camera);
+		createPipelineLayout();
+		createGraphicsPipeline(renderPass);
+	}
+
+	ImpostorRenderSystem::~ImpostorRenderSystem() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), InstanceBuffers[i], nullptr);
+			vkFreeMemory(device.device(), InstanceBuffersMemory[i], nullptr);
+		}
+
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	}
+
+	void ImpostorRenderSystem::createInstanceBuffers() {
+		VkDeviceSize bufferSize = sizeof(Instance) * MaxInstances;
+
+		InstanceBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		InstanceBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		InstanceBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				InstanceBuffers[i],
+				bufferSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				InstanceBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), InstanceBuffersMemory[i], 0, bufferSize, 0, &InstanceBuffersMapped[i]);
+		}
+	}
+
+	void ImpostorRenderSystem::createDescriptorSetLayout() {
+		VkDescriptorSetLayoutBinding uboBindingInfo{};
+		uboBindingInfo.binding = 0;
+		uboBindingInfo.descriptorCount = 1;
+		uboBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		uboBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		uboBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding atlasBindingInfo{};
+		atlasBindingInfo.binding = 1;
+		atlasBindingInfo.descriptorCount = 1;
+		atlasBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		atlasBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		atlasBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding instanceBindingInfo{};
+		instanceBindingInfo.binding = 2;
+		instanceBindingInfo.descriptorCount = 1;
+		instanceBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		instanceBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		instanceBindingInfo.pImmutableSamplers = nullptr;
+
+		std::array<VkDescriptorSetLayoutBinding, 3> bindingInfo{ uboBindingInfo, atlasBindingInfo, instanceBindingInfo };
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create impostor descriptor set layout");
+		}
+	}
+
+	void ImpostorRenderSystem::createDescriptorSets(Camera& Camera) {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = device.DescriptorPool();
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate impostor descriptor sets");
+		}
+
+		// Frames sit next to each other in the atlas, clamping only matters at its outer edge
+		SamplerDesc samplerDesc{};
+		samplerDesc.addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = Camera.GetCameraBuffer(i);
+			bufferInfo.offset = 0;
+			bufferInfo.range = sizeof(Camera::CameraUBO);
+
+			VkDescriptorImageInfo imageInfo{};
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			imageInfo.sampler = textures.GetSampler(samplerDesc);
+			imageInfo.imageView = atlasTexture->ImageView();
+
+			VkDescriptorBufferInfo instanceInfo{};
+			instanceInfo.buffer = InstanceBuffers[i];
+			instanceInfo.offset = 0;
+			instanceInfo.range = sizeof(Instance) * MaxInstances;
+
+			std::array<VkWriteDescriptorSet, 3> WriteSet{};
+			WriteSet[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[0].dstSet = DescriptorSets[i];
+			WriteSet[0].dstBinding = 0;
+			WriteSet[0].dstArrayElement = 0;
+			WriteSet[0].descriptorCount = 1;
+			WriteSet[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			WriteSet[0].pBufferInfo = &bufferInfo;
+
+			WriteSet[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[1].dstSet = DescriptorSets[i];
+			WriteSet[1].dstBinding = 1;
+			WriteSet[1].dstArrayElement = 0;
+			WriteSet[1].descriptorCount = 1;
+			WriteSet[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			WriteSet[1].pImageInfo = &imageInfo;
+
+			WriteSet[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[2].dstSet = DescriptorSets[i];
+			WriteSet[2].dstBinding = 2;
+			WriteSet[2].dstArrayElement = 0;
+			WriteSet[2].descriptorCount = 1;
+			WriteSet[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[2].pBufferInfo = &instanceInfo;
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void ImpostorRenderSystem::createPipelineLayout() {
+		VkPushConstantRange paramsRange{};
+		paramsRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		paramsRange.offset = 0;
+		paramsRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &paramsRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create impostor pipeline layout");
+		}
+	}
+
+	void ImpostorRenderSystem::createGraphicsPipeline(VkRenderPass renderPass) {
+		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
+		fixedFunctions.layout = pipelineLayout;
+		fixedFunctions.renderPass = renderPass;
+		fixedFunctions.subpass = 0;
+		// Corners come from gl_VertexIndex, there is no vertex buffer
+		fixedFunctions.vertexInput = VertexInputMode::VertexPulling;
+		fixedFunctions.Rasterization.cullMode = VK_CULL_MODE_NONE;
+
+		pipeline = std::make_unique<GPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Impostor.vert.spv",
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Impostor.frag.spv",
+			fixedFunctions
+		);
+	}
+
+	void ImpostorRenderSystem::Add(glm::vec3 position, float scale) {
+		if (instances.size() < MaxInstances) {
+			instances.push_back({ glm::vec4(position, scale) });
+		}
+	}
+
+	void ImpostorRenderSystem::Render(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+		if (instances.empty()) {
+			return;
+		}
+
+		// The frame's fence was waited on in StartFrame, nothing reads this buffer anymore
+		memcpy(InstanceBuffersMapped[currentFrame], instances.data(), sizeof(Instance) * instances.size());
+
+		PushConstants params{};
+		params.boundsCenterRadius = boundsCenterRadius;
+		params.cameraPosition = glm::vec4(camera.GetPosition(), 1.0f);
+		params.framesPerSide = framesPerSide;
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+		vkCmdDraw(commandBuffer, 6, static_cast<uint32_t>(instances.size()), 0, 0);
+
+		instances.clear();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Camera.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "ImpostorBaker.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Draws every far away instance of one model as a camera facing quad textured with the frame of its octahedral
+		impostor atlas closest to the view direction. Instances are collected with Add() during the frame and drawn
+		in one instanced draw by Render(), quads are expanded in Impostor.vert from gl_VertexIndex.
+	*/
+	class ImpostorRenderSystem
+	{
+	public:
+		struct Instance {
+			glm::vec4 positionScale;	// world position of the model's origin, uniform scale in w
+		};
+
+		struct PushConstants {
+			glm::vec4 boundsCenterRadius;	// model space bounds the atlas was baked around
+			glm::vec4 cameraPosition;
+			uint32_t framesPerSide;
+		};
+
+		static constexpr uint32_t MaxInstances = 65536;
+
+		ImpostorRenderSystem(Device& device, TextureCache& textures, VkRenderPass renderPass, Camera& Camera, const ImpostorAtlas& atlas);
+		~ImpostorRenderSystem();
+
+		ImpostorRenderSystem(const ImpostorRenderSystem&) = delete;
+		ImpostorRenderSystem& operator=(const ImpostorRenderSystem&) = delete;
+
+		// Instances past MaxInstances are dropped
+		void Add(glm::vec3 position, float scale);
+		// Draws and clears the collected instances
+		void Render(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+		// Above this many pixels on screen the impostor would be magnified, draw the mesh instead
+		float MaxScreenSize() { return static_cast<float>(frameSize); }
+		uint32_t InstanceCount() { return static_cast<uint32_t>(instances.size()); }
+
+	private:
+		void createInstanceBuffers();
+		void createDescriptorSetLayout();
+		void createDescriptorSets(Camera& Camera);
+		void createPipelineLayout();
+		void createGraphicsPipeline(VkRenderPass renderPass);
+
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+
+		// One host visible buffer per frame in flight, written right before the draw
+		std::vector<VkBuffer> InstanceBuffers;
+		std::vector<VkDeviceMemory> InstanceBuffersMemory;
+		std::vector<void*> InstanceBuffersMapped;
+		std::vector<Instance> instances;
+
+		glm::vec4 boundsCenterRadius;
+		uint32_t framesPerSide;
+		uint32_t frameSize;
+
+		Device& device;
+		TextureCache& textures;
+		Camera& camera;
+		std::unique_ptr<Texture> atlasTexture;
+		std::unique_ptr<GPipeline> pipeline;
+	};
+}
\ No newline at end of file
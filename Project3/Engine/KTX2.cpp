@@ -0,0 +1,132 @@
+#include "KTX2.h"
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+namespace Engine {
+	struct KTX2Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct KTX2LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(KTX2Header) == 80, "KTX2 header must match the file layout");
+	static_assert(sizeof(KTX2LevelIndex) == 24, "KTX2 level index must match the file layout");
+
+	bool isKTX2File(const std::string& FilePath) {
+		auto dot = FilePath.find_last_of('.');
+		if (dot == std::string::npos) {
+			return false;
+		}
+
+		std::string extension = FilePath.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension == "ktx2";
+	}
+
+	bool isBlockCompressedFormat(VkFormat format) {
+		return (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK) ||
+			(format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK) ||
+			(format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
+	}
+
+	KTX2Texture LoadKTX2(const std::string& FilePath) {
+		std::ifstream File(FilePath, std::ios::ate | std::ios::binary);
+
+		if (!File.is_open()) {
+			throw std::runtime_error("failed to open KTX2 file: " + FilePath);
+		}
+
+		size_t fileSize = File.tellg();
+		File.seekg(0);
+
+		std::vector<unsigned char> bytes(fileSize);
+		File.read(reinterpret_cast<char*>(bytes.data()), fileSize);
+		File.close();
+
+		return ParseKTX2(bytes.data(), bytes.size());
+	}
+
+	KTX2Texture ParseKTX2(const unsigned char* bytes, size_t size) {
+		if (size < sizeof(KTX2Header)) {
+			throw std::runtime_error("KTX2 file is too small");
+		}
+
+		KTX2Header header;
+		memcpy(&header, bytes, sizeof(header));
+
+		if (memcmp(header.identifier, KTX2Identifier, sizeof(KTX2Identifier)) != 0) {
+			throw std::runtime_error("file is not a KTX2 container");
+		}
+		if (header.vkFormat == VK_FORMAT_UNDEFINED) {
+			throw std::runtime_error("KTX2 files with VK_FORMAT_UNDEFINED (Basis Universal) are not supported");
+		}
+		if (header.supercompressionScheme != 0) {
+			throw std::runtime_error("supercompressed KTX2 files are not supported");
+		}
+		if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+			throw std::runtime_error("only 2D KTX2 textures with a single layer and face are supported");
+		}
+
+		uint32_t levelCount = std::max(header.levelCount, 1u);
+		size_t levelIndexEnd = sizeof(KTX2Header) + levelCount * sizeof(KTX2LevelIndex);
+		if (size < levelIndexEnd) {
+			throw std::runtime_error("KTX2 level index is truncated");
+		}
+
+		std::vector<KTX2LevelIndex> levelIndex(levelCount);
+		memcpy(levelIndex.data(), bytes + sizeof(KTX2Header), levelCount * sizeof(KTX2LevelIndex));
+
+		KTX2Texture texture;
+		texture.format = static_cast<VkFormat>(header.vkFormat);
+		texture.width = header.pixelWidth;
+		texture.height = std::max(header.pixelHeight, 1u);
+
+		// Levels are stored smallest first in the file, repack them largest first so offsets grow with the level
+		uint64_t totalSize = 0;
+		for (const auto& level : levelIndex) {
+			if (level.byteOffset + level.byteLength > size) {
+				throw std::runtime_error("KTX2 level data is out of bounds");
+			}
+			totalSize += level.byteLength;
+		}
+
+		texture.data.resize(static_cast<size_t>(totalSize));
+		texture.levels.resize(levelCount);
+
+		uint64_t offset = 0;
+		for (uint32_t i = 0; i < levelCount; i++) {
+			texture.levels[i].offset = offset;
+			texture.levels[i].size = levelIndex[i].byteLength;
+			texture.levels[i].width = std::max(texture.width >> i, 1u);
+			texture.levels[i].height = std::max(texture.height >> i, 1u);
+
+			memcpy(texture.data.data() + offset, bytes + levelIndex[i].byteOffset, static_cast<size_t>(levelIndex[i].byteLength));
+			offset += levelIndex[i].byteLength;
+		}
+
+		return texture;
+	}
+}
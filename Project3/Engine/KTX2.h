@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Engine
+{
+	/*
+		Minimal KTX2 container reader (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+		Supports 2D, single layer / single face textures stored without supercompression,
+		which is what Tools/TextureConverter writes. The level data is kept as-is so block
+		compressed formats (BC1/BC3/BC5/BC7, ETC2, ASTC) can be copied straight into a staging buffer.
+	*/
+	struct KTX2Texture {
+		struct Level {
+			uint64_t offset;	// into data
+			uint64_t size;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+
+		// levels[0] is the full resolution image
+		std::vector<Level> levels;
+		std::vector<unsigned char> data;
+	};
+
+	static constexpr uint8_t KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	KTX2Texture LoadKTX2(const std::string& FilePath);
+	KTX2Texture ParseKTX2(const unsigned char* bytes, size_t size);
+
+	bool isKTX2File(const std::string& FilePath);
+	bool isBlockCompressedFormat(VkFormat format);
+}
@@ -0,0 +1,67 @@
+#include "MaterialSystem.h"
+
+//std
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+	MaterialSystem::MaterialSystem(Device& device, uint32_t capacity) : capacity{ capacity }, device{ device } {
+		createMaterialBuffers();
+		Create(Material{});
+	}
+
+	MaterialSystem::~MaterialSystem() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), MaterialBuffers[i], nullptr);
+			vkFreeMemory(device.device(), MaterialBuffersMemory[i], nullptr);
+		}
+	}
+
+	uint32_t MaterialSystem::Create(const Material& material) {
+		if (materials.size() >= capacity) {
+			throw std::runtime_error("material buffer is full");
+		}
+
+		materials.push_back(material);
+		version++;
+		return static_cast<uint32_t>(materials.size() - 1);
+	}
+
+	void MaterialSystem::Set(uint32_t id, const Material& material) {
+		if (id >= materials.size()) {
+			throw std::runtime_error("setting a material that doesn't exist");
+		}
+
+		materials[id] = material;
+		version++;
+	}
+
+	void MaterialSystem::Update(uint32_t currentFrame) {
+		if (uploadedVersions[currentFrame] == version) {
+			return;
+		}
+
+		// Materials change rarely and the whole array is a few kilobytes, tracking single ones isn't worth it
+		memcpy(MaterialBuffersMapped[currentFrame], materials.data(), sizeof(Material) * materials.size());
+		uploadedVersions[currentFrame] = version;
+	}
+
+	void MaterialSystem::createMaterialBuffers() {
+		MaterialBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		MaterialBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		MaterialBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+		uploadedVersions.resize(MAX_FRAME_IN_FLIGHT, 0);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				MaterialBuffers[i],
+				GetBufferSize(),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				MaterialBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), MaterialBuffersMemory[i], 0, GetBufferSize(), 0, &MaterialBuffersMapped[i]);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Device.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Every material's parameters packed into one storage buffer per frame in flight, indexed by the material id each
+		draw pushes, so adding materials costs neither descriptor sets nor binds. Features pick the pipeline instead of
+		being tested in the shader, the renderer keeps one PipelineVariants pipeline per combination in use.
+	*/
+	class MaterialSystem
+	{
+	public:
+		// Shader features are specialization constants of Triangle.frag and GBuffer.frag, the bit index is the constant_id
+		enum Features : uint32_t {
+			// Base color times the model's texture
+			Textured = 1,
+			// Times the vertex color as well
+			VertexColor = 2,
+			// Discards fragments under alphaCutoff, opaque variants keep early depth testing without the discard
+			AlphaTest = 4,
+			// Lambert from the sun, shadowed by ShadowRenderSystem, and the ClusteredLights around it with faceted normals, the model has no normals of its own
+			Lit = 8,
+			// Drawn without back face culling
+			DoubleSided = 16,
+
+			ShaderFeatures = Textured | VertexColor | AlphaTest | Lit,
+			StateFeatures = DoubleSided,
+			VariantFeatures = ShaderFeatures | StateFeatures
+		};
+
+		// Matches the Material struct of Triangle.frag and GBuffer.frag
+		struct Material {
+			glm::vec4 baseColor{ 1.0f };
+			float alphaCutoff = 0.5f;
+			uint32_t features = Textured;
+			uint32_t padding[2] = {};
+		};
+		static_assert(sizeof(Material) == 32, "Material has to match its std430 layout");
+
+		// Always there, white and textured
+		static constexpr uint32_t DefaultMaterial = 0;
+
+		MaterialSystem(Device& device, uint32_t capacity = 4096);
+		~MaterialSystem();
+
+		MaterialSystem(const MaterialSystem&) = delete;
+		MaterialSystem& operator=(const MaterialSystem&) = delete;
+
+		uint32_t Create(const Material& material);
+		void Set(uint32_t id, const Material& material);
+		const Material& Get(uint32_t id) const { return materials[id]; }
+		// The features that pick the material's pipeline
+		uint32_t GetVariant(uint32_t id) const { return materials[id].features & VariantFeatures; }
+
+		// Copies the parameters into currentFrame's buffer when they changed since it was last written
+		void Update(uint32_t currentFrame);
+
+		VkBuffer GetBuffer(uint32_t currentFrame) { return MaterialBuffers[currentFrame]; }
+		VkDeviceSize GetBufferSize() const { return sizeof(Material) * capacity; }
+		uint32_t GetCount() const { return static_cast<uint32_t>(materials.size()); }
+
+	private:
+		void createMaterialBuffers();
+
+		uint32_t capacity;
+		std::vector<Material> materials;
+		// Goes up with every change, each frame's buffer remembers the one it holds
+		uint32_t version = 1;
+		std::vector<uint32_t> uploadedVersions;
+
+		std::vector<VkBuffer> MaterialBuffers;
+		std::vector<VkDeviceMemory> MaterialBuffersMemory;
+		std::vector<void*> MaterialBuffersMapped;
+
+		Device& device;
+	};
+}
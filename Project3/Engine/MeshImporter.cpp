@@ -0,0 +1,1130 @@
+#include "MeshImporter.h"
+
+//std
+#include <fstream>
+#include <stdexcept>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cctype>
+
+namespace Engine {
+	namespace {
+		std::vector<char> ReadBinaryFile(const std::string& FilePath) {
+			std::ifstream file{ FilePath, std::ios::ate | std::ios::binary };
+
+			if (!file.is_open()) {
+				throw std::runtime_error("failed to open mesh file: " + FilePath);
+			}
+
+			size_t fileSize = static_cast<size_t>(file.tellg());
+			std::vector<char> buffer(fileSize);
+
+			file.seekg(0);
+			file.read(buffer.data(), fileSize);
+
+			return buffer;
+		}
+
+		std::string Directory(const std::string& FilePath) {
+			size_t slash = FilePath.find_last_of("/\\");
+			return slash == std::string::npos ? std::string{} : FilePath.substr(0, slash + 1);
+		}
+
+		std::string Extension(const std::string& FilePath) {
+			size_t dot = FilePath.find_last_of('.');
+			if (dot == std::string::npos) {
+				return {};
+			}
+
+			std::string extension = FilePath.substr(dot + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+			return extension;
+		}
+
+		/*
+			Open addressing (linear probing) map from vertex value to its index in the unique vertex list.
+			Sized up front for the worst case of every vertex being unique so it never rehashes.
+		*/
+		class VertexHashMap
+		{
+			public:
+				VertexHashMap(size_t maxVertices) {
+					size_t capacity = 16;
+					while (capacity < maxVertices * 2) {
+						capacity <<= 1;
+					}
+
+					slots.assign(capacity, Empty);
+					mask = capacity - 1;
+				}
+
+				uint32_t Insert(const Model::Vertex& vertex, std::vector<Model::Vertex>& unique) {
+					for (size_t slot = Hash(vertex) & mask;; slot = (slot + 1) & mask) {
+						uint32_t index = slots[slot];
+
+						if (index == Empty) {
+							index = static_cast<uint32_t>(unique.size());
+							slots[slot] = index;
+							unique.push_back(vertex);
+							return index;
+						}
+						if (memcmp(&unique[index], &vertex, sizeof(Model::Vertex)) == 0) {
+							return index;
+						}
+					}
+				}
+
+			private:
+				static constexpr uint32_t Empty = UINT32_MAX;
+
+				static uint64_t Hash(const Model::Vertex& vertex) {
+					static_assert(sizeof(Model::Vertex) % sizeof(uint32_t) == 0, "Vertex is hashed as 32-bit words");
+
+					uint32_t words[sizeof(Model::Vertex) / sizeof(uint32_t)];
+					memcpy(words, &vertex, sizeof(words));
+
+					uint64_t hash = 0xcbf29ce484222325ull;
+					for (uint32_t word : words) {
+						hash = (hash ^ word) * 0x100000001b3ull;
+					}
+
+					// Finalizer so the low bits used for the slot depend on every word
+					hash ^= hash >> 33;
+					hash *= 0xff51afd7ed558ccdull;
+					hash ^= hash >> 33;
+					return hash;
+				}
+
+				std::vector<uint32_t> slots;
+				size_t mask;
+		};
+
+		// Result of one parallel job: locally deduplicated vertices and indices into them
+		struct MeshChunk {
+			std::vector<Model::Vertex> vertices;
+			std::vector<uint32_t> indices;
+			size_t inputVertices = 0;
+			std::string error;
+		};
+
+		/*
+			Chunks were deduplicated independently, so only their (much fewer) unique vertices go through the
+			global map on this thread. Remapping the indices is parallel again.
+		*/
+		void MergeChunks(std::vector<MeshChunk>& chunks, ThreadPool& workers, MeshData& mesh, ImportStats& stats) {
+			for (auto& chunk : chunks) {
+				if (!chunk.error.empty()) {
+					throw std::runtime_error(chunk.error);
+				}
+			}
+
+			size_t chunkVertices = 0;
+			size_t totalIndices = 0;
+			std::vector<size_t> indexOffsets;
+			for (auto& chunk : chunks) {
+				indexOffsets.push_back(totalIndices);
+				chunkVertices += chunk.vertices.size();
+				totalIndices += chunk.indices.size();
+				stats.inputVertices += chunk.inputVertices;
+			}
+
+			VertexHashMap map{ chunkVertices };
+			mesh.vertices.reserve(chunkVertices);
+			std::vector<std::vector<uint32_t>> remaps(chunks.size());
+			for (size_t i = 0; i < chunks.size(); i++) {
+				remaps[i].reserve(chunks[i].vertices.size());
+				for (const auto& vertex : chunks[i].vertices) {
+					remaps[i].push_back(map.Insert(vertex, mesh.vertices));
+				}
+			}
+
+			mesh.indices.resize(totalIndices);
+			workers.ParallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i) {
+				uint32_t* out = mesh.indices.data() + indexOffsets[i];
+				for (uint32_t index : chunks[i].indices) {
+					*out++ = remaps[i][index];
+				}
+			});
+
+			stats.uniqueVertices = mesh.vertices.size();
+			stats.triangles = totalIndices / 3;
+		}
+
+		/*
+			 OBJ
+		*/
+
+		// A face corner as written in the file, 0 means absent, negative is relative to the vertices defined so far
+		struct ObjCorner {
+			int32_t position;
+			int32_t texCoord;
+		};
+
+		struct ObjChunk {
+			const char* begin;
+			const char* end;
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> colors;
+			std::vector<glm::vec2> texCoords;
+
+			std::vector<ObjCorner> corners;
+			// Corners per face, and how many positions / texCoords this chunk had defined before it (for negative indices)
+			std::vector<uint32_t> faceSizes;
+			std::vector<uint32_t> facePositionCounts;
+			std::vector<uint32_t> faceTexCoordCounts;
+
+			std::string materialLibrary;
+			std::string firstMaterial;
+			std::string error;
+		};
+
+		inline const char* SkipSpaces(const char* p, const char* end) {
+			while (p < end && (*p == ' ' || *p == '\t')) p++;
+			return p;
+		}
+
+		inline const char* SkipLine(const char* p, const char* end) {
+			while (p < end && *p != '\n') p++;
+			return p < end ? p + 1 : p;
+		}
+
+		inline const char* ParseFloat(const char* p, const char* end, float& value) {
+			p = SkipSpaces(p, end);
+			// from_chars doesn't accept a leading '+'
+			if (p < end && *p == '+') p++;
+
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc{}) {
+				throw std::runtime_error("expected a number");
+			}
+			return result.ptr;
+		}
+
+		inline const char* ParseInt(const char* p, const char* end, int32_t& value) {
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc{}) {
+				throw std::runtime_error("expected an index");
+			}
+			return result.ptr;
+		}
+
+		std::string ParseName(const char* p, const char* end) {
+			p = SkipSpaces(p, end);
+			const char* nameEnd = p;
+			while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r' && *nameEnd != '#') nameEnd++;
+			while (nameEnd > p && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) nameEnd--;
+			return std::string(p, nameEnd);
+		}
+
+		bool Keyword(const char* p, const char* end, const char* keyword) {
+			size_t length = strlen(keyword);
+			return static_cast<size_t>(end - p) > length && memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+		}
+
+		void ParseObjChunk(ObjChunk& chunk) {
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+			size_t line = 0;
+
+			try
+			{
+				while (p < end) {
+					line++;
+					p = SkipSpaces(p, end);
+
+					if (Keyword(p, end, "v")) {
+						glm::vec3 position;
+						p = ParseFloat(p + 1, end, position.x);
+						p = ParseFloat(p, end, position.y);
+						p = ParseFloat(p, end, position.z);
+
+						// Either "v x y z w" or the common "v x y z r g b" vertex color extension
+						float extra[3];
+						uint32_t extraCount = 0;
+						for (const char* next = SkipSpaces(p, end); extraCount < 3 && next < end && *next != '\n' && *next != '\r' && *next != '#'; next = SkipSpaces(p, end)) {
+							p = ParseFloat(next, end, extra[extraCount++]);
+						}
+
+						glm::vec3 color{ 1.0f };
+						if (extraCount == 3) {
+							color = { extra[0], extra[1], extra[2] };
+						}
+
+						chunk.positions.push_back(position);
+						chunk.colors.push_back(color);
+					}
+					else if (Keyword(p, end, "vt")) {
+						glm::vec2 texCoord;
+						p = ParseFloat(p + 2, end, texCoord.x);
+						p = ParseFloat(p, end, texCoord.y);
+
+						// OBJ puts v = 0 at the bottom of the image
+						texCoord.y = 1.0f - texCoord.y;
+						chunk.texCoords.push_back(texCoord);
+					}
+					else if (Keyword(p, end, "f")) {
+						p += 1;
+						uint32_t size = 0;
+
+						for (;;) {
+							p = SkipSpaces(p, end);
+							if (p >= end || *p == '\n' || *p == '\r' || *p == '#') {
+								break;
+							}
+
+							// Normals are not part of Model::Vertex, "v//vn" and "v/vt/vn" just skip them
+							ObjCorner corner{ 0, 0 };
+							int32_t normal;
+							p = ParseInt(p, end, corner.position);
+							if (p < end && *p == '/') {
+								p++;
+								if (p < end && *p != '/') {
+									p = ParseInt(p, end, corner.texCoord);
+								}
+								if (p < end && *p == '/') {
+									p = ParseInt(p + 1, end, normal);
+								}
+							}
+
+							chunk.corners.push_back(corner);
+							size++;
+						}
+
+						if (size < 3) {
+							throw std::runtime_error("face with less than 3 vertices");
+						}
+
+						chunk.faceSizes.push_back(size);
+						chunk.facePositionCounts.push_back(static_cast<uint32_t>(chunk.positions.size()));
+						chunk.faceTexCoordCounts.push_back(static_cast<uint32_t>(chunk.texCoords.size()));
+					}
+					else if (Keyword(p, end, "mtllib") && chunk.materialLibrary.empty()) {
+						chunk.materialLibrary = ParseName(p + 6, end);
+					}
+					else if (Keyword(p, end, "usemtl") && chunk.firstMaterial.empty()) {
+						chunk.firstMaterial = ParseName(p + 6, end);
+					}
+
+					// vn, g, o, s, comments... are skipped
+					p = SkipLine(p, end);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				chunk.error = std::string(e.what()) + " (line " + std::to_string(line) + " of a chunk)";
+			}
+		}
+
+		// map_Kd of the material the file uses first, relative to the .mtl
+		std::string FindObjTexture(const std::string& directory, const std::string& library, const std::string& material) {
+			std::ifstream file{ directory + library };
+			if (!file.is_open()) {
+				return {};
+			}
+
+			std::string line;
+			std::string current;
+			std::string fallback;
+			while (std::getline(file, line)) {
+				const char* begin = line.data();
+				const char* end = begin + line.size();
+				const char* p = SkipSpaces(begin, end);
+
+				if (Keyword(p, end, "newmtl")) {
+					current = ParseName(p + 6, end);
+				}
+				else if (Keyword(p, end, "map_Kd")) {
+					std::string texture = directory + ParseName(p + 6, end);
+					if (material.empty() || current == material) {
+						return texture;
+					}
+					if (fallback.empty()) {
+						fallback = texture;
+					}
+				}
+			}
+
+			return fallback;
+		}
+
+		void ImportObj(const std::string& FilePath, const std::vector<char>& file, ThreadPool& workers, MeshData& mesh, ImportStats& stats) {
+			const char* begin = file.data();
+			const char* end = begin + file.size();
+
+			// Chunks of at least 256KB, a few per thread so uneven chunks balance out
+			constexpr size_t MinChunkSize = 256 * 1024;
+			size_t chunkCount = std::max<size_t>(1, std::min<size_t>(file.size() / MinChunkSize, (workers.WorkerCount() + 1) * 4));
+
+			std::vector<ObjChunk> chunks(chunkCount);
+			const char* chunkBegin = begin;
+			for (size_t i = 0; i < chunkCount; i++) {
+				const char* chunkEnd = i + 1 == chunkCount ? end : SkipLine(begin + file.size() * (i + 1) / chunkCount, end);
+				chunkEnd = std::max(chunkEnd, chunkBegin);
+
+				chunks[i].begin = chunkBegin;
+				chunks[i].end = chunkEnd;
+				chunkBegin = chunkEnd;
+			}
+
+			workers.ParallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) { ParseObjChunk(chunks[i]); });
+
+			for (auto& chunk : chunks) {
+				if (!chunk.error.empty()) {
+					throw std::runtime_error(FilePath + ": " + chunk.error);
+				}
+			}
+
+			// Indices are global across the file, so every chunk needs the counts of the chunks before it
+			std::vector<uint32_t> positionBases(chunkCount);
+			std::vector<uint32_t> texCoordBases(chunkCount);
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> colors;
+			std::vector<glm::vec2> texCoords;
+			for (size_t i = 0; i < chunkCount; i++) {
+				positionBases[i] = static_cast<uint32_t>(positions.size());
+				texCoordBases[i] = static_cast<uint32_t>(texCoords.size());
+				positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+				colors.insert(colors.end(), chunks[i].colors.begin(), chunks[i].colors.end());
+				texCoords.insert(texCoords.end(), chunks[i].texCoords.begin(), chunks[i].texCoords.end());
+			}
+
+			std::vector<MeshChunk> meshChunks(chunkCount);
+			workers.ParallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) {
+				const ObjChunk& chunk = chunks[i];
+				MeshChunk& out = meshChunks[i];
+
+				size_t triangles = 0;
+				for (uint32_t size : chunk.faceSizes) {
+					triangles += size - 2;
+				}
+				out.inputVertices = triangles * 3;
+				out.indices.reserve(triangles * 3);
+
+				VertexHashMap map{ chunk.corners.size() };
+				std::vector<uint32_t> faceIndices;
+				size_t corner = 0;
+
+				for (size_t face = 0; face < chunk.faceSizes.size(); face++) {
+					faceIndices.clear();
+
+					for (uint32_t c = 0; c < chunk.faceSizes[face]; c++, corner++) {
+						const ObjCorner& objCorner = chunk.corners[corner];
+
+						int64_t position = objCorner.position > 0 ? objCorner.position - 1 : static_cast<int64_t>(positionBases[i]) + chunk.facePositionCounts[face] + objCorner.position;
+						int64_t texCoord = objCorner.texCoord > 0 ? objCorner.texCoord - 1 : static_cast<int64_t>(texCoordBases[i]) + chunk.faceTexCoordCounts[face] + objCorner.texCoord;
+
+						if (objCorner.position == 0 || position < 0 || position >= static_cast<int64_t>(positions.size())) {
+							out.error = FilePath + ": face references a missing position";
+							return;
+						}
+
+						Model::Vertex vertex{};
+						vertex.position = positions[position];
+						vertex.color = colors[position];
+						if (objCorner.texCoord != 0) {
+							if (texCoord < 0 || texCoord >= static_cast<int64_t>(texCoords.size())) {
+								out.error = FilePath + ": face references a missing texture coordinate";
+								return;
+							}
+							vertex.texCoord = texCoords[texCoord];
+						}
+
+						faceIndices.push_back(map.Insert(vertex, out.vertices));
+					}
+
+					// Polygons are triangulated as fans
+					for (size_t c = 2; c < faceIndices.size(); c++) {
+						out.indices.push_back(faceIndices[0]);
+						out.indices.push_back(faceIndices[c - 1]);
+						out.indices.push_back(faceIndices[c]);
+					}
+				}
+			});
+
+			MergeChunks(meshChunks, workers, mesh, stats);
+
+			std::string library;
+			std::string material;
+			for (auto& chunk : chunks) {
+				if (library.empty()) library = chunk.materialLibrary;
+				if (material.empty()) material = chunk.firstMaterial;
+			}
+			if (!library.empty()) {
+				mesh.texturePath = FindObjTexture(Directory(FilePath), library, material);
+			}
+		}
+
+		/*
+			 glTF
+		*/
+
+		// Just enough JSON for a glTF document
+		struct JsonValue {
+			enum class Type { Null, Bool, Number, String, Array, Object };
+
+			Type type = Type::Null;
+			bool boolean = false;
+			double number = 0.0;
+			std::string string;
+			std::vector<JsonValue> array;
+			std::vector<std::pair<std::string, JsonValue>> object;
+
+			const JsonValue* Find(const char* key) const {
+				for (auto& member : object) {
+					if (member.first == key) {
+						return &member.second;
+					}
+				}
+				return nullptr;
+			}
+
+			const JsonValue& operator[](size_t index) const {
+				if (type != Type::Array || index >= array.size()) {
+					throw std::runtime_error("glTF index out of range");
+				}
+				return array[index];
+			}
+
+			double Number(const char* key, double fallback) const {
+				const JsonValue* value = Find(key);
+				return value && value->type == Type::Number ? value->number : fallback;
+			}
+
+			uint32_t Index(const char* key) const {
+				const JsonValue* value = Find(key);
+				if (!value || value->type != Type::Number) {
+					throw std::runtime_error(std::string("glTF is missing ") + key);
+				}
+				return static_cast<uint32_t>(value->number);
+			}
+		};
+
+		class JsonParser
+		{
+			public:
+				JsonParser(const char* begin, const char* end) : p{ begin }, end{ end } {}
+
+				JsonValue Parse() {
+					JsonValue value = parseValue();
+					skipWhitespace();
+					if (p != end) {
+						throw std::runtime_error("trailing characters after glTF JSON");
+					}
+					return value;
+				}
+
+			private:
+				void skipWhitespace() {
+					while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+				}
+
+				void expect(char c) {
+					skipWhitespace();
+					if (p >= end || *p != c) {
+						throw std::runtime_error(std::string("malformed glTF JSON, expected '") + c + "'");
+					}
+					p++;
+				}
+
+				bool literal(const char* text) {
+					size_t length = strlen(text);
+					if (static_cast<size_t>(end - p) >= length && memcmp(p, text, length) == 0) {
+						p += length;
+						return true;
+					}
+					return false;
+				}
+
+				JsonValue parseValue() {
+					skipWhitespace();
+					if (p >= end) {
+						throw std::runtime_error("unexpected end of glTF JSON");
+					}
+
+					JsonValue value;
+					if (*p == '{') {
+						value.type = JsonValue::Type::Object;
+						p++;
+						skipWhitespace();
+						if (p < end && *p == '}') {
+							p++;
+							return value;
+						}
+						do {
+							skipWhitespace();
+							std::string key = parseString();
+							expect(':');
+							value.object.emplace_back(std::move(key), parseValue());
+							skipWhitespace();
+						} while (p < end && *p == ',' && ++p);
+						expect('}');
+					}
+					else if (*p == '[') {
+						value.type = JsonValue::Type::Array;
+						p++;
+						skipWhitespace();
+						if (p < end && *p == ']') {
+							p++;
+							return value;
+						}
+						do {
+							value.array.push_back(parseValue());
+							skipWhitespace();
+						} while (p < end && *p == ',' && ++p);
+						expect(']');
+					}
+					else if (*p == '"') {
+						value.type = JsonValue::Type::String;
+						value.string = parseString();
+					}
+					else if (literal("true")) {
+						value.type = JsonValue::Type::Bool;
+						value.boolean = true;
+					}
+					else if (literal("false")) {
+						value.type = JsonValue::Type::Bool;
+					}
+					else if (literal("null")) {
+						value.type = JsonValue::Type::Null;
+					}
+					else {
+						value.type = JsonValue::Type::Number;
+						if (*p == '+') p++;
+						auto result = std::from_chars(p, end, value.number);
+						if (result.ec != std::errc{}) {
+							throw std::runtime_error("malformed number in glTF JSON");
+						}
+						p = result.ptr;
+					}
+
+					return value;
+				}
+
+				std::string parseString() {
+					if (p >= end || *p != '"') {
+						throw std::runtime_error("malformed glTF JSON, expected a string");
+					}
+					p++;
+
+					std::string result;
+					while (p < end && *p != '"') {
+						if (*p == '\\' && p + 1 < end) {
+							p++;
+							switch (*p) {
+								case 'n': result += '\n'; break;
+								case 't': result += '\t'; break;
+								case 'r': result += '\r'; break;
+								case 'b': result += '\b'; break;
+								case 'f': result += '\f'; break;
+								case 'u': {
+									// Only what fits in one UTF-8 sequence without surrogate pairs, enough for file names
+									uint32_t code = 0;
+									if (end - p < 5 || std::from_chars(p + 1, p + 5, code, 16).ec != std::errc{}) {
+										throw std::runtime_error("malformed \\u escape in glTF JSON");
+									}
+									p += 4;
+									if (code < 0x80) {
+										result += static_cast<char>(code);
+									}
+									else if (code < 0x800) {
+										result += static_cast<char>(0xC0 | (code >> 6));
+										result += static_cast<char>(0x80 | (code & 0x3F));
+									}
+									else {
+										result += static_cast<char>(0xE0 | (code >> 12));
+										result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+										result += static_cast<char>(0x80 | (code & 0x3F));
+									}
+									break;
+								}
+								default: result += *p; break;
+							}
+							p++;
+						}
+						else {
+							result += *p++;
+						}
+					}
+
+					if (p >= end) {
+						throw std::runtime_error("unterminated string in glTF JSON");
+					}
+					p++;
+					return result;
+				}
+
+				const char* p;
+				const char* end;
+		};
+
+		std::vector<char> DecodeBase64(const std::string& text, size_t start) {
+			static const auto table = []() {
+				std::array<int8_t, 256> t;
+				t.fill(-1);
+				const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+				for (int i = 0; i < 64; i++) {
+					t[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+				}
+				return t;
+			}();
+
+			std::vector<char> bytes;
+			bytes.reserve((text.size() - start) * 3 / 4);
+
+			uint32_t accumulator = 0;
+			int bits = 0;
+			for (size_t i = start; i < text.size() && text[i] != '='; i++) {
+				int8_t value = table[static_cast<unsigned char>(text[i])];
+				if (value < 0) {
+					throw std::runtime_error("malformed base64 buffer in glTF");
+				}
+
+				accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+				bits += 6;
+				if (bits >= 8) {
+					bits -= 8;
+					bytes.push_back(static_cast<char>((accumulator >> bits) & 0xFF));
+				}
+			}
+
+			return bytes;
+		}
+
+		struct GltfDocument {
+			JsonValue json;
+			std::vector<std::vector<char>> buffers;
+		};
+
+		// Where an accessor's elements are, data is null when it has no buffer view and every value is 0
+		struct AccessorView {
+			const char* data = nullptr;
+			size_t stride = 0;
+			uint32_t count = 0;
+			uint32_t components = 0;
+			uint32_t componentType = 0;
+			uint32_t componentSize = 0;
+			bool normalized = false;
+		};
+
+		AccessorView FindAccessor(const GltfDocument& gltf, uint32_t accessorIndex) {
+			const JsonValue* accessors = gltf.json.Find("accessors");
+			if (!accessors) {
+				throw std::runtime_error("glTF has no accessors");
+			}
+			const JsonValue& accessor = (*accessors)[accessorIndex];
+
+			if (accessor.Find("sparse")) {
+				throw std::runtime_error("sparse glTF accessors are not supported");
+			}
+
+			AccessorView view;
+			const JsonValue* typeValue = accessor.Find("type");
+			std::string type = typeValue ? typeValue->string : "";
+			if (type == "SCALAR") view.components = 1;
+			else if (type == "VEC2") view.components = 2;
+			else if (type == "VEC3") view.components = 3;
+			else if (type == "VEC4") view.components = 4;
+			else throw std::runtime_error("unsupported glTF accessor type " + type);
+
+			view.count = accessor.Index("count");
+			view.componentType = accessor.Index("componentType");
+			const JsonValue* normalizedValue = accessor.Find("normalized");
+			view.normalized = normalizedValue && normalizedValue->boolean;
+
+			switch (view.componentType) {
+				case 5120: case 5121: view.componentSize = 1; break;
+				case 5122: case 5123: view.componentSize = 2; break;
+				case 5125: case 5126: view.componentSize = 4; break;
+				default: throw std::runtime_error("unsupported glTF component type");
+			}
+
+			if (!accessor.Find("bufferView")) {
+				return view;
+			}
+
+			const JsonValue* bufferViews = gltf.json.Find("bufferViews");
+			if (!bufferViews) {
+				throw std::runtime_error("failed to read glTF accessor: the file has no bufferViews");
+			}
+			const JsonValue& bufferView = (*bufferViews)[accessor.Index("bufferView")];
+			uint32_t bufferIndex = bufferView.Index("buffer");
+			if (bufferIndex >= gltf.buffers.size()) {
+				throw std::runtime_error("glTF buffer view references a missing buffer");
+			}
+
+			const std::vector<char>& buffer = gltf.buffers[bufferIndex];
+			size_t elementSize = static_cast<size_t>(view.componentSize) * view.components;
+			view.stride = static_cast<size_t>(bufferView.Number("byteStride", 0.0));
+			if (view.stride == 0) {
+				view.stride = elementSize;
+			}
+			size_t offset = static_cast<size_t>(bufferView.Number("byteOffset", 0.0) + accessor.Number("byteOffset", 0.0));
+
+			if (view.count > 0 && offset + view.stride * (view.count - 1) + elementSize > buffer.size()) {
+				throw std::runtime_error("glTF accessor reads past the end of its buffer");
+			}
+
+			view.data = buffer.data() + offset;
+			return view;
+		}
+
+		// Reads any accessor as floats (normalized integers mapped to [0, 1] / [-1, 1]), count * components values
+		std::vector<float> ReadAccessor(const GltfDocument& gltf, uint32_t accessorIndex, uint32_t& components) {
+			AccessorView view = FindAccessor(gltf, accessorIndex);
+			components = view.components;
+
+			std::vector<float> values(static_cast<size_t>(view.count) * components, 0.0f);
+			if (!view.data) {
+				return values;
+			}
+
+			bool normalized = view.normalized;
+			for (size_t i = 0; i < view.count; i++) {
+				const char* element = view.data + i * view.stride;
+				for (uint32_t c = 0; c < components; c++) {
+					const char* component = element + c * view.componentSize;
+					float value;
+
+					switch (view.componentType) {
+						case 5120: { int8_t v; memcpy(&v, component, 1); value = normalized ? std::max(v / 127.0f, -1.0f) : v; break; }
+						case 5121: { uint8_t v; memcpy(&v, component, 1); value = normalized ? v / 255.0f : v; break; }
+						case 5122: { int16_t v; memcpy(&v, component, 2); value = normalized ? std::max(v / 32767.0f, -1.0f) : v; break; }
+						case 5123: { uint16_t v; memcpy(&v, component, 2); value = normalized ? v / 65535.0f : v; break; }
+						case 5125: { uint32_t v; memcpy(&v, component, 4); value = static_cast<float>(v); break; }
+						default: memcpy(&value, component, 4); break;
+					}
+
+					values[i * components + c] = value;
+				}
+			}
+
+			return values;
+		}
+
+		// Index accessors straight to integers, a float only holds them exactly up to 2^24
+		std::vector<uint32_t> ReadIndices(const GltfDocument& gltf, uint32_t accessorIndex) {
+			AccessorView view = FindAccessor(gltf, accessorIndex);
+			if (view.components != 1 || (view.componentType != 5121 && view.componentType != 5123 && view.componentType != 5125)) {
+				throw std::runtime_error("glTF indices have to be unsigned byte, short or int scalars");
+			}
+
+			std::vector<uint32_t> indices(view.count, 0);
+			if (!view.data) {
+				return indices;
+			}
+
+			for (size_t i = 0; i < view.count; i++) {
+				const char* element = view.data + i * view.stride;
+				switch (view.componentType) {
+					case 5121: { uint8_t v; memcpy(&v, element, 1); indices[i] = v; break; }
+					case 5123: { uint16_t v; memcpy(&v, element, 2); indices[i] = v; break; }
+					default: memcpy(&indices[i], element, 4); break;
+				}
+			}
+
+			return indices;
+		}
+
+		glm::mat4 NodeMatrix(const JsonValue& node) {
+			glm::mat4 matrix{ 1.0f };
+
+			if (const JsonValue* values = node.Find("matrix")) {
+				// Column major like glm
+				for (int column = 0; column < 4; column++) {
+					for (int row = 0; row < 4; row++) {
+						matrix[column][row] = static_cast<float>((*values)[column * 4 + row].number);
+					}
+				}
+				return matrix;
+			}
+
+			glm::vec3 translation{ 0.0f };
+			glm::vec4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+			glm::vec3 scale{ 1.0f };
+			if (const JsonValue* t = node.Find("translation")) translation = { (*t)[0].number, (*t)[1].number, (*t)[2].number };
+			if (const JsonValue* r = node.Find("rotation")) rotation = { (*r)[0].number, (*r)[1].number, (*r)[2].number, (*r)[3].number };
+			if (const JsonValue* s = node.Find("scale")) scale = { (*s)[0].number, (*s)[1].number, (*s)[2].number };
+
+			// T * R * S with R from the (x, y, z, w) quaternion
+			float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+			matrix[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * scale.x;
+			matrix[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * scale.y;
+			matrix[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scale.z;
+			matrix[3] = glm::vec4(translation, 1.0f);
+			return matrix;
+		}
+
+		struct GltfInstance {
+			uint32_t mesh;
+			glm::mat4 transform;
+		};
+
+		void CollectInstances(const JsonValue& nodes, uint32_t nodeIndex, const glm::mat4& parent, std::vector<GltfInstance>& instances, uint32_t depth) {
+			if (depth > 64) {
+				throw std::runtime_error("glTF node hierarchy is too deep (cycle?)");
+			}
+
+			const JsonValue& node = nodes[nodeIndex];
+			glm::mat4 transform = parent * NodeMatrix(node);
+
+			if (node.Find("mesh")) {
+				instances.push_back({ node.Index("mesh"), transform });
+			}
+			if (const JsonValue* children = node.Find("children")) {
+				for (const auto& child : children->array) {
+					CollectInstances(nodes, static_cast<uint32_t>(child.number), transform, instances, depth + 1);
+				}
+			}
+		}
+
+		std::vector<char> LoadGltfBuffer(const JsonValue& buffer, const std::string& directory, std::vector<char>* glbBinary) {
+			const JsonValue* uri = buffer.Find("uri");
+			if (!uri) {
+				if (!glbBinary) {
+					throw std::runtime_error("glTF buffer without uri outside of a .glb");
+				}
+				return std::move(*glbBinary);
+			}
+
+			const std::string& text = uri->string;
+			if (text.compare(0, 5, "data:") == 0) {
+				size_t comma = text.find(";base64,");
+				if (comma == std::string::npos) {
+					throw std::runtime_error("only base64 data uris are supported in glTF");
+				}
+				return DecodeBase64(text, comma + 8);
+			}
+
+			return ReadBinaryFile(directory + text);
+		}
+
+		std::string FindGltfTexture(const JsonValue& json, const std::string& directory, const JsonValue& primitive) {
+			const JsonValue* materials = json.Find("materials");
+			const JsonValue* textures = json.Find("textures");
+			const JsonValue* images = json.Find("images");
+			if (!primitive.Find("material") || !materials || !textures || !images) {
+				return {};
+			}
+
+			const JsonValue& material = (*materials)[primitive.Index("material")];
+			const JsonValue* pbr = material.Find("pbrMetallicRoughness");
+			const JsonValue* baseColor = pbr ? pbr->Find("baseColorTexture") : nullptr;
+			if (!baseColor) {
+				return {};
+			}
+
+			const JsonValue& texture = (*textures)[baseColor->Index("index")];
+			if (!texture.Find("source")) {
+				return {};
+			}
+
+			// Embedded images would need decoding from memory, only files are handed to the texture cache
+			const JsonValue* uri = (*images)[texture.Index("source")].Find("uri");
+			if (!uri || uri->string.compare(0, 5, "data:") == 0) {
+				return {};
+			}
+			return directory + uri->string;
+		}
+
+		void ImportGltf(const std::string& FilePath, std::vector<char>& file, ThreadPool& workers, MeshData& mesh, ImportStats& stats) {
+			GltfDocument gltf;
+			std::vector<char> glbBinary;
+			bool glb = file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0;
+
+			if (glb) {
+				// 12 byte header, then a JSON chunk and an optional BIN chunk
+				size_t offset = 12;
+				const char* jsonBegin = nullptr;
+				const char* jsonEnd = nullptr;
+
+				while (offset + 8 <= file.size()) {
+					uint32_t chunkLength, chunkType;
+					memcpy(&chunkLength, file.data() + offset, 4);
+					memcpy(&chunkType, file.data() + offset + 4, 4);
+					if (offset + 8 + chunkLength > file.size()) {
+						throw std::runtime_error(FilePath + ": truncated glb chunk");
+					}
+
+					const char* chunkData = file.data() + offset + 8;
+					if (chunkType == 0x4E4F534A) {	// "JSON"
+						jsonBegin = chunkData;
+						jsonEnd = chunkData + chunkLength;
+					}
+					else if (chunkType == 0x004E4942) {	// "BIN\0"
+						glbBinary.assign(chunkData, chunkData + chunkLength);
+					}
+
+					offset += 8 + ((chunkLength + 3) & ~3u);
+				}
+
+				if (!jsonBegin) {
+					throw std::runtime_error(FilePath + ": glb without a JSON chunk");
+				}
+				gltf.json = JsonParser{ jsonBegin, jsonEnd }.Parse();
+			}
+			else {
+				gltf.json = JsonParser{ file.data(), file.data() + file.size() }.Parse();
+			}
+
+			std::string directory = Directory(FilePath);
+			if (const JsonValue* buffers = gltf.json.Find("buffers")) {
+				for (const auto& buffer : buffers->array) {
+					gltf.buffers.push_back(LoadGltfBuffer(buffer, directory, glb && gltf.buffers.empty() ? &glbBinary : nullptr));
+				}
+			}
+
+			const JsonValue* meshes = gltf.json.Find("meshes");
+			if (!meshes || meshes->array.empty()) {
+				throw std::runtime_error(FilePath + ": glTF has no meshes");
+			}
+
+			// Default scene with its transforms, every mesh untransformed when the file has no scene
+			std::vector<GltfInstance> instances;
+			const JsonValue* scenes = gltf.json.Find("scenes");
+			const JsonValue* nodes = gltf.json.Find("nodes");
+			if (scenes && nodes && !scenes->array.empty()) {
+				const JsonValue& scene = (*scenes)[static_cast<size_t>(gltf.json.Number("scene", 0.0))];
+				if (const JsonValue* roots = scene.Find("nodes")) {
+					for (const auto& root : roots->array) {
+						CollectInstances(*nodes, static_cast<uint32_t>(root.number), glm::mat4{ 1.0f }, instances, 0);
+					}
+				}
+			}
+			else {
+				for (uint32_t i = 0; i < meshes->array.size(); i++) {
+					instances.push_back({ i, glm::mat4{ 1.0f } });
+				}
+			}
+
+			struct PrimitiveJob {
+				const JsonValue* primitive;
+				const glm::mat4* transform;
+			};
+			std::vector<PrimitiveJob> jobs;
+			for (const auto& instance : instances) {
+				const JsonValue* primitives = (*meshes)[instance.mesh].Find("primitives");
+				if (!primitives) {
+					continue;
+				}
+
+				for (const auto& primitive : primitives->array) {
+					// Only triangle lists, points / lines / strips are skipped
+					if (primitive.Number("mode", 4.0) == 4.0) {
+						jobs.push_back({ &primitive, &instance.transform });
+					}
+				}
+			}
+
+			std::vector<MeshChunk> meshChunks(jobs.size());
+			workers.ParallelFor(static_cast<uint32_t>(jobs.size()), [&](uint32_t i) {
+				const JsonValue& primitive = *jobs[i].primitive;
+				const glm::mat4& transform = *jobs[i].transform;
+				MeshChunk& out = meshChunks[i];
+
+				try
+				{
+					const JsonValue* attributes = primitive.Find("attributes");
+					if (!attributes || !attributes->Find("POSITION")) {
+						throw std::runtime_error("glTF primitive without POSITION");
+					}
+
+					uint32_t positionComponents, texCoordComponents = 0, colorComponents = 0;
+					std::vector<float> positions = ReadAccessor(gltf, attributes->Index("POSITION"), positionComponents);
+					std::vector<float> texCoords = attributes->Find("TEXCOORD_0") ? ReadAccessor(gltf, attributes->Index("TEXCOORD_0"), texCoordComponents) : std::vector<float>{};
+					std::vector<float> colors = attributes->Find("COLOR_0") ? ReadAccessor(gltf, attributes->Index("COLOR_0"), colorComponents) : std::vector<float>{};
+
+					size_t vertexCount = positions.size() / positionComponents;
+					if (positionComponents != 3 || (texCoordComponents != 0 && texCoords.size() / texCoordComponents != vertexCount) || (colorComponents != 0 && colors.size() / colorComponents != vertexCount)) {
+						throw std::runtime_error("glTF primitive attributes don't match");
+					}
+
+					std::vector<uint32_t> indices;
+					if (primitive.Find("indices")) {
+						indices = ReadIndices(gltf, primitive.Index("indices"));
+						for (uint32_t index : indices) {
+							if (index >= vertexCount) {
+								throw std::runtime_error("glTF index out of range");
+							}
+						}
+					}
+					else {
+						indices.resize(vertexCount);
+						for (uint32_t v = 0; v < vertexCount; v++) {
+							indices[v] = v;
+						}
+					}
+					indices.resize(indices.size() - indices.size() % 3);
+
+					// A mirroring node turns every triangle around, swap two corners so they still face out under back-face culling
+					if (glm::determinant(glm::mat3(transform)) < 0.0f) {
+						for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+							std::swap(indices[t + 1], indices[t + 2]);
+						}
+					}
+
+					// Transformed once per source vertex, then corners are deduplicated by value
+					std::vector<Model::Vertex> vertices(vertexCount);
+					for (size_t v = 0; v < vertexCount; v++) {
+						glm::vec4 position = transform * glm::vec4(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f);
+						vertices[v].position = glm::vec3(position);
+						vertices[v].color = colorComponents ? glm::vec3(colors[v * colorComponents], colors[v * colorComponents + 1], colors[v * colorComponents + 2]) : glm::vec3(1.0f);
+						vertices[v].texCoord = texCoordComponents ? glm::vec2(texCoords[v * texCoordComponents], texCoords[v * texCoordComponents + 1]) : glm::vec2(0.0f);
+					}
+
+					VertexHashMap map{ vertexCount };
+					out.inputVertices = indices.size();
+					out.indices.reserve(indices.size());
+					for (uint32_t index : indices) {
+						out.indices.push_back(map.Insert(vertices[index], out.vertices));
+					}
+				}
+				catch (const std::exception& e)
+				{
+					out.error = FilePath + ": " + e.what();
+				}
+			});
+
+			MergeChunks(meshChunks, workers, mesh, stats);
+
+			if (!jobs.empty()) {
+				mesh.texturePath = FindGltfTexture(gltf.json, directory, *jobs[0].primitive);
+			}
+		}
+	}
+
+	MeshData ImportMesh(const std::string& FilePath, ThreadPool& workers, ImportStats* stats) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<char> file = ReadBinaryFile(FilePath);
+		std::string extension = Extension(FilePath);
+
+		MeshData mesh;
+		ImportStats importStats;
+		importStats.fileBytes = file.size();
+
+		if (extension == "obj") {
+			ImportObj(FilePath, file, workers, mesh, importStats);
+		}
+		else if (extension == "gltf" || extension == "glb") {
+			ImportGltf(FilePath, file, workers, mesh, importStats);
+		}
+		else {
+			throw std::runtime_error("unsupported mesh format: " + FilePath);
+		}
+
+		if (mesh.indices.empty()) {
+			throw std::runtime_error(FilePath + " contains no triangles");
+		}
+
+		importStats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		if (stats) {
+			*stats = importStats;
+		}
+
+		return mesh;
+	}
+}
\ No newline at end of file
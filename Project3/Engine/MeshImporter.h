@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Model.h"
+#include "ThreadPool.h"
+
+//std
+#include <vector>
+#include <string>
+
+namespace Engine
+{
+	struct MeshData {
+		std::vector<Model::Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		// Base color texture referenced by the file (map_Kd / baseColorTexture), empty when there is none
+		std::string texturePath;
+	};
+
+	struct ImportStats {
+		size_t fileBytes = 0;
+		size_t triangles = 0;
+		// Vertices before and after deduplication
+		size_t inputVertices = 0;
+		size_t uniqueVertices = 0;
+		double seconds = 0.0;
+
+		double MegabytesPerSecond() const { return seconds > 0.0 ? fileBytes / (1024.0 * 1024.0) / seconds : 0.0; }
+		double TrianglesPerSecond() const { return seconds > 0.0 ? triangles / seconds : 0.0; }
+	};
+
+	/*
+		Imports Wavefront OBJ (.obj) and glTF 2.0 (.gltf with external or embedded buffers, .glb) into one indexed triangle mesh.
+		Parsing is split across workers, OBJ by line ranges and glTF by primitive, identical vertices are merged through
+		an open addressing hash map. glTF node transforms of the default scene are applied, every mesh ends up in one buffer.
+		Throws std::runtime_error on malformed or unsupported files.
+	*/
+	MeshData ImportMesh(const std::string& FilePath, ThreadPool& workers, ImportStats* stats = nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "MeshOptimizer.h"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+namespace Engine {
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+		VertexCacheStats stats;
+		if (indices.empty()) {
+			return stats;
+		}
+
+		// A vertex is still cached while fewer than cacheSize misses happened since it was loaded
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+		size_t misses = 0;
+		size_t uniqueVertices = 0;
+
+		for (uint32_t index : indices) {
+			assert(index < vertexCount);
+
+			if (time - loadedAt[index] > cacheSize) {
+				loadedAt[index] = time++;
+				misses++;
+			}
+			if (!referenced[index]) {
+				referenced[index] = true;
+				uniqueVertices++;
+			}
+		}
+
+		stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+		stats.atvr = static_cast<float>(misses) / uniqueVertices;
+		return stats;
+	}
+
+	namespace {
+		constexpr uint32_t ForsythCacheSize = 32;
+		constexpr uint32_t ForsythValenceTable = 32;
+
+		struct ForsythScores {
+			float position[ForsythCacheSize];
+			float valence[ForsythValenceTable];
+
+			ForsythScores() {
+				// The last triangle's 3 vertices get a fixed score so the next triangle doesn't just reuse its edge
+				for (uint32_t i = 0; i < ForsythCacheSize; i++) {
+					position[i] = i < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / (ForsythCacheSize - 3), 1.5f);
+				}
+				// Vertices with few triangles left get a boost so they are finished off instead of left behind
+				valence[0] = 0.0f;
+				for (uint32_t i = 1; i < ForsythValenceTable; i++) {
+					valence[i] = 2.0f / std::sqrt(static_cast<float>(i));
+				}
+			}
+
+			float Vertex(int cachePosition, uint32_t liveTriangles) const {
+				if (liveTriangles == 0) {
+					return -1.0f;
+				}
+
+				float score = cachePosition >= 0 ? position[cachePosition] : 0.0f;
+				score += liveTriangles < ForsythValenceTable ? valence[liveTriangles] : 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+				return score;
+			}
+		};
+
+		// FIFO cache simulation, Reset() empties it and Triangle() returns how many of the triangle's vertices missed
+		struct FifoCache {
+			FifoCache(size_t vertexCount, uint32_t cacheSize) : loadedAt(vertexCount, 0), cacheSize{ cacheSize }, time{ cacheSize + 1 } {}
+
+			void Reset() { time += cacheSize + 1; }
+
+			uint32_t Triangle(const uint32_t* triangle) {
+				uint32_t misses = 0;
+				for (int i = 0; i < 3; i++) {
+					if (time - loadedAt[triangle[i]] > cacheSize) {
+						loadedAt[triangle[i]] = time++;
+						misses++;
+					}
+				}
+				return misses;
+			}
+
+			std::vector<uint32_t> loadedAt;
+			uint32_t cacheSize;
+			uint32_t time;
+		};
+	}
+
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		static const ForsythScores scores;
+
+		// Triangles using each vertex, live ones are kept at the front of every vertex's range
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (uint32_t index : indices) {
+			liveTriangles[index]++;
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+		}
+
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<int> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			vertexScores[v] = scores.Vertex(-1, liveTriangles[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		// 3 extra slots hold the vertices pushed out by the last triangle so their scores get updated
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> newCache;
+		cache.reserve(ForsythCacheSize + 3);
+		newCache.reserve(ForsythCacheSize + 3);
+
+		size_t cursor = 0;
+		int64_t best = -1;
+
+		for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+			if (best < 0) {
+				// Dead end: nothing in the cache has live triangles, continue with the next one in input order
+				while (emitted[cursor]) cursor++;
+				best = static_cast<int64_t>(cursor);
+			}
+
+			const uint32_t* triangle = &indices[static_cast<size_t>(best) * 3];
+			output.insert(output.end(), triangle, triangle + 3);
+			emitted[static_cast<size_t>(best)] = true;
+
+			for (int i = 0; i < 3; i++) {
+				uint32_t v = triangle[i];
+
+				// Swap the triangle out of the live part of the vertex's range
+				uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+				uint32_t* end = begin + liveTriangles[v];
+				uint32_t* found = std::find(begin, end, static_cast<uint32_t>(best));
+				std::swap(*found, end[-1]);
+				liveTriangles[v]--;
+			}
+
+			newCache.assign(triangle, triangle + 3);
+			for (uint32_t v : cache) {
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2] && newCache.size() < ForsythCacheSize + 3) {
+					newCache.push_back(v);
+				}
+			}
+			// Whatever falls out of the extra slots was already past ForsythCacheSize, its score doesn't change
+			std::swap(cache, newCache);
+
+			for (size_t i = 0; i < cache.size(); i++) {
+				uint32_t v = cache[i];
+				cachePositions[v] = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+
+				float score = scores.Vertex(cachePositions[v], liveTriangles[v]);
+				float delta = score - vertexScores[v];
+				vertexScores[v] = score;
+
+				for (uint32_t a = 0; a < liveTriangles[v]; a++) {
+					triangleScores[adjacency[adjacencyOffsets[v] + a]] += delta;
+				}
+			}
+
+			// Only once every vertex is updated, a triangle can share one pushed out of the cache further down it
+			best = -1;
+			float bestScore = -1.0f;
+			for (uint32_t v : cache) {
+				for (uint32_t a = 0; a < liveTriangles[v]; a++) {
+					uint32_t t = adjacency[adjacencyOffsets[v] + a];
+					if (triangleScores[t] > bestScore) {
+						bestScore = triangleScores[t];
+						best = t;
+					}
+				}
+			}
+		}
+
+		indices = std::move(output);
+	}
+
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Model::Vertex>& vertices, float threshold) {
+		constexpr uint32_t CacheSize = 16;
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2) {
+			return;
+		}
+
+		FifoCache cache{ vertices.size(), CacheSize };
+
+		/*
+			Hard boundaries: a triangle missing all 3 vertices starts over anyway, so cutting there costs nothing.
+			The first cluster always starts at 0, a degenerate first triangle only misses 2 and would be lost otherwise.
+		*/
+		std::vector<size_t> hardClusters = { 0 };
+		for (size_t t = 0; t < triangleCount; t++) {
+			if (cache.Triangle(&indices[t * 3]) == 3 && t != 0) {
+				hardClusters.push_back(t);
+			}
+		}
+		hardClusters.push_back(triangleCount);
+
+		// Soft boundaries: split further as soon as a piece's cold start ACMR is within threshold of its cluster's
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+			size_t begin = hardClusters[c];
+			size_t end = hardClusters[c + 1];
+
+			cache.Reset();
+			size_t clusterMisses = 0;
+			for (size_t t = begin; t < end; t++) {
+				clusterMisses += cache.Triangle(&indices[t * 3]);
+			}
+			float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+			cache.Reset();
+			size_t start = begin;
+			size_t misses = 0;
+			clusters.push_back(begin);
+			for (size_t t = begin; t < end; t++) {
+				misses += cache.Triangle(&indices[t * 3]);
+
+				if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= clusterAcmr * threshold) {
+					clusters.push_back(t + 1);
+					cache.Reset();
+					start = t + 1;
+					misses = 0;
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// Area weighted centroid and normal per cluster
+		struct Cluster {
+			size_t begin;
+			size_t end;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float area;
+			float sortKey;
+		};
+
+		std::vector<Cluster> clusterInfo;
+		glm::vec3 meshCentroid{ 0.0f };
+		float meshArea = 0.0f;
+
+		for (size_t c = 0; c + 1 < clusters.size(); c++) {
+			Cluster cluster{ clusters[c], clusters[c + 1], glm::vec3{ 0.0f }, glm::vec3{ 0.0f }, 0.0f, 0.0f };
+
+			for (size_t t = cluster.begin; t < cluster.end; t++) {
+				const glm::vec3& a = vertices[indices[t * 3]].position;
+				const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float area = glm::length(normal);
+
+				cluster.centroid = cluster.centroid + (a + b + c) * (area / 3.0f);
+				cluster.normal = cluster.normal + normal;
+				cluster.area += area;
+			}
+
+			meshCentroid = meshCentroid + cluster.centroid;
+			meshArea += cluster.area;
+
+			if (cluster.area > 0.0f) {
+				cluster.centroid = cluster.centroid * (1.0f / cluster.area);
+			}
+			clusterInfo.push_back(cluster);
+		}
+
+		if (meshArea > 0.0f) {
+			meshCentroid = meshCentroid * (1.0f / meshArea);
+		}
+
+		// Clusters far out along their own normal are likely in front of the rest of the mesh
+		for (auto& cluster : clusterInfo) {
+			float length = glm::length(cluster.normal);
+			cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal * (1.0f / length)) : 0.0f;
+		}
+
+		std::stable_sort(clusterInfo.begin(), clusterInfo.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (const auto& cluster : clusterInfo) {
+			output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+		}
+
+		indices = std::move(output);
+	}
+
+	void OptimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Model::Vertex> ordered;
+		ordered.reserve(vertices.size());
+
+		for (uint32_t& index : indices) {
+			if (remap[index] == UINT32_MAX) {
+				remap[index] = static_cast<uint32_t>(ordered.size());
+				ordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices = std::move(ordered);
+	}
+
+	MeshOptimizationStats OptimizeMesh(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) {
+		MeshOptimizationStats stats;
+		stats.before = AnalyzeVertexCache(indices, vertices.size());
+
+		OptimizeVertexCache(indices, vertices.size());
+		OptimizeOverdraw(indices, vertices);
+		OptimizeVertexFetch(vertices, indices);
+
+		stats.after = AnalyzeVertexCache(indices, vertices.size());
+		return stats;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Model.h"
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	struct VertexCacheStats {
+		float acmr = 0.0f;	// average cache misses per triangle, 0.5 is the best possible on a regular grid, 3 the worst
+		float atvr = 0.0f;	// average transformed vertices per vertex, 1 is optimal
+	};
+
+	struct MeshOptimizationStats {
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	// Simulates a FIFO post-transform cache of cacheSize entries over the index order
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Reorders triangles for post-transform cache hits (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/*
+		Reorders clusters of the cache optimized order so outward facing clusters come first and occlude the rest
+		(Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+		Clusters are only split while the ACMR stays within threshold times the input's.
+	*/
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Model::Vertex>& vertices, float threshold = 1.05f);
+
+	// Renumbers vertices in the order the indices first reference them so fetches walk the buffer linearly, unreferenced vertices are dropped
+	void OptimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// All three passes in the order they have to run
+	MeshOptimizationStats OptimizeMesh(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+}
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+//std
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+namespace Engine {
+	namespace {
+		// Symmetric 4x4 error matrix of a set of weighted planes, evaluates to the weighted sum of squared distances
+		struct Quadric {
+			float a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+			float b0 = 0, b1 = 0, b2 = 0;
+			float c = 0;
+			float weight = 0;
+
+			void AddPlane(glm::vec3 n, float d, float w) {
+				a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+				a10 += w * n.y * n.x; a20 += w * n.z * n.x; a21 += w * n.z * n.y;
+				b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+				c += w * d * d;
+				weight += w;
+			}
+
+			void Add(const Quadric& q) {
+				a00 += q.a00; a11 += q.a11; a22 += q.a22;
+				a10 += q.a10; a20 += q.a20; a21 += q.a21;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2;
+				c += q.c;
+				weight += q.weight;
+			}
+
+			float Error(glm::vec3 p) const {
+				float rx = a00 * p.x + a10 * p.y + a20 * p.z + b0;
+				float ry = a10 * p.x + a11 * p.y + a21 * p.z + b1;
+				float rz = a20 * p.x + a21 * p.y + a22 * p.z + b2;
+				float r = rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c;
+				return std::max(r, 0.0f);
+			}
+		};
+
+		enum VertexKind : uint8_t {
+			Manifold,	// collapses onto any neighbour
+			Border,		// on an open edge, only collapses along the border
+			Locked		// seams and non-manifold vertices never move
+		};
+
+		struct Collapse {
+			uint32_t from;
+			uint32_t to;
+			float error;
+		};
+
+		struct PositionKey {
+			uint32_t bits[3];
+			bool operator==(const PositionKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+		};
+
+		struct PositionHash {
+			size_t operator()(const PositionKey& key) const {
+				uint64_t h = 14695981039346656037ull;
+				for (uint32_t b : key.bits) {
+					h = (h ^ b) * 1099511628211ull;
+				}
+				return static_cast<size_t>(h ^ (h >> 32));
+			}
+		};
+
+		// Open addressing set of directed edges between positions
+		class EdgeSet
+		{
+			public:
+				void Reset(size_t maxEdges) {
+					size_t capacity = 16;
+					while (capacity < maxEdges * 2) {
+						capacity <<= 1;
+					}
+
+					slots.assign(capacity, Empty);
+					mask = capacity - 1;
+				}
+
+				// False when the edge was already there
+				bool Insert(uint32_t a, uint32_t b) {
+					uint64_t key = Key(a, b);
+					for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+						if (slots[slot] == Empty) {
+							slots[slot] = key;
+							return true;
+						}
+						if (slots[slot] == key) {
+							return false;
+						}
+					}
+				}
+
+				bool Contains(uint32_t a, uint32_t b) const {
+					uint64_t key = Key(a, b);
+					for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+						if (slots[slot] == key) {
+							return true;
+						}
+						if (slots[slot] == Empty) {
+							return false;
+						}
+					}
+				}
+
+			private:
+				// Vertex indices stay below UINT32_MAX, so no key is all ones
+				static constexpr uint64_t Empty = UINT64_MAX;
+
+				static uint64_t Key(uint32_t a, uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; }
+
+				static uint64_t Hash(uint64_t key) {
+					key ^= key >> 33;
+					key *= 0xff51afd7ed558ccdull;
+					key ^= key >> 33;
+					return key;
+				}
+
+				std::vector<uint64_t> slots;
+				size_t mask = 0;
+		};
+
+		glm::vec3 TriangleNormal(glm::vec3 a, glm::vec3 b, glm::vec3 c) { return glm::cross(b - a, c - a); }
+	}
+
+	std::vector<uint32_t> SimplifyMesh(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError, float* resultError) {
+		const size_t vertexCount = vertices.size();
+		std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+		float maxError = 0.0f;
+
+		if (result.size() <= targetIndexCount || vertexCount == 0) {
+			if (resultError) *resultError = 0.0f;
+			return result;
+		}
+
+		// Vertices split by attributes share a position, topology is built on the first vertex of every position
+		std::vector<uint32_t> positionOf(vertexCount);
+		std::vector<uint32_t> sharing(vertexCount, 0);
+		{
+			std::unordered_map<PositionKey, uint32_t, PositionHash> positions;
+			positions.reserve(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; v++) {
+				PositionKey key;
+				memcpy(key.bits, &vertices[v].position, sizeof(key.bits));
+				positionOf[v] = positions.emplace(key, v).first->second;
+				sharing[positionOf[v]]++;
+			}
+		}
+
+		std::vector<VertexKind> kinds(vertexCount, Manifold);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			if (sharing[positionOf[v]] > 1) {
+				kinds[v] = Locked;
+			}
+		}
+
+		// Directed edges between positions, rebuilt every pass since collapses create new ones
+		EdgeSet edges;
+		auto buildEdges = [&](bool classify) {
+			edges.Reset(result.size());
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (int e = 0; e < 3; e++) {
+					uint32_t a = positionOf[result[i + e]];
+					uint32_t b = positionOf[result[i + (e + 1) % 3]];
+					// An edge used twice in the same direction is non-manifold
+					if (!edges.Insert(a, b) && classify) {
+						kinds[a] = Locked;
+						kinds[b] = Locked;
+					}
+				}
+			}
+		};
+		buildEdges(true);
+
+		// A directed edge without its reverse is a border
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = positionOf[result[i + e]];
+				uint32_t b = positionOf[result[i + (e + 1) % 3]];
+				if (!edges.Contains(b, a)) {
+					if (kinds[a] == Manifold) kinds[a] = Border;
+					if (kinds[b] == Manifold) kinds[b] = Border;
+				}
+			}
+		}
+
+		// Face planes weighted by area, plus planes through border edges so borders keep their shape
+		const float BorderWeight = 10.0f;
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t tri[3] = { positionOf[result[i]], positionOf[result[i + 1]], positionOf[result[i + 2]] };
+			glm::vec3 p[3] = { vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position };
+
+			glm::vec3 normal = TriangleNormal(p[0], p[1], p[2]);
+			float length = glm::length(normal);
+			if (length == 0.0f) {
+				continue;
+			}
+			normal = normal * (1.0f / length);
+
+			Quadric face;
+			face.AddPlane(normal, -glm::dot(normal, p[0]), length * 0.5f);
+			for (uint32_t v : tri) {
+				quadrics[v].Add(face);
+			}
+
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = tri[e];
+				uint32_t b = tri[(e + 1) % 3];
+				if (edges.Contains(b, a)) {
+					continue;
+				}
+
+				glm::vec3 edge = p[(e + 1) % 3] - p[e];
+				float edgeLength = glm::length(edge);
+				if (edgeLength == 0.0f) {
+					continue;
+				}
+
+				glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+				Quadric border;
+				border.AddPlane(borderNormal, -glm::dot(borderNormal, p[e]), edgeLength * edgeLength * BorderWeight);
+				quadrics[a].Add(border);
+				quadrics[b].Add(border);
+			}
+		}
+
+		auto collapseError = [&](uint32_t from, uint32_t to) {
+			const Quadric& q0 = quadrics[positionOf[from]];
+			const Quadric& q1 = quadrics[positionOf[to]];
+			float weight = q0.weight + q1.weight;
+			glm::vec3 p = vertices[to].position;
+			return weight > 0.0f ? (q0.Error(p) + q1.Error(p)) / weight : 0.0f;
+		};
+
+		// Border vertices stay on the border, moving inwards would open a hole
+		auto canCollapse = [&](uint32_t from, uint32_t to, bool borderEdge) {
+			uint32_t a = positionOf[from];
+			if (a == positionOf[to] || kinds[a] == Locked) {
+				return false;
+			}
+			return kinds[a] == Manifold || borderEdge;
+		};
+
+		const float errorLimit = targetError * targetError;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> locked(vertexCount);
+
+		for (bool firstPass = true; result.size() > targetIndexCount; firstPass = false) {
+			size_t triangleCount = result.size() / 3;
+			if (!firstPass) {
+				buildEdges(false);
+			}
+
+			// Triangles around every vertex, only needed for vertices that can move (they are never shared)
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t index : result) {
+				adjacencyOffsets[index + 1]++;
+			}
+			for (size_t v = 0; v < vertexCount; v++) {
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			}
+			adjacency.resize(result.size());
+			{
+				std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); i++) {
+					adjacency[filled[result[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			// Every edge once with its cheaper valid direction
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (int e = 0; e < 3; e++) {
+					uint32_t a = result[i + e];
+					uint32_t b = result[i + (e + 1) % 3];
+					bool border = !edges.Contains(positionOf[b], positionOf[a]);
+					if (!border && positionOf[a] > positionOf[b]) {
+						continue;
+					}
+
+					Collapse best{ a, b, FLT_MAX };
+					if (canCollapse(a, b, border)) {
+						best.error = collapseError(a, b);
+					}
+					if (canCollapse(b, a, border)) {
+						float error = collapseError(b, a);
+						if (error < best.error) {
+							best = { b, a, error };
+						}
+					}
+					if (best.error <= errorLimit) {
+						collapses.push_back(best);
+					}
+				}
+			}
+
+			if (collapses.empty()) {
+				break;
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			for (uint32_t v = 0; v < vertexCount; v++) {
+				remap[v] = v;
+			}
+			std::fill(locked.begin(), locked.end(), false);
+
+			// Each collapse removes one or two triangles, stop once this pass reached the target
+			size_t trianglesToRemove = (triangleCount - targetIndexCount / 3);
+			size_t removed = 0;
+			size_t applied = 0;
+
+			for (const Collapse& collapse : collapses) {
+				if (removed >= trianglesToRemove) {
+					break;
+				}
+
+				uint32_t from = collapse.from;
+				uint32_t to = collapse.to;
+				if (locked[from] || locked[to]) {
+					continue;
+				}
+
+				// Reject collapses that flip or flatten a triangle that survives it
+				bool flips = false;
+				uint32_t collapsedTriangles = 0;
+				glm::vec3 target = vertices[to].position;
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && !flips; a++) {
+					const uint32_t* tri = &result[adjacency[a] * 3];
+					if (tri[0] == to || tri[1] == to || tri[2] == to) {
+						collapsedTriangles++;
+						continue;
+					}
+
+					glm::vec3 p[3] = { vertices[tri[0]].position, vertices[tri[1]].position, vertices[tri[2]].position };
+					glm::vec3 before = TriangleNormal(p[0], p[1], p[2]);
+					for (int i = 0; i < 3; i++) {
+						if (tri[i] == from) p[i] = target;
+					}
+					glm::vec3 after = TriangleNormal(p[0], p[1], p[2]);
+					flips = glm::dot(before, after) <= 0.0f;
+				}
+				if (flips || collapsedTriangles == 0) {
+					continue;
+				}
+
+				// Lock the whole one ring so later flip tests in this pass never look at a triangle that already changed
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+					const uint32_t* tri = &result[adjacency[a] * 3];
+					locked[tri[0]] = true;
+					locked[tri[1]] = true;
+					locked[tri[2]] = true;
+				}
+
+				remap[from] = to;
+				quadrics[positionOf[to]].Add(quadrics[positionOf[from]]);
+				maxError = std::max(maxError, collapse.error);
+				removed += collapsedTriangles;
+				applied++;
+			}
+
+			if (applied == 0) {
+				break;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32_t a = remap[result[i]];
+				uint32_t b = remap[result[i + 1]];
+				uint32_t c = remap[result[i + 2]];
+				if (a == b || b == c || a == c) {
+					continue;
+				}
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		if (resultError) *resultError = std::sqrt(maxError);
+		return result;
+	}
+
+	std::vector<Model::Lod> GenerateLods(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t maxLods, float reduction, float maxError) {
+		const size_t MinLodTriangles = 32;
+
+		std::vector<Model::Lod> lods;
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+		if (vertices.empty()) {
+			return lods;
+		}
+
+		glm::vec3 Min = vertices[0].position;
+		glm::vec3 Max = vertices[0].position;
+		for (const auto& vertex : vertices) {
+			Min = glm::min(Min, vertex.position);
+			Max = glm::max(Max, vertex.position);
+		}
+		float radius = glm::length(Max - Min) * 0.5f;
+
+		std::vector<uint32_t> previous = indices;
+		while (lods.size() < maxLods && previous.size() / 3 > MinLodTriangles) {
+			size_t target = std::max(static_cast<size_t>(previous.size() / 3 * reduction), MinLodTriangles) * 3;
+			// What the earlier levels haven't used of maxError, every level moves the surface further from LOD 0
+			float budget = maxError * radius - lods.back().error;
+			if (budget <= 0.0f) {
+				break;
+			}
+
+			float error = 0.0f;
+			std::vector<uint32_t> simplified = SimplifyMesh(vertices, previous, target, budget, &error);
+			if (simplified.empty() || simplified.size() > previous.size() * 85 / 100) {
+				break;
+			}
+
+			OptimizeVertexCache(simplified, vertices.size());
+
+			// SimplifyMesh measures against the previous level, the sum of every level's error bounds the distance to LOD 0
+			Model::Lod lod;
+			lod.firstIndex = static_cast<uint32_t>(indices.size());
+			lod.indexCount = static_cast<uint32_t>(simplified.size());
+			lod.error = lods.back().error + error;
+			lods.push_back(lod);
+
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previous = std::move(simplified);
+		}
+
+		return lods;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Model.h"
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Quadric error metric edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+		Vertices are only ever collapsed onto one of their neighbours, the result indexes the same vertex buffer so every
+		LOD can live in one index buffer. Open borders only collapse along themselves, vertices sharing a position with
+		other vertices (UV / color seams) are kept so the seams don't tear.
+		Stops at targetIndexCount or once the next collapse would move the surface further than targetError (model space units).
+		resultError receives the largest error actually introduced.
+	*/
+	std::vector<uint32_t> SimplifyMesh(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	/*
+		Appends up to maxLods - 1 simplified versions of indices [0, indices.size()) to indices, each with about reduction times
+		the triangles of the one before, and returns the ranges with LOD 0 being the input. A level's error adds up the errors
+		of every level before it, and the chain ends early when a level can't get below 85% of the previous one without the
+		total going past maxError (relative to the mesh's bounding radius).
+	*/
+	std::vector<Model::Lod> GenerateLods(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t maxLods = Model::MaxLods, float reduction = 0.5f, float maxError = 0.05f);
+}
\ No newline at end of file
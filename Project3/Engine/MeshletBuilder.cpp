@@ -0,0 +1,204 @@
+#include "MeshletBuilder.h"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <cfloat>
+
+namespace Engine {
+	namespace {
+		// Sphere on the AABB center and normal cone (Meshoptimizer's meshopt_computeClusterBounds) of one meshlet
+		void ComputeMeshletBounds(const std::vector<Model::Vertex>& vertices, const uint32_t* indices, Model::Meshlet& meshlet) {
+			const uint32_t indexCount = meshlet.triangleCount * 3;
+
+			glm::vec3 Min = vertices[indices[0]].position;
+			glm::vec3 Max = Min;
+			for (uint32_t i = 0; i < indexCount; i++) {
+				Min = glm::min(Min, vertices[indices[i]].position);
+				Max = glm::max(Max, vertices[indices[i]].position);
+			}
+			meshlet.center = (Min + Max) * 0.5f;
+			meshlet.radius = 0.0f;
+			for (uint32_t i = 0; i < indexCount; i++) {
+				meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+			}
+
+			// Front faces are counter clockwise, the normals point towards the side that gets drawn
+			std::vector<glm::vec3> normals;
+			normals.reserve(meshlet.triangleCount);
+			glm::vec3 axis{ 0.0f };
+			for (uint32_t i = 0; i < indexCount; i += 3) {
+				glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - vertices[indices[i]].position, vertices[indices[i + 2]].position - vertices[indices[i]].position);
+				float length = glm::length(normal);
+				normals.push_back(length > 0.0f ? normal / length : glm::vec3{ 0.0f });
+				axis += normals.back();
+			}
+
+			meshlet.coneApex = meshlet.center;
+			meshlet.coneAxis = glm::vec3{ 0.0f, 1.0f, 0.0f };
+			meshlet.coneCutoff = 2.0f;
+
+			float axisLength = glm::length(axis);
+			if (axisLength < 1e-6f) {
+				return;
+			}
+			axis /= axisLength;
+
+			float minDot = 1.0f;
+			for (const glm::vec3& normal : normals) {
+				if (normal != glm::vec3{ 0.0f }) {
+					minDot = std::min(minDot, glm::dot(axis, normal));
+				}
+			}
+
+			// Normals spread too wide for the cone to ever cull anything useful
+			if (minDot <= 0.1f) {
+				return;
+			}
+
+			// Apex on the axis behind every triangle's plane, the camera sees all backs once it is outside the inverted cone from there
+			float maxT = 0.0f;
+			for (uint32_t i = 0; i < indexCount; i += 3) {
+				const glm::vec3& normal = normals[i / 3];
+				if (normal == glm::vec3{ 0.0f }) {
+					continue;
+				}
+				float t = glm::dot(meshlet.center - vertices[indices[i]].position, normal) / glm::dot(axis, normal);
+				maxT = std::max(maxT, t);
+			}
+
+			meshlet.coneApex = meshlet.center - axis * maxT;
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	std::vector<Model::Meshlet> BuildMeshlets(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t indexCount) {
+		assert(indexCount % 3 == 0 && indexCount <= indices.size());
+
+		const uint32_t triangleCount = indexCount / 3;
+		const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+		std::vector<Model::Meshlet> meshlets;
+		if (triangleCount == 0) {
+			return meshlets;
+		}
+
+		// Vertex -> triangles adjacency
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			adjacencyOffsets[indices[i] + 1]++;
+		}
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t i = 0; i < indexCount; i++) {
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<glm::vec3> centroids(triangleCount);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			centroids[t] = (vertices[indices[t * 3]].position + vertices[indices[t * 3 + 1]].position + vertices[indices[t * 3 + 2]].position) / 3.0f;
+		}
+
+		std::vector<bool> used(triangleCount, false);
+		// Stamped with the meshlet number + 1, saves clearing them per meshlet
+		std::vector<uint32_t> vertexInMeshlet(vertexCount, 0);
+		std::vector<uint32_t> candidateOf(triangleCount, 0);
+
+		std::vector<uint32_t> reordered;
+		reordered.reserve(indexCount);
+		std::vector<uint32_t> candidates;
+
+		uint32_t nextSeed = 0;
+		while (true) {
+			while (nextSeed < triangleCount && used[nextSeed]) {
+				nextSeed++;
+			}
+			if (nextSeed == triangleCount) {
+				break;
+			}
+
+			const uint32_t stamp = static_cast<uint32_t>(meshlets.size()) + 1;
+			Model::Meshlet meshlet{};
+			meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+			glm::vec3 centroidSum{ 0.0f };
+			candidates.clear();
+
+			auto newVertices = [&](uint32_t t) {
+				uint32_t count = 0;
+				for (uint32_t k = 0; k < 3; k++) {
+					count += vertexInMeshlet[indices[t * 3 + k]] != stamp;
+				}
+				return count;
+			};
+
+			auto add = [&](uint32_t t) {
+				used[t] = true;
+				meshlet.vertexCount += newVertices(t);
+				meshlet.triangleCount++;
+				centroidSum += centroids[t];
+
+				for (uint32_t k = 0; k < 3; k++) {
+					uint32_t v = indices[t * 3 + k];
+					vertexInMeshlet[v] = stamp;
+					reordered.push_back(v);
+
+					for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+						uint32_t neighbour = adjacency[a];
+						if (!used[neighbour] && candidateOf[neighbour] != stamp) {
+							candidateOf[neighbour] = stamp;
+							candidates.push_back(neighbour);
+						}
+					}
+				}
+			};
+
+			add(nextSeed);
+
+			while (meshlet.triangleCount < Model::MaxMeshletTriangles) {
+				glm::vec3 centroid = centroidSum / static_cast<float>(meshlet.triangleCount);
+				uint32_t best = UINT32_MAX;
+				uint32_t bestNew = UINT32_MAX;
+				float bestDistance = FLT_MAX;
+
+				for (size_t c = 0; c < candidates.size();) {
+					uint32_t t = candidates[c];
+					if (used[t]) {
+						candidates[c] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+					c++;
+
+					uint32_t added = newVertices(t);
+					if (meshlet.vertexCount + added > Model::MaxMeshletVertices) {
+						continue;
+					}
+
+					glm::vec3 offset = centroids[t] - centroid;
+					float distance = glm::dot(offset, offset);
+					if (added < bestNew || (added == bestNew && distance < bestDistance)) {
+						best = t;
+						bestNew = added;
+						bestDistance = distance;
+					}
+				}
+
+				// Nothing connected fits anymore, an unconnected triangle would only inflate the bounds
+				if (best == UINT32_MAX) {
+					break;
+				}
+				add(best);
+			}
+
+			ComputeMeshletBounds(vertices, reordered.data() + meshlet.firstIndex, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		std::copy(reordered.begin(), reordered.end(), indices.begin());
+		return meshlets;
+	}
+}
\ No newline at end of file
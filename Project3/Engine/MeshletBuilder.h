@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Model.h"
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Splits the triangles in indices [0, indexCount) (LOD 0) into meshlets of at most Model::MaxMeshletVertices vertices
+		and Model::MaxMeshletTriangles triangles and rewrites that range so every meshlet is contiguous. Meshlets are grown
+		greedily from a seed triangle over shared vertices, preferring triangles that add the fewest new vertices and lie
+		closest to the meshlet, which keeps bounding spheres and normal cones tight. Run it after OptimizeMesh and
+		GenerateLods, meshlets follow the vertex cache order of their seeds so the reorder costs little cache efficiency.
+	*/
+	std::vector<Model::Meshlet> BuildMeshlets(const std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t indexCount);
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "MeshletCuller.h"
+
+//std
+#include <algorithm>
+
+namespace Engine {
+	MeshletCuller::MeshletCuller(Device& device, Camera& Camera, Model& model) : device{ device }, model{ model } {
+		assert(model.GetMeshletCount() > 0 && "cluster culling needs a model with meshlets");
+
+		createBuffers();
+		createDescriptorSetLayout();
+		createDescriptorSets(Camera);
+		createPipelineLayout();
+		createComputePipeline();
+	}
+
+	MeshletCuller::~MeshletCuller() {
+		vkDestroyBuffer(device.device(), DrawBuffer, nullptr);
+		vkFreeMemory(device.device(), DrawBufferMemory, nullptr);
+		vkDestroyBuffer(device.device(), CulledIndexBuffer, nullptr);
+		vkFreeMemory(device.device(), CulledIndexBufferMemory, nullptr);
+
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	}
+
+	void MeshletCuller::createBuffers() {
+		static_assert(offsetof(DrawBufferContents, positionScale) == 160, "DrawBufferContents has to match the Draws block of MeshletCull.comp");
+
+		device.createBuffer(
+			DrawBuffer,
+			sizeof(DrawBufferContents),
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			DrawBufferMemory
+		);
+
+		CulledIndexBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(model.GetLod(0).indexCount) * MaxInstances;
+		device.createBuffer(
+			CulledIndexBuffer,
+			CulledIndexBufferSize,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			CulledIndexBufferMemory
+		);
+	}
+
+	void MeshletCuller::createDescriptorSetLayout() {
+		// 0 camera, 1 meshlets, 2 model indices, 3 draws, 4 compacted indices
+		std::array<VkDescriptorSetLayoutBinding, 5> bindingInfo{};
+		for (uint32_t i = 0; i < bindingInfo.size(); i++) {
+			bindingInfo[i].binding = i;
+			bindingInfo[i].descriptorCount = 1;
+			bindingInfo[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindingInfo[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingInfo[i].pImmutableSamplers = nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create meshlet culling descriptor set layout");
+		}
+	}
+
+	void MeshletCuller::createDescriptorSets(Camera& Camera) {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = device.DescriptorPool();
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate meshlet culling descriptor sets");
+		}
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			std::array<VkDescriptorBufferInfo, 5> bufferInfo{};
+			bufferInfo[0] = { Camera.GetCameraBuffer(static_cast<uint32_t>(i)), 0, sizeof(Camera::CameraUBO) };
+			bufferInfo[1] = { model.GetMeshletBuffer(), 0, sizeof(Model::Meshlet) * model.GetMeshletCount() };
+			bufferInfo[2] = { model.GetIndexBuffer(), 0, model.GetIndexBufferSize() };
+			bufferInfo[3] = { DrawBuffer, 0, sizeof(DrawBufferContents) };
+			bufferInfo[4] = { CulledIndexBuffer, 0, CulledIndexBufferSize };
+
+			std::array<VkWriteDescriptorSet, 5> WriteSet{};
+			for (uint32_t b = 0; b < WriteSet.size(); b++) {
+				WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteSet[b].dstSet = DescriptorSets[i];
+				WriteSet[b].dstBinding = b;
+				WriteSet[b].dstArrayElement = 0;
+				WriteSet[b].descriptorCount = 1;
+				WriteSet[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				WriteSet[b].pBufferInfo = &bufferInfo[b];
+			}
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void MeshletCuller::createPipelineLayout() {
+		VkPushConstantRange paramsRange{};
+		paramsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		paramsRange.offset = 0;
+		paramsRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &paramsRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create meshlet culling pipeline layout");
+		}
+	}
+
+	void MeshletCuller::createComputePipeline() {
+		pipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/MeshletCull.comp.spv",
+			pipelineLayout
+		);
+	}
+
+	void MeshletCuller::Cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, const glm::vec4* positionScales, uint32_t count) {
+		count = std::min(count, MaxInstances);
+		if (count == 0) {
+			return;
+		}
+
+		// Draws start empty, each instance owns its slice of the compacted index buffer
+		DrawBufferContents contents{};
+		for (uint32_t i = 0; i < count; i++) {
+			contents.commands[i].indexCount = 0;
+			contents.commands[i].instanceCount = 1;
+			contents.commands[i].firstIndex = model.GetLod(0).indexCount * i;
+			contents.commands[i].vertexOffset = 0;
+			contents.commands[i].firstInstance = 0;
+			contents.positionScale[i] = positionScales[i];
+		}
+
+		// The previous frame may still be culling into or drawing from both buffers
+		VkMemoryBarrier previousBarrier{};
+		previousBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		previousBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		previousBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &previousBarrier, 0, nullptr, 0, nullptr
+		);
+
+		vkCmdUpdateBuffer(commandBuffer, DrawBuffer, 0, sizeof(contents), &contents);
+
+		VkBufferMemoryBarrier resetBarrier{};
+		resetBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		resetBarrier.buffer = DrawBuffer;
+		resetBarrier.offset = 0;
+		resetBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &resetBarrier, 0, nullptr);
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+
+		// 65535 is the smallest maxComputeWorkGroupCount the spec allows
+		const uint32_t MaxGroups = 65535;
+		for (uint32_t offset = 0; offset < model.GetMeshletCount(); offset += MaxGroups) {
+			PushConstants params{ offset };
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+			vkCmdDispatch(commandBuffer, std::min(model.GetMeshletCount() - offset, MaxGroups), count, 1);
+		}
+
+		VkMemoryBarrier culledBarrier{};
+		culledBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		culledBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		culledBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0, 1, &culledBarrier, 0, nullptr, 0, nullptr
+		);
+	}
+}
\ No newline at end of file
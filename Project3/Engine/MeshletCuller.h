@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Model.h"
+#include "Camera.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		GPU cluster culling for a model with meshlets, without mesh shaders. Cull() runs MeshletCull.comp over every meshlet
+		of every instance: meshlets outside the frustum or whose normal cone faces away from the camera are dropped, the
+		indices of the others are compacted into one range per instance together with an indirect draw covering it.
+		Draw() then renders an instance with a single vkCmdDrawIndexedIndirect, the CPU never sees the counts.
+	*/
+	class MeshletCuller
+	{
+	public:
+		struct PushConstants {
+			uint32_t meshletOffset;	// dispatches are split to stay under the workgroup count limit
+		};
+
+		// Every instance reserves room for all of LOD 0's indices in the compacted index buffer
+		static constexpr uint32_t MaxInstances = 8;
+
+		MeshletCuller(Device& device, Camera& Camera, Model& model);
+		~MeshletCuller();
+
+		MeshletCuller(const MeshletCuller&) = delete;
+		MeshletCuller& operator=(const MeshletCuller&) = delete;
+
+		// Outside of a render pass, instances past MaxInstances are ignored
+		void Cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, const glm::vec4* positionScales, uint32_t count);
+
+		// Inside the render pass, in place of the model's own index buffer
+		void BindIndex(VkCommandBuffer commandBuffer) { vkCmdBindIndexBuffer(commandBuffer, CulledIndexBuffer, 0, VK_INDEX_TYPE_UINT32); }
+		void Draw(VkCommandBuffer commandBuffer, uint32_t instance) {
+			vkCmdDrawIndexedIndirect(commandBuffer, DrawBuffer, GetDrawOffset(instance), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		// For recording the same draws elsewhere, a RenderQueue
+		VkBuffer GetIndexBuffer() { return CulledIndexBuffer; }
+		VkBuffer GetDrawBuffer() { return DrawBuffer; }
+		static VkDeviceSize GetDrawOffset(uint32_t instance) { return sizeof(VkDrawIndexedIndirectCommand) * instance; }
+
+	private:
+		// Contents of DrawBuffer, matches the Draws block of MeshletCull.comp
+		struct DrawBufferContents {
+			VkDrawIndexedIndirectCommand commands[MaxInstances];
+			glm::vec4 positionScale[MaxInstances];
+		};
+
+		void createBuffers();
+		void createDescriptorSetLayout();
+		void createDescriptorSets(Camera& Camera);
+		void createPipelineLayout();
+		void createComputePipeline();
+
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+
+		/*
+			Device local and shared by the frames in flight, Cull() waits for the previous frame's draws before it
+			overwrites them so a second copy isn't worth the memory.
+		*/
+		VkBuffer DrawBuffer;
+		VkDeviceMemory DrawBufferMemory;
+		VkBuffer CulledIndexBuffer;
+		VkDeviceMemory CulledIndexBufferMemory;
+		VkDeviceSize CulledIndexBufferSize;
+
+		Device& device;
+		Model& model;
+		std::unique_ptr<CPipeline> pipeline;
+	};
+}
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include "Model.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <algorithm>
 
 namespace Engine {
 	std::array<VkVertexInputAttributeDescription, 3> Model::Vertex::AttributeDescriptions() {
@@ -39,12 +38,64 @@ namespace Engine {
 		return bindingDescriptions;
 	}
 
-	Model::Model(Device& dev, const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices) : device{ dev } {
-		createTextureImage();
-		createTextureImageView();
-		createTextureSampler();
-		createVertexBuffer(vertices);
-		createIndexBuffer(indices);
+	std::array<VkVertexInputAttributeDescription, 1> Model::Vertex::PositionAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 1> attribDescriptions;
+
+		attribDescriptions[0] = {};
+		attribDescriptions[0].binding = 0;
+		attribDescriptions[0].location = 0;
+		attribDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attribDescriptions[0].offset = 0;
+
+		return attribDescriptions;
+	}
+
+	std::array<VkVertexInputBindingDescription, 1> Model::Vertex::PositionBindingDescriptions() {
+		std::array<VkVertexInputBindingDescription, 1> bindingDescriptions;
+
+		bindingDescriptions[0] = {};
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(glm::vec3);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescriptions;
+	}
+
+	Model::PulledVertexLayout Model::PulledVertexLayout::Default() {
+		static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex must be made of 32-bit words to be pulled from a storage buffer");
+
+		PulledVertexLayout layout{};
+		layout.stride = sizeof(Vertex) / sizeof(uint32_t);
+		layout.positionOffset = offsetof(Vertex, position) / sizeof(uint32_t);
+		layout.colorOffset = offsetof(Vertex, color) / sizeof(uint32_t);
+		layout.texCoordOffset = offsetof(Vertex, texCoord) / sizeof(uint32_t);
+		layout.flags = 0;
+
+		return layout;
+	}
+
+	Model::Model(Device& dev, TextureCache& textures, const std::string& TexturePath, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<Lod>& lods, const std::vector<Meshlet>& meshlets) :
+		Model(dev, textures, TexturePath, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()), lods.data(), static_cast<uint32_t>(lods.size()), meshlets.data(), static_cast<uint32_t>(meshlets.size())) {}
+
+	Model::Model(Device& dev, TextureCache& textures, const std::string& TexturePath, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const Lod* lods, uint32_t lodCount, const Meshlet* meshlets, uint32_t meshletCount) : device{ dev }, textures{ textures } {
+		if (lodCount > 0) {
+			Lods.assign(lods, lods + lodCount);
+		}
+		else {
+			Lods.push_back({ 0, indexCount, 0.0f });
+		}
+		for (const auto& lod : Lods) {
+			assert(lod.firstIndex + lod.indexCount <= indexCount && "LOD outside of the index buffer");
+		}
+		for (uint32_t i = 0; i < meshletCount; i++) {
+			assert(meshlets[i].firstIndex + meshlets[i].triangleCount * 3 <= indexCount && "meshlet outside of the index buffer");
+		}
+
+		texture = textures.Load(TexturePath);
+		createVertexBuffer(vertices, vertexCount);
+		createPositionBuffer(vertices, vertexCount);
+		createIndexBuffer(indices, indexCount);
+		createMeshletBuffer(meshlets, meshletCount);
 		createUniformBuffers();
 	}
 
@@ -54,23 +105,57 @@ namespace Engine {
 			vkFreeMemory(device.device(), UniformBuffersMemory[i], nullptr);
 		}
 
+		if (MeshletBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device.device(), MeshletBuffer, nullptr);
+			vkFreeMemory(device.device(), MeshletBufferMemory, nullptr);
+		}
+
 		vkDestroyBuffer(device.device(), IndexBuffer, nullptr);
 		vkFreeMemory(device.device(), IndexBufferMemory, nullptr);
 
+		vkDestroyBuffer(device.device(), PositionBuffer, nullptr);
+		vkFreeMemory(device.device(), PositionBufferMemory, nullptr);
+
 		vkDestroyBuffer(device.device(), VertexBuffer, nullptr);
 		vkFreeMemory(device.device(), VertexBufferMemory, nullptr);
+	}
+
+	uint32_t Model::SelectLod(float projectedSize, float pixelError) const {
+		if (BoundsRadius <= 0.0f) {
+			return 0;
+		}
 
-		vkDestroySampler(device.device(), TextureSampler, nullptr);
-		vkDestroyImageView(device.device(), TextureImageView, nullptr);
+		// projectedSize covers the bounding sphere's diameter, errors scale with it
+		float pixelsPerUnit = projectedSize / (BoundsRadius * 2.0f);
 
-		vkDestroyImage(device.device(), TextureImage, nullptr);
-		vkFreeMemory(device.device(), TextureBufferMemory, nullptr);
+		uint32_t selected = 0;
+		for (uint32_t i = 1; i < Lods.size(); i++) {
+			if (Lods[i].error * pixelsPerUnit > pixelError) {
+				break;
+			}
+			selected = i;
+		}
+		return selected;
 	}
 
-	void Model::createVertexBuffer(const std::vector<Vertex>& vertices) {
-		vertexCounts = static_cast<uint32_t>(vertices.size());
+	void Model::createVertexBuffer(const Vertex* vertices, uint32_t vertexCount) {
+		vertexCounts = vertexCount;
 		assert(vertexCounts >= 3 && "Need to be atleast 3 vertices in the shader");
-		VkDeviceSize BufferSize = sizeof(vertices[0]) * vertices.size();
+		VkDeviceSize BufferSize = sizeof(vertices[0]) * vertexCount;
+		VertexBufferSize = BufferSize;
+
+		// Centered on the AABB, not minimal but good enough for LOD and streaming decisions
+		glm::vec3 Min = vertices[0].position;
+		glm::vec3 Max = vertices[0].position;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			Min = glm::min(Min, vertices[i].position);
+			Max = glm::max(Max, vertices[i].position);
+		}
+		BoundsCenter = (Min + Max) * 0.5f;
+		BoundsRadius = 0.0f;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			BoundsRadius = std::max(BoundsRadius, glm::length(vertices[i].position - BoundsCenter));
+		}
 
 		// Staging buffer
 		VkBuffer stagingBuffer;
@@ -85,14 +170,14 @@ namespace Engine {
 
 		void* data;
 		vkMapMemory(device.device(), stagingBufferMemory, 0, BufferSize, 0, &data);
-		memcpy(data, vertices.data(), static_cast<uint32_t>(BufferSize));
+		memcpy(data, vertices, static_cast<size_t>(BufferSize));
 		vkUnmapMemory(device.device(), stagingBufferMemory);
 
-		// Vertex Buffer
+		// Vertex Buffer (also a storage buffer so it can be pulled by the vertex shader)
 		device.createBuffer(
 			VertexBuffer,
 			BufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			VertexBufferMemory
 		);
@@ -103,8 +188,45 @@ namespace Engine {
 		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
 	}
 
+	void Model::createPositionBuffer(const Vertex* vertices, uint32_t vertexCount) {
+		VkDeviceSize BufferSize = sizeof(glm::vec3) * vertexCount;
+
+		// Staging buffer
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		device.createBuffer(
+			stagingBuffer,
+			BufferSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBufferMemory
+		);
+
+		void* data;
+		vkMapMemory(device.device(), stagingBufferMemory, 0, BufferSize, 0, &data);
+		glm::vec3* positions = static_cast<glm::vec3*>(data);
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			positions[i] = vertices[i].position;
+		}
+		vkUnmapMemory(device.device(), stagingBufferMemory);
+
+		// Position Buffer, the same vertices in the same order so the index buffers work with it
+		device.createBuffer(
+			PositionBuffer,
+			BufferSize,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			PositionBufferMemory
+		);
+
+		copyBuffer(stagingBuffer, PositionBuffer, BufferSize);
+
+		vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
+		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+	}
+
 	void Model::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-		auto CommandBuffer = StartOneTimeCommand();
+		auto CommandBuffer = device.StartOneTimeCommand();
 
 		VkBufferCopy copyRegion{};
 		copyRegion.srcOffset = 0;
@@ -112,12 +234,12 @@ namespace Engine {
 		copyRegion.size = size;
 		vkCmdCopyBuffer(CommandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-		EndOneTimeCommand(CommandBuffer);
+		device.EndOneTimeCommand(CommandBuffer);
 	}
 
-	void Model::createIndexBuffer(const std::vector<uint16_t>& indices) {
-		IndexCounts = static_cast<uint32_t>(indices.size());
-		VkDeviceSize BufferSize = sizeof(indices[0]) * indices.size();
+	void Model::createIndexBuffer(const uint32_t* indices, uint32_t indexCount) {
+		IndexCounts = indexCount;
+		VkDeviceSize BufferSize = sizeof(indices[0]) * indexCount;
 
 		// Staging buffer
 		VkBuffer stagingBuffer;
@@ -132,14 +254,14 @@ namespace Engine {
 
 		void* data;
 		vkMapMemory(device.device(), stagingBufferMemory, 0, BufferSize, 0, &data);
-		memcpy(data, indices.data(), static_cast<uint32_t>(BufferSize));
+		memcpy(data, indices, static_cast<size_t>(BufferSize));
 		vkUnmapMemory(device.device(), stagingBufferMemory);
 
-		// Index Buffer
+		// Index Buffer (also a storage buffer, the cluster culling pass copies surviving meshlets out of it)
 		device.createBuffer(
 			IndexBuffer,
 			BufferSize,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			IndexBufferMemory
 		);
@@ -150,6 +272,44 @@ namespace Engine {
 		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
 	}
 
+	void Model::createMeshletBuffer(const Meshlet* meshlets, uint32_t meshletCount) {
+		MeshletCount = meshletCount;
+		if (meshletCount == 0) {
+			return;
+		}
+		VkDeviceSize BufferSize = sizeof(meshlets[0]) * meshletCount;
+
+		// Staging buffer
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		device.createBuffer(
+			stagingBuffer,
+			BufferSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBufferMemory
+		);
+
+		void* data;
+		vkMapMemory(device.device(), stagingBufferMemory, 0, BufferSize, 0, &data);
+		memcpy(data, meshlets, static_cast<size_t>(BufferSize));
+		vkUnmapMemory(device.device(), stagingBufferMemory);
+
+		// Meshlet Buffer, only read by the culling compute shader
+		device.createBuffer(
+			MeshletBuffer,
+			BufferSize,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			MeshletBufferMemory
+		);
+
+		copyBuffer(stagingBuffer, MeshletBuffer, BufferSize);
+
+		vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
+		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+	}
+
 	void Model::createUniformBuffers() {
 		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
@@ -187,223 +347,4 @@ namespace Engine {
 
 		memcpy(UniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 	}
-
-	void Model::createTextureImage() {
-		int Texwidth, TexHeight, TexChannel;
-		stbi_uc* pixels = stbi_load("D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Textures/brick.png", &Texwidth, &TexHeight, &TexChannel, STBI_rgb_alpha);
-
-		VkDeviceSize ImageSize = Texwidth * TexHeight * 4;
-		if (!pixels) {
-			throw std::runtime_error("failed to load the texture pixels");
-		}
-		
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-
-		device.createBuffer(
-			stagingBuffer,
-			ImageSize,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			stagingBufferMemory
-		);
-
-		void* data;
-		vkMapMemory(device.device(), stagingBufferMemory, 0, ImageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(ImageSize));
-		vkUnmapMemory(device.device(), stagingBufferMemory);
-
-		stbi_image_free(pixels);
-
-		device.createImage(
-			TextureImage,
-			{static_cast<uint32_t>(Texwidth), static_cast<uint32_t>(TexHeight)},
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_FORMAT_R8G8B8A8_SRGB,
-			ImageSize,
-			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			TextureBufferMemory
-			);
-
-		transitionImageLayout(TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(stagingBuffer, TextureImage, static_cast<uint32_t>(Texwidth), static_cast<uint32_t>(TexHeight));
-		transitionImageLayout(TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-		vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
-	}
-
-	VkCommandBuffer Model::StartOneTimeCommand() {
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandBufferCount = 1;
-		allocInfo.commandPool = device.CommandPool();
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		
-		VkCommandBuffer commandBuffer;
-		if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate command buffer");
-		}
-
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-			throw std::runtime_error("failed to begin recordin the one time command buffer");
-		}
-
-		return commandBuffer;
-	}
-
-	void Model::EndOneTimeCommand(VkCommandBuffer& CommandBuffer) {
-		if (vkEndCommandBuffer(CommandBuffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to end recordin the one time command buffer");
-		}
-
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &CommandBuffer;
-
-		vkQueueSubmit(device.GraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(device.GraphicsQueue());
-
-		vkFreeCommandBuffers(device.device(), device.CommandPool(), 1, &CommandBuffer);
-	}
-
-	void Model::transitionImageLayout(VkImage Image, VkFormat Format, VkImageLayout oldImageLayout, VkImageLayout newImageLayout) {
-		auto CommandBuffer = StartOneTimeCommand();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = oldImageLayout;
-		barrier.newLayout = newImageLayout;
-
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-		barrier.image = Image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
-
-		if (oldImageLayout == VK_IMAGE_LAYOUT_UNDEFINED && newImageLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}	
-		else if (oldImageLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newImageLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else {
-			throw std::invalid_argument("unsupported layout transition");
-		}
-
-		vkCmdPipelineBarrier(
-			CommandBuffer,
-			sourceStage, destinationStage,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		EndOneTimeCommand(CommandBuffer);
-	}
-	
-	void Model::copyBufferToImage(VkBuffer buffer, VkImage Image, uint32_t width, uint32_t height) {
-		auto CommandBuffer = StartOneTimeCommand();
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageSubresource.mipLevel = 0;
-
-		region.imageOffset = { 0,0,0 };
-		region.imageExtent = {
-			width,
-			height,
-			1
-		};
-
-		vkCmdCopyBufferToImage(
-			CommandBuffer,
-			buffer,
-			Image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region
-		);
-
-		EndOneTimeCommand(CommandBuffer);
-	}
-
-	void Model::createTextureImageView() {
-		VkImageViewCreateInfo ViewInfo{};
-		ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		ViewInfo.image = TextureImage;
-		ViewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-		ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-
-		ViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-		ViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-		ViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-		ViewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-		ViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		ViewInfo.subresourceRange.baseArrayLayer = 0;
-		ViewInfo.subresourceRange.layerCount = 1;
-		ViewInfo.subresourceRange.baseMipLevel = 0;
-		ViewInfo.subresourceRange.levelCount = 1;
-
-		if (vkCreateImageView(device.device(), &ViewInfo, nullptr, &TextureImageView) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create an image view for texture");
-		}
-	}
-
-	void Model::createTextureSampler() {
-		VkSamplerCreateInfo samplerInfo{};
-		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-		samplerInfo.magFilter = VK_FILTER_LINEAR;
-		samplerInfo.minFilter = VK_FILTER_LINEAR;
-		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-
-		samplerInfo.anisotropyEnable = VK_TRUE;
-		samplerInfo.maxAnisotropy = device.GetMaxAntisotropy();
-
-		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
-		samplerInfo.unnormalizedCoordinates = VK_FALSE;
-
-		samplerInfo.compareEnable = VK_FALSE;
-		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-
-		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-		samplerInfo.minLod = 0.0;
-		samplerInfo.maxLod = 0.0f;
-		samplerInfo.mipLodBias = 0.0;
-
-		if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &TextureSampler) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create texture sampler");
-		}
-	}
 }
\ No newline at end of file
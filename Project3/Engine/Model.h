@@ -2,6 +2,7 @@
 
 #include "Device.h"
 #include "SwapChain.h"
+#include "TextureCache.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -24,15 +25,65 @@ namespace Engine
 
 				static std::array<VkVertexInputAttributeDescription, 3> AttributeDescriptions();
 				static std::array<VkVertexInputBindingDescription, 1> BindingDescriptions();
+				// Only the position at location 0, read from the tightly packed position buffer
+				static std::array<VkVertexInputAttributeDescription, 1> PositionAttributeDescriptions();
+				static std::array<VkVertexInputBindingDescription, 1> PositionBindingDescriptions();
 			};
 
+			/*
+				Describes how a vertex is packed inside the vertex storage buffer when using VertexInputMode::VertexPulling.
+				All offsets and the stride are in 32-bit words, pushed as push constants so different layouts share one pipeline.
+			*/
+			struct PulledVertexLayout {
+				static constexpr uint32_t ColorUnorm8 = 1 << 0;		// color packed as one RGBA8 word instead of 3 floats
+				static constexpr uint32_t TexCoordHalf = 1 << 1;	// texCoord packed as one half2 word instead of 2 floats
+
+				uint32_t stride;
+				uint32_t positionOffset;
+				uint32_t colorOffset;
+				uint32_t texCoordOffset;
+				uint32_t flags;
+
+				static PulledVertexLayout Default();
+			};
+
+			// Range of the index buffer drawing one level of detail, error bounds how far it deviates from LOD 0 in model space
+			struct Lod {
+				uint32_t firstIndex;
+				uint32_t indexCount;
+				float error;
+			};
+			static constexpr uint32_t MaxLods = 5;
+
+			/*
+				Cluster of LOD 0 triangles, contiguous in the index buffer, culled on its own by MeshletCuller.
+				Layout matches MeshletCull.comp (std430). The cone is culled when the camera sees every triangle
+				from behind: dot(normalize(coneApex - camera), coneAxis) >= coneCutoff, a cutoff above 1 disables it.
+			*/
+			struct Meshlet {
+				glm::vec3 center;
+				float radius;
+				glm::vec3 coneApex;
+				float coneCutoff;
+				glm::vec3 coneAxis;
+				uint32_t firstIndex;
+				uint32_t triangleCount;
+				uint32_t vertexCount;
+				uint32_t padding[2];
+			};
+			static constexpr uint32_t MaxMeshletVertices = 64;
+			static constexpr uint32_t MaxMeshletTriangles = 124;
+
 			struct UniformBufferObject {
 				//alignas(16) glm::mat4 model;
 				alignas(16) glm::mat4 view;
 				alignas(16) glm::mat4 proj;
 			};
 			
-			Model(Device& dev, const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices);
+			// Without lods the whole index buffer is the only LOD, without meshlets there is no cluster culling
+			Model(Device& dev, TextureCache& textures, const std::string& TexturePath, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<Lod>& lods = {}, const std::vector<Meshlet>& meshlets = {});
+			// Copies straight from vertices / indices into the staging buffers, e.g. from a mapped AssetArchive
+			Model(Device& dev, TextureCache& textures, const std::string& TexturePath, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const Lod* lods = nullptr, uint32_t lodCount = 0, const Meshlet* meshlets = nullptr, uint32_t meshletCount = 0);
 			~Model();
 
 			Model(const Model&) = delete;
@@ -45,50 +96,71 @@ namespace Engine
 				vkCmdBindVertexBuffers(CommandBuffer, 0, 1, VertexBuffers, offsets);
 			}
 
-			void BindIndex(VkCommandBuffer CommandBuffer) { vkCmdBindIndexBuffer(CommandBuffer, IndexBuffer, 0, VK_INDEX_TYPE_UINT16); }
-			void Draw(VkCommandBuffer CommandBuffers) { vkCmdDrawIndexed(CommandBuffers, IndexCounts, 1, 0, 0, 0); }
+			void BindIndex(VkCommandBuffer CommandBuffer) { vkCmdBindIndexBuffer(CommandBuffer, IndexBuffer, 0, VK_INDEX_TYPE_UINT32); }
+			void Draw(VkCommandBuffer CommandBuffers, uint32_t lod = 0) { vkCmdDrawIndexed(CommandBuffers, Lods[lod].indexCount, 1, Lods[lod].firstIndex, 0, 0); }
+
+			// Coarsest LOD whose error stays under pixelError on screen, projectedSize as returned by Camera::ProjectedSize for the bounds
+			uint32_t SelectLod(float projectedSize, float pixelError = 1.0f) const;
+			uint32_t GetLodCount() const { return static_cast<uint32_t>(Lods.size()); }
+			const Lod& GetLod(uint32_t lod) const { return Lods[lod]; }
+
+			// Index and meshlet buffers are also storage buffers, read by the cluster culling pass
+			VkBuffer GetIndexBuffer() { return IndexBuffer; }
+			VkDeviceSize GetIndexBufferSize() { return sizeof(uint32_t) * IndexCounts; }
+			VkBuffer GetMeshletBuffer() { return MeshletBuffer; }
+			uint32_t GetMeshletCount() { return MeshletCount; }
+
+			VkBuffer GetVertexBuffer() { return VertexBuffer; }
+			VkDeviceSize GetVertexBufferSize() { return VertexBufferSize; }
+			// Positions alone, a depth only pass fetches a third of the vertex data from it
+			VkBuffer GetPositionBuffer() { return PositionBuffer; }
+			PulledVertexLayout GetPulledVertexLayout() { return PulledVertexLayout::Default(); }
 
 			void updateUniformBuffer(size_t currentImage, VkExtent2D Extent);
 			VkBuffer GetUniformBuffer(size_t currentFrame) { return UniformBuffers[currentFrame]; }
 
-			VkImageView GetTextureImageView() { return TextureImageView; }
-			VkSampler GetTextureSampler() { return TextureSampler; }
+			// Placeholder until the texture cache finished uploading the real one, watch GetTextureVersion() to know when it changed
+			VkImageView GetTextureImageView() { return textures.GetImageView(texture); }
+			VkSampler GetTextureSampler() { return textures.GetSampler(); }
+			uint32_t GetTextureVersion() { return texture->version; }
+			CachedTexture* GetTexture() { return texture; }
+
+			// Bounding sphere of the vertices in model space
+			glm::vec3 GetBoundsCenter() { return BoundsCenter; }
+			float GetBoundsRadius() { return BoundsRadius; }
 
 		private:
-			void createVertexBuffer(const std::vector<Vertex>& vertices);
-			void createIndexBuffer(const std::vector<uint16_t>& indices);
+			void createVertexBuffer(const Vertex* vertices, uint32_t vertexCount);
+			void createPositionBuffer(const Vertex* vertices, uint32_t vertexCount);
+			void createIndexBuffer(const uint32_t* indices, uint32_t indexCount);
+			void createMeshletBuffer(const Meshlet* meshlets, uint32_t meshletCount);
 			void createUniformBuffers();
-			void createTextureImage();
-			void createTextureImageView();
-			void createTextureSampler();
-
 			void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-			void transitionImageLayout(VkImage Image, VkFormat Format, VkImageLayout oldImageLayout, VkImageLayout newImageLayout);
-			void copyBufferToImage(VkBuffer buffer, VkImage Image, uint32_t width, uint32_t height);
-
-			VkCommandBuffer StartOneTimeCommand();
-			void EndOneTimeCommand(VkCommandBuffer& CommandBuffer);
 
 			VkBuffer VertexBuffer;
 			VkDeviceMemory VertexBufferMemory;
+			VkDeviceSize VertexBufferSize;
+			VkBuffer PositionBuffer;
+			VkDeviceMemory PositionBufferMemory;
 			VkBuffer IndexBuffer;
 			VkDeviceMemory IndexBufferMemory;
+			VkBuffer MeshletBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory MeshletBufferMemory = VK_NULL_HANDLE;
+			uint32_t MeshletCount = 0;
 
-			VkImage TextureImage;
-			VkDeviceMemory TextureBufferMemory;
-			VkImageView TextureImageView;
+			CachedTexture* texture;
 
-			VkImage DepthImage;
-			VkDeviceMemory DepthbufferMemory;
-			VkImageView DepthImageView;
+			glm::vec3 BoundsCenter;
+			float BoundsRadius;
 
-			VkSampler TextureSampler;
+			std::vector<Lod> Lods;
 
 			std::vector<VkBuffer> UniformBuffers;
 			std::vector<VkDeviceMemory> UniformBuffersMemory;
 			std::vector<void*> UniformBuffersMapped;
 
 			Device& device;
+			TextureCache& textures;
 
 			uint32_t vertexCounts;
 			uint32_t IndexCounts;
@@ -0,0 +1,237 @@
+#include "OcclusionCuller.h"
+
+//std
+#include <algorithm>
+#include <cstring>
+
+namespace Engine {
+	OcclusionCuller::OcclusionCuller(Device& device, Camera& Camera, Model& model) : device{ device }, model{ model } {
+		createBuffers();
+		createDescriptorSetLayout();
+		createDescriptorSets(Camera);
+		createPipelineLayout();
+		createComputePipeline();
+	}
+
+	OcclusionCuller::~OcclusionCuller() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), DrawBuffers[i], nullptr);
+			vkFreeMemory(device.device(), DrawBuffersMemory[i], nullptr);
+		}
+		vkDestroyBuffer(device.device(), VisibilityBuffer, nullptr);
+		vkFreeMemory(device.device(), VisibilityBufferMemory, nullptr);
+		vkDestroyBuffer(device.device(), IndirectBuffer, nullptr);
+		vkFreeMemory(device.device(), IndirectBufferMemory, nullptr);
+
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	}
+
+	void OcclusionCuller::createBuffers() {
+		static_assert(sizeof(Draw) == 32, "Draw has to match OcclusionCull.comp");
+
+		DrawBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		DrawBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		DrawBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				DrawBuffers[i],
+				sizeof(Draw) * MaxDraws,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				DrawBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), DrawBuffersMemory[i], 0, sizeof(Draw) * MaxDraws, 0, &DrawBuffersMapped[i]);
+		}
+
+		device.createBuffer(
+			VisibilityBuffer,
+			sizeof(uint32_t) * MaxDraws,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VisibilityBufferMemory
+		);
+
+		device.createBuffer(
+			IndirectBuffer,
+			sizeof(VkDrawIndexedIndirectCommand) * MaxDraws * 2,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			IndirectBufferMemory
+		);
+
+		// Nothing counts as visible yet, the first frame draws everything in the late phase
+		VkCommandBuffer commandBuffer = device.StartOneTimeCommand();
+		vkCmdFillBuffer(commandBuffer, VisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+		device.EndOneTimeCommand(commandBuffer);
+	}
+
+	void OcclusionCuller::createDescriptorSetLayout() {
+		// 0 camera, 1 draws, 2 visibility, 3 indirect commands, 4 depth pyramid
+		std::array<VkDescriptorSetLayoutBinding, 5> bindingInfo{};
+		for (uint32_t i = 0; i < bindingInfo.size(); i++) {
+			bindingInfo[i].binding = i;
+			bindingInfo[i].descriptorCount = 1;
+			bindingInfo[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindingInfo[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingInfo[i].pImmutableSamplers = nullptr;
+		}
+		bindingInfo[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindingInfo[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create occlusion culling descriptor set layout");
+		}
+	}
+
+	void OcclusionCuller::createDescriptorSets(Camera& Camera) {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = device.DescriptorPool();
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		// The pyramid binding is written once CullEarly gets a pyramid
+		PyramidVersions.resize(MAX_FRAME_IN_FLIGHT, 0);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate occlusion culling descriptor sets");
+		}
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			std::array<VkDescriptorBufferInfo, 4> bufferInfo{};
+			bufferInfo[0] = { Camera.GetCameraBuffer(static_cast<uint32_t>(i)), 0, sizeof(Camera::CameraUBO) };
+			bufferInfo[1] = { DrawBuffers[i], 0, sizeof(Draw) * MaxDraws };
+			bufferInfo[2] = { VisibilityBuffer, 0, VK_WHOLE_SIZE };
+			bufferInfo[3] = { IndirectBuffer, 0, VK_WHOLE_SIZE };
+
+			std::array<VkWriteDescriptorSet, 4> WriteSet{};
+			for (uint32_t b = 0; b < WriteSet.size(); b++) {
+				WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				WriteSet[b].dstSet = DescriptorSets[i];
+				WriteSet[b].dstBinding = b;
+				WriteSet[b].dstArrayElement = 0;
+				WriteSet[b].descriptorCount = 1;
+				WriteSet[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				WriteSet[b].pBufferInfo = &bufferInfo[b];
+			}
+
+			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+		}
+	}
+
+	void OcclusionCuller::createPipelineLayout() {
+		VkPushConstantRange paramsRange{};
+		paramsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		paramsRange.offset = 0;
+		paramsRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &paramsRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create occlusion culling pipeline layout");
+		}
+	}
+
+	void OcclusionCuller::createComputePipeline() {
+		// constant_id 0 picks which way depth goes
+		VkBool32 reverseZ = REVERSE_Z;
+		VkSpecializationMapEntry reverseZEntry{ 0, 0, sizeof(VkBool32) };
+		VkSpecializationInfo specialization{ 1, &reverseZEntry, sizeof(VkBool32), &reverseZ };
+
+		pipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/OcclusionCull.comp.spv",
+			pipelineLayout,
+			&specialization
+		);
+	}
+
+	void OcclusionCuller::updatePyramidDescriptor(uint32_t currentFrame, DepthPyramid& pyramid) {
+		// The frame's fence was waited on in StartFrame so its descriptor set isn't in use anymore
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		imageInfo.sampler = pyramid.GetSampler();
+		imageInfo.imageView = pyramid.GetImageView();
+
+		VkWriteDescriptorSet WriteSet{};
+		WriteSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		WriteSet.dstSet = DescriptorSets[currentFrame];
+		WriteSet.dstBinding = 4;
+		WriteSet.dstArrayElement = 0;
+		WriteSet.descriptorCount = 1;
+		WriteSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		WriteSet.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device.device(), 1, &WriteSet, 0, nullptr);
+		PyramidVersions[currentFrame] = pyramid.GetVersion();
+	}
+
+	void OcclusionCuller::dispatch(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t phase, glm::vec2 screenSize) {
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+
+		PushConstants params{};
+		params.boundsCenterRadius = glm::vec4(model.GetBoundsCenter(), model.GetBoundsRadius());
+		params.screenSize = screenSize;
+		params.drawCount = drawCount;
+		params.phase = phase;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+		vkCmdDispatch(commandBuffer, (drawCount + 63) / 64, 1, 1);
+
+		VkMemoryBarrier commandBarrier{};
+		commandBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		commandBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		commandBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &commandBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	void OcclusionCuller::CullEarly(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid, const Draw* draws, uint32_t count) {
+		drawCount = std::min(count, MaxDraws);
+		if (drawCount == 0) {
+			return;
+		}
+		std::memcpy(DrawBuffersMapped[currentFrame], draws, sizeof(Draw) * drawCount);
+
+		// Both phases run the same shader, the pyramid binding has to be valid for the early one too
+		if (PyramidVersions[currentFrame] != pyramid.GetVersion()) {
+			updatePyramidDescriptor(currentFrame, pyramid);
+		}
+
+		// The previous frame may still be writing the visibility or drawing from the commands
+		VkMemoryBarrier previousBarrier{};
+		previousBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		previousBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		previousBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &previousBarrier, 0, nullptr, 0, nullptr
+		);
+
+		dispatch(commandBuffer, currentFrame, 0, glm::vec2(0.0f));
+	}
+
+	void OcclusionCuller::CullLate(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid) {
+		if (drawCount == 0) {
+			return;
+		}
+		assert(PyramidVersions[currentFrame] == pyramid.GetVersion() && "the pyramid changed between the two phases");
+
+		dispatch(commandBuffer, currentFrame, 1, glm::vec2(static_cast<float>(pyramid.GetExtent().width), static_cast<float>(pyramid.GetExtent().height)));
+	}
+}
\ No newline at end of file
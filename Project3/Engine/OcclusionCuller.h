@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Model.h"
+#include "Camera.h"
+#include "DepthPyramid.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Two phase occlusion culling of a model's instances with OcclusionCull.comp, a Hi-Z test against the DepthPyramid.
+		CullEarly() keeps the draws that passed the occlusion test last frame, they are rendered and the pyramid is built
+		from their depth. CullLate() tests every draw against that pyramid: the ones that are visible now but weren't drawn
+		early are rendered in a second pass, and the results become next frame's visibility. Anything that comes into view
+		is drawn in the same frame, so nothing pops in. Every draw is one vkCmdDrawIndexedIndirect whose instanceCount the
+		shader sets to 0 or 1, the CPU never reads the results.
+	*/
+	class OcclusionCuller
+	{
+	public:
+		// Matches the Draw struct of OcclusionCull.comp
+		struct Draw {
+			glm::vec4 positionScale;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t instance;	// index into the visibility kept between frames, stable for as long as the instance exists
+			uint32_t padding;
+		};
+
+		struct PushConstants {
+			glm::vec4 boundsCenterRadius;	// model space bounding sphere
+			glm::vec2 screenSize;
+			uint32_t drawCount;
+			uint32_t phase;	// 0 early, 1 late
+		};
+
+		static constexpr uint32_t MaxDraws = 16384;
+
+		OcclusionCuller(Device& device, Camera& Camera, Model& model);
+		~OcclusionCuller();
+
+		OcclusionCuller(const OcclusionCuller&) = delete;
+		OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+		/*
+			Outside of a render pass, before the first one. Draws past MaxDraws are ignored and every instance has to
+			be below MaxDraws. The pyramid isn't read yet, it's the one CullLate will test against.
+		*/
+		void CullEarly(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid, const Draw* draws, uint32_t count);
+		// Outside of a render pass, after DepthPyramid::Build
+		void CullLate(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid);
+
+		// Inside the render passes, with the model's index buffer bound
+		void DrawEarly(VkCommandBuffer commandBuffer, uint32_t draw) {
+			vkCmdDrawIndexedIndirect(commandBuffer, IndirectBuffer, GetEarlyOffset(draw), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		void DrawLate(VkCommandBuffer commandBuffer, uint32_t draw) {
+			vkCmdDrawIndexedIndirect(commandBuffer, IndirectBuffer, GetLateOffset(draw), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		// For recording the same draws elsewhere, a RenderQueue
+		VkBuffer GetIndirectBuffer() { return IndirectBuffer; }
+		static VkDeviceSize GetEarlyOffset(uint32_t draw) { return sizeof(VkDrawIndexedIndirectCommand) * draw; }
+		static VkDeviceSize GetLateOffset(uint32_t draw) { return sizeof(VkDrawIndexedIndirectCommand) * (MaxDraws + draw); }
+
+	private:
+		void createBuffers();
+		void createDescriptorSetLayout();
+		void createDescriptorSets(Camera& Camera);
+		void createPipelineLayout();
+		void createComputePipeline();
+		void updatePyramidDescriptor(uint32_t currentFrame, DepthPyramid& pyramid);
+		void dispatch(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t phase, glm::vec2 screenSize);
+
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+		// DepthPyramid::GetVersion() each frame's set was written with, 0 before the first one
+		std::vector<uint32_t> PyramidVersions;
+
+		// Written by the CPU every frame
+		std::vector<VkBuffer> DrawBuffers;
+		std::vector<VkDeviceMemory> DrawBuffersMemory;
+		std::vector<void*> DrawBuffersMapped;
+
+		// One visible flag per instance, persists between frames
+		VkBuffer VisibilityBuffer;
+		VkDeviceMemory VisibilityBufferMemory;
+		// MaxDraws early commands followed by MaxDraws late ones, shared by the frames in flight like MeshletCuller's
+		VkBuffer IndirectBuffer;
+		VkDeviceMemory IndirectBufferMemory;
+
+		uint32_t drawCount = 0;
+
+		Device& device;
+		Model& model;
+		std::unique_ptr<CPipeline> pipeline;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "OcclusionRasterizer.h"
+
+//std
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles any intrinsic without /arch, the runtime check decides which path runs
+#define OCCLUSION_TARGET_SSE41
+#define OCCLUSION_TARGET_AVX2
+#else
+#define OCCLUSION_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define OCCLUSION_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define OCCLUSION_X86 0
+#endif
+
+namespace Engine {
+	namespace {
+		void RasterizeRowScalar(float* row, uint32_t begin, uint32_t end, const OcclusionRasterizer::RowSetup& setup) {
+			for (uint32_t x = begin; x < end; x++) {
+				float fx = static_cast<float>(x);
+				bool inside = setup.edge[0] + setup.edgeStep[0] * fx >= 0.0f
+					&& setup.edge[1] + setup.edgeStep[1] * fx >= 0.0f
+					&& setup.edge[2] + setup.edgeStep[2] * fx >= 0.0f;
+				if (inside) {
+					row[x] = std::min(row[x], std::min(setup.depth + setup.depthStep * fx, setup.depthMax));
+				}
+			}
+		}
+
+		bool TestRowScalar(const float* row, uint32_t begin, uint32_t end, float depth) {
+			for (uint32_t x = begin; x < end; x++) {
+				if (depth <= row[x]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+#if OCCLUSION_X86
+		OCCLUSION_TARGET_SSE41 void RasterizeRowSSE41(float* row, uint32_t begin, uint32_t end, const OcclusionRasterizer::RowSetup& setup) {
+			const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 depthMax = _mm_set1_ps(setup.depthMax);
+
+			// begin and end are multiples of 4
+			for (uint32_t x = begin; x < end; x += 4) {
+				__m128 fx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_set1_ps(setup.edge[0]), _mm_mul_ps(_mm_set1_ps(setup.edgeStep[0]), fx)), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_set1_ps(setup.edge[1]), _mm_mul_ps(_mm_set1_ps(setup.edgeStep[1]), fx)), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_set1_ps(setup.edge[2]), _mm_mul_ps(_mm_set1_ps(setup.edgeStep[2]), fx)), zero));
+				if (_mm_movemask_ps(inside) == 0) {
+					continue;
+				}
+
+				__m128 depth = _mm_min_ps(_mm_add_ps(_mm_set1_ps(setup.depth), _mm_mul_ps(_mm_set1_ps(setup.depthStep), fx)), depthMax);
+				__m128 current = _mm_loadu_ps(row + x);
+				_mm_storeu_ps(row + x, _mm_blendv_ps(current, _mm_min_ps(current, depth), inside));
+			}
+		}
+
+		OCCLUSION_TARGET_SSE41 bool TestRowSSE41(const float* row, uint32_t begin, uint32_t end, float depth) {
+			const __m128 nearest = _mm_set1_ps(depth);
+			uint32_t x = begin;
+			for (; x + 4 <= end; x += 4) {
+				if (_mm_movemask_ps(_mm_cmple_ps(nearest, _mm_loadu_ps(row + x))) != 0) {
+					return true;
+				}
+			}
+			return TestRowScalar(row, x, end, depth);
+		}
+
+		OCCLUSION_TARGET_AVX2 void RasterizeRowAVX2(float* row, uint32_t begin, uint32_t end, const OcclusionRasterizer::RowSetup& setup) {
+			const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 depthMax = _mm256_set1_ps(setup.depthMax);
+
+			// begin and end are multiples of 8
+			for (uint32_t x = begin; x < end; x += 8) {
+				__m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+
+				__m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_set1_ps(setup.edge[0]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStep[0]), fx)), zero, _CMP_GE_OQ);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_set1_ps(setup.edge[1]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStep[1]), fx)), zero, _CMP_GE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_set1_ps(setup.edge[2]), _mm256_mul_ps(_mm256_set1_ps(setup.edgeStep[2]), fx)), zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(inside) == 0) {
+					continue;
+				}
+
+				__m256 depth = _mm256_min_ps(_mm256_add_ps(_mm256_set1_ps(setup.depth), _mm256_mul_ps(_mm256_set1_ps(setup.depthStep), fx)), depthMax);
+				__m256 current = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, depth), inside));
+			}
+		}
+
+		OCCLUSION_TARGET_AVX2 bool TestRowAVX2(const float* row, uint32_t begin, uint32_t end, float depth) {
+			const __m256 nearest = _mm256_set1_ps(depth);
+			uint32_t x = begin;
+			for (; x + 8 <= end; x += 8) {
+				if (_mm256_movemask_ps(_mm256_cmp_ps(nearest, _mm256_loadu_ps(row + x), _CMP_LE_OQ)) != 0) {
+					return true;
+				}
+			}
+			return TestRowScalar(row, x, end, depth);
+		}
+#endif
+	}
+
+	OcclusionRasterizer::OcclusionRasterizer(ThreadPool& workers, uint32_t width, uint32_t height, InstructionSet requested) : workers{ workers } {
+		this->width = (std::max(width, 1u) + TileSize - 1) / TileSize * TileSize;
+		this->height = (std::max(height, 1u) + TileSize - 1) / TileSize * TileSize;
+		tilesX = this->width / TileSize;
+		tilesY = this->height / TileSize;
+
+		depth.assign(static_cast<size_t>(this->width) * this->height, 1.0f);
+		tileMaxDepth.assign(static_cast<size_t>(tilesX) * tilesY, 1.0f);
+		tileRowBins.resize(tilesY);
+
+		// Asking for more than the CPU has falls back to the best it supports
+		instructions = std::min(requested, DetectInstructionSet());
+		switch (instructions) {
+#if OCCLUSION_X86
+		case InstructionSet::AVX2:
+			rasterizeRow = RasterizeRowAVX2;
+			testRow = TestRowAVX2;
+			break;
+		case InstructionSet::SSE41:
+			rasterizeRow = RasterizeRowSSE41;
+			testRow = TestRowSSE41;
+			break;
+#endif
+		default:
+			rasterizeRow = RasterizeRowScalar;
+			testRow = TestRowScalar;
+			break;
+		}
+	}
+
+	OcclusionRasterizer::InstructionSet OcclusionRasterizer::DetectInstructionSet() {
+#if OCCLUSION_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		bool sse41 = (info[2] & (1 << 19)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		// The OS has to save the YMM registers too
+		bool avx2 = false;
+		if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		bool sse41 = __builtin_cpu_supports("sse4.1");
+		bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		if (avx2) {
+			return InstructionSet::AVX2;
+		}
+		if (sse41) {
+			return InstructionSet::SSE41;
+		}
+#endif
+		return InstructionSet::Scalar;
+	}
+
+	void OcclusionRasterizer::Begin(const glm::mat4& viewProjection) {
+		this->viewProjection = viewProjection;
+		triangles.clear();
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+	}
+
+	void OcclusionRasterizer::AddOccluder(const glm::vec3* positions, const uint32_t* indices, uint32_t indexCount, const glm::mat4& world) {
+		glm::mat4 worldViewProjection = viewProjection * world;
+
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+			ScreenTriangle triangle;
+			bool clipped = false;
+			for (uint32_t k = 0; k < 3; k++) {
+				glm::vec4 clip = worldViewProjection * glm::vec4(positions[indices[i + k]], 1.0f);
+				// Behind the near plane, projecting it would flip it
+				if (clip.w <= 0.0f || clip.z < 0.0f) {
+					clipped = true;
+					break;
+				}
+
+				float invW = 1.0f / clip.w;
+				triangle.x[k] = (clip.x * invW * 0.5f + 0.5f) * width;
+				triangle.y[k] = (clip.y * invW * 0.5f + 0.5f) * height;
+				triangle.z[k] = clip.z * invW;
+			}
+
+			if (!clipped) {
+				triangles.push_back(triangle);
+			}
+		}
+	}
+
+	void OcclusionRasterizer::Rasterize() {
+		for (auto& bin : tileRowBins) {
+			bin.clear();
+		}
+
+		for (uint32_t t = 0; t < triangles.size(); t++) {
+			const ScreenTriangle& triangle = triangles[t];
+			float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+			float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+			if (maxY < 0.0f || minY >= static_cast<float>(height)) {
+				continue;
+			}
+
+			uint32_t first = static_cast<uint32_t>(std::max(minY, 0.0f)) / TileSize;
+			uint32_t last = std::min(static_cast<uint32_t>(std::min(maxY, static_cast<float>(height - 1))) / TileSize, tilesY - 1);
+			for (uint32_t row = first; row <= last; row++) {
+				tileRowBins[row].push_back(t);
+			}
+		}
+
+		// Rows of tiles never share pixels, so the workers need no locking
+		workers.ParallelFor(tilesY, [this](uint32_t tileRow) {
+			rasterizeTileRow(tileRow);
+		});
+	}
+
+	void OcclusionRasterizer::rasterizeTileRow(uint32_t tileRow) {
+		uint32_t rowBegin = tileRow * TileSize;
+		uint32_t rowEnd = rowBegin + TileSize;
+
+		for (uint32_t t : tileRowBins[tileRow]) {
+			rasterizeTriangle(triangles[t], rowBegin, rowEnd);
+		}
+
+		for (uint32_t tx = 0; tx < tilesX; tx++) {
+			float farthest = 0.0f;
+			for (uint32_t y = rowBegin; y < rowEnd; y++) {
+				const float* row = &depth[static_cast<size_t>(y) * width + tx * TileSize];
+				for (uint32_t x = 0; x < TileSize; x++) {
+					farthest = std::max(farthest, row[x]);
+				}
+			}
+			tileMaxDepth[static_cast<size_t>(tileRow) * tilesX + tx] = farthest;
+		}
+	}
+
+	void OcclusionRasterizer::rasterizeTriangle(const ScreenTriangle& triangle, uint32_t rowBegin, uint32_t rowEnd) {
+		const float* x = triangle.x;
+		const float* y = triangle.y;
+		const float* z = triangle.z;
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0.0f) {
+			return;
+		}
+		// Both windings are occluders, edges are flipped so inside is always positive
+		float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+		// Pixel centers inside the bounding box
+		float minX = std::min({ x[0], x[1], x[2] });
+		float maxX = std::max({ x[0], x[1], x[2] });
+		float minY = std::min({ y[0], y[1], y[2] });
+		float maxY = std::max({ y[0], y[1], y[2] });
+
+		int32_t beginX = std::max(static_cast<int32_t>(std::ceil(minX - 0.5f)), 0);
+		int32_t endX = std::min(static_cast<int32_t>(std::floor(maxX - 0.5f)) + 1, static_cast<int32_t>(width));
+		int32_t beginY = std::max(static_cast<int32_t>(std::ceil(minY - 0.5f)), static_cast<int32_t>(rowBegin));
+		int32_t endY = std::min(static_cast<int32_t>(std::floor(maxY - 0.5f)) + 1, static_cast<int32_t>(rowEnd));
+		if (beginX >= endX || beginY >= endY) {
+			return;
+		}
+
+		/*
+			Edge i goes from vertex i + 1 to i + 2: E(px, py) = A * px + B * py + C. Evaluated at pixel centers, C is pulled
+			in by the most the edge function drops within half a pixel, so only pixels the triangle covers entirely pass. A
+			pixel it only partly covers may show what is behind it past the silhouette.
+		*/
+		float A[3], B[3], C[3];
+		for (int i = 0; i < 3; i++) {
+			int a = (i + 1) % 3;
+			int b = (i + 2) % 3;
+			A[i] = -(y[b] - y[a]) * orientation;
+			B[i] = (x[b] - x[a]) * orientation;
+			C[i] = ((y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a]) * orientation - 0.5f * (std::abs(A[i]) + std::abs(B[i]));
+		}
+
+		// Depth plane, pushed back by half a pixel of slope so it is the farthest the triangle gets inside the pixel
+		float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		float bias = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+		// Whole SIMD blocks, the edges mask the pixels outside the triangle
+		uint32_t begin = static_cast<uint32_t>(beginX) / TileSize * TileSize;
+		uint32_t end = (static_cast<uint32_t>(endX) + TileSize - 1) / TileSize * TileSize;
+
+		RowSetup setup;
+		setup.depthStep = dzdx;
+		setup.depthMax = std::max({ z[0], z[1], z[2] });
+		for (int i = 0; i < 3; i++) {
+			setup.edgeStep[i] = A[i];
+		}
+
+		for (int32_t row = beginY; row < endY; row++) {
+			float centerY = static_cast<float>(row) + 0.5f;
+			for (int i = 0; i < 3; i++) {
+				setup.edge[i] = A[i] * 0.5f + B[i] * centerY + C[i];
+			}
+			setup.depth = z[0] + dzdx * (0.5f - x[0]) + dzdy * (centerY - y[0]) + bias;
+
+			rasterizeRow(&depth[static_cast<size_t>(row) * width], begin, end, setup);
+		}
+	}
+
+	bool OcclusionRasterizer::IsVisible(const Bounds& bounds) const {
+		float minX = static_cast<float>(width);
+		float maxX = 0.0f;
+		float minY = static_cast<float>(height);
+		float maxY = 0.0f;
+		float nearest = 1.0f;
+
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 corner = glm::vec3(
+				(i & 1) ? bounds.max.x : bounds.min.x,
+				(i & 2) ? bounds.max.y : bounds.min.y,
+				(i & 4) ? bounds.max.z : bounds.min.z
+			);
+			glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+			// Crosses the near plane, the camera may be inside it
+			if (clip.w <= 0.0f || clip.z < 0.0f) {
+				return true;
+			}
+
+			float invW = 1.0f / clip.w;
+			float px = (clip.x * invW * 0.5f + 0.5f) * width;
+			float py = (clip.y * invW * 0.5f + 0.5f) * height;
+			minX = std::min(minX, px);
+			maxX = std::max(maxX, px);
+			minY = std::min(minY, py);
+			maxY = std::max(maxY, py);
+			nearest = std::min(nearest, clip.z * invW);
+		}
+
+		// Every pixel the box touches, not just the centers
+		int32_t beginX = std::max(static_cast<int32_t>(std::floor(minX)), 0);
+		int32_t endX = std::min(static_cast<int32_t>(std::ceil(maxX)), static_cast<int32_t>(width));
+		int32_t beginY = std::max(static_cast<int32_t>(std::floor(minY)), 0);
+		int32_t endY = std::min(static_cast<int32_t>(std::ceil(maxY)), static_cast<int32_t>(height));
+		if (beginX >= endX || beginY >= endY) {
+			return false;
+		}
+
+		for (uint32_t ty = beginY / TileSize; ty <= (endY - 1) / TileSize; ty++) {
+			for (uint32_t tx = beginX / TileSize; tx <= (endX - 1) / TileSize; tx++) {
+				// Everything in the tile is nearer than the box
+				if (nearest > tileMaxDepth[static_cast<size_t>(ty) * tilesX + tx]) {
+					continue;
+				}
+
+				uint32_t spanBegin = std::max(static_cast<uint32_t>(beginX), tx * TileSize);
+				uint32_t spanEnd = std::min(static_cast<uint32_t>(endX), (tx + 1) * TileSize);
+				uint32_t rowBegin = std::max(static_cast<uint32_t>(beginY), ty * TileSize);
+				uint32_t rowEnd = std::min(static_cast<uint32_t>(endY), (ty + 1) * TileSize);
+				for (uint32_t y = rowBegin; y < rowEnd; y++) {
+					if (testRow(&depth[static_cast<size_t>(y) * width], spanBegin, spanEnd, nearest)) {
+						return true;
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void OcclusionRasterizer::Test(const Bounds* bounds, uint32_t count, uint8_t* visible) {
+		const uint32_t ChunkSize = 256;
+		uint32_t chunks = (count + ChunkSize - 1) / ChunkSize;
+
+		workers.ParallelFor(chunks, [&](uint32_t chunk) {
+			uint32_t end = std::min(count, (chunk + 1) * ChunkSize);
+			for (uint32_t i = chunk * ChunkSize; i < end; i++) {
+				visible[i] = IsVisible(bounds[i]) ? 1 : 0;
+			}
+		});
+	}
+}
\ No newline at end of file
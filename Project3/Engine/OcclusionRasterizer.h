@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Software occlusion culling on the CPU, for when the GPU is busy enough that the Hi-Z passes cost more than they save.
+		Occluder triangles are rasterized into a small depth buffer in 8x8 pixel tiles, every pixel a triangle covers entirely
+		keeping the nearest of its occluders' farthest depths inside it, and every tile keeping the farthest depth of its
+		pixels. Bounds are tested against the tiles first and against the pixels only where the tile can't decide.
+
+		The inner loops evaluate a whole row of pixels at once with the coverage of the three edges as a mask, 8 pixels with
+		AVX2, 4 with SSE4.1 and one at a time otherwise. The widest set the CPU supports is picked at runtime. Rasterizing
+		splits the buffer into rows of tiles and testing splits the bounds, both across the thread pool.
+	*/
+	class OcclusionRasterizer
+	{
+	public:
+		enum class InstructionSet {
+			Scalar,
+			SSE41,
+			AVX2
+		};
+
+		struct Bounds {
+			glm::vec3 min;
+			glm::vec3 max;
+		};
+
+		static constexpr uint32_t TileSize = 8;
+
+		// Sizes are rounded up to whole tiles
+		OcclusionRasterizer(ThreadPool& workers, uint32_t width = 256, uint32_t height = 256, InstructionSet instructions = DetectInstructionSet());
+
+		OcclusionRasterizer(const OcclusionRasterizer&) = delete;
+		OcclusionRasterizer& operator=(const OcclusionRasterizer&) = delete;
+
+		static InstructionSet DetectInstructionSet();
+		InstructionSet GetInstructionSet() const { return instructions; }
+
+		// Clears the occluders and the depth, viewProjection is the one the scene is drawn with (zero to one depth)
+		void Begin(const glm::mat4& viewProjection);
+		/*
+			Occluders have to lie inside the geometry they stand for or they hide what is visible. Triangles crossing the
+			near plane are dropped, which only makes the result more conservative.
+		*/
+		void AddOccluder(const glm::vec3* positions, const uint32_t* indices, uint32_t indexCount, const glm::mat4& world);
+		void Rasterize();
+
+		// visible[i] is 0 when bounds[i] is entirely hidden by the occluders or off screen
+		void Test(const Bounds* bounds, uint32_t count, uint8_t* visible);
+		bool IsVisible(const Bounds& bounds) const;
+
+		uint32_t GetWidth() const { return width; }
+		uint32_t GetHeight() const { return height; }
+		uint32_t GetTriangleCount() const { return static_cast<uint32_t>(triangles.size()); }
+		// Row major, 1 where nothing was rasterized
+		const float* GetDepth() const { return depth.data(); }
+
+		// One row of a triangle: edge functions and depth at x = 0, and how they change per pixel
+		struct RowSetup {
+			float edge[3];
+			float edgeStep[3];
+			float depth;
+			float depthStep;
+			float depthMax;
+		};
+
+	private:
+		struct ScreenTriangle {
+			float x[3];
+			float y[3];
+			float z[3];
+		};
+
+		using RasterizeRowFn = void (*)(float* row, uint32_t begin, uint32_t end, const RowSetup& setup);
+		using TestRowFn = bool (*)(const float* row, uint32_t begin, uint32_t end, float depth);
+
+		void rasterizeTileRow(uint32_t tileRow);
+		void rasterizeTriangle(const ScreenTriangle& triangle, uint32_t rowBegin, uint32_t rowEnd);
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t tilesX;
+		uint32_t tilesY;
+
+		std::vector<float> depth;
+		std::vector<float> tileMaxDepth;
+
+		glm::mat4 viewProjection{ 1.0f };
+		std::vector<ScreenTriangle> triangles;
+		// Triangles touching each row of tiles
+		std::vector<std::vector<uint32_t>> tileRowBins;
+
+		InstructionSet instructions;
+		RasterizeRowFn rasterizeRow;
+		TestRowFn testRow;
+
+		ThreadPool& workers;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "PipelineVariants.h"
+
+namespace Engine {
+	PipelineVariants::PipelineVariants(Device& device, ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions,
+		uint32_t shaderFeatures, uint32_t stateFeatures, Configure configure)
+		: VertexCode(VertexCode.code, VertexCode.code + VertexCode.size), FragmentCode(FragmentCode.code, FragmentCode.code + FragmentCode.size),
+		fixedFunctions{ fixedFunctions }, shaderFeatures{ shaderFeatures }, stateFeatures{ stateFeatures }, configure{ std::move(configure) }, device{ device } {
+		// The copy would still point at the caller's attachments. A single one is always the details' own Attachment
+		if (fixedFunctions.ColorBlending.attachmentCount == 1) {
+			this->fixedFunctions.ColorBlending.pAttachments = &this->fixedFunctions.Attachment;
+		}
+		else {
+			const VkPipelineColorBlendAttachmentState* attachments = fixedFunctions.ColorBlending.pAttachments;
+			ColorAttachments.assign(attachments, attachments + fixedFunctions.ColorBlending.attachmentCount);
+			this->fixedFunctions.ColorBlending.pAttachments = ColorAttachments.data();
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+		if (vkCreatePipelineCache(device.device(), &cacheInfo, nullptr, &PipelineCache) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline cache");
+		}
+	}
+
+	PipelineVariants::~PipelineVariants() {
+		variants.clear();
+		vkDestroyPipelineCache(device.device(), PipelineCache, nullptr);
+	}
+
+	GPipeline& PipelineVariants::Get(uint32_t features) {
+		features &= shaderFeatures | stateFeatures;
+
+		auto found = variants.find(features);
+		if (found != variants.end()) {
+			return *found->second;
+		}
+
+		// Every shader feature is specialized, disabled ones included, the shaders' defaults never decide a variant
+		VkBool32 values[32] = {};
+		std::vector<VkSpecializationMapEntry> entries;
+		for (uint32_t bit = 0; bit < 32; bit++) {
+			if (shaderFeatures & (1u << bit)) {
+				values[bit] = (features & (1u << bit)) ? VK_TRUE : VK_FALSE;
+				entries.push_back({ bit, static_cast<uint32_t>(sizeof(VkBool32) * bit), sizeof(VkBool32) });
+			}
+		}
+
+		VkSpecializationInfo specialization{};
+		specialization.mapEntryCount = static_cast<uint32_t>(entries.size());
+		specialization.pMapEntries = entries.data();
+		specialization.dataSize = sizeof(values);
+		specialization.pData = values;
+
+		GraphicsPipelineDetails details = fixedFunctions;
+		// A single attachment is taken from the details, so configure can change its blending
+		details.ColorBlending.pAttachments = details.ColorBlending.attachmentCount == 1 ? &details.Attachment : ColorAttachments.data();
+		details.specialization = entries.empty() ? nullptr : &specialization;
+		details.cache = PipelineCache;
+		if (configure) {
+			configure(features & stateFeatures, details);
+		}
+
+		auto pipeline = std::make_unique<GPipeline>(device, ShaderBytecode{ VertexCode.data(), VertexCode.size() }, ShaderBytecode{ FragmentCode.data(), FragmentCode.size() }, details);
+		return *variants.emplace(features, std::move(pipeline)).first->second;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GPipeline.h"
+
+//std
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		One pipeline per combination of feature bits asked for, created the first time and kept. Shader features reach
+		the shaders as boolean specialization constants, bit i as constant_id i, so the driver compiles every variant
+		with the code of its disabled features removed instead of branching on them per fragment. State features don't
+		touch the shaders, a Configure callback turns them into fixed function state. All variants go through one
+		VkPipelineCache, what the driver compiled for one is reused by the next.
+	*/
+	class PipelineVariants
+	{
+	public:
+		using Configure = std::function<void(uint32_t features, GraphicsPipelineDetails& fixedFunctions)>;
+
+		// The bytecode and the blend attachments are copied, bits outside of shaderFeatures and stateFeatures don't make a variant of their own
+		PipelineVariants(Device& device, ShaderBytecode VertexCode, ShaderBytecode FragmentCode, const GraphicsPipelineDetails& fixedFunctions,
+			uint32_t shaderFeatures, uint32_t stateFeatures = 0, Configure configure = nullptr);
+		~PipelineVariants();
+
+		PipelineVariants(const PipelineVariants&) = delete;
+		PipelineVariants& operator=(const PipelineVariants&) = delete;
+
+		GPipeline& Get(uint32_t features);
+		uint32_t GetVariantCount() const { return static_cast<uint32_t>(variants.size()); }
+
+	private:
+		std::vector<char> VertexCode;
+		std::vector<char> FragmentCode;
+		GraphicsPipelineDetails fixedFunctions;
+		// What fixedFunctions' color blending points at
+		std::vector<VkPipelineColorBlendAttachmentState> ColorAttachments;
+		uint32_t shaderFeatures;
+		uint32_t stateFeatures;
+		Configure configure;
+
+		std::unordered_map<uint32_t, std::unique_ptr<GPipeline>> variants;
+		VkPipelineCache PipelineCache;
+
+		Device& device;
+	};
+}
@@ -0,0 +1,331 @@
+#include "PostProcessor.h"
+
+//std
+#include <array>
+#include <cassert>
+
+namespace Engine {
+	PostProcessor::PostProcessor(Device& device, SwapChain& swapchain, uint32_t downscale) : extent{ swapchain.Extent() }, downscale{ downscale }, device{ device }, swapchain{ swapchain } {
+		assert((downscale == 2 || downscale == 4) && "bloom runs at half or quarter resolution");
+
+		if (!device.SupportsStorageWriteWithoutFormat()) {
+			throw std::runtime_error("the device can't write storage images without a format, disable post processing");
+		}
+
+		createBloomImage();
+		createSampler();
+		createDescriptors();
+		createPipelines();
+	}
+
+	PostProcessor::~PostProcessor() {
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device.device(), DescriptorPool, nullptr);
+
+		vkDestroySampler(device.device(), Sampler, nullptr);
+		for (VkImageView view : LevelViews) {
+			vkDestroyImageView(device.device(), view, nullptr);
+		}
+		vkDestroyImage(device.device(), BloomImage, nullptr);
+		vkFreeMemory(device.device(), BloomImageMemory, nullptr);
+	}
+
+	void PostProcessor::createBloomImage() {
+		VkExtent2D level = { (extent.width + downscale - 1) / downscale, (extent.height + downscale - 1) / downscale };
+		while (true) {
+			LevelExtents.push_back(level);
+			if (LevelExtents.size() == MaxBloomLevels || level.width == 1 || level.height == 1) {
+				break;
+			}
+			level = { (level.width + 1) / 2, (level.height + 1) / 2 };
+		}
+		const uint32_t levelCount = static_cast<uint32_t>(LevelExtents.size());
+
+		device.createImage(
+			BloomImage,
+			LevelExtents[0],
+			levelCount,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_R16G16B16A16_SFLOAT,
+			0,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			BloomImageMemory
+		);
+
+		// Storage image views can only have one level, and each pass samples a single one
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = BloomImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		LevelViews.resize(levelCount);
+		for (uint32_t i = 0; i < levelCount; i++) {
+			viewInfo.subresourceRange.baseMipLevel = i;
+			if (vkCreateImageView(device.device(), &viewInfo, nullptr, &LevelViews[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create bloom level view");
+			}
+		}
+	}
+
+	void PostProcessor::createSampler() {
+		// Bilinear taps do half the filtering of the downsamples and upsamples
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		samplerInfo.compareEnable = VK_FALSE;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = 0.0f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+		if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &Sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create post processing sampler");
+		}
+	}
+
+	void PostProcessor::createDescriptors() {
+		const uint32_t levelCount = static_cast<uint32_t>(LevelViews.size());
+		const uint32_t imageCount = swapchain.GetImageCount();
+		const uint32_t setCount = imageCount * 2 + (levelCount - 1) * 2;
+
+		// Remade with the swapchain like the depth pyramid, so a pool of its own
+		std::array<VkDescriptorPoolSize, 2> PoolSize{};
+		PoolSize[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		PoolSize[0].descriptorCount = setCount * 2;
+		PoolSize[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		PoolSize[1].descriptorCount = setCount;
+
+		VkDescriptorPoolCreateInfo PoolInfo{};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		PoolInfo.poolSizeCount = static_cast<uint32_t>(PoolSize.size());
+		PoolInfo.pPoolSizes = PoolSize.data();
+		PoolInfo.maxSets = setCount;
+
+		if (vkCreateDescriptorPool(device.device(), &PoolInfo, nullptr, &DescriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create post processing descriptor pool");
+		}
+
+		// 0 source, 1 second source (the bloom for the final pass), 2 written
+		std::array<VkDescriptorSetLayoutBinding, 3> bindingInfo{};
+		for (uint32_t i = 0; i < bindingInfo.size(); i++) {
+			bindingInfo[i].binding = i;
+			bindingInfo[i].descriptorCount = 1;
+			bindingInfo[i].descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			bindingInfo[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			bindingInfo[i].pImmutableSamplers = nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
+		LayoutInfo.pBindings = bindingInfo.data();
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create post processing descriptor set layout");
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(setCount, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = setCount;
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = DescriptorPool;
+
+		std::vector<VkDescriptorSet> sets(setCount);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, sets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate post processing descriptor sets");
+		}
+
+		auto next = sets.begin();
+		PrefilterSets.assign(next, next + imageCount);
+		next += imageCount;
+		CompositeSets.assign(next, next + imageCount);
+		next += imageCount;
+		DownsampleSets.assign(next, next + (levelCount - 1));
+		next += levelCount - 1;
+		UpsampleSets.assign(next, next + (levelCount - 1));
+
+		// The scene color is left read only by the render passes, the bloom levels are storage and sampled in GENERAL
+		auto level = [&](uint32_t i) { return VkDescriptorImageInfo{ Sampler, LevelViews[i], VK_IMAGE_LAYOUT_GENERAL }; };
+
+		for (uint32_t i = 0; i < imageCount; i++) {
+			VkDescriptorImageInfo sceneColor{ Sampler, swapchain.GetSceneColorView(i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			writeSet(PrefilterSets[i], sceneColor, sceneColor, LevelViews[0]);
+			writeSet(CompositeSets[i], sceneColor, level(0), swapchain.GetSwapchainImageView(i));
+		}
+
+		for (uint32_t i = 1; i < levelCount; i++) {
+			writeSet(DownsampleSets[i - 1], level(i - 1), level(i - 1), LevelViews[i]);
+			writeSet(UpsampleSets[i - 1], level(i), level(i), LevelViews[i - 1]);
+		}
+	}
+
+	void PostProcessor::writeSet(VkDescriptorSet set, VkDescriptorImageInfo source, VkDescriptorImageInfo secondSource, VkImageView destination) {
+		std::array<VkDescriptorImageInfo, 3> imageInfo = { source, secondSource, VkDescriptorImageInfo{ VK_NULL_HANDLE, destination, VK_IMAGE_LAYOUT_GENERAL } };
+
+		std::array<VkWriteDescriptorSet, 3> WriteSet{};
+		for (uint32_t b = 0; b < WriteSet.size(); b++) {
+			WriteSet[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[b].dstSet = set;
+			WriteSet[b].dstBinding = b;
+			WriteSet[b].dstArrayElement = 0;
+			WriteSet[b].descriptorCount = 1;
+			WriteSet[b].descriptorType = b == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			WriteSet[b].pImageInfo = &imageInfo[b];
+		}
+
+		vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
+	}
+
+	void PostProcessor::createPipelines() {
+		VkPushConstantRange paramsRange{};
+		paramsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		paramsRange.offset = 0;
+		paramsRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &paramsRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create post processing pipeline layout");
+		}
+
+		downsamplePipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/PostDownsample.comp.spv",
+			pipelineLayout
+		);
+		upsamplePipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/PostUpsample.comp.spv",
+			pipelineLayout
+		);
+		compositePipeline = std::make_unique<CPipeline>(
+			device,
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/PostComposite.comp.spv",
+			pipelineLayout
+		);
+	}
+
+	void PostProcessor::levelBarrier(VkCommandBuffer commandBuffer, uint32_t level) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = BloomImage;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void PostProcessor::Record(VkCommandBuffer commandBuffer, uint32_t ImageIndex, const Settings& settings, bool crossQueue) {
+		const uint32_t levelCount = static_cast<uint32_t>(LevelViews.size());
+
+		/*
+			On the graphics queue the render pass's color writes come before the reads here, on the compute queue the
+			semaphore already did that. The swapchain image's transition has to follow the acquire, which the graphics
+			submission waits for at the color output stage, and the compute one gets through the semaphore after it.
+			Last frame's final pass may still be sampling the bloom.
+		*/
+		std::array<VkImageMemoryBarrier, 3> barriers{};
+		for (auto& barrier : barriers) {
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		}
+
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[0].image = BloomImage;
+		barriers[0].subresourceRange.levelCount = levelCount;
+		barriers[0].srcAccessMask = 0;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[1].image = swapchain.GetSwapchainImage(ImageIndex);
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+		// Already in the layout the render pass left it in, only its writes have to be made visible
+		barriers[2].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[2].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[2].image = swapchain.GetSceneColorImage(ImageIndex);
+		barriers[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barriers[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (crossQueue ? 0 : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, crossQueue ? 2 : 3, barriers.data()
+		);
+
+		PushConstants params{};
+		params.bloomThreshold = settings.bloomThreshold;
+		params.bloomIntensity = settings.bloomIntensity;
+		params.exposure = settings.exposure;
+		params.sharpness = settings.sharpness;
+
+		auto dispatch = [&](VkDescriptorSet set, VkExtent2D source, VkExtent2D destination) {
+			params.sourceTexel[0] = 1.0f / source.width;
+			params.sourceTexel[1] = 1.0f / source.height;
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+			vkCmdDispatch(commandBuffer, (destination.width + 7) / 8, (destination.height + 7) / 8, 1);
+		};
+
+		// Down the chain, the first pass straight from the full resolution scene
+		downsamplePipeline->bind(commandBuffer);
+		params.prefilter = 1;
+		dispatch(PrefilterSets[ImageIndex], extent, LevelExtents[0]);
+		levelBarrier(commandBuffer, 0);
+
+		params.prefilter = 0;
+		for (uint32_t i = 1; i < levelCount; i++) {
+			dispatch(DownsampleSets[i - 1], LevelExtents[i - 1], LevelExtents[i]);
+			levelBarrier(commandBuffer, i);
+		}
+
+		// And back up, every level adding the blurred one below onto itself
+		if (levelCount > 1) {
+			upsamplePipeline->bind(commandBuffer);
+			for (uint32_t i = levelCount - 1; i > 0; i--) {
+				dispatch(UpsampleSets[i - 1], LevelExtents[i], LevelExtents[i - 1]);
+				levelBarrier(commandBuffer, i - 1);
+			}
+		}
+
+		compositePipeline->bind(commandBuffer);
+		dispatch(CompositeSets[ImageIndex], LevelExtents[0], extent);
+
+		VkImageMemoryBarrier presentBarrier = barriers[1];
+		presentBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		presentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		presentBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		presentBarrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &presentBarrier);
+	}
+}
\ No newline at end of file
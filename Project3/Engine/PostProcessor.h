@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "SwapChain.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Post processing of a swapchain made with postProcess, all in compute. Bloom is a chain of downsamples from the scene
+		color into a half or quarter resolution image and its mips, then a chain of tent upsamples adding each level onto
+		the one above. One full resolution pass at the end sharpens the scene color, adds the bloom, tonemaps and writes the
+		swapchain image. Everything but that last pass runs at a fraction of the resolution, so the cost barely follows it.
+		The bloom image is remade every frame, it's moved to GENERAL from UNDEFINED at the start of every Record.
+	*/
+	class PostProcessor
+	{
+	public:
+		static constexpr uint32_t MaxBloomLevels = 5;
+
+		struct Settings {
+			float exposure = 1.0f;
+			float bloomThreshold = 1.0f;	// scene luminance bloom starts at, with a soft knee below
+			float bloomIntensity = 0.05f;
+			float sharpness = 0.25f;	// 0 leaves the scene as is
+			uint32_t downscale = 2;	// of the first bloom level, 2 for half and 4 for quarter resolution
+		};
+
+		// Shared by the three shaders, each reads what it needs
+		struct PushConstants {
+			float sourceTexel[2];	// 1 / the size of what is sampled
+			float bloomThreshold;
+			float bloomIntensity;
+			float exposure;
+			float sharpness;
+			uint32_t prefilter;	// the first downsample thresholds the scene and weighs down lone bright texels
+			uint32_t padding;
+		};
+
+		// Needs a swapchain made with postProcess
+		PostProcessor(Device& device, SwapChain& swapchain, uint32_t downscale);
+		~PostProcessor();
+
+		PostProcessor(const PostProcessor&) = delete;
+		PostProcessor& operator=(const PostProcessor&) = delete;
+
+		/*
+			Outside of a render pass, after the last one drawing into the scene color. Leaves the swapchain image in
+			PRESENT_SRC_KHR. crossQueue when recorded for the compute queue, a semaphore then orders it after the drawing.
+		*/
+		void Record(VkCommandBuffer commandBuffer, uint32_t ImageIndex, const Settings& settings, bool crossQueue);
+
+		uint32_t GetDownscale() { return downscale; }
+
+	private:
+		void createBloomImage();
+		void createSampler();
+		void createDescriptors();
+		void createPipelines();
+
+		// Every binding of the set at once, the passes that don't read the second source get the first one again
+		void writeSet(VkDescriptorSet set, VkDescriptorImageInfo source, VkDescriptorImageInfo secondSource, VkImageView destination);
+		// The next pass reads what the last one wrote
+		void levelBarrier(VkCommandBuffer commandBuffer, uint32_t level);
+
+		VkImage BloomImage;
+		VkDeviceMemory BloomImageMemory;
+		std::vector<VkImageView> LevelViews;
+		std::vector<VkExtent2D> LevelExtents;
+		VkSampler Sampler;
+
+		VkDescriptorPool DescriptorPool;
+		VkDescriptorSetLayout DescriptorSetLayout;
+		// Per swapchain image, the first downsample and the final pass
+		std::vector<VkDescriptorSet> PrefilterSets;
+		std::vector<VkDescriptorSet> CompositeSets;
+		// Per level from 1 on, reading the one above
+		std::vector<VkDescriptorSet> DownsampleSets;
+		// Per level but the last, reading the one below
+		std::vector<VkDescriptorSet> UpsampleSets;
+
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<CPipeline> downsamplePipeline;
+		std::unique_ptr<CPipeline> upsamplePipeline;
+		std::unique_ptr<CPipeline> compositePipeline;
+
+		// Swapchain size
+		VkExtent2D extent;
+		uint32_t downscale;
+
+		Device& device;
+		SwapChain& swapchain;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "RenderQueue.h"
+
+//std
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace Engine {
+	namespace {
+		constexpr uint32_t PassShift = 60;
+		constexpr uint32_t PipelineShift = 52;
+		constexpr uint32_t SetShift = 40;
+		constexpr uint32_t MeshShift = 24;
+		constexpr uint64_t DepthMask = (1ull << 24) - 1;
+
+		constexpr uint32_t NotBound = UINT32_MAX;
+	}
+
+	uint64_t RenderQueue::MakeKey(Pass pass, uint32_t pipeline, uint32_t set, uint32_t mesh, float depth) {
+		uint64_t quantizedDepth = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * DepthMask);
+
+		return static_cast<uint64_t>(pass) << PassShift
+			| static_cast<uint64_t>(pipeline) << PipelineShift
+			| static_cast<uint64_t>(set) << SetShift
+			| static_cast<uint64_t>(mesh) << MeshShift
+			| quantizedDepth;
+	}
+
+	uint32_t RenderQueue::AddPipeline(const PipelineState& state) {
+		if (pipelines.size() >= MaxPipelines) {
+			throw std::runtime_error("too many pipelines in the render queue");
+		}
+		pipelines.push_back(state);
+		return static_cast<uint32_t>(pipelines.size() - 1);
+	}
+
+	uint32_t RenderQueue::AddDescriptorSet(const DescriptorState& state) {
+		if (sets.size() >= MaxDescriptorSets) {
+			throw std::runtime_error("too many descriptor sets in the render queue");
+		}
+		sets.push_back(state);
+		return static_cast<uint32_t>(sets.size() - 1);
+	}
+
+	uint32_t RenderQueue::AddMesh(const MeshState& state) {
+		if (meshes.size() >= MaxMeshes) {
+			throw std::runtime_error("too many meshes in the render queue");
+		}
+		meshes.push_back(state);
+		return static_cast<uint32_t>(meshes.size() - 1);
+	}
+
+	void RenderQueue::Add(uint64_t key, const Draw& draw) {
+		keys.push_back(key);
+		draws.push_back(draw);
+	}
+
+	void RenderQueue::Clear() {
+		pipelines.clear();
+		sets.clear();
+		meshes.clear();
+		keys.clear();
+		draws.clear();
+		order.clear();
+		stats = {};
+	}
+
+	void RenderQueue::Sort() {
+		size_t count = keys.size();
+		order.resize(count);
+		std::iota(order.begin(), order.end(), 0u);
+		if (count < 2) {
+			return;
+		}
+
+		scratchKeys.resize(count);
+		scratchOrder.resize(count);
+
+		// Least significant byte first, each pass keeps the order of the one before for equal bytes
+		for (uint32_t shift = 0; shift < 64; shift += 8) {
+			uint32_t offsets[256] = {};
+			for (uint64_t key : keys) {
+				offsets[(key >> shift) & 0xff]++;
+			}
+
+			// Every key has the same byte here, the pass wouldn't move anything
+			if (offsets[(keys[0] >> shift) & 0xff] == count) {
+				continue;
+			}
+
+			uint32_t sum = 0;
+			for (uint32_t& offset : offsets) {
+				uint32_t bucket = offset;
+				offset = sum;
+				sum += bucket;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				uint32_t destination = offsets[(keys[i] >> shift) & 0xff]++;
+				scratchKeys[destination] = keys[i];
+				scratchOrder[destination] = order[i];
+			}
+
+			keys.swap(scratchKeys);
+			order.swap(scratchOrder);
+		}
+	}
+
+	void RenderQueue::Submit(VkCommandBuffer commandBuffer, Pass pass) {
+		uint64_t passBegin = static_cast<uint64_t>(pass) << PassShift;
+		uint64_t passEnd = passBegin + (1ull << PassShift);
+		size_t begin = std::lower_bound(keys.begin(), keys.end(), passBegin) - keys.begin();
+		size_t end = passEnd == 0 ? keys.size() : std::lower_bound(keys.begin(), keys.end(), passEnd) - keys.begin();
+
+		uint32_t boundPipeline = NotBound;
+		uint32_t boundSet = NotBound;
+		uint32_t boundMesh = NotBound;
+
+		for (size_t i = begin; i < end; i++) {
+			uint64_t key = keys[i];
+			uint32_t pipelineId = static_cast<uint32_t>(key >> PipelineShift) & (MaxPipelines - 1);
+			uint32_t setId = static_cast<uint32_t>(key >> SetShift) & (MaxDescriptorSets - 1);
+			uint32_t meshId = static_cast<uint32_t>(key >> MeshShift) & (MaxMeshes - 1);
+			const PipelineState& pipeline = pipelines[pipelineId];
+
+			if (pipelineId != boundPipeline) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+				if (pipeline.pushSize) {
+					vkCmdPushConstants(commandBuffer, pipeline.layout, pipeline.pushStages, 0, pipeline.pushSize, pipeline.pushData);
+				}
+				boundPipeline = pipelineId;
+				// The layout may differ from the last pipeline's, the set isn't guaranteed to survive it
+				boundSet = NotBound;
+				stats.pipelineBinds++;
+			}
+			else {
+				stats.bindsSkipped++;
+			}
+
+			if (setId != boundSet) {
+				const DescriptorState& set = sets[setId];
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, set.layout, 0, 1, &set.set, 0, nullptr);
+				boundSet = setId;
+				stats.setBinds++;
+			}
+			else {
+				stats.bindsSkipped++;
+			}
+
+			if (meshId != boundMesh) {
+				const MeshState& mesh = meshes[meshId];
+				if (mesh.vertexBuffer != VK_NULL_HANDLE) {
+					VkDeviceSize offset = 0;
+					vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &offset);
+				}
+				vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
+				boundMesh = meshId;
+				stats.meshBinds++;
+			}
+			else {
+				stats.bindsSkipped++;
+			}
+
+			const Draw& draw = draws[order[i]];
+			uint32_t indices[2] = { draw.object, draw.material };
+			vkCmdPushConstants(commandBuffer, pipeline.layout, pipeline.pushStages, pipeline.objectOffset, sizeof(indices), indices);
+
+			if (draw.indirectBuffer != VK_NULL_HANDLE) {
+				vkCmdDrawIndexedIndirect(commandBuffer, draw.indirectBuffer, draw.indirectOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+			else {
+				vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+			}
+			stats.draws++;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	/*
+		Draws of a frame packed into 64 bit sort keys, radix sorted, then recorded in key order while only binding what
+		differs from the draw before. From the most significant bits down a key holds:
+
+			pass      4 bits   render pass the draw is recorded in, Submit records one pass at a time
+			pipeline  8 bits
+			set      12 bits   descriptor set, materials are indices into a buffer it holds so they don't need their own
+			mesh     12 bits   vertex and index buffers
+			depth    24 bits   distance over the far plane, so draws sharing all of the above go front to back
+
+		Pipelines, descriptor sets and meshes are registered every frame and referred to by the id Add... returned, ids are
+		only valid until the next Clear.
+	*/
+	class RenderQueue
+	{
+	public:
+		enum class Pass : uint32_t {
+			Main = 0,
+			// The occlusion culler's second phase, recorded in the resumed render pass
+			Late = 1,
+			// Depth only, recorded in the depth prepass before Main
+			DepthPrepass = 2
+		};
+
+		struct PipelineState {
+			VkPipeline pipeline;
+			VkPipelineLayout layout;
+			VkShaderStageFlags pushStages;
+			// Push constants shared by every draw, pushed at offset 0 whenever the pipeline is bound
+			const void* pushData;
+			uint32_t pushSize;
+			// Where each draw's object and material indices are pushed, next to each other
+			uint32_t objectOffset;
+		};
+
+		struct DescriptorState {
+			VkPipelineLayout layout;
+			VkDescriptorSet set;
+		};
+
+		struct MeshState {
+			// Null for pipelines that pull their vertices
+			VkBuffer vertexBuffer;
+			VkBuffer indexBuffer;
+			VkIndexType indexType;
+		};
+
+		// Indexed, indirect when indirectBuffer isn't null
+		struct Draw {
+			uint32_t object;
+			uint32_t material;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			VkBuffer indirectBuffer;
+			VkDeviceSize indirectOffset;
+		};
+
+		// Per frame, Clear starts over
+		struct Stats {
+			uint32_t draws;
+			uint32_t pipelineBinds;
+			uint32_t setBinds;
+			uint32_t meshBinds;
+			// Binds the draws would have needed had each bound everything itself
+			uint32_t bindsSkipped;
+		};
+
+		static constexpr uint32_t MaxPipelines = 1u << 8;
+		static constexpr uint32_t MaxDescriptorSets = 1u << 12;
+		static constexpr uint32_t MaxMeshes = 1u << 12;
+
+		// depth is clamped to [0, 1]
+		static uint64_t MakeKey(Pass pass, uint32_t pipeline, uint32_t set, uint32_t mesh, float depth);
+
+		uint32_t AddPipeline(const PipelineState& state);
+		uint32_t AddDescriptorSet(const DescriptorState& state);
+		uint32_t AddMesh(const MeshState& state);
+
+		void Add(uint64_t key, const Draw& draw);
+		void Sort();
+		// Records the draws of one pass, nothing is assumed to be bound before
+		void Submit(VkCommandBuffer commandBuffer, Pass pass);
+		void Clear();
+
+		const Stats& GetStats() const { return stats; }
+
+	private:
+		std::vector<PipelineState> pipelines;
+		std::vector<DescriptorState> sets;
+		std::vector<MeshState> meshes;
+
+		std::vector<uint64_t> keys;
+		std::vector<Draw> draws;
+		// Draw of every sorted key
+		std::vector<uint32_t> order;
+
+		std::vector<uint64_t> scratchKeys;
+		std::vector<uint32_t> scratchOrder;
+
+		Stats stats{};
+	};
+}
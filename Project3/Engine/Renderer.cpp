@@ -1,9 +1,23 @@
 #include "Renderer.h"
 
 namespace Engine {
-	Renderer::Renderer(Device& device, Window& window) : device{ device }, window{ window } {
+	Renderer::Renderer(Device& device, Window& window, bool depthPyramid, bool deferred, bool postProcessing) : depthPyramidEnabled{ depthPyramid }, deferredEnabled{ deferred }, postProcessingEnabled{ postProcessing }, window{ window }, device{ device } {
 		recreateSwapchain();
 		AllocateCommandBuffers();
+
+		if (postProcessingEnabled && device.HasAsyncCompute()) {
+			computeCommandbuffers.resize(MAX_FRAME_IN_FLIGHT);
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandBufferCount = static_cast<uint32_t>(computeCommandbuffers.size());
+			allocInfo.commandPool = device.ComputeCommandPool();
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, computeCommandbuffers.data()) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate compute command buffer");
+			}
+		}
 	}
 
 	void Renderer::AllocateCommandBuffers() {
@@ -33,24 +47,73 @@ namespace Engine {
 		}
 
 
+		// Still points at the old swapchain's depth and images
+		depthPyramid.reset();
+		postProcessor.reset();
+
 		if (swapchain == nullptr)
 		{
 			swapchain = std::make_unique<SwapChain>(
 				device,
-				window.WindowExtent()
+				window.WindowExtent(),
+				depthPyramidEnabled,
+				deferredEnabled,
+				postProcessingEnabled
 			);
 		}
 		else {
 			swapchain = std::make_unique<SwapChain>(
 				device,
 				window.WindowExtent(),
-				std::move(swapchain)
+				std::move(swapchain),
+				depthPyramidEnabled,
+				deferredEnabled,
+				postProcessingEnabled
 			);
 			if (swapchain->GetImageCount() != commandbuffers.size()) {
 				freeCommandBuffers();
 				AllocateCommandBuffers();
 			}
 		}
+
+		if (depthPyramidEnabled) {
+			depthPyramid = std::make_unique<DepthPyramid>(device, *swapchain);
+		}
+		if (postProcessingEnabled) {
+			postProcessor = std::make_unique<PostProcessor>(device, *swapchain, postSettings.downscale);
+		}
+	}
+
+	void Renderer::SetPostSettings(const PostProcessor::Settings& settings) {
+		assert(!FrameInProgress && "can't change the post processing during a frame");
+
+		bool remake = postProcessor && settings.downscale != postSettings.downscale;
+		postSettings = settings;
+		if (remake) {
+			vkDeviceWaitIdle(device.device());
+			postProcessor = std::make_unique<PostProcessor>(device, *swapchain, postSettings.downscale);
+		}
+	}
+
+	VkCommandBuffer Renderer::recordAsyncPostProcessing() {
+		VkCommandBuffer commandBuffer = computeCommandbuffers[currentFrame];
+		vkResetCommandBuffer(commandBuffer, 0);
+
+		VkCommandBufferBeginInfo CBbeginInfo{};
+		CBbeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		CBbeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &CBbeginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record commands to compute command buffer");
+		}
+
+		postProcessor->Record(commandBuffer, ImageIndex, postSettings, true);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record commands to compute command buffer");
+		}
+
+		return commandBuffer;
 	}
 
 	void Renderer::freeCommandBuffers() {
@@ -84,6 +147,8 @@ namespace Engine {
 		}
 
 		FrameInProgress = true;
+		depthPrepassed = false;
+		gpuTimer.Begin(commandBuffer, currentFrame);
 
 		return commandBuffer;
 	}
@@ -92,11 +157,21 @@ namespace Engine {
 		assert(FrameInProgress && "can't use this function if frame is not in progress");
 		auto commandBuffer = GetCurrentCommandBuffer();
 
+		// On the graphics queue it's timed like any other pass, the compute queue's time isn't measured
+		VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+		if (postProcessor && !computeCommandbuffers.empty()) {
+			computeCommandBuffer = recordAsyncPostProcessing();
+		}
+		else if (postProcessor) {
+			postProcessor->Record(commandBuffer, ImageIndex, postSettings, false);
+			gpuTimer.Mark(commandBuffer, currentFrame, "post processing");
+		}
+
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to record commands to command buffer");
 		}
 
-		auto result = swapchain->SubmitCommandBuffer(commandBuffer, &ImageIndex);
+		auto result = swapchain->SubmitCommandBuffer(commandBuffer, &ImageIndex, computeCommandBuffer);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.ResizedFlag()) {
 			window.ResetResizedFlag();
 			recreateSwapchain();
@@ -111,22 +186,64 @@ namespace Engine {
 	}
 
 	void Renderer::StartSwapchainRenderPass(VkCommandBuffer commandBuffer) {
+		VkRenderPass renderPass = depthPrepassed ? swapchain->prepassedRenderPass() : swapchain->renderPass();
+		beginRenderPass(commandBuffer, renderPass, swapchain->Framebuffer(ImageIndex), "main pass");
+	}
+
+	void Renderer::StartDeferredRenderPass(VkCommandBuffer commandBuffer) {
+		assert(deferredEnabled && "the renderer was made without the G-buffer");
+		beginRenderPass(commandBuffer, swapchain->deferredRenderPass(), swapchain->DeferredFramebuffer(ImageIndex), "g-buffer");
+	}
+
+	void Renderer::NextSubpass(VkCommandBuffer commandBuffer) {
+		assert(FrameInProgress && "can't use this function if frame is not in progress");
+
+		gpuTimer.Mark(commandBuffer, currentFrame, passLabel);
+		passLabel = "lighting";
+		vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	void Renderer::StartDepthPrepass(VkCommandBuffer commandBuffer) {
+		depthPrepassed = true;
+		beginRenderPass(commandBuffer, swapchain->depthPrepassRenderPass(), swapchain->DepthFramebuffer(), "depth prepass");
+	}
+
+	void Renderer::ResumeSwapchainRenderPass(VkCommandBuffer commandBuffer) {
+		assert(depthPyramid && "the swapchain only keeps its depth with the depth pyramid");
+		beginRenderPass(commandBuffer, swapchain->resumeRenderPass(), swapchain->Framebuffer(ImageIndex), "late pass");
+	}
+
+	void Renderer::BuildDepthPyramid(VkCommandBuffer commandBuffer) {
+		assert(FrameInProgress && "can't use this function if frame is not in progress");
+		assert(depthPyramid && "the renderer was made without the depth pyramid");
+
+		depthPyramid->Build(commandBuffer);
+		gpuTimer.Mark(commandBuffer, currentFrame, "depth pyramid");
+	}
+
+	void Renderer::beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer, const char* label) {
 		assert(FrameInProgress && "can't use this function if frame is not in progress");
 		assert(commandBuffer == GetCurrentCommandBuffer() && "commandbuffer given isn't the current commandBuffer");
 
+		// Compute and copies recorded since the last pass
+		gpuTimer.Mark(commandBuffer, currentFrame, "outside passes");
+		passLabel = label;
+
 		VkRenderPassBeginInfo RPbeginInfo{};
 		RPbeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		RPbeginInfo.framebuffer = swapchain->Framebuffer(ImageIndex);
-		RPbeginInfo.renderPass = swapchain->renderPass();
+		RPbeginInfo.framebuffer = framebuffer;
+		RPbeginInfo.renderPass = renderPass;
 
 		RPbeginInfo.renderArea.offset = { 0, 0 };
 		RPbeginInfo.renderArea.extent = swapchain->Extent();
 
+		// Ignored by the attachments that are loaded, the depth prepass only has the depth and the G-buffer isn't cleared
 		std::array<VkClearValue, 2> clearValues;
 		clearValues[0].color = { {0.07f, 0.13f, 0.17f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-		RPbeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		RPbeginInfo.pClearValues = clearValues.data();
+		clearValues[1].depthStencil = { REVERSE_Z ? 0.0f : 1.0f, 0 };
+		bool depthOnly = framebuffer == swapchain->DepthFramebuffer();
+		RPbeginInfo.clearValueCount = depthOnly ? 1 : static_cast<uint32_t>(clearValues.size());
+		RPbeginInfo.pClearValues = depthOnly ? &clearValues[1] : clearValues.data();
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -150,5 +267,6 @@ namespace Engine {
 		assert(commandBuffer == GetCurrentCommandBuffer() && "commandbuffer given isn't the current commandBuffer");
 
 		vkCmdEndRenderPass(commandBuffer);
+		gpuTimer.Mark(commandBuffer, currentFrame, passLabel);
 	}
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "Device.h"
 #include "SwapChain.h"
 #include "Window.h"
+#include "DepthPyramid.h"
+#include "PostProcessor.h"
+#include "GpuTimer.h"
 
 #include <cassert>
 
@@ -11,34 +14,88 @@ namespace Engine
 	class Renderer
 	{
 	public:
-		Renderer(Device& device, Window& window);
+		// depthPyramid keeps the depth attachment after the render pass and builds a DepthPyramid from it on request
+		// deferred makes the swapchain's G-buffer for StartDeferredRenderPass
+		/*
+			postProcessing draws into an HDR scene color that EndFrame tonemaps into the swapchain image with a
+			PostProcessor. Where the device has a compute only queue it runs there, beside the next frame's drawing.
+		*/
+		Renderer(Device& device, Window& window, bool depthPyramid = false, bool deferred = false, bool postProcessing = false);
 
 		VkCommandBuffer StartFrame();
+		// Post processes the frame first when the renderer was made with it
 		void EndFrame();
 
+		// Loads the depth StartDepthPrepass drew when it ran this frame instead of clearing it
 		void StartSwapchainRenderPass(VkCommandBuffer commandBuffer);
+		// Also ends the depth prepass
 		void EndSwapchainRenderPass(VkCommandBuffer commandBuffer);
 
+		/*
+			Instead of StartSwapchainRenderPass, only with deferred. Draws into the G-buffer with pipelines made for subpass 0
+			of GetDeferredRenderPass(), NextSubpass then moves on to the lighting. Ended by EndSwapchainRenderPass.
+		*/
+		void StartDeferredRenderPass(VkCommandBuffer commandBuffer);
+		void NextSubpass(VkCommandBuffer commandBuffer);
+
+		// Depth only, before StartSwapchainRenderPass. Its pipelines are made with GetDepthPrepassRenderPass()
+		void StartDepthPrepass(VkCommandBuffer commandBuffer);
+
+		// Between two swapchain render passes, only with depthPyramid
+		void BuildDepthPyramid(VkCommandBuffer commandBuffer);
+		// Begins the render pass again keeping what was drawn, after BuildDepthPyramid
+		void ResumeSwapchainRenderPass(VkCommandBuffer commandBuffer);
+		// Null without depthPyramid, changes when the swapchain is recreated
+		DepthPyramid* GetDepthPyramid() { return depthPyramid.get(); }
+
 		VkRenderPass GetSwapchainRenderPass() { return swapchain->renderPass(); }
+		VkRenderPass GetDepthPrepassRenderPass() { return swapchain->depthPrepassRenderPass(); }
+		VkRenderPass GetDeferredRenderPass() { return swapchain->deferredRenderPass(); }
+		// Changes when the swapchain is recreated, its version tells
+		GBuffer GetGBuffer() { return swapchain->GetGBuffer(); }
 		VkExtent2D GetSwapchainExtent() { return swapchain->Extent(); }
 
+		const PostProcessor::Settings& GetPostSettings() const { return postSettings; }
+		// A different downscale remakes the bloom images, outside of a frame
+		void SetPostSettings(const PostProcessor::Settings& settings);
+
+		// Ends a GPU timing under label for what was recorded since the last pass, for passes other systems record
+		void MarkGpuTime(VkCommandBuffer commandBuffer, const char* label) { gpuTimer.Mark(commandBuffer, currentFrame, label); }
+		// GPU time of the render passes and of the work recorded between them, a couple of frames old
+		const std::vector<GpuTimer::Timing>& GetGpuTimings() const { return gpuTimer.GetTimings(); }
+
 
 	private:
 		void recreateSwapchain();
 		void AllocateCommandBuffers();
 		void freeCommandBuffers();
+		// Records and ends the compute command buffer of the frame, for the compute queue
+		VkCommandBuffer recordAsyncPostProcessing();
+		// label names the pass in the GPU timings
+		void beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer, const char* label);
 
 		VkCommandBuffer GetCurrentCommandBuffer() { return commandbuffers[currentFrame]; }
 		
 		std::vector<VkCommandBuffer> commandbuffers;
+		// From the compute queue's pool, only for async post processing
+		std::vector<VkCommandBuffer> computeCommandbuffers;
 
 		uint32_t ImageIndex;
 		uint32_t currentFrame = 0;
 		bool FrameInProgress = false;
+		bool depthPyramidEnabled;
+		bool deferredEnabled;
+		bool postProcessingEnabled;
+		PostProcessor::Settings postSettings;
+		bool depthPrepassed = false;
+		const char* passLabel = nullptr;
 
 		Window& window;
 		Device& device;
 		std::unique_ptr<SwapChain> swapchain;
+		std::unique_ptr<DepthPyramid> depthPyramid;
+		std::unique_ptr<PostProcessor> postProcessor;
+		GpuTimer gpuTimer{ device };
 	};
 }
 
@@ -0,0 +1,406 @@
+#include "Scene.h"
+
+//std
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SCENE_SSE 1
+#include <emmintrin.h>
+#else
+#define SCENE_SSE 0
+#endif
+
+namespace Engine {
+	namespace {
+		glm::mat4 Compose(glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+			glm::mat4 matrix = glm::mat4_cast(rotation);
+			matrix[0] *= scale.x;
+			matrix[1] *= scale.y;
+			matrix[2] *= scale.z;
+			matrix[3] = glm::vec4(position, 1.0f);
+			return matrix;
+		}
+
+#if SCENE_SSE
+		// Columns of the result are the parent's columns weighted by the local matrix's
+		inline void Multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result) {
+			__m128 p0 = _mm_loadu_ps(&parent[0][0]);
+			__m128 p1 = _mm_loadu_ps(&parent[1][0]);
+			__m128 p2 = _mm_loadu_ps(&parent[2][0]);
+			__m128 p3 = _mm_loadu_ps(&parent[3][0]);
+
+			for (int column = 0; column < 4; column++) {
+				__m128 l = _mm_loadu_ps(&local[column][0]);
+				__m128 sum = _mm_mul_ps(p0, _mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)));
+				sum = _mm_add_ps(sum, _mm_mul_ps(p1, _mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1))));
+				sum = _mm_add_ps(sum, _mm_mul_ps(p2, _mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2))));
+				sum = _mm_add_ps(sum, _mm_mul_ps(p3, _mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3))));
+				_mm_storeu_ps(&result[column][0], sum);
+			}
+		}
+
+		// Center through the matrix, half extent through its absolute value
+		inline Bvh::Aabb TransformBounds(const glm::mat4& matrix, const Bvh::Aabb& bounds) {
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+			glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+
+			__m128 m0 = _mm_loadu_ps(&matrix[0][0]);
+			__m128 m1 = _mm_loadu_ps(&matrix[1][0]);
+			__m128 m2 = _mm_loadu_ps(&matrix[2][0]);
+
+			__m128 worldCenter = _mm_loadu_ps(&matrix[3][0]);
+			worldCenter = _mm_add_ps(worldCenter, _mm_mul_ps(m0, _mm_set1_ps(center.x)));
+			worldCenter = _mm_add_ps(worldCenter, _mm_mul_ps(m1, _mm_set1_ps(center.y)));
+			worldCenter = _mm_add_ps(worldCenter, _mm_mul_ps(m2, _mm_set1_ps(center.z)));
+
+			__m128 worldExtent = _mm_mul_ps(_mm_andnot_ps(signMask, m0), _mm_set1_ps(extent.x));
+			worldExtent = _mm_add_ps(worldExtent, _mm_mul_ps(_mm_andnot_ps(signMask, m1), _mm_set1_ps(extent.y)));
+			worldExtent = _mm_add_ps(worldExtent, _mm_mul_ps(_mm_andnot_ps(signMask, m2), _mm_set1_ps(extent.z)));
+
+			alignas(16) float minimum[4];
+			alignas(16) float maximum[4];
+			_mm_store_ps(minimum, _mm_sub_ps(worldCenter, worldExtent));
+			_mm_store_ps(maximum, _mm_add_ps(worldCenter, worldExtent));
+			return { glm::vec3(minimum[0], minimum[1], minimum[2]), glm::vec3(maximum[0], maximum[1], maximum[2]) };
+		}
+
+		// Mapped memory is usually write combined, full lines written around the cache are the cheapest way in
+		inline void StoreMatrix(glm::mat4* destination, const glm::mat4& matrix) {
+			float* target = &(*destination)[0][0];
+			for (int column = 0; column < 4; column++) {
+				_mm_stream_ps(target + column * 4, _mm_loadu_ps(&matrix[column][0]));
+			}
+		}
+#else
+		inline void Multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result) {
+			result = parent * local;
+		}
+
+		inline Bvh::Aabb TransformBounds(const glm::mat4& matrix, const Bvh::Aabb& bounds) {
+			glm::vec3 center = glm::vec3(matrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+			glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+			glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y + glm::abs(glm::vec3(matrix[2])) * extent.z;
+			return { center - worldExtent, center + worldExtent };
+		}
+
+		inline void StoreMatrix(glm::mat4* destination, const glm::mat4& matrix) {
+			*destination = matrix;
+		}
+#endif
+	}
+
+	Scene::Scene(Device& device, ThreadPool& workers, uint32_t capacity) : capacity{ capacity }, device{ device }, workers{ workers } {
+		createMatrixBuffers();
+	}
+
+	Scene::~Scene() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), MatrixBuffers[i], nullptr);
+			vkFreeMemory(device.device(), MatrixBuffersMemory[i], nullptr);
+		}
+	}
+
+	void Scene::createMatrixBuffers() {
+		MatrixBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		MatrixBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		MatrixBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				MatrixBuffers[i],
+				GetMatrixBufferSize(),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				MatrixBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), MatrixBuffersMemory[i], 0, GetMatrixBufferSize(), 0, &MatrixBuffersMapped[i]);
+		}
+	}
+
+	uint32_t Scene::slotOf(Entity entity) const {
+		assert(IsAlive(entity) && "entity was destroyed");
+		return sparse[entity.index];
+	}
+
+	bool Scene::IsAlive(Entity entity) const {
+		return entity.index < generations.size() && generations[entity.index] == entity.generation;
+	}
+
+	Entity Scene::Create(Entity parent) {
+		if (entities.size() >= capacity) {
+			throw std::runtime_error("scene is out of entities");
+		}
+
+		Entity entity;
+		if (!freeIndices.empty()) {
+			entity.index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			entity.index = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+			sparse.push_back(NoSlot);
+		}
+		entity.generation = generations[entity.index];
+
+		uint32_t slot = static_cast<uint32_t>(entities.size());
+		uint32_t parentSlot = parent == Entity{} ? NoSlot : slotOf(parent);
+		uint32_t depth = parentSlot == NoSlot ? 0 : depths[parentSlot] + 1;
+		sparse[entity.index] = slot;
+
+		entities.push_back(entity.index);
+		parents.push_back(parentSlot);
+		depths.push_back(depth);
+		positions.push_back(glm::vec3(0.0f));
+		rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		scales.push_back(glm::vec3(1.0f));
+		localBounds.push_back({ glm::vec3(0.0f), glm::vec3(0.0f) });
+		worldBounds.push_back({ glm::vec3(0.0f), glm::vec3(0.0f) });
+		worldMatrices.push_back(glm::mat4(1.0f));
+		renderables.push_back(NoRenderable);
+		flags.push_back(Dirty);
+		changed.push_back(0);
+		pendingUploads.push_back(0);
+
+		// Appending keeps the depths sorted unless a shallower entity lands after deeper ones
+		uint32_t levelCount = levelStarts.empty() ? 0 : static_cast<uint32_t>(levelStarts.size()) - 1;
+		if (depth + 1 == levelCount) {
+			levelStarts.back()++;
+		}
+		else if (depth == levelCount) {
+			if (levelStarts.empty()) {
+				levelStarts.push_back(0);
+			}
+			levelStarts.push_back(slot + 1);
+		}
+		else {
+			restructurePending = true;
+		}
+
+		return entity;
+	}
+
+	void Scene::Destroy(Entity entity) {
+		flags[slotOf(entity)] |= Destroyed;
+		// Dead from now on, the slot and the index are given back by the next Update
+		generations[entity.index]++;
+		restructurePending = true;
+	}
+
+	void Scene::SetParent(Entity entity, Entity parent) {
+		uint32_t slot = slotOf(entity);
+		uint32_t parentSlot = parent == Entity{} ? NoSlot : slotOf(parent);
+
+		for (uint32_t ancestor = parentSlot; ancestor != NoSlot; ancestor = parents[ancestor]) {
+			if (ancestor == slot) {
+				throw std::runtime_error("an entity can't be parented under its own descendant");
+			}
+		}
+
+		parents[slot] = parentSlot;
+		flags[slot] |= Dirty;
+		restructurePending = true;
+	}
+
+	Entity Scene::GetParent(Entity entity) const {
+		uint32_t parentSlot = parents[slotOf(entity)];
+		if (parentSlot == NoSlot) {
+			return {};
+		}
+		return { entities[parentSlot], generations[entities[parentSlot]] };
+	}
+
+	void Scene::SetPosition(Entity entity, glm::vec3 position) {
+		uint32_t slot = slotOf(entity);
+		positions[slot] = position;
+		flags[slot] |= Dirty;
+	}
+
+	void Scene::SetRotation(Entity entity, glm::quat rotation) {
+		uint32_t slot = slotOf(entity);
+		rotations[slot] = rotation;
+		flags[slot] |= Dirty;
+	}
+
+	void Scene::SetScale(Entity entity, glm::vec3 scale) {
+		uint32_t slot = slotOf(entity);
+		scales[slot] = scale;
+		flags[slot] |= Dirty;
+	}
+
+	void Scene::SetBounds(Entity entity, const Bvh::Aabb& bounds) {
+		uint32_t slot = slotOf(entity);
+		localBounds[slot] = bounds;
+		flags[slot] |= Dirty;
+	}
+
+	void Scene::restructure() {
+		uint32_t slotCount = static_cast<uint32_t>(entities.size());
+
+		// Depths and destruction come down from the ancestors, slots aren't in parent order yet
+		std::vector<uint32_t> newDepths(slotCount, NoSlot);
+		std::vector<uint8_t> removed(slotCount, 0);
+		std::vector<uint32_t> path;
+		for (uint32_t slot = 0; slot < slotCount; slot++) {
+			uint32_t ancestor = slot;
+			while (ancestor != NoSlot && newDepths[ancestor] == NoSlot) {
+				path.push_back(ancestor);
+				ancestor = parents[ancestor];
+			}
+
+			uint32_t depth = ancestor == NoSlot ? 0 : newDepths[ancestor] + 1;
+			bool isRemoved = ancestor != NoSlot && removed[ancestor];
+			for (size_t i = path.size(); i-- > 0;) {
+				isRemoved = isRemoved || (flags[path[i]] & Destroyed);
+				removed[path[i]] = isRemoved;
+				newDepths[path[i]] = depth++;
+			}
+			path.clear();
+		}
+
+		// Stable counting sort of the survivors by depth
+		uint32_t levelCount = 0;
+		for (uint32_t slot = 0; slot < slotCount; slot++) {
+			if (!removed[slot]) {
+				levelCount = std::max(levelCount, newDepths[slot] + 1);
+			}
+		}
+
+		levelStarts.assign(levelCount + 1, 0);
+		for (uint32_t slot = 0; slot < slotCount; slot++) {
+			if (!removed[slot]) {
+				levelStarts[newDepths[slot] + 1]++;
+			}
+		}
+		for (uint32_t level = 0; level < levelCount; level++) {
+			levelStarts[level + 1] += levelStarts[level];
+		}
+
+		std::vector<uint32_t> newSlots(slotCount, NoSlot);
+		std::vector<uint32_t> next(levelStarts.begin(), levelStarts.end() - 1);
+		for (uint32_t slot = 0; slot < slotCount; slot++) {
+			if (removed[slot]) {
+				uint32_t index = entities[slot];
+				// Destroy already killed the entity itself, its descendants die here
+				if (!(flags[slot] & Destroyed)) {
+					generations[index]++;
+				}
+				sparse[index] = NoSlot;
+				freeIndices.push_back(index);
+			}
+			else {
+				newSlots[slot] = next[newDepths[slot]]++;
+			}
+		}
+
+		uint32_t newCount = levelStarts.back();
+		auto permute = [&](auto& component) {
+			std::remove_reference_t<decltype(component)> sorted(newCount);
+			for (uint32_t slot = 0; slot < slotCount; slot++) {
+				if (newSlots[slot] != NoSlot) {
+					sorted[newSlots[slot]] = component[slot];
+				}
+			}
+			component.swap(sorted);
+		};
+
+		permute(entities);
+		permute(parents);
+		permute(positions);
+		permute(rotations);
+		permute(scales);
+		permute(localBounds);
+		permute(worldBounds);
+		permute(worldMatrices);
+		permute(renderables);
+		permute(flags);
+		permute(newDepths);
+		depths.swap(newDepths);
+
+		for (uint32_t slot = 0; slot < newCount; slot++) {
+			sparse[entities[slot]] = slot;
+			if (parents[slot] != NoSlot) {
+				parents[slot] = newSlots[parents[slot]];
+			}
+		}
+
+		// Every matrix moved, both frames' buffers have to be rewritten
+		changed.assign(newCount, 0);
+		pendingUploads.assign(newCount, MAX_FRAME_IN_FLIGHT);
+
+		restructurePending = false;
+	}
+
+	void Scene::updateSlots(uint32_t begin, uint32_t end, glm::mat4* mapped) {
+		for (uint32_t slot = begin; slot < end; slot++) {
+			uint32_t parent = parents[slot];
+			bool worldChanged = (flags[slot] & Dirty) || (parent != NoSlot && changed[parent]);
+			changed[slot] = worldChanged;
+
+			if (worldChanged) {
+				flags[slot] &= ~Dirty;
+
+				glm::mat4 local = Compose(positions[slot], rotations[slot], scales[slot]);
+				if (parent == NoSlot) {
+					worldMatrices[slot] = local;
+				}
+				else {
+					Multiply(worldMatrices[parent], local, worldMatrices[slot]);
+				}
+				worldBounds[slot] = TransformBounds(worldMatrices[slot], localBounds[slot]);
+				pendingUploads[slot] = MAX_FRAME_IN_FLIGHT;
+			}
+
+			if (pendingUploads[slot]) {
+				StoreMatrix(mapped + slot, worldMatrices[slot]);
+				pendingUploads[slot]--;
+			}
+		}
+	}
+
+	void Scene::Update(uint32_t currentFrame) {
+		// Slots per job, small enough to spread a level of a few thousand entities over the workers
+		const uint32_t BatchSize = 1024;
+
+		if (restructurePending) {
+			restructure();
+		}
+
+		glm::mat4* mapped = static_cast<glm::mat4*>(MatrixBuffersMapped[currentFrame]);
+
+		// A depth only starts once the one above it is done, its parents' matrices are read
+		for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+			uint32_t begin = levelStarts[level];
+			uint32_t end = levelStarts[level + 1];
+			uint32_t batchCount = (end - begin + BatchSize - 1) / BatchSize;
+
+			if (batchCount <= 1) {
+				updateSlots(begin, end, mapped);
+			}
+			else {
+				workers.ParallelFor(batchCount, [&](uint32_t batch) {
+					uint32_t batchBegin = begin + batch * BatchSize;
+					updateSlots(batchBegin, std::min(batchBegin + BatchSize, end), mapped);
+				});
+			}
+		}
+
+#if SCENE_SSE
+		// Streaming stores aren't ordered with the ones after them, the queue submit has to see all of them
+		_mm_sfence();
+#endif
+
+		changedRenderables.clear();
+		for (uint32_t slot = 0; slot < changed.size(); slot++) {
+			if (changed[slot] && renderables[slot] != NoRenderable) {
+				changedRenderables.push_back(renderables[slot]);
+			}
+		}
+
+		version++;
+	}
+}
\ No newline at end of file
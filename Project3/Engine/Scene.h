@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Device.h"
+#include "ThreadPool.h"
+#include "Bvh.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//std
+#include <vector>
+#include <cstdint>
+
+namespace Engine
+{
+	// Handle to a Scene entity, the generation tells a destroyed one from whatever reused its index
+	struct Entity {
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+
+		bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Entity& other) const { return !(*this == other); }
+	};
+
+	/*
+		Entities and their components as a sparse set: an entity's index leads through sparse to its slot, and every
+		component is its own array indexed by slot, so the transform update only streams through what it reads.
+
+		Slots are sorted by depth in the hierarchy. Parents come before their children and each depth is a contiguous
+		batch, split across the thread pool once the depth above it is done. Setting a transform marks the entity dirty,
+		Update recomputes the world matrix and bounds of dirty entities and their descendants and writes the matrices
+		straight into the frame's GPU buffer at the entity's slot, which is the index shaders read them with.
+
+		Anything that moves slots (destroying, parenting under an entity with a later slot) is applied by the next Update.
+	*/
+	class Scene
+	{
+	public:
+		static constexpr uint32_t NoRenderable = UINT32_MAX;
+
+		// capacity is the most entities the matrix buffers hold, destroyed ones count until the next Update
+		Scene(Device& device, ThreadPool& workers, uint32_t capacity = 16384);
+		~Scene();
+
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
+		// A default constructed parent makes a root
+		Entity Create(Entity parent = {});
+		// Its descendants go with it
+		void Destroy(Entity entity);
+		bool IsAlive(Entity entity) const;
+
+		void SetParent(Entity entity, Entity parent);
+		Entity GetParent(Entity entity) const;
+
+		// Local transform, relative to the parent
+		void SetPosition(Entity entity, glm::vec3 position);
+		void SetRotation(Entity entity, glm::quat rotation);
+		void SetScale(Entity entity, glm::vec3 scale);
+		glm::vec3 GetPosition(Entity entity) const { return positions[slotOf(entity)]; }
+		glm::quat GetRotation(Entity entity) const { return rotations[slotOf(entity)]; }
+		glm::vec3 GetScale(Entity entity) const { return scales[slotOf(entity)]; }
+
+		// In the entity's own space, Update transforms it into world bounds
+		void SetBounds(Entity entity, const Bvh::Aabb& bounds);
+		// Handle of whatever draws the entity, the scene only reports it when the entity's world matrix changes
+		void SetRenderable(Entity entity, uint32_t renderable) { renderables[slotOf(entity)] = renderable; }
+		uint32_t GetRenderable(Entity entity) const { return renderables[slotOf(entity)]; }
+
+		// As of the last Update
+		const glm::mat4& GetWorldMatrix(Entity entity) const { return worldMatrices[slotOf(entity)]; }
+		const Bvh::Aabb& GetWorldBounds(Entity entity) const { return worldBounds[slotOf(entity)]; }
+		// Where the entity's matrix is in the buffers, until the next Update
+		uint32_t GetObjectIndex(Entity entity) const { return slotOf(entity); }
+
+		/*
+			Writes into currentFrame's matrix buffer, so it has to run after the renderer waited for that frame. The
+			renderables whose world matrix changed are in GetChangedRenderables until the next call.
+		*/
+		void Update(uint32_t currentFrame);
+		const std::vector<uint32_t>& GetChangedRenderables() const { return changedRenderables; }
+		// Goes up with every Update
+		uint32_t GetVersion() const { return version; }
+
+		VkBuffer GetMatrixBuffer(uint32_t currentFrame) { return MatrixBuffers[currentFrame]; }
+		VkDeviceSize GetMatrixBufferSize() const { return sizeof(glm::mat4) * capacity; }
+		uint32_t GetEntityCount() const { return static_cast<uint32_t>(entities.size()); }
+
+	private:
+		static constexpr uint32_t NoSlot = UINT32_MAX;
+
+		enum Flags : uint8_t {
+			Dirty = 1,
+			Destroyed = 2
+		};
+
+		uint32_t slotOf(Entity entity) const;
+		// Drops destroyed slots and sorts the others by depth
+		void restructure();
+		void updateSlots(uint32_t begin, uint32_t end, glm::mat4* mapped);
+		void createMatrixBuffers();
+
+		uint32_t capacity;
+
+		// By entity index
+		std::vector<uint32_t> sparse;
+		std::vector<uint32_t> generations;
+		std::vector<uint32_t> freeIndices;
+
+		// By slot
+		std::vector<uint32_t> entities;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> depths;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+		std::vector<Bvh::Aabb> localBounds;
+		std::vector<Bvh::Aabb> worldBounds;
+		std::vector<glm::mat4> worldMatrices;
+		std::vector<uint32_t> renderables;
+		std::vector<uint8_t> flags;
+		// World matrix changed in the last Update
+		std::vector<uint8_t> changed;
+		// Frame buffers that still hold an older matrix
+		std::vector<uint8_t> pendingUploads;
+
+		// First slot of every depth, then the slot count
+		std::vector<uint32_t> levelStarts;
+		bool restructurePending = false;
+
+		std::vector<uint32_t> changedRenderables;
+		uint32_t version = 0;
+
+		std::vector<VkBuffer> MatrixBuffers;
+		std::vector<VkDeviceMemory> MatrixBuffersMemory;
+		std::vector<void*> MatrixBuffersMapped;
+
+		Device& device;
+		ThreadPool& workers;
+	};
+}
@@ -0,0 +1,506 @@
+#include "ShadowRenderSystem.h"
+
+//std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace Engine {
+	namespace {
+		// Casters this far past a cascade toward the sun still shadow it
+		const float CasterReach = 50.0f;
+	}
+
+	ShadowRenderSystem::ShadowRenderSystem(Device& device, Camera& Camera, Scene& scene) : sunDirection{ glm::normalize(glm::vec3(0.4f, -1.0f, 0.3f)) }, device{ device }, camera{ Camera }, scene{ scene } {
+		createShadowMap();
+		createSampler();
+		createRenderPass();
+		createFramebuffers();
+		createShadowBuffers();
+		createDescriptorSetLayout();
+		createDescriptorSets();
+		createPipelineLayout();
+		createGraphicsPipeline();
+	}
+
+	ShadowRenderSystem::~ShadowRenderSystem() {
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			vkDestroyBuffer(device.device(), ShadowBuffers[i], nullptr);
+			vkFreeMemory(device.device(), ShadowBuffersMemory[i], nullptr);
+		}
+
+		vkDestroyDescriptorSetLayout(device.device(), DescriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+
+		for (VkFramebuffer framebuffer : Framebuffers) {
+			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+		}
+		vkDestroyRenderPass(device.device(), RenderPass, nullptr);
+
+		vkDestroySampler(device.device(), ShadowSampler, nullptr);
+		for (VkImageView view : LayerViews) {
+			vkDestroyImageView(device.device(), view, nullptr);
+		}
+		vkDestroyImageView(device.device(), ShadowMapView, nullptr);
+		vkDestroyImage(device.device(), ShadowMap, nullptr);
+		vkFreeMemory(device.device(), ShadowMapMemory, nullptr);
+	}
+
+	void ShadowRenderSystem::AddCaster(Model& model, Entity entity, bool isStatic) {
+		casters.push_back({ &model, entity, isStatic });
+		staticCastersAdded |= isStatic;
+	}
+
+	void ShadowRenderSystem::SetSunDirection(glm::vec3 direction) {
+		direction = glm::normalize(direction);
+		if (direction != sunDirection) {
+			sunDirection = direction;
+			sunMoved = true;
+		}
+	}
+
+	void ShadowRenderSystem::createShadowMap() {
+		DepthFormat = device.findDepthFormat();
+
+		device.createImage(
+			ShadowMap,
+			{ ShadowMapSize, ShadowMapSize },
+			1,
+			VK_IMAGE_TILING_OPTIMAL,
+			DepthFormat,
+			0,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			ShadowMapMemory,
+			CascadeCount
+		);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = ShadowMap;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = DepthFormat;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = CascadeCount;
+
+		if (vkCreateImageView(device.device(), &viewInfo, nullptr, &ShadowMapView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow map image view");
+		}
+
+		LayerViews.resize(CascadeCount);
+		for (uint32_t i = 0; i < CascadeCount; i++) {
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.subresourceRange.baseArrayLayer = i;
+			viewInfo.subresourceRange.layerCount = 1;
+			if (vkCreateImageView(device.device(), &viewInfo, nullptr, &LayerViews[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create shadow map layer view");
+			}
+		}
+
+		// Cleared to the far plane so sampling it before the first Render shadows nothing
+		VkCommandBuffer commandBuffer = device.StartOneTimeCommand();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = ShadowMap;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, CascadeCount };
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkClearDepthStencilValue clear{ 1.0f, 0 };
+		vkCmdClearDepthStencilImage(commandBuffer, ShadowMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &barrier.subresourceRange);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		device.EndOneTimeCommand(commandBuffer);
+	}
+
+	void ShadowRenderSystem::createSampler() {
+		// Hardware depth comparison with bilinear filtering, outside the cascade everything is lit
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		samplerInfo.compareEnable = VK_TRUE;
+		samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = 0.0f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+		if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &ShadowSampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow map sampler");
+		}
+	}
+
+	void ShadowRenderSystem::createRenderPass() {
+		VkAttachmentDescription DepthAttachment{};
+		DepthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		DepthAttachment.format = DepthFormat;
+		DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		DepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference DepthAttachmentRef{};
+		DepthAttachmentRef.attachment = 0;
+		DepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription depthSubpass{};
+		depthSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		depthSubpass.colorAttachmentCount = 0;
+		depthSubpass.pDepthStencilAttachment = &DepthAttachmentRef;
+
+		std::array<VkSubpassDependency, 2> dependencies{};
+		// Last frame's color pass may still sample the cascade being redrawn
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		// This frame's color pass samples it
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo DepthPassInfo{};
+		DepthPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		DepthPassInfo.attachmentCount = 1;
+		DepthPassInfo.pAttachments = &DepthAttachment;
+		DepthPassInfo.subpassCount = 1;
+		DepthPassInfo.pSubpasses = &depthSubpass;
+		DepthPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		DepthPassInfo.pDependencies = dependencies.data();
+
+		if (vkCreateRenderPass(device.device(), &DepthPassInfo, nullptr, &RenderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the shadow map render pass");
+		}
+	}
+
+	void ShadowRenderSystem::createFramebuffers() {
+		Framebuffers.resize(CascadeCount);
+		for (uint32_t i = 0; i < CascadeCount; i++) {
+			VkFramebufferCreateInfo FramebufferInfo{};
+			FramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			FramebufferInfo.renderPass = RenderPass;
+			FramebufferInfo.attachmentCount = 1;
+			FramebufferInfo.pAttachments = &LayerViews[i];
+			FramebufferInfo.width = ShadowMapSize;
+			FramebufferInfo.height = ShadowMapSize;
+			FramebufferInfo.layers = 1;
+
+			if (vkCreateFramebuffer(device.device(), &FramebufferInfo, nullptr, &Framebuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create shadow map framebuffer");
+			}
+		}
+	}
+
+	void ShadowRenderSystem::createShadowBuffers() {
+		ShadowBuffers.resize(MAX_FRAME_IN_FLIGHT);
+		ShadowBuffersMemory.resize(MAX_FRAME_IN_FLIGHT);
+		ShadowBuffersMapped.resize(MAX_FRAME_IN_FLIGHT);
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			device.createBuffer(
+				ShadowBuffers[i],
+				GetShadowBufferSize(),
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				ShadowBuffersMemory[i]
+			);
+
+			vkMapMemory(device.device(), ShadowBuffersMemory[i], 0, GetShadowBufferSize(), 0, &ShadowBuffersMapped[i]);
+
+			// Nothing is shadowed until the first Render, the splits end right away
+			ShadowUBO empty{};
+			empty.sunDirection = glm::vec4(sunDirection, 0.0f);
+			memcpy(ShadowBuffersMapped[i], &empty, sizeof(empty));
+		}
+	}
+
+	void ShadowRenderSystem::createDescriptorSetLayout() {
+		// World matrices of the casters
+		VkDescriptorSetLayoutBinding objectBindingInfo{};
+		objectBindingInfo.binding = 0;
+		objectBindingInfo.descriptorCount = 1;
+		objectBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		objectBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		objectBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		LayoutInfo.bindingCount = 1;
+		LayoutInfo.pBindings = &objectBindingInfo;
+
+		if (vkCreateDescriptorSetLayout(device.device(), &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow descriptor set layout");
+		}
+	}
+
+	void ShadowRenderSystem::createDescriptorSets() {
+		std::vector<VkDescriptorSetLayout> layouts(MAX_FRAME_IN_FLIGHT, DescriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAME_IN_FLIGHT);
+		allocInfo.pSetLayouts = layouts.data();
+		allocInfo.descriptorPool = device.DescriptorPool();
+
+		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate shadow descriptor sets");
+		}
+
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			VkDescriptorBufferInfo objectInfo{};
+			objectInfo.buffer = scene.GetMatrixBuffer(static_cast<uint32_t>(i));
+			objectInfo.offset = 0;
+			objectInfo.range = scene.GetMatrixBufferSize();
+
+			VkWriteDescriptorSet WriteSet{};
+			WriteSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet.dstSet = DescriptorSets[i];
+			WriteSet.dstBinding = 0;
+			WriteSet.dstArrayElement = 0;
+			WriteSet.descriptorCount = 1;
+			WriteSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet.pBufferInfo = &objectInfo;
+
+			vkUpdateDescriptorSets(device.device(), 1, &WriteSet, 0, nullptr);
+		}
+	}
+
+	void ShadowRenderSystem::createPipelineLayout() {
+		VkPushConstantRange casterRange{};
+		casterRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		casterRange.offset = 0;
+		casterRange.size = sizeof(PushConstants);
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &casterRange;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &DescriptorSetLayout;
+
+		if (vkCreatePipelineLayout(device.device(), &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create shadow pipeline layout");
+		}
+	}
+
+	void ShadowRenderSystem::createGraphicsPipeline() {
+		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
+		fixedFunctions.layout = pipelineLayout;
+		fixedFunctions.renderPass = RenderPass;
+		fixedFunctions.subpass = 0;
+		fixedFunctions.vertexInput = VertexInputMode::PositionOnly;
+		fixedFunctions.ColorBlending.attachmentCount = 0;
+		fixedFunctions.ColorBlending.pAttachments = nullptr;
+		// Orthographic, reverse Z gains nothing there
+		fixedFunctions.DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+		// Both faces cast so thin and open meshes don't leak light, the slope bias keeps lit faces from shadowing themselves
+		fixedFunctions.Rasterization.cullMode = VK_CULL_MODE_NONE;
+		fixedFunctions.Rasterization.depthBiasEnable = VK_TRUE;
+		fixedFunctions.Rasterization.depthBiasConstantFactor = 1.25f;
+		fixedFunctions.Rasterization.depthBiasSlopeFactor = 1.75f;
+
+		std::vector<char> VertexCode = ReadFile("D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/ShadowDepth.vert.spv");
+		pipeline = std::make_unique<GPipeline>(device, ShaderBytecode{ VertexCode.data(), VertexCode.size() }, ShaderBytecode{ nullptr, 0 }, fixedFunctions);
+	}
+
+	bool ShadowRenderSystem::updateStaticCasters() {
+		bool changed = staticCastersAdded;
+		staticCastersAdded = false;
+
+		if (sceneVersion == scene.GetVersion()) {
+			return changed;
+		}
+		sceneVersion = scene.GetVersion();
+
+		for (size_t i = 0; i < casters.size();) {
+			Caster& caster = casters[i];
+			if (!scene.IsAlive(caster.entity)) {
+				changed |= caster.isStatic;
+				casters[i] = casters.back();
+				casters.pop_back();
+				continue;
+			}
+
+			if (caster.isStatic) {
+				const glm::mat4& world = scene.GetWorldMatrix(caster.entity);
+				if (world != caster.world) {
+					caster.world = world;
+					changed = true;
+				}
+			}
+			i++;
+		}
+
+		return changed;
+	}
+
+	void ShadowRenderSystem::fitCascade(Cascade& cascade, glm::vec3 center, float radius) {
+		glm::vec3 up = std::abs(sunDirection.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		// Moves the center by whole texels in light space, the shadow map's texels then land on the same world positions
+		glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), sunDirection, up);
+		float texel = 2.0f * radius / ShadowMapSize;
+		glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+		lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+		center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightCenter, 1.0f));
+
+		glm::mat4 view = glm::lookAt(center - sunDirection * (radius + CasterReach), center, up);
+		glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + CasterReach);
+
+		cascade.viewProj = proj * view;
+		cascade.center = center;
+		cascade.radius = radius;
+		cascade.valid = true;
+	}
+
+	void ShadowRenderSystem::renderCascade(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t index, bool staticOnly) {
+		const Cascade& cascade = cascades[index];
+		// LODs are picked by the texels a caster covers the way the color pass picks them by pixels
+		float texel = 2.0f * cascade.radius / ShadowMapSize;
+		float depthRange = 2.0f * cascade.radius + CasterReach;
+
+		VkClearValue clearValue{};
+		clearValue.depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.renderPass = RenderPass;
+		beginInfo.framebuffer = Framebuffers[index];
+		beginInfo.renderArea.offset = { 0, 0 };
+		beginInfo.renderArea.extent = { ShadowMapSize, ShadowMapSize };
+		beginInfo.clearValueCount = 1;
+		beginInfo.pClearValues = &clearValue;
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(ShadowMapSize), static_cast<float>(ShadowMapSize), 0.0f, 1.0f };
+		VkRect2D scissor{ { 0, 0 }, { ShadowMapSize, ShadowMapSize } };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
+
+		Model* boundModel = nullptr;
+		for (const Caster& caster : casters) {
+			if (staticOnly && !caster.isStatic) {
+				continue;
+			}
+
+			// The projection is orthographic, the bounds stay a sphere in its clip space
+			const Bvh::Aabb& bounds = scene.GetWorldBounds(caster.entity);
+			glm::vec3 extent = bounds.max - bounds.min;
+			float radius = glm::length(extent) * 0.5f;
+			glm::vec4 clip = cascade.viewProj * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f);
+			float side = 1.0f + radius / cascade.radius;
+			if (std::abs(clip.x) > side || std::abs(clip.y) > side || clip.z < -radius / depthRange || clip.z > 1.0f + radius / depthRange) {
+				continue;
+			}
+
+			if (caster.model != boundModel) {
+				VkBuffer PositionBuffers[] = { caster.model->GetPositionBuffer() };
+				VkDeviceSize offsets[] = { 0 };
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, PositionBuffers, offsets);
+				caster.model->BindIndex(commandBuffer);
+				boundModel = caster.model;
+			}
+
+			PushConstants push{ cascade.viewProj, scene.GetObjectIndex(caster.entity) };
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+
+			float diameter = std::max(extent.x, std::max(extent.y, extent.z));
+			caster.model->Draw(commandBuffer, caster.model->SelectLod(diameter / texel));
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void ShadowRenderSystem::Render(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+		// Mostly logarithmic splits, the uniform part keeps the far cascades from growing too large
+		const float SplitLambda = 0.8f;
+		// Cached cascades are made this much larger than needed, the camera can move within the difference
+		const float CacheSlack = 1.25f;
+
+		bool staticCastersMoved = updateStaticCasters();
+
+		float nearPlane = camera.GetNearPlane();
+		float farPlane = camera.GetFarPlane();
+		for (uint32_t i = 0; i < CascadeCount; i++) {
+			float t = static_cast<float>(i + 1) / CascadeCount;
+			float logarithmic = nearPlane * std::pow(farPlane / nearPlane, t);
+			float uniform = nearPlane + (farPlane - nearPlane) * t;
+			splits[i] = SplitLambda * logarithmic + (1.0f - SplitLambda) * uniform;
+		}
+
+		glm::mat4 cameraWorld = glm::inverse(camera.GetMatrices().view);
+		float tanY = glm::tan(glm::radians(camera.GetFov()) / 2.0f);
+		float tanX = tanY * camera.GetAspect();
+		// Squared distance of the frustum's corners from its axis at a depth of 1
+		float corner = tanX * tanX + tanY * tanY;
+
+		renderedCascades = 0;
+		for (uint32_t i = 0; i < CascadeCount; i++) {
+			float sliceNear = i == 0 ? nearPlane : splits[i - 1];
+			float sliceFar = splits[i];
+
+			// Smallest sphere around the slice, the same whichever way the camera looks
+			float centerDepth = std::min((sliceNear + sliceFar) * (1.0f + corner) * 0.5f, sliceFar);
+			float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + sliceFar * sliceFar * corner);
+			// Rounding errors would change the texel size and undo the snapping
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+			glm::vec3 center = glm::vec3(cameraWorld * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+
+			bool cached = i >= FirstCachedCascade;
+			if (cached) {
+				const Cascade& cascade = cascades[i];
+				if (cascade.valid && !staticCastersMoved && !sunMoved && glm::distance(center, cascade.center) + radius <= cascade.radius) {
+					continue;
+				}
+				radius *= CacheSlack;
+			}
+
+			fitCascade(cascades[i], center, radius);
+			renderCascade(commandBuffer, currentFrame, i, cached);
+			renderedCascades++;
+		}
+		sunMoved = false;
+
+		ShadowUBO ubo{};
+		for (uint32_t i = 0; i < CascadeCount; i++) {
+			ubo.cascades[i] = cascades[i].viewProj;
+		}
+		ubo.splits = glm::vec4(splits[0], splits[1], splits[2], splits[3]);
+		ubo.sunDirection = glm::vec4(sunDirection, 0.0f);
+		memcpy(ShadowBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+	}
+}
\ No newline at end of file
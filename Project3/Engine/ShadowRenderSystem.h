@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Device.h"
+#include "GPipeline.h"
+#include "Model.h"
+#include "Camera.h"
+#include "Scene.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	/*
+		Cascaded shadow maps of the sun. The view frustum up to the camera's far plane is split into CascadeCount slices,
+		each fitted with a sphere so the cascade doesn't change size as the camera turns, snapped to whole texels so its
+		edges don't crawl as it moves. Every cascade is one layer of a depth array drawn in a depth only pass of its own.
+
+		The cascades from FirstCachedCascade on are fitted with some slack and only hold static casters. They are kept
+		between frames and drawn again when the camera leaves the slack, the sun turns or a static caster moves, so far
+		shadows of a large outdoor scene cost nothing most frames. Dynamic casters only shadow the near cascades.
+	*/
+	class ShadowRenderSystem
+	{
+	public:
+		static constexpr uint32_t CascadeCount = 4;
+		static constexpr uint32_t FirstCachedCascade = 2;
+		static constexpr uint32_t ShadowMapSize = 2048;
+
+		// Matches the Shadows block of Lighting.glsl (std140)
+		struct ShadowUBO {
+			glm::mat4 cascades[CascadeCount];	// world to shadow map
+			glm::vec4 splits;	// view depth each cascade ends at
+			glm::vec4 sunDirection;	// the way the light travels
+		};
+		static_assert(CascadeCount == 4, "the splits are packed in one vec4");
+
+		struct PushConstants {
+			glm::mat4 viewProj;
+			uint32_t object;	// slot of the caster's world matrix in the scene's buffer
+		};
+
+		ShadowRenderSystem(Device& device, Camera& Camera, Scene& scene);
+		~ShadowRenderSystem();
+
+		ShadowRenderSystem(const ShadowRenderSystem&) = delete;
+		ShadowRenderSystem& operator=(const ShadowRenderSystem&) = delete;
+
+		// Drawn with the model's position buffer, until the entity is destroyed
+		void AddCaster(Model& model, Entity entity, bool isStatic = true);
+		void SetSunDirection(glm::vec3 direction);
+		glm::vec3 GetSunDirection() const { return sunDirection; }
+
+		// Outside of a render pass, after Scene::Update and before anything samples currentFrame's shadows
+		void Render(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+		VkBuffer GetShadowBuffer(uint32_t currentFrame) { return ShadowBuffers[currentFrame]; }
+		VkDeviceSize GetShadowBufferSize() const { return sizeof(ShadowUBO); }
+		// Sampled in DEPTH_STENCIL_READ_ONLY_OPTIMAL with a comparison sampler, one layer per cascade
+		VkImageView GetShadowMapView() { return ShadowMapView; }
+		VkSampler GetShadowSampler() { return ShadowSampler; }
+
+		// Cascades the last Render drew, the others were cached
+		uint32_t GetRenderedCascades() const { return renderedCascades; }
+
+	private:
+		struct Caster {
+			Model* model;
+			Entity entity;
+			bool isStatic;
+			// As of the last Render, to notice static casters moving
+			glm::mat4 world{ 0.0f };
+		};
+
+		struct Cascade {
+			glm::mat4 viewProj{ 1.0f };
+			// Sphere the cascade covers, in world space
+			glm::vec3 center{ 0.0f };
+			float radius = 0.0f;
+			bool valid = false;
+		};
+
+		void createShadowMap();
+		void createSampler();
+		void createRenderPass();
+		void createFramebuffers();
+		void createShadowBuffers();
+		void createDescriptorSetLayout();
+		void createDescriptorSets();
+		void createPipelineLayout();
+		void createGraphicsPipeline();
+
+		// True when a static caster moved or went away since the last call
+		bool updateStaticCasters();
+		// Fits the cascade around the sphere, its radius is the cascade's half width
+		void fitCascade(Cascade& cascade, glm::vec3 center, float radius);
+		void renderCascade(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t cascade, bool staticOnly);
+
+		VkImage ShadowMap;
+		VkDeviceMemory ShadowMapMemory;
+		VkImageView ShadowMapView;
+		// One per cascade to render into
+		std::vector<VkImageView> LayerViews;
+		std::vector<VkFramebuffer> Framebuffers;
+		VkFormat DepthFormat;
+		VkSampler ShadowSampler;
+		VkRenderPass RenderPass;
+
+		// One host visible buffer per frame in flight, written by Render
+		std::vector<VkBuffer> ShadowBuffers;
+		std::vector<VkDeviceMemory> ShadowBuffersMemory;
+		std::vector<void*> ShadowBuffersMapped;
+
+		VkDescriptorSetLayout DescriptorSetLayout;
+		VkPipelineLayout pipelineLayout;
+		std::vector<VkDescriptorSet> DescriptorSets;
+
+		std::vector<Caster> casters;
+		Cascade cascades[CascadeCount];
+		float splits[CascadeCount];
+		glm::vec3 sunDirection;
+		bool sunMoved = true;
+		bool staticCastersAdded = false;
+		uint32_t sceneVersion = 0;
+		uint32_t renderedCascades = 0;
+
+		Device& device;
+		Camera& camera;
+		Scene& scene;
+		std::unique_ptr<GPipeline> pipeline;
+	};
+}
@@ -1,8 +1,18 @@
 #include "SimpleRenderereSystem.h"
 
+//std
+#include <algorithm>
+#include <unordered_map>
+#include <cstddef>
+#include <iterator>
+#include <cassert>
+
 namespace Engine {
-	SimpleRenderereSystem::SimpleRenderereSystem(Device& device, VkRenderPass renderPass, Camera& Camera) : device{device} {
-		LoadModel();
+	SimpleRenderereSystem::SimpleRenderereSystem(Device& device, TextureCache& textures, VkRenderPass renderPass, Camera& Camera, Scene& scene, MaterialSystem& materials, ClusteredLights& lights, ShadowRenderSystem& shadows, VertexInputMode vertexInput, const std::string& MeshPath, const AssetArchive* archive) : vertexInput{vertexInput}, archive{archive}, device{device}, textures{textures}, camera{Camera}, scene{scene}, materials{materials}, lights{lights}, shadows{shadows} {
+		LoadModel(MeshPath, renderPass);
+		if (model->GetMeshletCount() > 0) {
+			meshletCuller = std::make_unique<MeshletCuller>(device, Camera, *model);
+		}
 		createDescriptorSetLayout();
 		createDescriptorSets(Camera);
 		createPipelineLayout();
@@ -28,7 +38,71 @@ namespace Engine {
 	*/
 
 
-	void SimpleRenderereSystem::LoadModel() {
+	void SimpleRenderereSystem::LoadModel(const std::string& MeshPath, VkRenderPass renderPass) {
+		const std::string DefaultTexture = "D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Textures/brick.png";
+
+		if (!MeshPath.empty() && archive) {
+			if (const ArchiveEntry* packed = archive->Find(MeshPath, AssetType::Mesh)) {
+				ArchiveMesh mesh = archive->Mesh(*packed);
+				std::string TexturePath = mesh.textureName.empty() ? DefaultTexture : std::string(mesh.textureName);
+
+				model = std::make_unique<Model>(
+					device,
+					textures,
+					TexturePath,
+					mesh.vertices,
+					mesh.vertexCount,
+					mesh.indices,
+					mesh.indexCount,
+					mesh.lods,
+					mesh.lodCount,
+					mesh.meshlets,
+					mesh.meshletCount
+				);
+				createImpostors(renderPass, mesh.vertices, mesh.vertexCount, mesh.indices, TexturePath);
+				createOccluderMesh(mesh.vertices, mesh.indices);
+				return;
+			}
+		}
+
+		if (!MeshPath.empty()) {
+			ImportStats stats;
+			MeshData mesh = ImportMesh(MeshPath, textures.Workers(), &stats);
+
+			std::cout << "Imported " << MeshPath << ": " << stats.triangles << " triangles, " << stats.uniqueVertices << "/" << stats.inputVertices
+				<< " vertices after dedup, " << stats.MegabytesPerSecond() << " MB/s, " << stats.TrianglesPerSecond() << " triangles/s" << std::endl;
+
+			MeshOptimizationStats optimization = OptimizeMesh(mesh.vertices, mesh.indices);
+			std::cout << "Optimized " << MeshPath << ": ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+				<< ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr << std::endl;
+
+			// Simplified LODs reuse the optimized vertices and are appended to the index buffer
+			std::vector<Model::Lod> lods = GenerateLods(mesh.vertices, mesh.indices);
+			std::cout << "LODs of " << MeshPath << ":";
+			for (const auto& lod : lods) {
+				std::cout << " " << lod.indexCount / 3;
+			}
+			std::cout << " triangles" << std::endl;
+
+			// Regroups LOD 0's triangles so every meshlet is a contiguous index range
+			std::vector<Model::Meshlet> meshlets = BuildMeshlets(mesh.vertices, mesh.indices, lods[0].indexCount);
+			std::cout << "Meshlets of " << MeshPath << ": " << meshlets.size() << std::endl;
+
+			std::string TexturePath = mesh.texturePath.empty() ? DefaultTexture : mesh.texturePath;
+			model = std::make_unique<Model>(
+				device,
+				textures,
+				TexturePath,
+				mesh.vertices,
+				mesh.indices,
+				lods,
+				meshlets
+			);
+			createImpostors(renderPass, mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()), mesh.indices.data(), TexturePath);
+			createOccluderMesh(mesh.vertices.data(), mesh.indices.data());
+			return;
+		}
+
 		std::vector<Model::Vertex> vertices = {
 			/* TOP */
 			{{-0.5f, 0.4f, 0.5f}, {0.83f, 0.70f, 0.44f}, {0.0f, 0.0f}},	// 0
@@ -44,7 +118,7 @@ namespace Engine {
 			{{-0.5f, -0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}},// 7
 		};
 
-		std::vector<uint16_t> indices = {
+		std::vector<uint32_t> indices = {
 			2, 1, 0,
 			3, 2, 0,
 			0, 1, 4,
@@ -55,9 +129,65 @@ namespace Engine {
 
 		model = std::make_unique<Model>(
 			device,
+			textures,
+			DefaultTexture,
 			vertices,
 			indices
 		);
+		createImpostors(renderPass, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), DefaultTexture);
+		createOccluderMesh(vertices.data(), indices.data());
+	}
+
+	void SimpleRenderereSystem::createImpostors(VkRenderPass renderPass, const Model::Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, const std::string& TexturePath) {
+		const uint32_t FramesPerSide = 8;
+		const uint32_t FrameSize = 64;
+
+		// Coarsest LOD that is still exact to a texel of a frame
+		float texelSize = model->GetBoundsRadius() * 2.0f / FrameSize;
+		uint32_t lod = 0;
+		while (lod + 1 < model->GetLodCount() && model->GetLod(lod + 1).error <= texelSize) {
+			lod++;
+		}
+
+		// The GPU copy belongs to the texture cache, the baker needs the pixels on the CPU
+		TextureData albedo;
+		try
+		{
+			const ArchiveEntry* packed = archive ? archive->Find(TexturePath, AssetType::Texture) : nullptr;
+			albedo = packed ? archive->Texture(*packed) : LoadTextureData(TexturePath, false);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "Impostor falls back to vertex colors: " << e.what() << std::endl;
+		}
+
+		ImpostorAtlas atlas = BakeImpostor(
+			vertices,
+			vertexCount,
+			indices + model->GetLod(lod).firstIndex,
+			model->GetLod(lod).indexCount,
+			albedo,
+			textures.Workers(),
+			FramesPerSide,
+			FrameSize
+		);
+
+		impostors = std::make_unique<ImpostorRenderSystem>(device, textures, renderPass, camera, atlas);
+	}
+
+	void SimpleRenderereSystem::createOccluderMesh(const Model::Vertex* vertices, const uint32_t* indices) {
+		// The full detail mesh, a simplified LOD can bulge past the surface it stands for and hide what is visible behind it
+		const Model::Lod& occluder = model->GetLod(0);
+		std::unordered_map<uint32_t, uint32_t> remap;
+		occluderIndices.reserve(occluder.indexCount);
+		for (uint32_t i = 0; i < occluder.indexCount; i++) {
+			uint32_t index = indices[occluder.firstIndex + i];
+			auto [it, inserted] = remap.emplace(index, static_cast<uint32_t>(occluderPositions.size()));
+			if (inserted) {
+				occluderPositions.push_back(vertices[index].position);
+			}
+			occluderIndices.push_back(it->second);
+		}
 	}
 
 
@@ -66,7 +196,8 @@ namespace Engine {
 		uboBindingInfo.binding = 0;
 		uboBindingInfo.descriptorCount = 1;
 		uboBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		uboBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		// The fragment stage finds its light cluster from the view depth
+		uboBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 		uboBindingInfo.pImmutableSamplers = nullptr;
 
 		VkDescriptorSetLayoutBinding imageBindingInfo{};
@@ -76,7 +207,56 @@ namespace Engine {
 		imageBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		imageBindingInfo.pImmutableSamplers = nullptr;
 
-		std::array<VkDescriptorSetLayoutBinding, 2> bindingInfo{uboBindingInfo, imageBindingInfo};
+		VkDescriptorSetLayoutBinding vertexBindingInfo{};
+		vertexBindingInfo.binding = 2;
+		vertexBindingInfo.descriptorCount = 1;
+		vertexBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		vertexBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		vertexBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding objectBindingInfo{};
+		objectBindingInfo.binding = 3;
+		objectBindingInfo.descriptorCount = 1;
+		objectBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		objectBindingInfo.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		objectBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding materialBindingInfo{};
+		materialBindingInfo.binding = 4;
+		materialBindingInfo.descriptorCount = 1;
+		materialBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		materialBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		materialBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding lightBindingInfo{};
+		lightBindingInfo.binding = 5;
+		lightBindingInfo.descriptorCount = 1;
+		lightBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		lightBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		lightBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding clusterBindingInfo{};
+		clusterBindingInfo.binding = 6;
+		clusterBindingInfo.descriptorCount = 1;
+		clusterBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		clusterBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		clusterBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding shadowBindingInfo{};
+		shadowBindingInfo.binding = 7;
+		shadowBindingInfo.descriptorCount = 1;
+		shadowBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		shadowBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shadowBindingInfo.pImmutableSamplers = nullptr;
+
+		VkDescriptorSetLayoutBinding shadowMapBindingInfo{};
+		shadowMapBindingInfo.binding = 8;
+		shadowMapBindingInfo.descriptorCount = 1;
+		shadowMapBindingInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		shadowMapBindingInfo.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shadowMapBindingInfo.pImmutableSamplers = nullptr;
+
+		std::array<VkDescriptorSetLayoutBinding, 9> bindingInfo{uboBindingInfo, imageBindingInfo, vertexBindingInfo, objectBindingInfo, materialBindingInfo, lightBindingInfo, clusterBindingInfo, shadowBindingInfo, shadowMapBindingInfo};
 		VkDescriptorSetLayoutCreateInfo LayoutInfo{};
 		LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		LayoutInfo.bindingCount = static_cast<uint32_t>(bindingInfo.size());
@@ -97,6 +277,7 @@ namespace Engine {
 		allocInfo.descriptorPool = device.DescriptorPool();
 
 		DescriptorSets.resize(MAX_FRAME_IN_FLIGHT);
+		DescriptorTextureVersions.resize(MAX_FRAME_IN_FLIGHT, model->GetTextureVersion());
 		if (vkAllocateDescriptorSets(device.device(), &allocInfo, DescriptorSets.data()) != VK_SUCCESS) {
 			throw std::runtime_error("failed to allocate descriptor sets");
 		}
@@ -112,7 +293,42 @@ namespace Engine {
 			imageInfo.sampler = model->GetTextureSampler();
 			imageInfo.imageView = model->GetTextureImageView();
 
-			std::array<VkWriteDescriptorSet, 2> WriteSet{};
+			VkDescriptorBufferInfo vertexInfo{};
+			vertexInfo.buffer = model->GetVertexBuffer();
+			vertexInfo.offset = 0;
+			vertexInfo.range = model->GetVertexBufferSize();
+
+			VkDescriptorBufferInfo objectInfo{};
+			objectInfo.buffer = scene.GetMatrixBuffer(i);
+			objectInfo.offset = 0;
+			objectInfo.range = scene.GetMatrixBufferSize();
+
+			VkDescriptorBufferInfo materialInfo{};
+			materialInfo.buffer = materials.GetBuffer(i);
+			materialInfo.offset = 0;
+			materialInfo.range = materials.GetBufferSize();
+
+			VkDescriptorBufferInfo lightInfo{};
+			lightInfo.buffer = lights.GetLightBuffer(i);
+			lightInfo.offset = 0;
+			lightInfo.range = lights.GetLightBufferSize();
+
+			VkDescriptorBufferInfo clusterInfo{};
+			clusterInfo.buffer = lights.GetClusterBuffer(i);
+			clusterInfo.offset = 0;
+			clusterInfo.range = lights.GetClusterBufferSize();
+
+			VkDescriptorBufferInfo shadowInfo{};
+			shadowInfo.buffer = shadows.GetShadowBuffer(i);
+			shadowInfo.offset = 0;
+			shadowInfo.range = shadows.GetShadowBufferSize();
+
+			VkDescriptorImageInfo shadowMapInfo{};
+			shadowMapInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			shadowMapInfo.sampler = shadows.GetShadowSampler();
+			shadowMapInfo.imageView = shadows.GetShadowMapView();
+
+			std::array<VkWriteDescriptorSet, 9> WriteSet{};
 			WriteSet[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			WriteSet[0].dstSet = DescriptorSets[i];
 			WriteSet[0].dstBinding = 0;
@@ -133,16 +349,91 @@ namespace Engine {
 			WriteSet[1].pImageInfo = &imageInfo;
 			WriteSet[1].pTexelBufferView = nullptr;
 
+			WriteSet[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[2].dstSet = DescriptorSets[i];
+			WriteSet[2].dstBinding = 2;
+			WriteSet[2].dstArrayElement = 0;
+			WriteSet[2].descriptorCount = 1;
+			WriteSet[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[2].pBufferInfo = &vertexInfo;
+			WriteSet[2].pImageInfo = nullptr;
+			WriteSet[2].pTexelBufferView = nullptr;
+
+			WriteSet[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[3].dstSet = DescriptorSets[i];
+			WriteSet[3].dstBinding = 3;
+			WriteSet[3].dstArrayElement = 0;
+			WriteSet[3].descriptorCount = 1;
+			WriteSet[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[3].pBufferInfo = &objectInfo;
+			WriteSet[3].pImageInfo = nullptr;
+			WriteSet[3].pTexelBufferView = nullptr;
+
+			WriteSet[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[4].dstSet = DescriptorSets[i];
+			WriteSet[4].dstBinding = 4;
+			WriteSet[4].dstArrayElement = 0;
+			WriteSet[4].descriptorCount = 1;
+			WriteSet[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[4].pBufferInfo = &materialInfo;
+			WriteSet[4].pImageInfo = nullptr;
+			WriteSet[4].pTexelBufferView = nullptr;
+
+			WriteSet[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[5].dstSet = DescriptorSets[i];
+			WriteSet[5].dstBinding = 5;
+			WriteSet[5].dstArrayElement = 0;
+			WriteSet[5].descriptorCount = 1;
+			WriteSet[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[5].pBufferInfo = &lightInfo;
+			WriteSet[5].pImageInfo = nullptr;
+			WriteSet[5].pTexelBufferView = nullptr;
+
+			WriteSet[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[6].dstSet = DescriptorSets[i];
+			WriteSet[6].dstBinding = 6;
+			WriteSet[6].dstArrayElement = 0;
+			WriteSet[6].descriptorCount = 1;
+			WriteSet[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			WriteSet[6].pBufferInfo = &clusterInfo;
+			WriteSet[6].pImageInfo = nullptr;
+			WriteSet[6].pTexelBufferView = nullptr;
+
+			WriteSet[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[7].dstSet = DescriptorSets[i];
+			WriteSet[7].dstBinding = 7;
+			WriteSet[7].dstArrayElement = 0;
+			WriteSet[7].descriptorCount = 1;
+			WriteSet[7].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			WriteSet[7].pBufferInfo = &shadowInfo;
+			WriteSet[7].pImageInfo = nullptr;
+			WriteSet[7].pTexelBufferView = nullptr;
+
+			WriteSet[8].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			WriteSet[8].dstSet = DescriptorSets[i];
+			WriteSet[8].dstBinding = 8;
+			WriteSet[8].dstArrayElement = 0;
+			WriteSet[8].descriptorCount = 1;
+			WriteSet[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			WriteSet[8].pBufferInfo = nullptr;
+			WriteSet[8].pImageInfo = &shadowMapInfo;
+			WriteSet[8].pTexelBufferView = nullptr;
+
 			vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(WriteSet.size()), WriteSet.data(), 0, nullptr);
 		}
 	}
 
 
 	void SimpleRenderereSystem::createPipelineLayout() {
+		VkPushConstantRange vertexLayoutRange{};
+		vertexLayoutRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		vertexLayoutRange.offset = 0;
+		vertexLayoutRange.size = sizeof(ObjectPushConstants);
+
 		VkPipelineLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		layoutInfo.pushConstantRangeCount = 0;
-		layoutInfo.pPushConstantRanges = nullptr;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &vertexLayoutRange;
 		layoutInfo.setLayoutCount = 1;
 		layoutInfo.pSetLayouts = &DescriptorSetLayout;
 
@@ -151,26 +442,440 @@ namespace Engine {
 		}
 	}
 
+	std::unique_ptr<PipelineVariants> SimpleRenderereSystem::createVariants(const char* FragmentShader, const GraphicsPipelineDetails& fixedFunctions) {
+		const char* VertexShader = vertexInput == VertexInputMode::VertexPulling ?
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/VertexPulling.vert.spv" :
+			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Triangle.vert.spv";
+
+		auto configure = [](uint32_t features, GraphicsPipelineDetails& details) {
+			if (features & MaterialSystem::DoubleSided) {
+				details.Rasterization.cullMode = VK_CULL_MODE_NONE;
+			}
+			// The depth prepass already wrote the nearest depth, only the fragments that made it there pass
+			if (features & DepthEqual) {
+				details.DepthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+				details.DepthStencil.depthWriteEnable = VK_FALSE;
+			}
+		};
+
+		const ArchiveEntry* PackedVertex = archive ? archive->Find(VertexShader, AssetType::Shader) : nullptr;
+		const ArchiveEntry* PackedFragment = archive ? archive->Find(FragmentShader, AssetType::Shader) : nullptr;
+
+		if (PackedVertex && PackedFragment) {
+			ArchiveBlob VertexCode = archive->Shader(*PackedVertex);
+			ArchiveBlob FragmentCode = archive->Shader(*PackedFragment);
+
+			return std::make_unique<PipelineVariants>(
+				device,
+				ShaderBytecode{ VertexCode.data, VertexCode.size },
+				ShaderBytecode{ FragmentCode.data, FragmentCode.size },
+				fixedFunctions,
+				MaterialSystem::ShaderFeatures,
+				MaterialSystem::StateFeatures | DepthEqual,
+				configure
+			);
+		}
+
+		auto VertexCode = ReadFile(VertexShader);
+		auto FragmentCode = ReadFile(FragmentShader);
+
+		return std::make_unique<PipelineVariants>(
+			device,
+			ShaderBytecode{ VertexCode.data(), VertexCode.size() },
+			ShaderBytecode{ FragmentCode.data(), FragmentCode.size() },
+			fixedFunctions,
+			MaterialSystem::ShaderFeatures,
+			MaterialSystem::StateFeatures | DepthEqual,
+			configure
+		);
+	}
+
 	void SimpleRenderereSystem::createGraphicsPipeline(VkRenderPass renderPass) {
 		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
 		fixedFunctions.layout = pipelineLayout;
 		fixedFunctions.renderPass = renderPass;
 		fixedFunctions.subpass = 0;
+		fixedFunctions.vertexInput = vertexInput;
 
-		pipeline = std::make_unique<GPipeline>(
-			device,
-			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Triangle.vert.spv",
-			"D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Triangle.frag.spv",
-			fixedFunctions
-		);
+		pipelines = createVariants("D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/Triangle.frag.spv", fixedFunctions);
+
+		// What most instances use, the other variants are created when a material first needs them
+		pipelines->Get(materials.GetVariant(MaterialSystem::DefaultMaterial));
 	}
 
+	void SimpleRenderereSystem::createGBufferPipelines(VkRenderPass deferredRenderPass) {
+		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
+		fixedFunctions.layout = pipelineLayout;
+		fixedFunctions.renderPass = deferredRenderPass;
+		fixedFunctions.subpass = 0;
+		fixedFunctions.vertexInput = vertexInput;
+
+		// Albedo and normal, neither blended
+		VkPipelineColorBlendAttachmentState attachments[2] = { fixedFunctions.Attachment, fixedFunctions.Attachment };
+		fixedFunctions.ColorBlending.attachmentCount = 2;
+		fixedFunctions.ColorBlending.pAttachments = attachments;
+
+		gbufferPipelines = createVariants("D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/GBuffer.frag.spv", fixedFunctions);
+		gbufferPipelines->Get(materials.GetVariant(MaterialSystem::DefaultMaterial));
+	}
+
+	void SimpleRenderereSystem::EnableDeferredShading(VkRenderPass deferredRenderPass) {
+		if (!gbufferPipelines) {
+			createGBufferPipelines(deferredRenderPass);
+		}
+		deferred = true;
+	}
+
+	void SimpleRenderereSystem::createDepthPipelines(VkRenderPass depthPrepassRenderPass) {
+		GraphicsPipelineDetails fixedFunctions = GPipeline::PipelineDefaultDetails();
+		fixedFunctions.layout = pipelineLayout;
+		fixedFunctions.renderPass = depthPrepassRenderPass;
+		fixedFunctions.subpass = 0;
+		fixedFunctions.vertexInput = VertexInputMode::PositionOnly;
+		// No color attachment in the depth prepass
+		fixedFunctions.ColorBlending.attachmentCount = 0;
+		fixedFunctions.ColorBlending.pAttachments = nullptr;
+
+		const char* VertexShader = "D:/Coding/YTVulkan/VulkanLearn/VulkanLearningProject/Project3/Res/Shaders/DepthOnly.vert.spv";
+		std::vector<char> VertexCode;
+		if (const ArchiveEntry* PackedVertex = archive ? archive->Find(VertexShader, AssetType::Shader) : nullptr) {
+			ArchiveBlob Packed = archive->Shader(*PackedVertex);
+			VertexCode.assign(Packed.data, Packed.data + Packed.size);
+		}
+		else {
+			VertexCode = ReadFile(VertexShader);
+		}
+
+		for (uint32_t doubleSided = 0; doubleSided < 2; doubleSided++) {
+			fixedFunctions.Rasterization.cullMode = doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			depthPipelines[doubleSided] = std::make_unique<GPipeline>(device, ShaderBytecode{ VertexCode.data(), VertexCode.size() }, ShaderBytecode{ nullptr, 0 }, fixedFunctions);
+		}
+	}
+
+	void SimpleRenderereSystem::EnableDepthPrepass(VkRenderPass depthPrepassRenderPass) {
+		if (!depthPipelines[0]) {
+			createDepthPipelines(depthPrepassRenderPass);
+		}
+		depthPrepass = true;
+	}
+
+
+	void SimpleRenderereSystem::updateTextureDescriptor(uint32_t currentFrame) {
+		// The frame's fence was waited on in StartFrame so its descriptor set isn't in use anymore
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.sampler = model->GetTextureSampler();
+		imageInfo.imageView = model->GetTextureImageView();
+
+		VkWriteDescriptorSet WriteSet{};
+		WriteSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		WriteSet.dstSet = DescriptorSets[currentFrame];
+		WriteSet.dstBinding = 1;
+		WriteSet.dstArrayElement = 0;
+		WriteSet.descriptorCount = 1;
+		WriteSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		WriteSet.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device.device(), 1, &WriteSet, 0, nullptr);
+		DescriptorTextureVersions[currentFrame] = model->GetTextureVersion();
+	}
+
+	void SimpleRenderereSystem::CullOccluded() {
+		if (!occlusionRasterizer) {
+			return;
+		}
+
+		// Screen pixels, smaller occluders hide little and cost as much to rasterize
+		const float MinOccluderSize = 64.0f;
+
+		syncScene();
+
+		Camera::CameraUBO matrices = camera.GetMatrices();
+		glm::mat4 viewProj = matrices.proj * matrices.view;
+		if (REVERSE_Z) {
+			// The rasterizer keeps the nearest depth as the smallest, z' = w - z turns reverse Z back around
+			glm::mat4 flip(1.0f);
+			flip[2][2] = -1.0f;
+			flip[3][2] = 1.0f;
+			viewProj = flip * viewProj;
+		}
+		occlusionRasterizer->Begin(viewProj);
+
+		for (uint32_t i : occluderInstances) {
+			const glm::vec4& instance = instances[i];
+			float ProjectedSize = camera.ProjectedSize(glm::vec3(instance) + model->GetBoundsCenter() * instance.w, model->GetBoundsRadius() * instance.w);
+			if (ProjectedSize >= MinOccluderSize) {
+				occlusionRasterizer->AddOccluder(occluderPositions.data(), occluderIndices.data(), static_cast<uint32_t>(occluderIndices.size()), scene.GetWorldMatrix(instanceEntities[i]));
+			}
+		}
+		occlusionRasterizer->Rasterize();
+
+		instanceBounds.resize(instances.size());
+		for (size_t i = 0; i < instances.size(); i++) {
+			const Bvh::Aabb& bounds = scene.GetWorldBounds(instanceEntities[i]);
+			instanceBounds[i] = { bounds.min, bounds.max };
+		}
+
+		instanceVisible.resize(instances.size());
+		occlusionRasterizer->Test(instanceBounds.data(), static_cast<uint32_t>(instanceBounds.size()), instanceVisible.data());
+	}
+
+	Entity SimpleRenderereSystem::AddInstance(glm::vec3 position, float scale, Entity parent, uint32_t material) {
+		Entity entity = scene.Create(parent);
+		scene.SetPosition(entity, position);
+		scene.SetScale(entity, glm::vec3(scale));
+
+		// The model's bounding sphere as a box, so the world bounds hold it however the entity turns
+		glm::vec3 radius = glm::vec3(model->GetBoundsRadius());
+		scene.SetBounds(entity, { model->GetBoundsCenter() - radius, model->GetBoundsCenter() + radius });
+		scene.SetRenderable(entity, static_cast<uint32_t>(instances.size()));
+
+		// Filled in by the first Scene::Update that sees the entity
+		instances.push_back(glm::vec4(position, scale));
+		instanceEntities.push_back(entity);
+		instanceMaterials.push_back(material);
+		instanceAxisAligned.push_back(1);
+		sceneBvhDirty = true;
+		return entity;
+	}
+
+	void SimpleRenderereSystem::syncScene() {
+		// Off axis by more than this and the model doesn't line up with its impostor or meshlet bounds anymore
+		const float AxisTolerance = 1e-4f;
+
+		if (sceneVersion == scene.GetVersion()) {
+			return;
+		}
+		sceneVersion = scene.GetVersion();
+
+		for (uint32_t instance : scene.GetChangedRenderables()) {
+			const glm::mat4& world = scene.GetWorldMatrix(instanceEntities[instance]);
+			glm::vec3 axes[3] = { glm::vec3(world[0]), glm::vec3(world[1]), glm::vec3(world[2]) };
+			float scale = std::max(glm::length(axes[0]), std::max(glm::length(axes[1]), glm::length(axes[2])));
+
+			// A position that puts the model's bounds center where the matrix puts it, with the largest scale
+			glm::vec3 center = glm::vec3(world * glm::vec4(model->GetBoundsCenter(), 1.0f));
+			instances[instance] = glm::vec4(center - model->GetBoundsCenter() * scale, scale);
+
+			bool axisAligned = true;
+			for (int axis = 0; axis < 3; axis++) {
+				glm::vec3 expected = glm::vec3(0.0f);
+				expected[axis] = scale;
+				axisAligned = axisAligned && glm::all(glm::lessThanEqual(glm::abs(axes[axis] - expected), glm::vec3(AxisTolerance * scale)));
+			}
+			instanceAxisAligned[instance] = axisAligned;
+
+			// Added since the last build, the next one picks it up
+			if (!sceneBvhDirty && instance < sceneBvh.GetObjectCount()) {
+				sceneBvh.Update(instance, scene.GetWorldBounds(instanceEntities[instance]));
+				instancesMoved = true;
+			}
+		}
+	}
+
+	void SimpleRenderereSystem::updateSceneBvh() {
+		// Past this refits have made queries about twice as slow as on a fresh tree
+		const float MaxBvhDegradation = 2.0f;
+
+		if (!sceneBvhDirty && !(instancesMoved && sceneBvh.Degradation() > MaxBvhDegradation)) {
+			instancesMoved = false;
+			return;
+		}
+
+		std::vector<Bvh::Aabb> bounds(instances.size());
+		for (size_t i = 0; i < instances.size(); i++) {
+			bounds[i] = scene.GetWorldBounds(instanceEntities[i]);
+		}
+		sceneBvh.Build(bounds.data(), static_cast<uint32_t>(bounds.size()));
+
+		sceneBvhDirty = false;
+		instancesMoved = false;
+	}
+
+	uint32_t SimpleRenderereSystem::PickInstance(glm::vec3 origin, glm::vec3 direction) {
+		syncScene();
+		updateSceneBvh();
+		return sceneBvh.Raycast(origin, direction).object;
+	}
+
+	void SimpleRenderereSystem::PrepareFrame(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid* pyramid) {
+		meshDraws.clear();
+		culledDraws.clear();
+		culledInstances.clear();
+
+		syncScene();
+		updateSceneBvh();
+		Camera::CameraUBO matrices = camera.GetMatrices();
+		frustumInstances.clear();
+		sceneBvh.QueryFrustum(matrices.proj * matrices.view, frustumInstances);
+		// The occlusion culler relies on draws coming in instance order
+		std::sort(frustumInstances.begin(), frustumInstances.end());
+
+		uint32_t LastLod = model->GetLodCount() - 1;
+		float LargestSize = 0.0f;
+
+		for (uint32_t i : frustumInstances) {
+			// Hidden behind an occluder according to CullOccluded
+			if (i < instanceVisible.size() && !instanceVisible[i]) {
+				continue;
+			}
+
+			const glm::vec4& instance = instances[i];
+			float scale = instance.w;
+			glm::vec3 position = glm::vec3(instance);
+			float ProjectedSize = camera.ProjectedSize(position + model->GetBoundsCenter() * scale, model->GetBoundsRadius() * scale);
+			LargestSize = std::max(LargestSize, ProjectedSize);
+
+			uint32_t lod = model->SelectLod(ProjectedSize);
+			// The atlas was baked with the default material, other materials stay meshes
+			bool impostorable = instanceAxisAligned[i] && instanceMaterials[i] == MaterialSystem::DefaultMaterial;
+			if (lod == LastLod && ProjectedSize < impostors->MaxScreenSize() && impostorable && !deferred) {
+				impostors->Add(position, scale);
+			}
+			// Only the full detail mesh is split into meshlets, and it is where culling clusters pays off. The cone test drops
+			// clusters facing away, which a double sided material still draws
+			else if (lod == 0 && meshletCuller && culledDraws.size() < MeshletCuller::MaxInstances && instanceAxisAligned[i] && !(materials.GetVariant(instanceMaterials[i]) & MaterialSystem::DoubleSided)) {
+				culledDraws.push_back(instance);
+				culledInstances.push_back(i);
+			}
+			else {
+				meshDraws.push_back({ instance, lod, i });
+			}
+		}
+
+		// Only matters when the cache streams, the new residency shows up through the texture version
+		textures.RequestDetail(model->GetTexture(), LargestSize);
+
+		if (meshletCuller) {
+			meshletCuller->Cull(commandBuffer, currentFrame, culledDraws.data(), static_cast<uint32_t>(culledDraws.size()));
+		}
+
+		if (occlusionCuller) {
+			assert(pyramid && "occlusion culling needs the renderer's depth pyramid");
+
+			// Instances past what the culler keeps visibility for are drawn without it
+			occlusionDraws.clear();
+			for (const auto& draw : meshDraws) {
+				if (draw.instance >= OcclusionCuller::MaxDraws) {
+					break;
+				}
+				const Model::Lod& lod = model->GetLod(draw.lod);
+				occlusionDraws.push_back({ draw.positionScale, lod.firstIndex, lod.indexCount, draw.instance, 0 });
+			}
+			occlusionCuller->CullEarly(commandBuffer, currentFrame, *pyramid, occlusionDraws.data(), static_cast<uint32_t>(occlusionDraws.size()));
+		}
+
+		queueDraws(currentFrame);
+	}
+
+	void SimpleRenderereSystem::queueDraws(uint32_t currentFrame) {
+		renderQueue.Clear();
+
+		// Before anything binds the set, the depth prepass records its draws ahead of RenderObject
+		if (DescriptorTextureVersions[currentFrame] != model->GetTextureVersion()) {
+			updateTextureDescriptor(currentFrame);
+		}
+
+		pushedVertexLayout = model->GetPulledVertexLayout();
+		// Every material reads its parameters from the same set, only the variants in use cost a pipeline
+		uint32_t setId = renderQueue.AddDescriptorSet({ pipelineLayout, DescriptorSets[currentFrame] });
+		uint32_t pipelineIds[(MaterialSystem::VariantFeatures | DepthEqual) + 1];
+		std::fill(std::begin(pipelineIds), std::end(pipelineIds), UINT32_MAX);
+		auto pipelineOf = [&](uint32_t variant) {
+			if (pipelineIds[variant] == UINT32_MAX) {
+				PipelineVariants& variants = deferred ? *gbufferPipelines : *pipelines;
+				pipelineIds[variant] = renderQueue.AddPipeline({ variants.Get(variant).GetPipeline(), pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+					&pushedVertexLayout, sizeof(pushedVertexLayout), offsetof(ObjectPushConstants, object) });
+			}
+			return pipelineIds[variant];
+		};
+		uint32_t depthPipelineIds[2] = { UINT32_MAX, UINT32_MAX };
+		auto depthPipelineOf = [&](uint32_t variant) {
+			uint32_t doubleSided = (variant & MaterialSystem::DoubleSided) ? 1 : 0;
+			if (depthPipelineIds[doubleSided] == UINT32_MAX) {
+				depthPipelineIds[doubleSided] = renderQueue.AddPipeline({ depthPipelines[doubleSided]->GetPipeline(), pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+					nullptr, 0, offsetof(ObjectPushConstants, object) });
+			}
+			return depthPipelineIds[doubleSided];
+		};
+
+		// Vertices are read from the storage buffer when pulled, only the index buffer is bound then
+		VkBuffer vertexBuffer = vertexInput == VertexInputMode::FixedFunction ? model->GetVertexBuffer() : VK_NULL_HANDLE;
+		uint32_t modelMesh = renderQueue.AddMesh({ vertexBuffer, model->GetIndexBuffer(), VK_INDEX_TYPE_UINT32 });
+		uint32_t modelPositions = depthPrepass ? renderQueue.AddMesh({ model->GetPositionBuffer(), model->GetIndexBuffer(), VK_INDEX_TYPE_UINT32 }) : 0;
+
+		glm::vec3 cameraPosition = camera.GetPosition();
+		float farPlane = camera.GetFarPlane();
+		auto depthOf = [&](uint32_t instance) { return glm::distance(cameraPosition, glm::vec3(instances[instance])) / farPlane; };
+		auto objectOf = [&](uint32_t instance) { return scene.GetObjectIndex(instanceEntities[instance]); };
+		auto variantOf = [&](uint32_t instance) { return materials.GetVariant(instanceMaterials[instance]); };
+
+		// The depth prepass draws the same thing from the positions alone, the color pass then only tests for equality
+		auto queueMain = [&](uint32_t instance, uint32_t mesh, uint32_t positions, const RenderQueue::Draw& draw) {
+			uint32_t variant = variantOf(instance);
+			float depth = depthOf(instance);
+			if (depthPrepass && !(variant & MaterialSystem::AlphaTest)) {
+				renderQueue.Add(RenderQueue::MakeKey(RenderQueue::Pass::DepthPrepass, depthPipelineOf(variant), setId, positions, depth), draw);
+				variant |= DepthEqual;
+			}
+			renderQueue.Add(RenderQueue::MakeKey(RenderQueue::Pass::Main, pipelineOf(variant), setId, mesh, depth), draw);
+		};
+
+		for (uint32_t i = 0; i < meshDraws.size(); i++) {
+			const MeshDraw& draw = meshDraws[i];
+			uint32_t material = instanceMaterials[draw.instance];
+
+			// What was visible last frame, the GPU decided whether to draw it
+			if (i < occlusionDraws.size()) {
+				queueMain(draw.instance, modelMesh, modelPositions, { objectOf(draw.instance), material, 0, 0, occlusionCuller->GetIndirectBuffer(), OcclusionCuller::GetEarlyOffset(i) });
+			}
+			else {
+				const Model::Lod& lod = model->GetLod(draw.lod);
+				queueMain(draw.instance, modelMesh, modelPositions, { objectOf(draw.instance), material, lod.firstIndex, lod.indexCount, VK_NULL_HANDLE, 0 });
+			}
+		}
+
+		if (!culledDraws.empty()) {
+			// Surviving clusters were compacted into the culler's index buffer, the counts never come back to the CPU
+			uint32_t culledMesh = renderQueue.AddMesh({ vertexBuffer, meshletCuller->GetIndexBuffer(), VK_INDEX_TYPE_UINT32 });
+			uint32_t culledPositions = depthPrepass ? renderQueue.AddMesh({ model->GetPositionBuffer(), meshletCuller->GetIndexBuffer(), VK_INDEX_TYPE_UINT32 }) : 0;
+			for (uint32_t i = 0; i < culledDraws.size(); i++) {
+				uint32_t instance = culledInstances[i];
+				assert(!(variantOf(instance) & MaterialSystem::DoubleSided) && "a double sided instance would lose its back facing clusters");
+				queueMain(instance, culledMesh, culledPositions, { objectOf(instance), instanceMaterials[instance], 0, 0, meshletCuller->GetDrawBuffer(), MeshletCuller::GetDrawOffset(i) });
+			}
+		}
+
+		// Not in the depth prepass, they show up after it
+		for (uint32_t i = 0; i < occlusionDraws.size(); i++) {
+			uint32_t instance = occlusionDraws[i].instance;
+			uint64_t key = RenderQueue::MakeKey(RenderQueue::Pass::Late, pipelineOf(variantOf(instance)), setId, modelMesh, depthOf(instance));
+			renderQueue.Add(key, { objectOf(instance), instanceMaterials[instance], 0, 0, occlusionCuller->GetIndirectBuffer(), OcclusionCuller::GetLateOffset(i) });
+		}
+
+		renderQueue.Sort();
+	}
+
+	void SimpleRenderereSystem::CullLate(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid) {
+		if (occlusionCuller) {
+			occlusionCuller->CullLate(commandBuffer, currentFrame, pyramid);
+		}
+	}
+
+	void SimpleRenderereSystem::RenderDepthPrepass(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+		renderQueue.Submit(commandBuffer, RenderQueue::Pass::DepthPrepass);
+	}
 
 	void SimpleRenderereSystem::RenderObject(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
-		pipeline->bind(commandBuffer);
-		model->Bind(commandBuffer);
-		model->BindIndex(commandBuffer);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &DescriptorSets[currentFrame], 0, nullptr);
-		model->Draw(commandBuffer);
+		renderQueue.Submit(commandBuffer, RenderQueue::Pass::Main);
+		// Made for the forward render pass, they can't draw into the G-buffer
+		if (!deferred) {
+			impostors->Render(commandBuffer, currentFrame);
+		}
+	}
+
+	void SimpleRenderereSystem::RenderLate(VkCommandBuffer commandBuffer, uint32_t currentFrame) {
+		// A new render pass, Submit binds everything again
+		renderQueue.Submit(commandBuffer, RenderQueue::Pass::Late);
 	}
 }
\ No newline at end of file
@@ -4,34 +4,200 @@
 #include "GPipeline.h"
 #include "Model.h"
 #include "Camera.h"
+#include "TextureCache.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MeshletCuller.h"
+#include "OcclusionCuller.h"
+#include "OcclusionRasterizer.h"
+#include "AssetArchive.h"
+#include "ImpostorRenderSystem.h"
+#include "Bvh.h"
+#include "Scene.h"
+#include "RenderQueue.h"
+#include "MaterialSystem.h"
+#include "ClusteredLights.h"
+#include "ShadowRenderSystem.h"
+#include "PipelineVariants.h"
 
 namespace Engine
 {
 	class SimpleRenderereSystem
 	{
 	public:
-		SimpleRenderereSystem(Device& device, VkRenderPass renderPass, Camera& Camera);
+		// Vertex stage push constants, the layout is only read by VertexPulling.vert
+		struct ObjectPushConstants {
+			Model::PulledVertexLayout vertexLayout;
+			alignas(16) uint32_t object;	// slot of the instance's world matrix in the scene's buffer
+			uint32_t material;	// index into the material system's buffer, read by Triangle.frag
+		};
+
+		// Pipeline state on top of the material variants, the depth is tested for equality and not written
+		static constexpr uint32_t DepthEqual = 1u << 5;
+		static_assert((DepthEqual & MaterialSystem::VariantFeatures) == 0, "DepthEqual overlaps a material feature");
+
+		SimpleRenderereSystem(Device& device, TextureCache& textures, VkRenderPass renderPass, Camera& Camera, Scene& scene, MaterialSystem& materials, ClusteredLights& lights, ShadowRenderSystem& shadows, VertexInputMode vertexInput = VertexInputMode::FixedFunction, const std::string& MeshPath = "", const AssetArchive* archive = nullptr);
 		~SimpleRenderereSystem();
 
+		/*
+			A scene entity drawn with the model, moved through the scene from then on. Its matrix is only there once the
+			next Scene::Update ran, instances have to be added before it.
+		*/
+		Entity AddInstance(glm::vec3 position, float scale = 1.0f, Entity parent = {}, uint32_t material = MaterialSystem::DefaultMaterial);
+		// An instance that also hides the instances behind it once software occlusion is enabled
+		Entity AddOccluder(glm::vec3 position, float scale = 1.0f, Entity parent = {}, uint32_t material = MaterialSystem::DefaultMaterial) {
+			occluderInstances.push_back(static_cast<uint32_t>(instances.size()));
+			return AddInstance(position, scale, parent, material);
+		}
+		// Takes effect from the next PrepareFrame
+		void SetMaterial(Entity instance, uint32_t material) { instanceMaterials[scene.GetRenderable(instance)] = material; }
+		// Nearest instance whose bounds the ray hits, Bvh::InvalidObject when none
+		uint32_t PickInstance(glm::vec3 origin, glm::vec3 direction);
+
+		// Instances hidden behind the occluders are skipped, tested by an OcclusionRasterizer on the texture cache's workers
+		void EnableSoftwareOcclusion() { occlusionRasterizer = std::make_unique<OcclusionRasterizer>(textures.Workers()); }
+		// On the CPU once the scene was updated, PrepareFrame uses the result
+		void CullOccluded();
+
+		/*
+			Meshes drawn whole go through OcclusionCuller's two phases from then on. The frame has to go PrepareFrame,
+			RenderObject, Renderer::BuildDepthPyramid, CullLate, RenderLate, with the last one in the resumed render pass.
+		*/
+		void EnableOcclusionCulling() { occlusionCuller = std::make_unique<OcclusionCuller>(device, camera, *model); }
+
+		/*
+			From the next PrepareFrame, RenderDepthPrepass draws the depth of the opaque draws in a render pass of its own
+			so RenderObject shades them once per pixel with an EQUAL depth test. Alpha tested materials still test and
+			write depth in RenderObject, the depth prepass has no fragment shader to discard with.
+		*/
+		void EnableDepthPrepass(VkRenderPass depthPrepassRenderPass);
+		void DisableDepthPrepass() { depthPrepass = false; }
+		bool DepthPrepassEnabled() const { return depthPrepass; }
+
+		/*
+			From the next PrepareFrame, RenderObject draws into the G-buffer of Renderer::StartDeferredRenderPass with
+			GBuffer.frag and a DeferredLightingSystem shades it in the next subpass. Far instances stay on their last LOD
+			instead of impostors, and neither the depth prepass nor occlusion culling's late pass work with it.
+		*/
+		void EnableDeferredShading(VkRenderPass deferredRenderPass);
+
+		/*
+			Before the render pass: finds the instances in the view frustum through the scene BVH, picks their LOD, hands
+			small far ones to the impostor batch and, when the model has meshlets, culls the clusters of instances drawn at
+			LOD 0 on the GPU. The pyramid is only needed with occlusion culling.
+		*/
+		void PrepareFrame(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid* pyramid = nullptr);
+		// In Renderer::StartDepthPrepass's render pass, before RenderObject
+		void RenderDepthPrepass(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+		// Draws what PrepareFrame decided on
 		void RenderObject(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+		// Outside of a render pass once the pyramid was built from what RenderObject drew
+		void CullLate(VkCommandBuffer commandBuffer, uint32_t currentFrame, DepthPyramid& pyramid);
+		// Draws what only became visible in this frame's depth pyramid
+		void RenderLate(VkCommandBuffer commandBuffer, uint32_t currentFrame);
 
 		void UniformUpdates(uint32_t currentFrame, VkExtent2D Extent) { model->updateUniformBuffer(currentFrame, Extent); }
 
+		// For other systems drawing the same instances, e.g. as shadow casters
+		Model& GetModel() { return *model; }
+
+		// Draws and binds RenderDepthPrepass, RenderObject and RenderLate recorded so far this frame
+		const RenderQueue::Stats& GetRenderStats() const { return renderQueue.GetStats(); }
+
 	private:
-		void LoadModel();
+		void LoadModel(const std::string& MeshPath, VkRenderPass renderPass);
+		void createImpostors(VkRenderPass renderPass, const Model::Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, const std::string& TexturePath);
+		void createOccluderMesh(const Model::Vertex* vertices, const uint32_t* indices);
+		// Takes in what the last Scene::Update moved
+		void syncScene();
+		// Rebuilds the BVH when instances were added or moving them made it too slow to query
+		void updateSceneBvh();
 		void createDescriptorSetLayout();
 		void createDescriptorSets(Camera& Camera);
 		void createPipelineLayout();
+		// Material variants of Triangle.vert or VertexPulling.vert with the fragment shader
+		std::unique_ptr<PipelineVariants> createVariants(const char* FragmentShader, const GraphicsPipelineDetails& fixedFunctions);
 		void createGraphicsPipeline(VkRenderPass renderPass);
+		void createGBufferPipelines(VkRenderPass deferredRenderPass);
+		void createDepthPipelines(VkRenderPass depthPrepassRenderPass);
+		void updateTextureDescriptor(uint32_t currentFrame);
+		// Hands what PrepareFrame decided on to the render queue, sorted front to back within each binding
+		void queueDraws(uint32_t currentFrame);
 
 		VkDescriptorSetLayout DescriptorSetLayout;
 		VkPipelineLayout pipelineLayout;
 
 		std::vector<VkDescriptorSet> DescriptorSets;
+		// Texture version each frame's descriptor set was written with
+		std::vector<uint32_t> DescriptorTextureVersions;
+
+		VertexInputMode vertexInput;
+		// Meshes and shaders are taken from here when packed, can be null
+		const AssetArchive* archive;
 
 		Device& device;
+		TextureCache& textures;
+		Camera& camera;
+		Scene& scene;
 		std::unique_ptr<Model> model;
-		std::unique_ptr<GPipeline> pipeline;
+		MaterialSystem& materials;
+		ClusteredLights& lights;
+		ShadowRenderSystem& shadows;
+		// By MaterialSystem variant and DepthEqual
+		std::unique_ptr<PipelineVariants> pipelines;
+		// Position only, no fragment stage, the second one without back face culling for double sided materials
+		std::unique_ptr<GPipeline> depthPipelines[2];
+		bool depthPrepass = false;
+		// Same variants with GBuffer.frag, for subpass 0 of the deferred render pass
+		std::unique_ptr<PipelineVariants> gbufferPipelines;
+		bool deferred = false;
+		std::unique_ptr<ImpostorRenderSystem> impostors;
+		// Null without meshlets
+		std::unique_ptr<MeshletCuller> meshletCuller;
+		// Null until EnableOcclusionCulling
+		std::unique_ptr<OcclusionCuller> occlusionCuller;
+		// Null until EnableSoftwareOcclusion
+		std::unique_ptr<OcclusionRasterizer> occlusionRasterizer;
+
+		// CPU copy of the full detail mesh occluders are rasterized with, compacted to the vertices it uses
+		std::vector<glm::vec3> occluderPositions;
+		std::vector<uint32_t> occluderIndices;
+		std::vector<uint32_t> occluderInstances;
+		std::vector<OcclusionRasterizer::Bounds> instanceBounds;
+		// Filled by CullOccluded, 0 for hidden instances
+		std::vector<uint8_t> instanceVisible;
+
+		struct MeshDraw {
+			glm::vec4 positionScale;
+			uint32_t lod;
+			uint32_t instance;
+		};
+
+		/*
+			Every instance's bounding sphere as the position and uniform scale the culling passes and the LOD pick take,
+			from the world matrix the scene computed
+		*/
+		std::vector<glm::vec4> instances;
+		std::vector<Entity> instanceEntities;
+		std::vector<uint32_t> instanceMaterials;
+		// Neither rotated nor scaled unevenly, meshlet culling and impostors only place the model by position and scale
+		std::vector<uint8_t> instanceAxisAligned;
+		uint32_t sceneVersion = 0;
+		Bvh sceneBvh;
+		bool sceneBvhDirty = true;
+		bool instancesMoved = false;
+		// Filled by PrepareFrame, in increasing order
+		std::vector<uint32_t> frustumInstances;
+		// Filled by PrepareFrame for RenderObject
+		std::vector<MeshDraw> meshDraws;
+		std::vector<glm::vec4> culledDraws;
+		std::vector<uint32_t> culledInstances;
+		std::vector<OcclusionCuller::Draw> occlusionDraws;
+		RenderQueue renderQueue;
+		// Pushed by the queue whenever it binds the pipeline, has to outlive the frame's Submit calls
+		Model::PulledVertexLayout pushedVertexLayout;
 	};
 }
 
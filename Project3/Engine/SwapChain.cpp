@@ -1,20 +1,48 @@
 #include "SwapChain.h"
 
 namespace Engine {
-	SwapChain::SwapChain(Device& dev, VkExtent2D windowExtent) : device{ dev }, windowExtent{windowExtent} {
+	namespace {
+		uint32_t NextVersion = 1;
+
+		// Albedo is stored in sRGB so 8 bits keep the dark colors, the normal gets 10 bits per axis and 2 to mark lit surfaces
+		constexpr VkFormat AlbedoFormat = VK_FORMAT_R8G8B8A8_SRGB;
+		constexpr VkFormat NormalFormat = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+
+		// Every family that touches an image shared between the graphics and the compute queue
+		std::vector<uint32_t> sharingFamilies(QueueFamilyIndices indices, bool present) {
+			std::set<uint32_t> families = { indices.graphicsQueue.value() };
+			if (present) {
+				families.insert(indices.presentQueue.value());
+			}
+			if (indices.computeQueue.has_value()) {
+				families.insert(indices.computeQueue.value());
+			}
+			return std::vector<uint32_t>(families.begin(), families.end());
+		}
+	}
+
+	SwapChain::SwapChain(Device& dev, VkExtent2D windowExtent, bool keepDepth, bool deferred, bool postProcess) : device{ dev }, windowExtent{windowExtent}, keepDepth{keepDepth}, deferred{deferred}, version{NextVersion++}, postProcess{postProcess} {
 		createSwapChain();
 		createSwapchainImageView();
+		createSceneColors();
 		createDepthResources();
+		createGBuffer();
 		createRenderPass();
+		createDepthPrepassRenderPasses();
+		createDeferredRenderPass();
 		createFrameBuffer();
 		createSyncObject();
 	}
 
-	SwapChain::SwapChain(Device& dev, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous) : device{ dev }, windowExtent{ windowExtent }, oldSwapChain{previous} {
+	SwapChain::SwapChain(Device& dev, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, bool keepDepth, bool deferred, bool postProcess) : device{ dev }, windowExtent{ windowExtent }, oldSwapChain{previous}, keepDepth{keepDepth}, deferred{deferred}, version{NextVersion++}, postProcess{postProcess} {
 		createSwapChain();
 		createSwapchainImageView();
+		createSceneColors();
 		createDepthResources();
+		createGBuffer();
 		createRenderPass();
+		createDepthPrepassRenderPasses();
+		createDeferredRenderPass();
 		createFrameBuffer();
 		createSyncObject();
 
@@ -27,6 +55,9 @@ namespace Engine {
 		{
 			vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
 			vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
+			if (postProcess) {
+				vkDestroySemaphore(device.device(), sceneReadySemaphores[i], nullptr);
+			}
 			vkDestroyFence(device.device(), inFlightFences[i], nullptr);
 		}
 
@@ -34,13 +65,40 @@ namespace Engine {
 		for (const auto& framebuffer : framebuffers) {
 			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
 		}
+		vkDestroyFramebuffer(device.device(), depthFramebuffer, nullptr);
+		for (const auto& framebuffer : deferredFramebuffers) {
+			vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+		}
 
 		vkDestroyRenderPass(device.device(), _renderPass, nullptr);
+		vkDestroyRenderPass(device.device(), _depthPrepassRenderPass, nullptr);
+		vkDestroyRenderPass(device.device(), _prepassedRenderPass, nullptr);
+		if (_resumeRenderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(device.device(), _resumeRenderPass, nullptr);
+		}
+		if (_deferredRenderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(device.device(), _deferredRenderPass, nullptr);
+		}
+
+		if (deferred) {
+			vkDestroyImageView(device.device(), AlbedoImageView, nullptr);
+			vkDestroyImage(device.device(), AlbedoImage, nullptr);
+			vkFreeMemory(device.device(), AlbedoImageMemory, nullptr);
+			vkDestroyImageView(device.device(), NormalImageView, nullptr);
+			vkDestroyImage(device.device(), NormalImage, nullptr);
+			vkFreeMemory(device.device(), NormalImageMemory, nullptr);
+		}
 
 		vkDestroyImageView(device.device(), DepthImageView, nullptr);
 		vkDestroyImage(device.device(), DepthImage, nullptr);
 		vkFreeMemory(device.device(), DepthImageMemory, nullptr);
 
+		for (size_t i = 0; i < sceneColorImages.size(); i++) {
+			vkDestroyImageView(device.device(), sceneColorImageViews[i], nullptr);
+			vkDestroyImage(device.device(), sceneColorImages[i], nullptr);
+			vkFreeMemory(device.device(), sceneColorImagesMemory[i], nullptr);
+		}
+
 		for (const auto& imageView : swapchainImageViews) {
 			vkDestroyImageView(device.device(), imageView, nullptr);
 		}
@@ -61,6 +119,18 @@ namespace Engine {
 	}
 
 	VkSurfaceFormatKHR SwapChain::GetSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& Formats) {
+		// Compute writes it, and sRGB formats are hardly ever storage images
+		if (postProcess) {
+			for (const auto& Format : Formats) {
+				if (Format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR && (Format.format == VK_FORMAT_B8G8R8A8_UNORM || Format.format == VK_FORMAT_R8G8B8A8_UNORM) &&
+					(device.GetFormatProperties(Format.format).optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+					return Format;
+				}
+			}
+
+			throw std::runtime_error("the surface has no format compute can write, disable post processing");
+		}
+
 		for (const auto& Format : Formats) {
 			if (Format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR && Format.format == VK_FORMAT_R8G8B8A8_SRGB) {
 				return Format;
@@ -106,11 +176,24 @@ namespace Engine {
 		swapchainInfo.imageFormat = surfaceFormat.format;
 		swapchainInfo.imageArrayLayers = 1;
 		swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		if (postProcess) {
+			if (!(details.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT)) {
+				throw std::runtime_error("the swapchain images can't be storage images, disable post processing");
+			}
+			swapchainInfo.imageUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		}
 
 		QueueFamilyIndices indices = device.GetFamilyIndices();
 		uint32_t queueFamilyIndices[] = {indices.graphicsQueue.value(), indices.presentQueue.value()};
+		// Written by the compute queue and presented by the present one
+		std::vector<uint32_t> postFamilies = sharingFamilies(indices, true);
 
-		if (indices.graphicsQueue != indices.presentQueue) {
+		if (postProcess && postFamilies.size() > 1) {
+			swapchainInfo.queueFamilyIndexCount = static_cast<uint32_t>(postFamilies.size());
+			swapchainInfo.pQueueFamilyIndices = postFamilies.data();
+			swapchainInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		}
+		else if (indices.graphicsQueue != indices.presentQueue) {
 			swapchainInfo.queueFamilyIndexCount = 2;
 			swapchainInfo.pQueueFamilyIndices = queueFamilyIndices;
 			swapchainInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
@@ -153,22 +236,52 @@ namespace Engine {
 		}
 	}
 
+	void SwapChain::createSceneColors() {
+		if (!postProcess) {
+			return;
+		}
+
+		sceneColorImages.resize(swapchainImages.size());
+		sceneColorImagesMemory.resize(swapchainImages.size());
+		sceneColorImageViews.resize(swapchainImages.size());
+
+		// Sampled by the compute queue while the graphics queue already draws the next one
+		std::vector<uint32_t> families = sharingFamilies(device.GetFamilyIndices(), false);
+
+		for (size_t i = 0; i < sceneColorImages.size(); i++) {
+			device.createImage(
+				sceneColorImages[i],
+				swapchainExtent,
+				1,
+				VK_IMAGE_TILING_OPTIMAL,
+				SceneColorFormat,
+				0,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				sceneColorImagesMemory[i],
+				1,
+				families
+			);
+			sceneColorImageViews[i] = createImageView(sceneColorImages[i], SceneColorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		}
+	}
+
 	void SwapChain::createRenderPass() {
 		VkAttachmentDescription ColorAttachment{};
 		ColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		ColorAttachment.format = swapchainColorFormat;
+		ColorAttachment.format = colorAttachmentFormat();
 		ColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		ColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		ColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		ColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		ColorAttachment.finalLayout = colorFinalLayout();
 
 		VkAttachmentDescription DepthAttachment{};
 		DepthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		DepthAttachment.format = device.findDepthFormat();
+		DepthAttachment.format = DepthFormat;
 		DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.storeOp = keepDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -192,7 +305,8 @@ namespace Engine {
 		subpassDep.srcSubpass = VK_SUBPASS_EXTERNAL;
 		subpassDep.dstSubpass = 0;
 
-		subpassDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		// The scene color may still be sampled by the post processing it last went through
+		subpassDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | (postProcess ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0);
 		subpassDep.srcAccessMask = 0;
 
 		subpassDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
@@ -212,6 +326,232 @@ namespace Engine {
 			throw std::runtime_error("failed to create the render pass");
 		}
 
+		if (!keepDepth) {
+			return;
+		}
+
+		// Continues after compute work on the kept depth, e.g. the second phase of occlusion culling
+		Attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		Attachments[0].initialLayout = colorFinalLayout();
+		Attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		Attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		Attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkSubpassDependency resumeDep{};
+		resumeDep.srcSubpass = VK_SUBPASS_EXTERNAL;
+		resumeDep.dstSubpass = 0;
+
+		resumeDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		resumeDep.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		resumeDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		resumeDep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		PassInfo.pDependencies = &resumeDep;
+
+		if (vkCreateRenderPass(device.device(), &PassInfo, nullptr, &_resumeRenderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the resume render pass");
+		}
+	}
+
+	void SwapChain::createDepthPrepassRenderPasses() {
+		VkAttachmentDescription DepthAttachment{};
+		DepthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		DepthAttachment.format = DepthFormat;
+		DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		DepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference DepthAttachmentRef{};
+		DepthAttachmentRef.attachment = 0;
+		DepthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription depthSubpass{};
+		depthSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		depthSubpass.colorAttachmentCount = 0;
+		depthSubpass.pDepthStencilAttachment = &DepthAttachmentRef;
+
+		// Last frame's passes may still test against the depth being cleared
+		VkSubpassDependency depthDep{};
+		depthDep.srcSubpass = VK_SUBPASS_EXTERNAL;
+		depthDep.dstSubpass = 0;
+		depthDep.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		depthDep.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthDep.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		depthDep.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		VkRenderPassCreateInfo DepthPassInfo{};
+		DepthPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		DepthPassInfo.attachmentCount = 1;
+		DepthPassInfo.pAttachments = &DepthAttachment;
+		DepthPassInfo.subpassCount = 1;
+		DepthPassInfo.pSubpasses = &depthSubpass;
+		DepthPassInfo.dependencyCount = 1;
+		DepthPassInfo.pDependencies = &depthDep;
+
+		if (vkCreateRenderPass(device.device(), &DepthPassInfo, nullptr, &_depthPrepassRenderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the depth prepass render pass");
+		}
+
+		// The color pass after it, same attachments as renderPass() with the depth loaded
+		VkAttachmentDescription ColorAttachment{};
+		ColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		ColorAttachment.format = colorAttachmentFormat();
+		ColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		ColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		ColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		ColorAttachment.finalLayout = colorFinalLayout();
+
+		DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		DepthAttachment.storeOp = keepDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference ColorAttachmentRef{};
+		ColorAttachmentRef.attachment = 0;
+		ColorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		DepthAttachmentRef.attachment = 1;
+
+		VkSubpassDescription colorSubpass{};
+		colorSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		colorSubpass.colorAttachmentCount = 1;
+		colorSubpass.pColorAttachments = &ColorAttachmentRef;
+		colorSubpass.pDepthStencilAttachment = &DepthAttachmentRef;
+
+		VkSubpassDependency prepassedDep{};
+		prepassedDep.srcSubpass = VK_SUBPASS_EXTERNAL;
+		prepassedDep.dstSubpass = 0;
+		prepassedDep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | (postProcess ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0);
+		prepassedDep.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		prepassedDep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		prepassedDep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		std::array<VkAttachmentDescription, 2> Attachments = { ColorAttachment, DepthAttachment };
+		VkRenderPassCreateInfo PassInfo{};
+		PassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		PassInfo.attachmentCount = static_cast<uint32_t>(Attachments.size());
+		PassInfo.pAttachments = Attachments.data();
+		PassInfo.subpassCount = 1;
+		PassInfo.pSubpasses = &colorSubpass;
+		PassInfo.dependencyCount = 1;
+		PassInfo.pDependencies = &prepassedDep;
+
+		if (vkCreateRenderPass(device.device(), &PassInfo, nullptr, &_prepassedRenderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the prepassed render pass");
+		}
+	}
+
+	void SwapChain::createDeferredRenderPass() {
+		if (!deferred) {
+			return;
+		}
+
+		VkAttachmentDescription ColorAttachment{};
+		ColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		ColorAttachment.format = colorAttachmentFormat();
+		ColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		ColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		ColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		ColorAttachment.finalLayout = colorFinalLayout();
+
+		// Read back by the lighting subpass, which only shades where something was drawn
+		VkAttachmentDescription DepthAttachment{};
+		DepthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		DepthAttachment.format = DepthFormat;
+		DepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		DepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		// Every pixel the lighting reads was written first, nothing is loaded and nothing outlives the pass
+		VkAttachmentDescription GBufferAttachment{};
+		GBufferAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		GBufferAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		GBufferAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		GBufferAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		GBufferAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		GBufferAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		GBufferAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkAttachmentDescription AlbedoAttachment = GBufferAttachment;
+		AlbedoAttachment.format = AlbedoFormat;
+		VkAttachmentDescription NormalAttachment = GBufferAttachment;
+		NormalAttachment.format = NormalFormat;
+
+		std::array<VkAttachmentReference, 2> GBufferRefs{};
+		GBufferRefs[0] = { 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		GBufferRefs[1] = { 3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference DepthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+		// The depth is tested against and read as an input at once, both in the read only layout
+		std::array<VkAttachmentReference, 3> InputRefs{};
+		InputRefs[0] = { 2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		InputRefs[1] = { 3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		InputRefs[2] = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+		VkAttachmentReference ColorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference ReadOnlyDepthRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+		std::array<VkSubpassDescription, 2> subpasses{};
+		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[0].colorAttachmentCount = static_cast<uint32_t>(GBufferRefs.size());
+		subpasses[0].pColorAttachments = GBufferRefs.data();
+		subpasses[0].pDepthStencilAttachment = &DepthAttachmentRef;
+
+		subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[1].inputAttachmentCount = static_cast<uint32_t>(InputRefs.size());
+		subpasses[1].pInputAttachments = InputRefs.data();
+		subpasses[1].colorAttachmentCount = 1;
+		subpasses[1].pColorAttachments = &ColorAttachmentRef;
+		subpasses[1].pDepthStencilAttachment = &ReadOnlyDepthRef;
+
+		std::array<VkSubpassDependency, 3> dependencies{};
+		// Last frame's lighting may still read the G-buffer and depth being drawn over
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		// The swapchain image (or scene color) is first used by the lighting, its layout transition has to wait for the acquire too
+		dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].dstSubpass = 1;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | (postProcess ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0);
+		dependencies[1].srcAccessMask = 0;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		// Each pixel only reads its own G-buffer texels, so by region lets a tiled GPU keep everything on chip
+		dependencies[2].srcSubpass = 0;
+		dependencies[2].dstSubpass = 1;
+		dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+		std::array<VkAttachmentDescription, 4> Attachments = { ColorAttachment, DepthAttachment, AlbedoAttachment, NormalAttachment };
+		VkRenderPassCreateInfo PassInfo{};
+		PassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		PassInfo.attachmentCount = static_cast<uint32_t>(Attachments.size());
+		PassInfo.pAttachments = Attachments.data();
+		PassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+		PassInfo.pSubpasses = subpasses.data();
+		PassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		PassInfo.pDependencies = dependencies.data();
+
+		if (vkCreateRenderPass(device.device(), &PassInfo, nullptr, &_deferredRenderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the deferred render pass");
+		}
 	}
 
 	void SwapChain::createFrameBuffer() {
@@ -219,7 +559,7 @@ namespace Engine {
 
 		for (size_t i = 0; i < swapchainImageViews.size(); i++) {
 			std::array<VkImageView, 2> attachments = {
-				swapchainImageViews[i],
+				colorAttachmentView(i),
 				DepthImageView
 			};
 
@@ -236,12 +576,55 @@ namespace Engine {
 				throw std::runtime_error("failed to create framebuffer");
 			}
 		}
+
+		// One depth image for every swapchain image, so one framebuffer for the depth prepass
+		VkFramebufferCreateInfo depthFramebufferInfo{};
+		depthFramebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		depthFramebufferInfo.attachmentCount = 1;
+		depthFramebufferInfo.pAttachments = &DepthImageView;
+		depthFramebufferInfo.renderPass = _depthPrepassRenderPass;
+		depthFramebufferInfo.layers = 1;
+		depthFramebufferInfo.width = swapchainExtent.width;
+		depthFramebufferInfo.height = swapchainExtent.height;
+
+		if (vkCreateFramebuffer(device.device(), &depthFramebufferInfo, nullptr, &depthFramebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create the depth framebuffer");
+		}
+
+		if (!deferred) {
+			return;
+		}
+
+		deferredFramebuffers.resize(swapchainImageViews.size());
+
+		for (size_t i = 0; i < swapchainImageViews.size(); i++) {
+			std::array<VkImageView, 4> attachments = {
+				colorAttachmentView(i),
+				DepthImageView,
+				AlbedoImageView,
+				NormalImageView
+			};
+
+			VkFramebufferCreateInfo framebufferInfo{};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+			framebufferInfo.pAttachments = attachments.data();
+			framebufferInfo.renderPass = _deferredRenderPass;
+			framebufferInfo.layers = 1;
+			framebufferInfo.width = swapchainExtent.width;
+			framebufferInfo.height = swapchainExtent.height;
+
+			if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &deferredFramebuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create deferred framebuffer");
+			}
+		}
 	}
 
 	void SwapChain::createSyncObject() {
 		imageAvailableSemaphores.resize(MAX_FRAME_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAME_IN_FLIGHT);
 		inFlightFences.resize(MAX_FRAME_IN_FLIGHT);
+		sceneReadySemaphores.resize(postProcess ? MAX_FRAME_IN_FLIGHT : 0);
 
 		VkSemaphoreCreateInfo SemaphoreInfo{};
 		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -262,6 +645,10 @@ namespace Engine {
 				) {
 				throw std::runtime_error("Sync objects failed to create");
 			}
+
+			if (postProcess && vkCreateSemaphore(device.device(), &SemaphoreInfo, nullptr, &sceneReadySemaphores[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Sync objects failed to create");
+			}
 		}
 
 	}
@@ -275,7 +662,7 @@ namespace Engine {
 		return result;
 	}
 
-	VkResult SwapChain::SubmitCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t* ImageIndex) {
+	VkResult SwapChain::SubmitCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t* ImageIndex, VkCommandBuffer ComputeCommandBuffer) {
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -292,8 +679,32 @@ namespace Engine {
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		if (vkQueueSubmit(device.GraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to submit draw command buffer");
+		if (ComputeCommandBuffer == VK_NULL_HANDLE) {
+			if (vkQueueSubmit(device.GraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit draw command buffer");
+			}
+		}
+		else {
+			// The fence goes with the compute half, which can't finish before the graphics half
+			submitInfo.pSignalSemaphores = &sceneReadySemaphores[currentFrame];
+			if (vkQueueSubmit(device.GraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit draw command buffer");
+			}
+
+			VkPipelineStageFlags computeWaitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			VkSubmitInfo computeInfo{};
+			computeInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			computeInfo.waitSemaphoreCount = 1;
+			computeInfo.pWaitSemaphores = &sceneReadySemaphores[currentFrame];
+			computeInfo.pWaitDstStageMask = &computeWaitStage;
+			computeInfo.commandBufferCount = 1;
+			computeInfo.pCommandBuffers = &ComputeCommandBuffer;
+			computeInfo.signalSemaphoreCount = 1;
+			computeInfo.pSignalSemaphores = signalSemaphores;
+
+			if (vkQueueSubmit(device.ComputeQueue(), 1, &computeInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit post processing command buffer");
+			}
 		}
 
 		VkPresentInfoKHR presentInfo{};
@@ -340,19 +751,39 @@ namespace Engine {
 	}
 
 	void SwapChain::createDepthResources() {
-		VkFormat DepthFormat = device.findDepthFormat();
+		DepthFormat = device.findDepthFormat();
+
+		if (keepDepth && !device.isSampledFormatSupported(DepthFormat)) {
+			throw std::runtime_error("the depth format can't be sampled, disable occlusion culling");
+		}
 
 		device.createImage(
 			DepthImage,
 			swapchainExtent,
+			1,
 			VK_IMAGE_TILING_OPTIMAL,
 			DepthFormat,
 			0,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (keepDepth ? VK_IMAGE_USAGE_SAMPLED_BIT : 0) | (deferred ? VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT : 0),
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			DepthImageMemory
 		);
 
 		DepthImageView = createImageView(DepthImage, DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 	}
+	void SwapChain::createGBuffer() {
+		if (!deferred) {
+			return;
+		}
+
+		// Only ever attachments of the deferred pass, never stored, so they can live in tile memory alone
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+		device.createImage(AlbedoImage, swapchainExtent, 1, VK_IMAGE_TILING_OPTIMAL, AlbedoFormat, 0, usage, properties, AlbedoImageMemory);
+		AlbedoImageView = createImageView(AlbedoImage, AlbedoFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		device.createImage(NormalImage, swapchainExtent, 1, VK_IMAGE_TILING_OPTIMAL, NormalFormat, 0, usage, properties, NormalImageMemory);
+		NormalImageView = createImageView(NormalImage, NormalFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
 }
\ No newline at end of file
@@ -14,37 +14,92 @@
 
 namespace Engine
 {
+	// Views of deferredRenderPass()'s G-buffer, read as input attachments by its lighting subpass
+	struct GBuffer {
+		VkImageView albedo;
+		VkImageView normal;
+		VkImageView depth;
+		// Different for every swapchain ever made, descriptor sets compare it to know when to be rewritten
+		uint32_t version;
+	};
 
 	class SwapChain
 	{
 		public:
-			SwapChain(Device& dev, VkExtent2D windowExtent);
-			SwapChain(Device& dev, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+			// keepDepth stores the depth attachment and makes it sampleable, for building a depth pyramid after the pass
+			// deferred makes the G-buffer and deferredRenderPass()
+			/*
+				postProcess renders into HDR scene colors, one per swapchain image, left SHADER_READ_ONLY_OPTIMAL by every
+				pass for compute to sample. The swapchain image is then only written as a storage image, so it gets a UNORM
+				format and the sRGB encoding is up to the shader.
+			*/
+			SwapChain(Device& dev, VkExtent2D windowExtent, bool keepDepth = false, bool deferred = false, bool postProcess = false);
+			SwapChain(Device& dev, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, bool keepDepth = false, bool deferred = false, bool postProcess = false);
 			~SwapChain();
 
 			SwapChain(const SwapChain&) = delete;
 			SwapChain& operator=(const SwapChain&) = delete;
 
 			VkRenderPass renderPass() { return _renderPass; }
+			/*
+				Same attachments loaded instead of cleared, compatible with renderPass() so pipelines and framebuffers are
+				shared. Only with keepDepth, the depth is expected in DEPTH_STENCIL_READ_ONLY_OPTIMAL when it begins.
+			*/
+			VkRenderPass resumeRenderPass() { return _resumeRenderPass; }
+			// Depth attachment alone, cleared and stored for the color pass after it, drawn into DepthFramebuffer()
+			VkRenderPass depthPrepassRenderPass() { return _depthPrepassRenderPass; }
+			// renderPass() loading the depth depthPrepassRenderPass() left instead of clearing it, compatible with it
+			VkRenderPass prepassedRenderPass() { return _prepassedRenderPass; }
+			/*
+				Only with deferred. Subpass 0 draws the G-buffer, albedo and normal colors plus the depth, subpass 1 reads
+				them back as input attachments and shades into the swapchain image. The G-buffer is transient and never
+				stored, a tiled GPU keeps it in tile memory for the whole pass and never backs it with real memory.
+			*/
+			VkRenderPass deferredRenderPass() { return _deferredRenderPass; }
 			VkFramebuffer Framebuffer(uint32_t ImageIndex) { return framebuffers[ImageIndex]; }
+			VkFramebuffer DeferredFramebuffer(uint32_t ImageIndex) { return deferredFramebuffers[ImageIndex]; }
+			VkFramebuffer DepthFramebuffer() { return depthFramebuffer; }
 			VkExtent2D Extent() { return swapchainExtent; }
 
 			VkResult AquireNextImage(uint32_t *ImageIndex);
-			VkResult SubmitCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t* ImageIndex);
+			/*
+				With a compute command buffer the graphics one only waits for the image and signals the compute one, which
+				presents. It goes to the compute queue, so the post processing of a frame runs beside the next frame's drawing.
+			*/
+			VkResult SubmitCommandBuffer(VkCommandBuffer CommandBuffer, uint32_t* ImageIndex, VkCommandBuffer ComputeCommandBuffer = VK_NULL_HANDLE);
 			uint32_t GetImageCount() { return ImageCount; }
 
 			VkImageView createImageView(VkImage Image, VkFormat format, VkImageAspectFlags aspectFlag);
 
+			VkImage GetDepthImage() { return DepthImage; }
+			VkImageView GetDepthImageView() { return DepthImageView; }
+			VkFormat GetDepthFormat() { return DepthFormat; }
+			GBuffer GetGBuffer() { return { AlbedoImageView, NormalImageView, DepthImageView, version }; }
+
+			// Only with postProcess
+			VkImage GetSceneColorImage(uint32_t ImageIndex) { return sceneColorImages[ImageIndex]; }
+			VkImageView GetSceneColorView(uint32_t ImageIndex) { return sceneColorImageViews[ImageIndex]; }
+			VkImage GetSwapchainImage(uint32_t ImageIndex) { return swapchainImages[ImageIndex]; }
+			VkImageView GetSwapchainImageView(uint32_t ImageIndex) { return swapchainImageViews[ImageIndex]; }
+
 		private:
 			void createSwapChain();
 			void createSwapchainImageView();
+			void createSceneColors();
 			void createDepthResources();
 			void createRenderPass();
+			void createDepthPrepassRenderPasses();
+			void createGBuffer();
+			void createDeferredRenderPass();
 			void createFrameBuffer();
 			void createSyncObject();
 
 			VkPresentModeKHR GetPresentMode(const std::vector<VkPresentModeKHR>& PresentModes);
 			VkSurfaceFormatKHR GetSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& Formats);
+			// What the color attachment of every pass is, the swapchain image or the scene color
+			VkFormat colorAttachmentFormat() { return postProcess ? SceneColorFormat : swapchainColorFormat; }
+			VkImageLayout colorFinalLayout() { return postProcess ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+			VkImageView colorAttachmentView(size_t ImageIndex) { return postProcess ? sceneColorImageViews[ImageIndex] : swapchainImageViews[ImageIndex]; }
 			VkExtent2D chooseSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 			VkSwapchainKHR swapchain;
@@ -53,13 +108,35 @@ namespace Engine
 			std::vector<VkImage> swapchainImages;
 			std::vector<VkImageView> swapchainImageViews;
 			std::vector<VkFramebuffer> framebuffers;
+			VkFramebuffer depthFramebuffer;
+			std::vector<VkFramebuffer> deferredFramebuffers;
 
 			VkImage DepthImage;
 			VkDeviceMemory DepthImageMemory;
 			VkImageView DepthImageView;
+			VkFormat DepthFormat;
+			bool keepDepth;
+
+			// Transient, backed by lazily allocated memory where there is some
+			VkImage AlbedoImage;
+			VkDeviceMemory AlbedoImageMemory;
+			VkImageView AlbedoImageView = VK_NULL_HANDLE;
+			VkImage NormalImage;
+			VkDeviceMemory NormalImageMemory;
+			VkImageView NormalImageView = VK_NULL_HANDLE;
+			bool deferred;
+			uint32_t version;
+
+			static constexpr VkFormat SceneColorFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+			std::vector<VkImage> sceneColorImages;
+			std::vector<VkDeviceMemory> sceneColorImagesMemory;
+			std::vector<VkImageView> sceneColorImageViews;
+			bool postProcess;
 
 			std::vector<VkSemaphore> imageAvailableSemaphores;
 			std::vector<VkSemaphore> renderFinishedSemaphores;
+			// Graphics to compute, only for async post processing
+			std::vector<VkSemaphore> sceneReadySemaphores;
 			std::vector<VkFence> inFlightFences;
 
 			size_t currentFrame = 0;
@@ -69,6 +146,10 @@ namespace Engine
 			VkExtent2D swapchainExtent;
 
 			VkRenderPass _renderPass;
+			VkRenderPass _resumeRenderPass = VK_NULL_HANDLE;
+			VkRenderPass _depthPrepassRenderPass;
+			VkRenderPass _prepassedRenderPass;
+			VkRenderPass _deferredRenderPass = VK_NULL_HANDLE;
 
 			VkExtent2D windowExtent;
 			Device& device;
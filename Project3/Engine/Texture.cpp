@@ -0,0 +1,260 @@
+#include "Texture.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <cassert>
+
+namespace Engine {
+	bool Texture::SupportsBlitMipmaps(Device& dev, VkFormat format) {
+		VkFormatProperties FormatProperties = dev.GetFormatProperties(format);
+		return (FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) &&
+			(FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) &&
+			(FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+	}
+
+	Texture::Texture(Device& dev, const TextureData& data, uint32_t firstLevel) :
+		format{ data.format },
+		extent{ data.levels[firstLevel].width, data.levels[firstLevel].height },
+		mipLevels{ data.mipLevels - firstLevel },
+		firstLevel{ firstLevel },
+		device{ dev } {
+		assert((firstLevel == 0 || !data.generateMips) && "streamed textures need their whole mip chain on the CPU");
+
+		if (!device.isSampledFormatSupported(format)) {
+			throw std::runtime_error("texture format is not supported by the device");
+		}
+
+		VkImageUsageFlags Usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		if (data.generateMips) {
+			Usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+
+		device.createImage(
+			image,
+			extent,
+			mipLevels,
+			VK_IMAGE_TILING_OPTIMAL,
+			format,
+			static_cast<VkDeviceSize>(data.ByteSize() - UploadOffset(data, firstLevel)),
+			Usage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			imageMemory
+		);
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device.device(), image, &memRequirements);
+		memorySize = memRequirements.size;
+
+		createImageView();
+	}
+
+	Texture::~Texture() {
+		vkDestroyImageView(device.device(), imageView, nullptr);
+		vkDestroyImage(device.device(), image, nullptr);
+		vkFreeMemory(device.device(), imageMemory, nullptr);
+	}
+
+	std::unique_ptr<Texture> Texture::CreateImmediate(Device& dev, const TextureData& data) {
+		auto texture = std::make_unique<Texture>(dev, data);
+		VkDeviceSize Size = static_cast<VkDeviceSize>(data.ByteSize());
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		dev.createBuffer(
+			stagingBuffer,
+			Size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBufferMemory
+		);
+
+		void* mapped;
+		vkMapMemory(dev.device(), stagingBufferMemory, 0, Size, 0, &mapped);
+		memcpy(mapped, data.Bytes(), static_cast<size_t>(Size));
+		vkUnmapMemory(dev.device(), stagingBufferMemory);
+
+		auto CommandBuffer = dev.StartOneTimeCommand();
+		texture->RecordUpload(CommandBuffer, stagingBuffer, data);
+		dev.EndOneTimeCommand(CommandBuffer);
+
+		vkDestroyBuffer(dev.device(), stagingBuffer, nullptr);
+		vkFreeMemory(dev.device(), stagingBufferMemory, nullptr);
+
+		return texture;
+	}
+
+	void Texture::RecordUpload(VkCommandBuffer CommandBuffer, VkBuffer stagingBuffer, const TextureData& data) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = image;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(CommandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+
+		// The staging buffer starts at firstLevel, levels are stored largest first
+		VkDeviceSize BaseOffset = UploadOffset(data, firstLevel);
+		std::vector<VkBufferImageCopy> regions(data.levels.size() - firstLevel);
+		for (uint32_t level = 0; level < regions.size(); level++) {
+			const TextureData::Level& source = data.levels[firstLevel + level];
+
+			regions[level] = {};
+			regions[level].bufferOffset = source.offset - BaseOffset;
+			regions[level].bufferRowLength = 0;
+			regions[level].bufferImageHeight = 0;
+			regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			regions[level].imageSubresource.mipLevel = level;
+			regions[level].imageSubresource.baseArrayLayer = 0;
+			regions[level].imageSubresource.layerCount = 1;
+			regions[level].imageOffset = { 0, 0, 0 };
+			regions[level].imageExtent = { source.width, source.height, 1 };
+		}
+
+		vkCmdCopyBufferToImage(
+			CommandBuffer,
+			stagingBuffer,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()),
+			regions.data()
+		);
+
+		if (data.generateMips) {
+			// Leaves every level in SHADER_READ_ONLY_OPTIMAL
+			recordMipmapBlits(CommandBuffer);
+			return;
+		}
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
+	void Texture::recordMipmapBlits(VkCommandBuffer CommandBuffer) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = image;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = 1;
+
+		int32_t mipWidth = static_cast<int32_t>(extent.width);
+		int32_t mipHeight = static_cast<int32_t>(extent.height);
+
+		for (uint32_t i = 1; i < mipLevels; i++) {
+			// Level i - 1 was written (copy or blit), make it a blit source
+			barrier.subresourceRange.baseMipLevel = i - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			vkCmdPipelineBarrier(CommandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+
+			VkImageBlit blit{};
+			blit.srcOffsets[0] = { 0, 0, 0 };
+			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.dstOffsets[0] = { 0, 0, 0 };
+			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+
+			vkCmdBlitImage(CommandBuffer,
+				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit,
+				VK_FILTER_LINEAR
+			);
+
+			// Level i - 1 is done
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(CommandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+
+			if (mipWidth > 1) mipWidth /= 2;
+			if (mipHeight > 1) mipHeight /= 2;
+		}
+
+		// The last level was only ever a blit destination
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+	}
+
+	void Texture::createImageView() {
+		VkImageViewCreateInfo ViewInfo{};
+		ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		ViewInfo.image = image;
+		ViewInfo.format = format;
+		ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+		ViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		ViewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+		ViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		ViewInfo.subresourceRange.baseArrayLayer = 0;
+		ViewInfo.subresourceRange.layerCount = 1;
+		ViewInfo.subresourceRange.baseMipLevel = 0;
+		ViewInfo.subresourceRange.levelCount = mipLevels;
+
+		if (vkCreateImageView(device.device(), &ViewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create an image view for texture");
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Device.h"
+#include "TextureData.h"
+
+//std
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace Engine
+{
+	class Texture
+	{
+		public:
+			// firstLevel > 0 creates the image with only levels [firstLevel, mipLevels) of data, used by texture streaming
+			Texture(Device& dev, const TextureData& data, uint32_t firstLevel = 0);
+			~Texture();
+
+			Texture(const Texture&) = delete;
+			Texture& operator=(const Texture&) = delete;
+
+			// Creates the texture and uploads it right away (waits for the graphics queue)
+			static std::unique_ptr<Texture> CreateImmediate(Device& dev, const TextureData& data);
+			// Linear filtered blits need format support, otherwise the chain has to be built on the CPU
+			static bool SupportsBlitMipmaps(Device& dev, VkFormat format);
+
+			// Copies stagingBuffer (holding data.bytes from UploadOffset() on) into the image and leaves every level in SHADER_READ_ONLY_OPTIMAL
+			void RecordUpload(VkCommandBuffer CommandBuffer, VkBuffer stagingBuffer, const TextureData& data);
+			static VkDeviceSize UploadOffset(const TextureData& data, uint32_t firstLevel) { return data.levels[firstLevel].offset; }
+
+			VkImage Image() { return image; }
+			VkImageView ImageView() { return imageView; }
+			VkFormat Format() { return format; }
+			VkExtent2D Extent() { return extent; }
+			uint32_t MipLevels() { return mipLevels; }
+			uint32_t FirstLevel() { return firstLevel; }
+			VkDeviceSize MemorySize() { return memorySize; }
+
+		private:
+			void createImageView();
+			void recordMipmapBlits(VkCommandBuffer CommandBuffer);
+
+			VkImage image;
+			VkDeviceMemory imageMemory;
+			VkImageView imageView;
+
+			VkFormat format;
+			VkExtent2D extent;
+			uint32_t mipLevels;
+			uint32_t firstLevel;
+			VkDeviceSize memorySize;
+
+			Device& device;
+	};
+}
@@ -0,0 +1,358 @@
+#include "TextureCache.h"
+#include "AssetArchive.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+
+namespace Engine {
+	TextureCache::TextureCache(Device& device, uint32_t workerCount) : device{ device }, workers{ workerCount } {
+		gpuMipmaps = Texture::SupportsBlitMipmaps(device, VK_FORMAT_R8G8B8A8_SRGB);
+		placeholder = Texture::CreateImmediate(device, SolidColorTextureData(128, 128, 128, 255));
+	}
+
+	TextureCache::~TextureCache() {
+		vkDeviceWaitIdle(device.device());
+
+		for (auto& upload : pendingUploads) {
+			retireUpload(upload);
+		}
+		retiredTextures.clear();
+
+		for (auto& sampler : samplers) {
+			vkDestroySampler(device.device(), sampler.second, nullptr);
+		}
+	}
+
+	CachedTexture* TextureCache::Load(const std::string& FilePath) {
+		auto found = entries.find(FilePath);
+		if (found != entries.end()) {
+			return found->second.get();
+		}
+
+		auto entry = std::make_unique<CachedTexture>();
+		entry->path = FilePath;
+		CachedTexture* pEntry = entry.get();
+		entries.emplace(FilePath, std::move(entry));
+
+		// Streaming uploads single levels from the CPU so the whole chain has to be built there
+		bool blitMips = gpuMipmaps && !streaming;
+		const ArchiveEntry* packed = archive ? archive->Find(FilePath, AssetType::Texture) : nullptr;
+		workers.Submit([this, pEntry, blitMips, packed]() {
+			try
+			{
+				// Packed textures already hold their whole mip chain, only the level table is read here
+				auto data = std::make_shared<TextureData>(packed ? archive->Texture(*packed) : LoadTextureData(pEntry->path, blitMips));
+
+				std::lock_guard<std::mutex> lock(decodedMutex);
+				decoded.push_back({ pEntry, std::move(data) });
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << std::endl;
+				pEntry->state = CachedTexture::State::Failed;
+			}
+		});
+
+		return pEntry;
+	}
+
+	void TextureCache::EnableStreaming(VkDeviceSize budget) {
+		assert(entries.empty() && "streaming has to be enabled before any texture is loaded");
+
+		streaming = true;
+		memoryBudget = budget;
+	}
+
+	void TextureCache::RequestDetail(CachedTexture* texture, float screenSize) {
+		if (!streaming || texture->source == nullptr) {
+			return;
+		}
+
+		// One texel per covered pixel: every halving of the screen size drops a level
+		const TextureData& data = *texture->source;
+		float texels = static_cast<float>(std::max(data.width, data.height));
+		float mip = std::floor(std::log2(texels / std::max(screenSize, 1.0f)));
+		uint32_t wanted = static_cast<uint32_t>(std::clamp(mip, 0.0f, static_cast<float>(texture->tailMip)));
+
+		if (texture->lastUsedFrame != frameIndex) {
+			texture->requestedMip = wanted;
+		}
+		else {
+			texture->requestedMip = std::min(texture->requestedMip, wanted);
+		}
+		texture->lastUsedFrame = frameIndex;
+	}
+
+	void TextureCache::Update() {
+		std::vector<DecodedTexture> ready;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			ready.swap(decoded);
+		}
+
+		for (auto& decodedTexture : ready) {
+			try
+			{
+				CachedTexture* entry = decodedTexture.entry;
+				uint32_t firstLevel = 0;
+
+				if (streaming) {
+					// Start with only the tail resident, RequestDetail pulls in the rest
+					const TextureData& data = *decodedTexture.data;
+					entry->tailMip = data.mipLevels - 1;
+					while (entry->tailMip > 0 && std::max(data.levels[entry->tailMip - 1].width, data.levels[entry->tailMip - 1].height) <= StreamingTailSize) {
+						entry->tailMip--;
+					}
+					entry->requestedMip = entry->tailMip;
+					entry->source = decodedTexture.data;
+					firstLevel = entry->tailMip;
+				}
+
+				startUpload(entry, decodedTexture.data, firstLevel);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << decodedTexture.entry->path << ": " << e.what() << std::endl;
+				decodedTexture.entry->state = CachedTexture::State::Failed;
+			}
+		}
+
+		for (size_t i = 0; i < pendingUploads.size();) {
+			if (vkGetFenceStatus(device.device(), pendingUploads[i].fence) == VK_SUCCESS) {
+				auto& upload = pendingUploads[i];
+				CachedTexture* entry = upload.entry;
+
+				residentMemory += upload.texture->MemorySize();
+				if (entry->texture) {
+					residentMemory -= entry->texture->MemorySize();
+					retiredTextures.push_back({ std::move(entry->texture), frameIndex });
+				}
+
+				entry->texture = std::move(upload.texture);
+				entry->version++;
+				entry->state = CachedTexture::State::Resident;
+
+				retireUpload(upload);
+				pendingUploads[i] = std::move(pendingUploads.back());
+				pendingUploads.pop_back();
+			}
+			else {
+				i++;
+			}
+		}
+
+		// Old images are only destroyed once every frame that could have bound them has finished
+		retiredTextures.erase(
+			std::remove_if(retiredTextures.begin(), retiredTextures.end(), [this](const RetiredTexture& retired) {
+				return retired.retiredFrame + MAX_FRAME_IN_FLIGHT < frameIndex;
+			}),
+			retiredTextures.end()
+		);
+
+		if (streaming) {
+			updateStreaming();
+		}
+
+		frameIndex++;
+	}
+
+	VkDeviceSize TextureCache::estimateMemory(const TextureData& data, uint32_t firstLevel) {
+		return static_cast<VkDeviceSize>(data.ByteSize() - data.levels[firstLevel].offset);
+	}
+
+	void TextureCache::updateStreaming() {
+		std::vector<CachedTexture*> resident;
+		for (auto& entry : entries) {
+			if (entry.second->state == CachedTexture::State::Resident && entry.second->source) {
+				resident.push_back(entry.second.get());
+			}
+		}
+
+		// Evict: least recently used first, textures out of view for a while go straight to their tail
+		std::sort(resident.begin(), resident.end(), [](CachedTexture* a, CachedTexture* b) { return a->lastUsedFrame < b->lastUsedFrame; });
+
+		VkDeviceSize projected = residentMemory;
+		for (CachedTexture* entry : resident) {
+			if (projected <= memoryBudget) {
+				break;
+			}
+			if (entry->ResidentMip() >= entry->tailMip) {
+				continue;
+			}
+
+			uint32_t current = entry->ResidentMip();
+			uint32_t target = entry->lastUsedFrame + EvictAfterFrames < frameIndex ? entry->tailMip : current + 1;
+			if (entry->lastUsedFrame == frameIndex && entry->requestedMip >= target) {
+				// Still visible and asking for more than we'd drop to, try older textures first
+				continue;
+			}
+
+			projected -= entry->texture->MemorySize() - std::min(entry->texture->MemorySize(), estimateMemory(*entry->source, target));
+			startUpload(entry, entry->source, target);
+		}
+
+		// Still over budget with only visible textures left: take a level from the least recently used ones anyway
+		for (CachedTexture* entry : resident) {
+			if (projected <= memoryBudget) {
+				break;
+			}
+			if (entry->state != CachedTexture::State::Resident || entry->ResidentMip() >= entry->tailMip) {
+				continue;
+			}
+
+			uint32_t target = entry->ResidentMip() + 1;
+			projected -= entry->texture->MemorySize() - std::min(entry->texture->MemorySize(), estimateMemory(*entry->source, target));
+			startUpload(entry, entry->source, target);
+		}
+
+		// Promote visible textures one level at a time, biggest deficit first, while the budget allows
+		std::vector<CachedTexture*> wanting;
+		for (CachedTexture* entry : resident) {
+			if (entry->state == CachedTexture::State::Resident && entry->lastUsedFrame == frameIndex && entry->requestedMip < entry->ResidentMip()) {
+				wanting.push_back(entry);
+			}
+		}
+		std::sort(wanting.begin(), wanting.end(), [](CachedTexture* a, CachedTexture* b) {
+			return a->ResidentMip() - a->requestedMip > b->ResidentMip() - b->requestedMip;
+		});
+
+		uint32_t uploads = 0;
+		for (CachedTexture* entry : wanting) {
+			if (uploads == MaxStreamingUploadsPerFrame) {
+				break;
+			}
+
+			uint32_t target = entry->ResidentMip() - 1;
+			VkDeviceSize growth = estimateMemory(*entry->source, target) - std::min(estimateMemory(*entry->source, target), entry->texture->MemorySize());
+			if (projected + growth > memoryBudget) {
+				continue;
+			}
+
+			projected += growth;
+			startUpload(entry, entry->source, target);
+			uploads++;
+		}
+	}
+
+	void TextureCache::startUpload(CachedTexture* entry, std::shared_ptr<const TextureData> source, uint32_t firstLevel) {
+		const TextureData& data = *source;
+		VkDeviceSize Offset = Texture::UploadOffset(data, firstLevel);
+		VkDeviceSize Size = static_cast<VkDeviceSize>(data.ByteSize()) - Offset;
+
+		PendingUpload upload{};
+		upload.entry = entry;
+		upload.texture = std::make_unique<Texture>(device, data, firstLevel);
+		upload.source = std::move(source);
+
+		device.createBuffer(
+			upload.stagingBuffer,
+			Size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			upload.stagingBufferMemory
+		);
+
+		void* mapped;
+		vkMapMemory(device.device(), upload.stagingBufferMemory, 0, Size, 0, &mapped);
+		memcpy(mapped, data.Bytes() + Offset, static_cast<size_t>(Size));
+		vkUnmapMemory(device.device(), upload.stagingBufferMemory);
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.commandPool = device.CommandPool();
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+		if (vkAllocateCommandBuffers(device.device(), &allocInfo, &upload.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate texture upload command buffer");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(upload.commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording texture upload");
+		}
+
+		upload.texture->RecordUpload(upload.commandBuffer, upload.stagingBuffer, data);
+
+		if (vkEndCommandBuffer(upload.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to end recording texture upload");
+		}
+
+		VkFenceCreateInfo FenceInfo{};
+		FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(device.device(), &FenceInfo, nullptr, &upload.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture upload fence");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &upload.commandBuffer;
+
+		if (vkQueueSubmit(device.GraphicsQueue(), 1, &submitInfo, upload.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit texture upload");
+		}
+
+		// A resident texture keeps being sampled as-is until the new residency replaces it
+		upload.entry->state = CachedTexture::State::Uploading;
+		pendingUploads.push_back(std::move(upload));
+	}
+
+	void TextureCache::retireUpload(PendingUpload& upload) {
+		vkDestroyFence(device.device(), upload.fence, nullptr);
+		vkFreeCommandBuffers(device.device(), device.CommandPool(), 1, &upload.commandBuffer);
+		vkDestroyBuffer(device.device(), upload.stagingBuffer, nullptr);
+		vkFreeMemory(device.device(), upload.stagingBufferMemory, nullptr);
+	}
+
+	VkImageView TextureCache::GetImageView(const CachedTexture* texture) {
+		if (texture != nullptr && texture->texture) {
+			return texture->texture->ImageView();
+		}
+
+		return placeholder->ImageView();
+	}
+
+	VkSampler TextureCache::GetSampler(const SamplerDesc& desc) {
+		auto found = samplers.find(desc);
+		if (found != samplers.end()) {
+			return found->second;
+		}
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = desc.filter;
+		samplerInfo.minFilter = desc.filter;
+		samplerInfo.addressModeU = desc.addressMode;
+		samplerInfo.addressModeV = desc.addressMode;
+		samplerInfo.addressModeW = desc.addressMode;
+
+		samplerInfo.anisotropyEnable = desc.anisotropy ? VK_TRUE : VK_FALSE;
+		samplerInfo.maxAnisotropy = desc.anisotropy ? device.GetMaxAntisotropy() : 1.0f;
+
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+		samplerInfo.compareEnable = VK_FALSE;
+		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+
+		// Not clamped to a mip count so one sampler serves every texture
+		samplerInfo.mipmapMode = desc.filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.mipLodBias = 0.0f;
+
+		VkSampler sampler;
+		if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create texture sampler");
+		}
+
+		samplers.emplace(desc, sampler);
+		return sampler;
+	}
+}
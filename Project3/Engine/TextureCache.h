@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Device.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+//std
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+	class AssetArchive;
+
+	struct SamplerDesc {
+		VkFilter filter = VK_FILTER_LINEAR;
+		VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		bool anisotropy = true;
+
+		bool operator<(const SamplerDesc& other) const {
+			if (filter != other.filter) return filter < other.filter;
+			if (addressMode != other.addressMode) return addressMode < other.addressMode;
+			return anisotropy < other.anisotropy;
+		}
+	};
+
+	/*
+		One entry per file path. texture stays null until the upload finished on the GPU,
+		until then users get the cache's placeholder. version is bumped every time the image
+		behind the entry changes (first upload and every streaming residency change)
+		so descriptor sets know when to be rewritten.
+	*/
+	struct CachedTexture {
+		enum class State {
+			Decoding,
+			Uploading,
+			Resident,
+			Failed
+		};
+
+		std::string path;
+		std::atomic<State> state{ State::Decoding };
+		std::unique_ptr<Texture> texture;
+		uint32_t version = 0;
+
+		// Streaming only: the whole mip chain stays on the CPU, levels [tailMip, mipLevels) are always resident
+		std::shared_ptr<const TextureData> source;
+		uint32_t tailMip = 0;
+		uint32_t requestedMip = 0;
+		uint64_t lastUsedFrame = 0;
+
+		uint32_t ResidentMip() { return texture ? texture->FirstLevel() : UINT32_MAX; }
+	};
+
+	/*
+		Path keyed texture cache. Files are decoded on a thread pool, uploads are recorded and submitted
+		from Update() on the main thread without waiting for the queue, and retired once their fence signals.
+
+		With EnableStreaming() textures are streamed by mip level: the small tail mips are always resident,
+		finer levels are uploaded when RequestDetail() asks for them and the least recently used ones are
+		dropped again while the resident textures exceed the memory budget.
+	*/
+	class TextureCache
+	{
+		public:
+			TextureCache(Device& device, uint32_t workerCount = 0);
+			~TextureCache();
+
+			TextureCache(const TextureCache&) = delete;
+			TextureCache& operator=(const TextureCache&) = delete;
+
+			// Never blocks, the same path always returns the same entry
+			CachedTexture* Load(const std::string& FilePath);
+
+			// Paths found in the archive are read from its mapping instead of being decoded, the archive has to outlive the cache
+			void Mount(const AssetArchive& archive) { this->archive = &archive; }
+
+			// Call once per frame from the main thread: starts uploads for decoded files and retires finished ones
+			void Update();
+
+			// Must be called before the first Load(), budget is the device memory all textures may use together
+			void EnableStreaming(VkDeviceSize budget);
+			// Called every frame a texture is used, screenSize is how many pixels the textured object covers (see Camera::ProjectedSize)
+			void RequestDetail(CachedTexture* texture, float screenSize);
+			VkDeviceSize ResidentMemory() { return residentMemory; }
+
+			VkImageView GetImageView(const CachedTexture* texture);
+			VkSampler GetSampler(const SamplerDesc& desc = {});
+
+			Texture& Placeholder() { return *placeholder; }
+			ThreadPool& Workers() { return workers; }
+
+		private:
+			struct DecodedTexture {
+				CachedTexture* entry;
+				std::shared_ptr<TextureData> data;
+			};
+
+			struct PendingUpload {
+				CachedTexture* entry;
+				std::unique_ptr<Texture> texture;
+				std::shared_ptr<const TextureData> source;
+				VkCommandBuffer commandBuffer;
+				VkFence fence;
+				VkBuffer stagingBuffer;
+				VkDeviceMemory stagingBufferMemory;
+			};
+
+			struct RetiredTexture {
+				std::unique_ptr<Texture> texture;
+				uint64_t retiredFrame;
+			};
+
+			void startUpload(CachedTexture* entry, std::shared_ptr<const TextureData> data, uint32_t firstLevel);
+			void retireUpload(PendingUpload& upload);
+			void updateStreaming();
+			VkDeviceSize estimateMemory(const TextureData& data, uint32_t firstLevel);
+
+			// Below this size (in texels) mips are never streamed out
+			static constexpr uint32_t StreamingTailSize = 64;
+			static constexpr uint32_t MaxStreamingUploadsPerFrame = 4;
+			// Textures not requested for this many frames are dropped straight to their tail mips when over budget
+			static constexpr uint64_t EvictAfterFrames = 120;
+
+			std::unordered_map<std::string, std::unique_ptr<CachedTexture>> entries;
+			std::map<SamplerDesc, VkSampler> samplers;
+			std::unique_ptr<Texture> placeholder;
+
+			// Filled by the workers, drained by Update()
+			std::mutex decodedMutex;
+			std::vector<DecodedTexture> decoded;
+
+			std::vector<PendingUpload> pendingUploads;
+			// Replaced images can still be read by frames in flight
+			std::vector<RetiredTexture> retiredTextures;
+
+			bool gpuMipmaps;
+			const AssetArchive* archive = nullptr;
+
+			bool streaming = false;
+			VkDeviceSize memoryBudget = 0;
+			VkDeviceSize residentMemory = 0;
+			uint64_t frameIndex = 0;
+
+			Device& device;
+			ThreadPool workers;
+	};
+}
@@ -0,0 +1,132 @@
+#include "TextureData.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace Engine {
+	uint32_t MipLevelCount(uint32_t width, uint32_t height) {
+		return static_cast<uint32_t>(std::floor(std::log2(std::max(std::max(width, height), 1u)))) + 1;
+	}
+
+	static float SrgbToLinear(unsigned char value) {
+		float c = value / 255.0f;
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static unsigned char LinearToSrgb(float value) {
+		float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		return static_cast<unsigned char>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	void GenerateMipmapsCPU(TextureData& data) {
+		// Averaging is done in linear space since the texture is sampled as sRGB
+		std::array<float, 256> toLinear;
+		for (int i = 0; i < 256; i++) {
+			toLinear[i] = SrgbToLinear(static_cast<unsigned char>(i));
+		}
+
+		VkDeviceSize TotalSize = 0;
+		for (uint32_t level = 0, w = data.width, h = data.height; level < data.mipLevels; level++) {
+			TotalSize += static_cast<VkDeviceSize>(w) * h * 4;
+			w = std::max(w / 2, 1u);
+			h = std::max(h / 2, 1u);
+		}
+		data.bytes.resize(static_cast<size_t>(TotalSize));
+
+		for (uint32_t level = 1; level < data.mipLevels; level++) {
+			const TextureData::Level& source = data.levels[level - 1];
+
+			TextureData::Level mip{};
+			mip.offset = source.offset + source.size;
+			mip.width = std::max(source.width / 2, 1u);
+			mip.height = std::max(source.height / 2, 1u);
+			mip.size = static_cast<uint64_t>(mip.width) * mip.height * 4;
+
+			const unsigned char* src = data.bytes.data() + source.offset;
+			unsigned char* dst = data.bytes.data() + mip.offset;
+
+			// 2x2 box filter, odd edges clamp to the last texel
+			for (uint32_t y = 0; y < mip.height; y++) {
+				uint32_t y0 = std::min(y * 2, source.height - 1);
+				uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+				for (uint32_t x = 0; x < mip.width; x++) {
+					uint32_t x0 = std::min(x * 2, source.width - 1);
+					uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+
+					const unsigned char* p00 = src + (y0 * source.width + x0) * 4;
+					const unsigned char* p01 = src + (y0 * source.width + x1) * 4;
+					const unsigned char* p10 = src + (y1 * source.width + x0) * 4;
+					const unsigned char* p11 = src + (y1 * source.width + x1) * 4;
+					unsigned char* out = dst + (y * mip.width + x) * 4;
+
+					for (int c = 0; c < 3; c++) {
+						out[c] = LinearToSrgb((toLinear[p00[c]] + toLinear[p01[c]] + toLinear[p10[c]] + toLinear[p11[c]]) * 0.25f);
+					}
+					out[3] = static_cast<unsigned char>((p00[3] + p01[3] + p10[3] + p11[3] + 2) / 4);
+				}
+			}
+
+			data.levels.push_back(mip);
+		}
+	}
+
+	TextureData LoadTextureData(const std::string& FilePath, bool gpuMipmaps) {
+		TextureData data;
+
+		if (isKTX2File(FilePath)) {
+			// Compressed blocks can't be blitted, the mips come pre-built from the file
+			KTX2Texture ktx = LoadKTX2(FilePath);
+			data.format = ktx.format;
+			data.width = ktx.width;
+			data.height = ktx.height;
+			data.mipLevels = static_cast<uint32_t>(ktx.levels.size());
+			data.levels = std::move(ktx.levels);
+			data.bytes = std::move(ktx.data);
+			return data;
+		}
+
+		int Texwidth, TexHeight, TexChannel;
+		stbi_uc* pixels = stbi_load(FilePath.c_str(), &Texwidth, &TexHeight, &TexChannel, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load the texture pixels: " + FilePath);
+		}
+
+		data.format = VK_FORMAT_R8G8B8A8_SRGB;
+		data.width = static_cast<uint32_t>(Texwidth);
+		data.height = static_cast<uint32_t>(TexHeight);
+		data.mipLevels = MipLevelCount(data.width, data.height);
+		data.generateMips = gpuMipmaps;
+
+		TextureData::Level base{};
+		base.offset = 0;
+		base.size = static_cast<uint64_t>(Texwidth) * TexHeight * 4;
+		base.width = data.width;
+		base.height = data.height;
+		data.levels.push_back(base);
+
+		data.bytes.assign(pixels, pixels + base.size);
+		stbi_image_free(pixels);
+
+		if (!gpuMipmaps) {
+			GenerateMipmapsCPU(data);
+		}
+
+		return data;
+	}
+
+	TextureData SolidColorTextureData(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		TextureData data;
+		data.format = VK_FORMAT_R8G8B8A8_SRGB;
+		data.width = 1;
+		data.height = 1;
+		data.mipLevels = 1;
+		data.levels.push_back({ 0, 4, 1, 1 });
+		data.bytes = { r, g, b, a };
+		return data;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "KTX2.h"
+
+//std
+#include <vector>
+#include <string>
+
+namespace Engine
+{
+	/*
+		CPU side texture, every level present is tightly packed in bytes.
+		Produced by LoadTextureData, which is safe to call from worker threads (no Vulkan calls).
+	*/
+	struct TextureData {
+		using Level = KTX2Texture::Level;
+
+		VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;
+
+		// When set only levels[0] is in bytes and the rest of the chain is blitted on the GPU
+		bool generateMips = false;
+
+		std::vector<Level> levels;
+		std::vector<unsigned char> bytes;
+
+		// Set instead of bytes when the pixels live in memory owned by someone else (a mapped AssetArchive)
+		const unsigned char* mappedBytes = nullptr;
+		size_t mappedSize = 0;
+
+		const unsigned char* Bytes() const { return mappedBytes ? mappedBytes : bytes.data(); }
+		size_t ByteSize() const { return mappedBytes ? mappedSize : bytes.size(); }
+	};
+
+	// Decodes png/jpg/... through stb_image or reads a KTX2 container as-is. gpuMipmaps selects blitting over a CPU built chain
+	TextureData LoadTextureData(const std::string& FilePath, bool gpuMipmaps);
+	TextureData SolidColorTextureData(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+	uint32_t MipLevelCount(uint32_t width, uint32_t height);
+	// Appends levels 1..mipLevels-1 to an RGBA8 sRGB texture holding only level 0
+	void GenerateMipmapsCPU(TextureData& data);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace Engine {
+	ThreadPool::ThreadPool(uint32_t workerCount) {
+		if (workerCount == 0) {
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(jobsMutex);
+			stopping = true;
+		}
+		jobsAvailable.notify_all();
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> job) {
+		{
+			std::lock_guard<std::mutex> lock(jobsMutex);
+			jobs.push(std::move(job));
+		}
+		jobsAvailable.notify_one();
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job) {
+		if (count == 0) {
+			return;
+		}
+
+		// Shared so helpers that only get scheduled after the loop is done don't touch this stack frame
+		struct LoopState {
+			std::function<void(uint32_t)> job;
+			uint32_t count;
+			std::atomic<uint32_t> next{ 0 };
+			std::atomic<uint32_t> finished{ 0 };
+			std::mutex doneMutex;
+			std::condition_variable done;
+		};
+
+		auto state = std::make_shared<LoopState>();
+		state->job = job;
+		state->count = count;
+
+		auto worker = [state]() {
+			uint32_t completed = 0;
+			for (uint32_t i = state->next.fetch_add(1); i < state->count; i = state->next.fetch_add(1)) {
+				state->job(i);
+				completed++;
+			}
+
+			if (completed > 0 && state->finished.fetch_add(completed) + completed == state->count) {
+				std::lock_guard<std::mutex> lock(state->doneMutex);
+				state->done.notify_one();
+			}
+		};
+
+		uint32_t helpers = std::min(WorkerCount(), count - 1);
+		for (uint32_t i = 0; i < helpers; i++) {
+			Submit(worker);
+		}
+		worker();
+
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->done.wait(lock, [&]() { return state->finished.load() == count; });
+	}
+
+	void ThreadPool::WorkerLoop() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(jobsMutex);
+				jobsAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+				if (stopping && jobs.empty()) {
+					return;
+				}
+
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+
+			job();
+		}
+	}
+}
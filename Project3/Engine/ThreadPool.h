@@ -0,0 +1,41 @@
+#pragma once
+
+//std
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace Engine
+{
+	class ThreadPool
+	{
+		public:
+			// 0 picks hardware_concurrency - 1 (the main thread keeps one core)
+			ThreadPool(uint32_t workerCount = 0);
+			~ThreadPool();
+
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			void Submit(std::function<void()> job);
+
+			// Runs job(i) for i in [0, count) across the workers and the calling thread, returns when all are done
+			void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+
+			uint32_t WorkerCount() { return static_cast<uint32_t>(workers.size()); }
+
+		private:
+			void WorkerLoop();
+
+			std::vector<std::thread> workers;
+			std::queue<std::function<void()>> jobs;
+
+			std::mutex jobsMutex;
+			std::condition_variable jobsAvailable;
+			bool stopping = false;
+	};
+}
@@ -1,3 +0,0 @@
-C:\VulkanSDK\1.3.268.0\Bin\glslc.exe Triangle.vert -o Triangle.vert.spv
-C:\VulkanSDK\1.3.268.0\Bin\glslc.exe Triangle.frag -o Triangle.frag.spv
-pause
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 450
+
+layout(location = 0) out vec4 outColors;
+
+layout(binding = 0) uniform UniformBufferObject{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// What GBuffer.frag wrote in subpass 0, and its depth
+layout(input_attachment_index = 0, binding = 1) uniform subpassInput gbufferAlbedo;
+layout(input_attachment_index = 1, binding = 2) uniform subpassInput gbufferNormal;
+layout(input_attachment_index = 2, binding = 3) uniform subpassInput gbufferDepth;
+
+// Matches DeferredLightingSystem::PushConstants
+layout(push_constant) uniform Screen{
+	vec2 size;
+} screen;
+
+#include "Lighting.glsl"
+
+void main(){
+	vec4 albedo = subpassLoad(gbufferAlbedo);
+	vec4 encodedNormal = subpassLoad(gbufferNormal);
+
+	// Surfaces drawn without LIT keep their color
+	if (encodedNormal.a < 0.5f) {
+		outColors = vec4(albedo.rgb, 1.0f);
+		return;
+	}
+
+	/*
+		Undoes the perspective projection: its depth is (proj[2][2] * z + proj[3][2]) / -z, reverse Z's as well as the
+		finite one's. Vulkan's y points down like gl_FragCoord's, the flipped projection already matches them.
+	*/
+	float depth = ubo.proj[3][2] / (subpassLoad(gbufferDepth).r + ubo.proj[2][2]);
+	vec2 ndc = gl_FragCoord.xy / screen.size * 2.0f - 1.0f;
+	vec3 viewPosition = vec3(ndc * depth / vec2(ubo.proj[0][0], ubo.proj[1][1]), -depth);
+
+	// The view matrix only rotates and moves, its inverse is the transposed rotation
+	vec3 worldPosition = transpose(mat3(ubo.view)) * (viewPosition - ubo.view[3].xyz);
+
+	vec3 normal = normalize(encodedNormal.xyz * 2.0f - 1.0f);
+	outColors = vec4(albedo.rgb * Lighting(worldPosition, normal, depth), 1.0f);
+}
\ No newline at end of file
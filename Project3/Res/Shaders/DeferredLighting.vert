@@ -0,0 +1,10 @@
+#version 450
+
+// Device.h REVERSE_Z, the depth is cleared to 0 instead of 1
+layout(constant_id = 0) const bool REVERSE_Z = false;
+
+// One triangle covering the screen, at the clear depth so the depth test skips the pixels nothing was drawn on
+void main(){
+	vec2 corner = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(corner * 2.0f - 1.0f, REVERSE_Z ? 0.0f : 1.0f, 1.0f);
+}
\ No newline at end of file
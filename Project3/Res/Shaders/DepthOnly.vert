@@ -0,0 +1,28 @@
+#version 450
+
+// Depth prepass, same transform as Triangle.vert and VertexPulling.vert from Model's position buffer, no fragment stage
+
+layout(binding = 0) uniform UniformBufferObject{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// World matrices of every scene entity, written by Scene::Update
+layout(std430, binding = 3) readonly buffer ObjectMatrices{
+	mat4 world[];
+} objects;
+
+// Shares the push constant range with the color pass's vertex shaders
+layout(push_constant) uniform Object{
+	layout(offset = 32) uint index;
+	uint material;
+} object;
+
+layout(location = 0) in vec3 Position;
+
+invariant gl_Position;
+
+void main(){
+	vec4 world = objects.world[object.index] * vec4(Position, 1.0f);
+	gl_Position = ubo.proj * ubo.view * world;
+}
\ No newline at end of file
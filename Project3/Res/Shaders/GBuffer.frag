@@ -0,0 +1,56 @@
+#version 450
+
+// Triangle.frag without the lighting, which DeferredLighting.frag does once per pixel in the next subpass
+layout(location = 0) out vec4 outAlbedo;
+// World space normal scaled to 0..1, alpha is 1 when the surface is lit
+layout(location = 1) out vec4 outNormal;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 texCoords;
+layout(location = 2) flat in uint fragMaterial;
+layout(location = 3) in vec3 worldPosition;
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+// MaterialSystem::Features, set per pipeline by PipelineVariants so disabled features are compiled out
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+layout(constant_id = 3) const bool LIT = false;
+
+// Matches MaterialSystem::Material
+struct Material {
+	vec4 baseColor;
+	float alphaCutoff;
+	uint features;
+	uint padding0;
+	uint padding1;
+};
+
+// Every material's parameters, written by MaterialSystem::Update
+layout(std430, binding = 4) readonly buffer Materials{
+	Material materials[];
+} materialData;
+
+void main(){
+	Material material = materialData.materials[fragMaterial];
+	vec4 color = material.baseColor;
+
+	if (TEXTURED) {
+		color *= texture(texSampler, texCoords);
+	}
+
+	if (VERTEX_COLOR) {
+		color.rgb *= fragColor;
+	}
+
+	if (ALPHA_TEST && color.a < material.alphaCutoff) {
+		discard;
+	}
+
+	outAlbedo = vec4(color.rgb, 1.0f);
+
+	// Derivatives don't exist in the lighting subpass, the face normal is taken here
+	vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+	outNormal = vec4(normal * 0.5f + 0.5f, LIT ? 1.0f : 0.0f);
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 450
+
+layout(location = 0) out vec4 outColors;
+layout(location = 0) in vec2 texCoords;
+
+layout(binding = 1) uniform sampler2D atlas;
+
+void main(){
+	vec4 color = texture(atlas, texCoords);
+	// Alpha is the baked coverage
+	if (color.a < 0.5) {
+		discard;
+	}
+	outColors = vec4(color.rgb, 1.0);
+}
\ No newline at end of file
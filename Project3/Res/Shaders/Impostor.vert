@@ -0,0 +1,66 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// xyz world position of the model's origin, w uniform scale
+layout(std430, binding = 2) readonly buffer Instances{
+	vec4 positionScale[];
+} instances;
+
+layout(push_constant) uniform ImpostorParams{
+	vec4 boundsCenterRadius;
+	vec4 cameraPosition;
+	uint framesPerSide;
+} params;
+
+layout(location = 0) out vec2 outTexCoord;
+
+const vec2 Corners[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// Has to match OctahedralEncode / OctahedralDecode / ImpostorFrameBasis in Engine/ImpostorBaker.cpp
+float SignNotZero(float value) {
+	return value >= 0.0 ? 1.0 : -1.0;
+}
+
+vec2 OctahedralEncode(vec3 direction) {
+	vec2 p = direction.xz / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+	if (direction.y < 0.0) {
+		p = vec2((1.0 - abs(p.y)) * SignNotZero(p.x), (1.0 - abs(p.x)) * SignNotZero(p.y));
+	}
+	return p;
+}
+
+vec3 OctahedralDecode(vec2 p) {
+	vec3 direction = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+	if (direction.y < 0.0) {
+		direction.xz = vec2((1.0 - abs(p.y)) * SignNotZero(p.x), (1.0 - abs(p.x)) * SignNotZero(p.y));
+	}
+	return normalize(direction);
+}
+
+void main(){
+	vec4 instance = instances.positionScale[gl_InstanceIndex];
+	vec3 center = instance.xyz + params.boundsCenterRadius.xyz * instance.w;
+	float radius = params.boundsCenterRadius.w * instance.w;
+
+	// Frame baked closest to the direction the camera sees the instance from
+	float lastFrame = float(params.framesPerSide - 1);
+	vec2 frame = round((OctahedralEncode(normalize(params.cameraPosition.xyz - center)) * 0.5 + 0.5) * lastFrame);
+	vec3 direction = OctahedralDecode(frame / lastFrame * 2.0 - 1.0);
+
+	vec3 worldUp = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+	vec3 right = normalize(cross(worldUp, direction));
+	vec3 up = cross(direction, right);
+
+	vec2 corner = Corners[gl_VertexIndex];
+	vec3 Position = center + (right * corner.x + up * corner.y) * radius;
+
+	gl_Position = ubo.proj * ubo.view * vec4(Position, 1.0f);
+	outTexCoord = (frame + corner * 0.5 + 0.5) / float(params.framesPerSide);
+}
\ No newline at end of file
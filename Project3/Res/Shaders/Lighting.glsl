@@ -0,0 +1,104 @@
+// Sun and clustered lights, shared by Triangle.frag and DeferredLighting.frag. Fragment shaders only, the clusters are found from gl_FragCoord
+
+const float AMBIENT = 0.25f;
+
+// Has to match ClusteredLights::MaxLightsPerCluster
+const uint MaxLightsPerCluster = 128;
+const uint SPOT_LIGHT = 1;
+
+// ClusteredLights::Light
+struct Light {
+	vec3 position;
+	float range;
+	vec3 color;
+	float intensity;
+	vec3 direction;
+	float cosOuter;
+	float cosInner;
+	uint type;
+	uint padding0;
+	uint padding1;
+};
+
+// Written by ClusteredLights::Cull, the header is described in LightCull.comp
+layout(std430, binding = 5) readonly buffer Lights{
+	uvec4 grid;
+	vec4 projection;
+	vec4 slicing;
+	Light lights[];
+} lightData;
+
+layout(std430, binding = 6) readonly buffer Clusters{
+	uint clusterData[];
+};
+
+// Matches ShadowRenderSystem::ShadowUBO
+layout(binding = 7) uniform Shadows{
+	mat4 cascades[4];
+	vec4 splits;
+	vec4 sunDirection;
+} shadows;
+
+// One layer per cascade, compared against with LESS_OR_EQUAL
+layout(binding = 8) uniform sampler2DArrayShadow shadowMap;
+
+// 1 where the sun reaches, the first cascade reaching past depth is used and nothing is shadowed past the last
+float SunShadow(vec3 position, float depth) {
+	uint cascade = 0;
+	while (cascade < 4 && depth > shadows.splits[cascade]) {
+		cascade++;
+	}
+	if (cascade == 4) {
+		return 1.0f;
+	}
+
+	vec4 shadowPosition = shadows.cascades[cascade] * vec4(position, 1.0f);
+	vec2 uv = shadowPosition.xy * 0.5f + 0.5f;
+
+	// Four bilinear comparisons half a texel apart filter over 3x3 texels
+	vec2 texel = 1.0f / vec2(textureSize(shadowMap, 0).xy);
+	float lit = 0.0f;
+	for (int y = 0; y < 2; y++) {
+		for (int x = 0; x < 2; x++) {
+			vec2 offset = (vec2(x, y) - 0.5f) * texel;
+			lit += texture(shadowMap, vec4(uv + offset, float(cascade), shadowPosition.z));
+		}
+	}
+	return lit * 0.25f;
+}
+
+// Only the lights LightCull.comp listed for this fragment's cluster, depth is the fragment's view depth
+vec3 ClusteredLighting(vec3 position, vec3 normal, float depth) {
+	uvec3 grid = lightData.grid.xyz;
+	uint slice = uint(clamp(log(depth) * lightData.slicing.x - lightData.slicing.y, 0.0f, float(grid.z - 1)));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / lightData.slicing.zw * vec2(grid.xy)), grid.xy - 1);
+	uint cluster = tile.x + tile.y * grid.x + slice * grid.x * grid.y;
+
+	uint count = clusterData[cluster];
+	uint base = grid.x * grid.y * grid.z + cluster * MaxLightsPerCluster;
+
+	vec3 result = vec3(0.0f);
+	for (uint i = 0; i < count; i++) {
+		Light light = lightData.lights[clusterData[base + i]];
+		vec3 toLight = light.position - position;
+		float distance = length(toLight);
+		vec3 direction = toLight / max(distance, 1e-4f);
+
+		// Inverse square, windowed to reach 0 at the range the light was culled with
+		float window = clamp(1.0f - pow(distance / light.range, 4.0f), 0.0f, 1.0f);
+		float attenuation = window * window / max(distance * distance, 0.01f);
+		if (light.type == SPOT_LIGHT) {
+			attenuation *= smoothstep(light.cosOuter, light.cosInner, dot(-direction, light.direction));
+		}
+
+		result += light.color * light.intensity * attenuation * max(dot(normal, direction), 0.0f);
+	}
+
+	return result;
+}
+
+// What the surface's color is multiplied by, position in world space
+vec3 Lighting(vec3 position, vec3 normal, float depth) {
+	float sun = max(dot(normal, -shadows.sunDirection.xyz), 0.0f) * SunShadow(position, depth);
+	return AMBIENT + (1.0f - AMBIENT) * sun + ClusteredLighting(position, normal, depth);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+// Shared by the post processing compute shaders, the set and push constants of PostProcessor
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// What is read, the scene color or a bloom level
+layout(binding = 0) uniform sampler2D source;
+// The bloom for PostComposite.comp, the others get the source again
+layout(binding = 1) uniform sampler2D bloom;
+
+// PostProcessor::PushConstants
+layout(push_constant) uniform PostParams{
+	vec2 sourceTexel;
+	float bloomThreshold;
+	float bloomIntensity;
+	float exposure;
+	float sharpness;
+	uint prefilter;
+} params;
+
+float Luminance(vec3 color) {
+	return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 450
+
+// Shadow casters into one cascade of ShadowRenderSystem's map, from Model's position buffer, no fragment stage
+
+// World matrices of every scene entity, written by Scene::Update
+layout(std430, binding = 0) readonly buffer ObjectMatrices{
+	mat4 world[];
+} objects;
+
+// ShadowRenderSystem::PushConstants
+layout(push_constant) uniform Caster{
+	mat4 viewProj;
+	uint object;
+} caster;
+
+layout(location = 0) in vec3 Position;
+
+void main(){
+	gl_Position = caster.viewProj * objects.world[caster.object] * vec4(Position, 1.0f);
+}
\ No newline at end of file
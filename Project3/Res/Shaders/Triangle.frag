@@ -3,9 +3,59 @@
 layout(location = 0) out vec4 outColors;
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 texCoords;
+layout(location = 2) flat in uint fragMaterial;
+layout(location = 3) in vec3 worldPosition;
+
+layout(binding = 0) uniform UniformBufferObject{
+	mat4 view;
+	mat4 proj;
+} ubo;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
+// MaterialSystem::Features, set per pipeline by PipelineVariants so disabled features are compiled out
+layout(constant_id = 0) const bool TEXTURED = true;
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+layout(constant_id = 3) const bool LIT = false;
+
+// Matches MaterialSystem::Material
+struct Material {
+	vec4 baseColor;
+	float alphaCutoff;
+	uint features;
+	uint padding0;
+	uint padding1;
+};
+
+// Every material's parameters, written by MaterialSystem::Update
+layout(std430, binding = 4) readonly buffer Materials{
+	Material materials[];
+} materialData;
+
+#include "Lighting.glsl"
+
 void main(){
-	outColors = texture(texSampler, texCoords);
+	Material material = materialData.materials[fragMaterial];
+	vec4 color = material.baseColor;
+
+	if (TEXTURED) {
+		color *= texture(texSampler, texCoords);
+	}
+
+	if (VERTEX_COLOR) {
+		color.rgb *= fragColor;
+	}
+
+	if (ALPHA_TEST && color.a < material.alphaCutoff) {
+		discard;
+	}
+
+	if (LIT) {
+		vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+		float depth = -(ubo.view * vec4(worldPosition, 1.0f)).z;
+		color.rgb *= Lighting(worldPosition, normal, depth);
+	}
+
+	outColors = color;
 }
\ No newline at end of file
@@ -5,15 +5,34 @@ layout(binding = 0) uniform UniformBufferObject{
 	mat4 proj;
 } ubo;
 
+// World matrices of every scene entity, written by Scene::Update
+layout(std430, binding = 3) readonly buffer ObjectMatrices{
+	mat4 world[];
+} objects;
+
+// Shares the push constant range with VertexPulling.vert, the vertex layout occupies the first 32 bytes
+layout(push_constant) uniform Object{
+	layout(offset = 32) uint index;
+	uint material;
+} object;
+
 layout(location = 0) in vec3 Position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec2 inTexCoord;
 
 layout (location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) flat out uint fragMaterial;
+layout(location = 3) out vec3 worldPosition;
+
+// Computed exactly like DepthOnly.vert does, the color pass tests the depth prepass's depth for equality
+invariant gl_Position;
 
 void main(){
-	gl_Position = ubo.proj * ubo.view * vec4(Position, 1.0f);
+	vec4 world = objects.world[object.index] * vec4(Position, 1.0f);
+	gl_Position = ubo.proj * ubo.view * world;
+	worldPosition = world.xyz;
 	fragColor = color;
 	outTexCoord = inTexCoord;
+	fragMaterial = object.material;
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject{
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// Raw vertex words, the layout is described by the push constants below
+layout(std430, binding = 2) readonly buffer VertexData{
+	uint words[];
+} vertexData;
+
+// World matrices of every scene entity, written by Scene::Update
+layout(std430, binding = 3) readonly buffer ObjectMatrices{
+	mat4 world[];
+} objects;
+
+const uint COLOR_UNORM8 = 1;
+const uint TEXCOORD_HALF = 2;
+
+layout(push_constant) uniform VertexLayout{
+	uint stride;
+	uint positionOffset;
+	uint colorOffset;
+	uint texCoordOffset;
+	uint flags;
+	layout(offset = 32) uint object;	// index into objects.world, where ObjectPushConstants puts it
+	uint material;	// index into the fragment shader's materials
+} vertexLayout;
+
+layout (location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) flat out uint fragMaterial;
+layout(location = 3) out vec3 worldPosition;
+
+// Computed exactly like DepthOnly.vert does, the color pass tests the depth prepass's depth for equality
+invariant gl_Position;
+
+float FetchFloat(uint base, uint offset) {
+	return uintBitsToFloat(vertexData.words[base + offset]);
+}
+
+void main(){
+	uint base = uint(gl_VertexIndex) * vertexLayout.stride;
+
+	vec3 Position = vec3(
+		FetchFloat(base, vertexLayout.positionOffset),
+		FetchFloat(base, vertexLayout.positionOffset + 1),
+		FetchFloat(base, vertexLayout.positionOffset + 2)
+	);
+
+	vec3 color;
+	if ((vertexLayout.flags & COLOR_UNORM8) != 0) {
+		color = unpackUnorm4x8(vertexData.words[base + vertexLayout.colorOffset]).rgb;
+	}
+	else {
+		color = vec3(
+			FetchFloat(base, vertexLayout.colorOffset),
+			FetchFloat(base, vertexLayout.colorOffset + 1),
+			FetchFloat(base, vertexLayout.colorOffset + 2)
+		);
+	}
+
+	vec2 texCoord;
+	if ((vertexLayout.flags & TEXCOORD_HALF) != 0) {
+		texCoord = unpackHalf2x16(vertexData.words[base + vertexLayout.texCoordOffset]);
+	}
+	else {
+		texCoord = vec2(
+			FetchFloat(base, vertexLayout.texCoordOffset),
+			FetchFloat(base, vertexLayout.texCoordOffset + 1)
+		);
+	}
+
+	vec4 world = objects.world[vertexLayout.object] * vec4(Position, 1.0f);
+	gl_Position = ubo.proj * ubo.view * world;
+	worldPosition = world.xyz;
+	fragColor = color;
+	outTexCoord = texCoord;
+	fragMaterial = vertexLayout.material;
+}
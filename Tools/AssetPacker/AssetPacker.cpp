@@ -0,0 +1,310 @@
+/*
+	Offline asset packer: meshes, textures and SPIR-V -> one .vkpa archive the engine memory maps at startup
+
+	Usage:
+		AssetPacker <output.vkpa> <root directory> <file or directory>...
+
+		Directories are packed recursively. Entries are named by their path relative to the root with '/'
+		separators (e.g. "Res/Textures/brick.png"), which is what Engine::AssetArchive::Find matches the
+		engine's paths against.
+
+		.obj .gltf .glb                        - imported through Engine::ImportMesh, reordered by Engine::OptimizeMesh, given
+		                                         a LOD chain by Engine::GenerateLods and LOD 0 split by Engine::BuildMeshlets,
+		                                         stored as Model::Vertex + uint32 indices
+		.png .jpg .jpeg .tga .bmp .psd .ktx2   - decoded with their full mip chain (KTX2 blocks are kept as-is)
+		.spv                                   - SPIR-V, stored as-is
+
+	Mesh blobs depend on the layout of Model::Vertex, archives have to be repacked when it changes.
+*/
+
+#include "../../Project3/Engine/AssetArchive.h"
+#include "../../Project3/Engine/MeshImporter.h"
+#include "../../Project3/Engine/MeshOptimizer.h"
+#include "../../Project3/Engine/MeshSimplifier.h"
+#include "../../Project3/Engine/MeshletBuilder.h"
+#include "../../Project3/Engine/TextureData.h"
+#include "../../Project3/Engine/ThreadPool.h"
+
+//std
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+struct PackedAsset {
+	fs::path path;
+	std::string name;
+	Engine::AssetType type;
+
+	std::vector<char> blob;
+	std::string error;
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+template<typename T>
+static void WriteAt(std::vector<char>& blob, uint64_t offset, const T* values, size_t count) {
+	memcpy(blob.data() + offset, values, sizeof(T) * count);
+}
+
+static bool AssetTypeOf(const fs::path& path, Engine::AssetType& type) {
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	if (extension == ".obj" || extension == ".gltf" || extension == ".glb") {
+		type = Engine::AssetType::Mesh;
+	}
+	else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp" || extension == ".psd" || extension == ".ktx2") {
+		type = Engine::AssetType::Texture;
+	}
+	else if (extension == ".spv") {
+		type = Engine::AssetType::Shader;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+// Inside the root the texture is referenced by its entry name so it resolves from the archive, otherwise by its file path
+static std::string TextureReference(const std::string& texturePath, const fs::path& root) {
+	if (texturePath.empty()) {
+		return {};
+	}
+
+	fs::path relative = fs::path(texturePath).lexically_normal().lexically_relative(root);
+	if (relative.empty() || *relative.begin() == "..") {
+		return texturePath;
+	}
+	return relative.generic_string();
+}
+
+static std::vector<char> PackMesh(const PackedAsset& asset, const fs::path& root, Engine::ThreadPool& workers) {
+	Engine::ImportStats stats;
+	Engine::MeshData mesh = Engine::ImportMesh(asset.path.string(), workers, &stats);
+	Engine::MeshOptimizationStats optimization = Engine::OptimizeMesh(mesh.vertices, mesh.indices);
+	std::vector<Engine::Model::Lod> lods = Engine::GenerateLods(mesh.vertices, mesh.indices);
+	std::vector<Engine::Model::Meshlet> meshlets = Engine::BuildMeshlets(mesh.vertices, mesh.indices, lods[0].indexCount);
+	std::string texture = TextureReference(mesh.texturePath, root);
+
+	Engine::MeshBlobHeader header{};
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.vertexStride = sizeof(Engine::Model::Vertex);
+	header.textureNameLength = static_cast<uint32_t>(texture.size());
+	header.lodCount = static_cast<uint32_t>(lods.size());
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+	header.verticesOffset = Engine::ArchiveBlobAlignment;
+	header.indicesOffset = AlignUp(header.verticesOffset + sizeof(Engine::Model::Vertex) * mesh.vertices.size(), 16);
+	header.lodsOffset = header.indicesOffset + sizeof(uint32_t) * mesh.indices.size();
+	header.meshletsOffset = AlignUp(header.lodsOffset + sizeof(Engine::Model::Lod) * lods.size(), 16);
+	header.textureNameOffset = header.meshletsOffset + sizeof(Engine::Model::Meshlet) * meshlets.size();
+
+	std::vector<char> blob(static_cast<size_t>(header.textureNameOffset + texture.size()), 0);
+	WriteAt(blob, 0, &header, 1);
+	WriteAt(blob, header.verticesOffset, mesh.vertices.data(), mesh.vertices.size());
+	WriteAt(blob, header.indicesOffset, mesh.indices.data(), mesh.indices.size());
+	WriteAt(blob, header.lodsOffset, lods.data(), lods.size());
+	WriteAt(blob, header.meshletsOffset, meshlets.data(), meshlets.size());
+	WriteAt(blob, header.textureNameOffset, texture.data(), texture.size());
+
+	std::cout << "  " << asset.name << ": " << stats.triangles << " triangles, " << mesh.vertices.size() << " vertices, ACMR "
+		<< optimization.before.acmr << " -> " << optimization.after.acmr << ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr << ", " << lods.size() << " LODs down to " << lods.back().indexCount / 3 << " triangles, " << meshlets.size() << " meshlets" << std::endl;
+	return blob;
+}
+
+static std::vector<char> PackTexture(const PackedAsset& asset) {
+	// The whole chain is built here so the engine never decodes or blits at load time
+	Engine::TextureData data = Engine::LoadTextureData(asset.path.string(), false);
+
+	Engine::TextureBlobHeader header{};
+	header.format = data.format;
+	header.width = data.width;
+	header.height = data.height;
+	header.levelCount = static_cast<uint32_t>(data.levels.size());
+	header.levelsOffset = sizeof(Engine::TextureBlobHeader);
+	header.dataOffset = AlignUp(header.levelsOffset + sizeof(Engine::TextureData::Level) * data.levels.size(), Engine::ArchiveBlobAlignment);
+	header.dataSize = data.ByteSize();
+
+	std::vector<char> blob(static_cast<size_t>(header.dataOffset + header.dataSize), 0);
+	WriteAt(blob, 0, &header, 1);
+	WriteAt(blob, header.levelsOffset, data.levels.data(), data.levels.size());
+	WriteAt(blob, header.dataOffset, data.Bytes(), data.ByteSize());
+
+	std::cout << "  " << asset.name << ": " << data.width << "x" << data.height << ", " << data.levels.size() << " levels" << std::endl;
+	return blob;
+}
+
+static std::vector<char> PackShader(const PackedAsset& asset) {
+	std::ifstream file{ asset.path, std::ios::ate | std::ios::binary };
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + asset.path.string());
+	}
+
+	std::vector<char> blob(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(blob.data(), blob.size());
+
+	const uint32_t SpirvMagic = 0x07230203;
+	uint32_t magic = 0;
+	if (blob.size() >= 4) {
+		memcpy(&magic, blob.data(), 4);
+	}
+	if (blob.size() % 4 != 0 || magic != SpirvMagic) {
+		throw std::runtime_error(asset.path.string() + " is not SPIR-V");
+	}
+
+	return blob;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		std::cerr << "usage: AssetPacker <output.vkpa> <root directory> <file or directory>..." << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	fs::path output = argv[1];
+	fs::path root = fs::absolute(argv[2]).lexically_normal();
+
+	std::vector<PackedAsset> assets;
+	auto addFile = [&](const fs::path& file) {
+		PackedAsset asset;
+		if (!AssetTypeOf(file, asset.type)) {
+			return;
+		}
+
+		asset.path = fs::absolute(file).lexically_normal();
+		asset.name = asset.path.lexically_relative(root).generic_string();
+		if (asset.name.empty() || asset.name.compare(0, 2, "..") == 0) {
+			std::cerr << "skipping " << file.string() << ": not inside the root directory" << std::endl;
+			return;
+		}
+		assets.push_back(std::move(asset));
+	};
+
+	for (int i = 3; i < argc; i++) {
+		fs::path input = argv[i];
+		if (fs::is_directory(input)) {
+			for (const auto& file : fs::recursive_directory_iterator(input)) {
+				if (file.is_regular_file()) {
+					addFile(file.path());
+				}
+			}
+		}
+		else if (fs::is_regular_file(input)) {
+			addFile(input);
+		}
+		else {
+			std::cerr << "no such file or directory: " << input.string() << std::endl;
+			return 1;
+		}
+	}
+
+	// Stable output for the same inputs
+	std::sort(assets.begin(), assets.end(), [](const PackedAsset& a, const PackedAsset& b) {
+		return a.type != b.type ? a.type < b.type : a.name < b.name;
+	});
+	assets.erase(std::unique(assets.begin(), assets.end(), [](const PackedAsset& a, const PackedAsset& b) {
+		return a.type == b.type && a.name == b.name;
+	}), assets.end());
+
+	if (assets.empty()) {
+		std::cerr << "nothing to pack" << std::endl;
+		return 1;
+	}
+
+	Engine::ThreadPool workers;
+	workers.ParallelFor(static_cast<uint32_t>(assets.size()), [&](uint32_t i) {
+		PackedAsset& asset = assets[i];
+		try
+		{
+			switch (asset.type) {
+				case Engine::AssetType::Mesh: asset.blob = PackMesh(asset, root, workers); break;
+				case Engine::AssetType::Texture: asset.blob = PackTexture(asset); break;
+				case Engine::AssetType::Shader: asset.blob = PackShader(asset); break;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			asset.error = e.what();
+		}
+	});
+
+	for (const auto& asset : assets) {
+		if (!asset.error.empty()) {
+			std::cerr << asset.name << ": " << asset.error << std::endl;
+			return 1;
+		}
+	}
+
+	// Layout: header, 64 byte aligned blobs, entry table, names
+	std::vector<Engine::ArchiveEntry> entries;
+	std::string names;
+	uint64_t offset = Engine::ArchiveBlobAlignment;
+	for (const auto& asset : assets) {
+		Engine::ArchiveEntry entry{};
+		entry.type = asset.type;
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(asset.name.size());
+		entry.offset = offset;
+		entry.size = asset.blob.size();
+		entries.push_back(entry);
+
+		names += asset.name;
+		offset = AlignUp(offset + asset.blob.size(), Engine::ArchiveBlobAlignment);
+	}
+
+	Engine::ArchiveHeader header{};
+	memcpy(header.magic, Engine::ArchiveMagic, sizeof(header.magic));
+	header.version = Engine::ArchiveVersion;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.namesSize = static_cast<uint32_t>(names.size());
+	header.entriesOffset = offset;
+	header.namesOffset = offset + sizeof(Engine::ArchiveEntry) * entries.size();
+
+	std::ofstream file{ output, std::ios::binary | std::ios::trunc };
+	if (!file.is_open()) {
+		std::cerr << "failed to create " << output.string() << std::endl;
+		return 1;
+	}
+
+	const std::vector<char> padding(Engine::ArchiveBlobAlignment, 0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding.data(), Engine::ArchiveBlobAlignment - sizeof(header));
+	for (size_t i = 0; i < assets.size(); i++) {
+		file.write(assets[i].blob.data(), assets[i].blob.size());
+
+		uint64_t written = entries[i].offset + assets[i].blob.size();
+		file.write(padding.data(), AlignUp(written, Engine::ArchiveBlobAlignment) - written);
+	}
+	file.write(reinterpret_cast<const char*>(entries.data()), sizeof(Engine::ArchiveEntry) * entries.size());
+	file.write(names.data(), names.size());
+	file.close();
+
+	if (!file) {
+		std::cerr << "failed to write " << output.string() << std::endl;
+		return 1;
+	}
+
+	// Read it back through the engine's loader so a bad archive never leaves the tool
+	Engine::AssetArchive archive{ output.string() };
+	for (const auto& asset : assets) {
+		if (!archive.Find(asset.name, asset.type)) {
+			std::cerr << "verification failed for " << asset.name << std::endl;
+			return 1;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Packed " << assets.size() << " assets into " << output.string() << " (" << (header.namesOffset + names.size()) / 1024 << " KB) in " << seconds << "s" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+/*
+	Times Engine::Bvh against walking every object, on random boxes spread evenly through a cube that grows with the count
+
+	Usage:
+		BvhBenchmark [object count]...
+
+		Without counts it runs 10000, 100000 and 1000000. For every count it reports the build, a refit after every
+		object moved, single object updates for 1% of them, and frustum, ray and range queries next to the same queries
+		done by testing every object. The brute force results are also compared against the tree's, any disagreement
+		makes it return non zero.
+*/
+
+#include "../../Project3/Engine/Bvh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+//std
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+using Engine::Bvh;
+using Clock = std::chrono::high_resolution_clock;
+
+static double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static bool BruteForceFrustum(const glm::vec4 (&planes)[6], const Bvh::Aabb& bounds) {
+	for (const glm::vec4& plane : planes) {
+		glm::vec3 normal = glm::vec3(plane);
+		glm::vec3 positive = glm::mix(bounds.min, bounds.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+		if (glm::dot(normal, positive) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool BruteForceRange(const Bvh::Aabb& range, const Bvh::Aabb& bounds) {
+	return glm::all(glm::lessThanEqual(range.min, bounds.max)) && glm::all(glm::greaterThanEqual(range.max, bounds.min));
+}
+
+static Bvh::RayHit BruteForceRay(glm::vec3 origin, glm::vec3 direction, const std::vector<Bvh::Aabb>& bounds) {
+	Bvh::RayHit hit{ Bvh::InvalidObject, FLT_MAX };
+	glm::vec3 inverseDirection = 1.0f / glm::normalize(direction);
+
+	for (uint32_t i = 0; i < bounds.size(); i++) {
+		glm::vec3 t0 = (bounds[i].min - origin) * inverseDirection;
+		glm::vec3 t1 = (bounds[i].max - origin) * inverseDirection;
+		glm::vec3 closest = glm::min(t0, t1);
+		glm::vec3 farthest = glm::max(t0, t1);
+
+		float enter = std::max(std::max(closest.x, closest.y), std::max(closest.z, 0.0f));
+		float exit = std::min(std::min(farthest.x, farthest.y), farthest.z);
+		if (enter <= exit && enter < hit.distance) {
+			hit = { i, enter };
+		}
+	}
+	return hit;
+}
+
+static bool Run(uint32_t objectCount, std::mt19937& random) {
+	const uint32_t FrustumQueries = 100;
+	const uint32_t RayQueries = 10000;
+	const uint32_t RangeQueries = 10000;
+	// Brute force is too slow to run every query at a million objects
+	const uint32_t BruteForceQueries = 20;
+
+	// About one object per 64 cubic units whatever the count
+	float halfSize = std::cbrt(static_cast<float>(objectCount)) * 2.0f;
+	std::uniform_real_distribution<float> position(-halfSize, halfSize);
+	std::uniform_real_distribution<float> extent(0.25f, 1.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Bvh::Aabb> bounds(objectCount);
+	for (auto& object : bounds) {
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 size(extent(random), extent(random), extent(random));
+		object = { center - size, center + size };
+	}
+
+	Bvh bvh;
+	auto start = Clock::now();
+	bvh.Build(bounds.data(), objectCount);
+	double buildTime = MillisecondsSince(start);
+
+	for (auto& object : bounds) {
+		glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 0.5f;
+		object = { object.min + offset, object.max + offset };
+	}
+	start = Clock::now();
+	bvh.Refit(bounds.data());
+	double refitTime = MillisecondsSince(start);
+
+	uint32_t updateCount = std::max(objectCount / 100, 1u);
+	std::vector<uint32_t> moved(updateCount);
+	for (auto& object : moved) {
+		object = random() % objectCount;
+		glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * 0.5f;
+		bounds[object] = { bounds[object].min + offset, bounds[object].max + offset };
+	}
+	start = Clock::now();
+	for (uint32_t object : moved) {
+		bvh.Update(object, bounds[object]);
+	}
+	double updateTime = MillisecondsSince(start);
+
+	uint32_t mismatches = 0;
+	std::vector<uint32_t> results;
+
+	// Frustums looking in random directions from inside the cube, as far as the engine's camera sees
+	std::vector<glm::mat4> frustums(FrustumQueries);
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	for (auto& frustum : frustums) {
+		glm::vec3 eye(position(random), position(random), position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random) * 0.5f, unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f));
+		frustum = projection * glm::lookAt(eye, eye + direction, glm::vec3(0.0f, -1.0f, 0.0f));
+	}
+
+	size_t frustumObjects = 0;
+	start = Clock::now();
+	for (const auto& frustum : frustums) {
+		results.clear();
+		bvh.QueryFrustum(frustum, results);
+		frustumObjects += results.size();
+	}
+	double frustumTime = MillisecondsSince(start) / FrustumQueries;
+
+	start = Clock::now();
+	for (uint32_t query = 0; query < BruteForceQueries; query++) {
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(frustums[query][0][i], frustums[query][1][i], frustums[query][2][i], frustums[query][3][i]);
+		}
+		const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+
+		size_t count = 0;
+		for (const auto& object : bounds) {
+			count += BruteForceFrustum(planes, object);
+		}
+
+		results.clear();
+		bvh.QueryFrustum(frustums[query], results);
+		mismatches += count != results.size();
+	}
+	double frustumBruteTime = MillisecondsSince(start) / BruteForceQueries;
+
+	std::vector<glm::vec3> rayOrigins(RayQueries);
+	std::vector<glm::vec3> rayDirections(RayQueries);
+	for (uint32_t i = 0; i < RayQueries; i++) {
+		rayOrigins[i] = glm::vec3(position(random), position(random), position(random));
+		rayDirections[i] = glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f);
+	}
+
+	uint32_t rayHits = 0;
+	start = Clock::now();
+	for (uint32_t i = 0; i < RayQueries; i++) {
+		rayHits += bvh.Raycast(rayOrigins[i], rayDirections[i]).object != Bvh::InvalidObject;
+	}
+	double rayTime = MillisecondsSince(start) * 1000.0 / RayQueries;
+
+	start = Clock::now();
+	for (uint32_t i = 0; i < BruteForceQueries; i++) {
+		Bvh::RayHit expected = BruteForceRay(rayOrigins[i], rayDirections[i], bounds);
+		Bvh::RayHit hit = bvh.Raycast(rayOrigins[i], rayDirections[i]);
+		// Touching boxes can be hit at the same distance, either is right
+		mismatches += (expected.object == Bvh::InvalidObject) != (hit.object == Bvh::InvalidObject) ||
+			std::abs(expected.distance - hit.distance) > 1e-3f * std::max(expected.distance, 1.0f);
+	}
+	double rayBruteTime = MillisecondsSince(start) * 1000.0 / BruteForceQueries;
+
+	std::vector<Bvh::Aabb> ranges(RangeQueries);
+	for (auto& range : ranges) {
+		glm::vec3 center(position(random), position(random), position(random));
+		range = { center - glm::vec3(5.0f), center + glm::vec3(5.0f) };
+	}
+
+	size_t rangeObjects = 0;
+	start = Clock::now();
+	for (const auto& range : ranges) {
+		results.clear();
+		bvh.QueryRange(range, results);
+		rangeObjects += results.size();
+	}
+	double rangeTime = MillisecondsSince(start) * 1000.0 / RangeQueries;
+
+	start = Clock::now();
+	for (uint32_t query = 0; query < BruteForceQueries; query++) {
+		size_t count = 0;
+		for (const auto& object : bounds) {
+			count += BruteForceRange(ranges[query], object);
+		}
+
+		results.clear();
+		bvh.QueryRange(ranges[query], results);
+		mismatches += count != results.size();
+	}
+	double rangeBruteTime = MillisecondsSince(start) * 1000.0 / BruteForceQueries;
+
+	printf("%u objects, %u nodes\n", objectCount, bvh.GetNodeCount());
+	printf("  build                   %10.2f ms\n", buildTime);
+	printf("  refit                   %10.2f ms    SAH cost %.2fx the built tree's\n", refitTime, bvh.Degradation());
+	printf("  update %-8u          %10.2f ms\n", updateCount, updateTime);
+	printf("  frustum                 %10.3f ms    brute force %10.3f ms    %zu objects per query\n", frustumTime, frustumBruteTime, frustumObjects / FrustumQueries);
+	printf("  ray                     %10.3f us    brute force %10.3f us    %u%% hit\n", rayTime, rayBruteTime, rayHits * 100 / RayQueries);
+	printf("  range                   %10.3f us    brute force %10.3f us    %.1f objects per query\n", rangeTime, rangeBruteTime, static_cast<double>(rangeObjects) / RangeQueries);
+	if (mismatches) {
+		printf("  %u queries disagree with brute force\n", mismatches);
+	}
+	return mismatches == 0;
+}
+
+int main(int argc, char** argv) {
+	std::vector<uint32_t> counts;
+	for (int i = 1; i < argc; i++) {
+		long count = std::strtol(argv[i], nullptr, 10);
+		if (count <= 0) {
+			std::cerr << "usage: BvhBenchmark [object count]..." << std::endl;
+			return 1;
+		}
+		counts.push_back(static_cast<uint32_t>(count));
+	}
+	if (counts.empty()) {
+		counts = { 10000, 100000, 1000000 };
+	}
+
+	std::mt19937 random(1234);
+	bool agreed = true;
+	for (uint32_t count : counts) {
+		agreed &= Run(count, random);
+	}
+
+	return agreed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*
+	Checks Engine's mesh optimizer passes keep every triangle they are given, on small meshes built to hit its edge cases
+
+	Usage:
+		MeshOptimizerTest
+
+		Prints every case and whether it passed, returns non zero when one failed.
+*/
+
+#include "../../Project3/Engine/MeshOptimizer.h"
+
+//std
+#include <iostream>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
+
+using Engine::Model;
+
+// Positions of a triangle's corners, rotated so the smallest comes first, keeping the winding
+static std::array<float, 9> Canonical(const std::vector<Model::Vertex>& vertices, const uint32_t* triangle) {
+	std::array<std::array<float, 3>, 3> corners;
+	for (int c = 0; c < 3; c++) {
+		const glm::vec3& p = vertices[triangle[c]].position;
+		corners[c] = { p.x, p.y, p.z };
+	}
+	while (corners[0] > corners[1] || corners[0] > corners[2]) {
+		std::rotate(corners.begin(), corners.begin() + 1, corners.end());
+	}
+
+	std::array<float, 9> key;
+	for (int c = 0; c < 3; c++) {
+		std::copy(corners[c].begin(), corners[c].end(), key.begin() + c * 3);
+	}
+	return key;
+}
+
+static std::vector<std::array<float, 9>> Triangles(const std::vector<Model::Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		triangles.push_back(Canonical(vertices, &indices[t]));
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static std::vector<Model::Vertex> Grid(uint32_t size) {
+	std::vector<Model::Vertex> vertices;
+	for (uint32_t y = 0; y <= size; y++) {
+		for (uint32_t x = 0; x <= size; x++) {
+			vertices.push_back({ glm::vec3(static_cast<float>(x), static_cast<float>(y), 0.0f), glm::vec3(1.0f), glm::vec2(0.0f) });
+		}
+	}
+	return vertices;
+}
+
+// size * size quads of a Grid with rowLength vertices per row, from firstVertex on
+static void AddGridTriangles(std::vector<uint32_t>& indices, uint32_t size, uint32_t rowLength, uint32_t firstVertex) {
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			uint32_t corner = firstVertex + y * rowLength + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + rowLength, corner + 1, corner + rowLength + 1, corner + rowLength });
+		}
+	}
+}
+
+// The pass under test may reorder triangles but not drop, add or turn any
+static bool Check(const char* name, std::vector<Model::Vertex> vertices, std::vector<uint32_t> indices, const std::function<void(std::vector<Model::Vertex>&, std::vector<uint32_t>&)>& pass) {
+	auto before = Triangles(vertices, indices);
+	pass(vertices, indices);
+	auto after = Triangles(vertices, indices);
+
+	bool passed = before == after;
+	std::cout << (passed ? "passed  " : "FAILED  ") << name << " (" << before.size() << " triangles in, " << after.size() << " out)" << std::endl;
+	return passed;
+}
+
+int main() {
+	auto overdraw = [](std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) { Engine::OptimizeOverdraw(indices, vertices); };
+	auto everything = [](std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices) { Engine::OptimizeMesh(vertices, indices); };
+
+	bool passed = true;
+
+	// A strip after a degenerate triangle, no triangle misses all 3 cache entries
+	{
+		std::vector<Model::Vertex> vertices = Grid(4);
+		std::vector<uint32_t> indices = { 0, 0, 1, 0, 1, 5, 1, 6, 5, 1, 2, 6, 2, 7, 6 };
+		passed &= Check("overdraw, degenerate leading triangle", vertices, indices, overdraw);
+		passed &= Check("whole pipeline, degenerate leading triangle", vertices, indices, everything);
+	}
+
+	// The same followed by a grid far from it, so there is a later hard cluster boundary too
+	{
+		std::vector<Model::Vertex> vertices = Grid(16);
+		std::vector<uint32_t> indices = { 0, 0, 1, 0, 1, 17, 1, 18, 17 };
+		AddGridTriangles(indices, 8, 17, 8 * 17 + 8);
+		passed &= Check("overdraw, degenerate leading triangle then a grid", vertices, indices, overdraw);
+		passed &= Check("whole pipeline, degenerate leading triangle then a grid", vertices, indices, everything);
+	}
+
+	{
+		std::vector<Model::Vertex> vertices = Grid(32);
+		std::vector<uint32_t> indices;
+		AddGridTriangles(indices, 32, 33, 0);
+		passed &= Check("whole pipeline, grid", vertices, indices, everything);
+	}
+
+	return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+	Checks Engine's software occlusion rasterizer never hides what a correct rasterizer would show, on small scenes built
+	around its edge cases
+
+	Usage:
+		OcclusionRasterizerTest
+
+		Prints every case and whether it passed, returns non zero when one failed.
+*/
+
+#include "../../Project3/Engine/OcclusionRasterizer.h"
+
+//std
+#include <iostream>
+#include <vector>
+#include <random>
+
+using Engine::OcclusionRasterizer;
+
+// Pixel x of a width wide buffer to the normalized device coordinate the rasterizer maps to it, with an identity viewProjection
+static float PixelToNdc(float x, uint32_t width) {
+	return x / width * 2.0f - 1.0f;
+}
+
+// One triangle at depth z covering the buffer left of pixel right, a single one so no inner edge splits pixels
+static void AddWall(OcclusionRasterizer& rasterizer, float right, float z) {
+	float edge = PixelToNdc(right, rasterizer.GetWidth());
+	glm::vec3 positions[3] = { { edge, -3.0f, z }, { edge, 3.0f, z }, { -5.0f, 0.0f, z } };
+	uint32_t indices[3] = { 0, 1, 2 };
+	rasterizer.AddOccluder(positions, indices, 3, glm::mat4(1.0f));
+}
+
+// A box between pixels left and right, across the middle half of the buffer's height
+static OcclusionRasterizer::Bounds Box(const OcclusionRasterizer& rasterizer, float left, float right, float nearZ, float farZ) {
+	return { { PixelToNdc(left, rasterizer.GetWidth()), -0.5f, nearZ }, { PixelToNdc(right, rasterizer.GetWidth()), 0.5f, farZ } };
+}
+
+static bool Check(const char* name, bool expected, bool actual) {
+	bool passed = expected == actual;
+	std::cout << (passed ? "passed  " : "FAILED  ") << name << " (" << (actual ? "visible" : "hidden") << ")" << std::endl;
+	return passed;
+}
+
+// Every instruction set the CPU has must write the same depth as the scalar path, to the bit
+static bool CheckInstructionSets(Engine::ThreadPool& workers, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+	const OcclusionRasterizer::InstructionSet sets[] = { OcclusionRasterizer::InstructionSet::Scalar, OcclusionRasterizer::InstructionSet::SSE41, OcclusionRasterizer::InstructionSet::AVX2 };
+	const char* names[] = { "scalar", "SSE4.1", "AVX2" };
+
+	std::vector<float> reference;
+	bool passed = true;
+	for (auto set : sets) {
+		OcclusionRasterizer rasterizer(workers, 256, 256, set);
+		// Sets the CPU doesn't have fall back to one already compared
+		if (rasterizer.GetInstructionSet() != set) {
+			continue;
+		}
+
+		rasterizer.Begin(glm::mat4(1.0f));
+		rasterizer.AddOccluder(positions.data(), indices.data(), static_cast<uint32_t>(indices.size()), glm::mat4(1.0f));
+		rasterizer.Rasterize();
+
+		const float* depth = rasterizer.GetDepth();
+		size_t size = static_cast<size_t>(rasterizer.GetWidth()) * rasterizer.GetHeight();
+		if (reference.empty()) {
+			reference.assign(depth, depth + size);
+			continue;
+		}
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < size; i++) {
+			mismatches += depth[i] != reference[i] ? 1 : 0;
+		}
+		std::cout << (mismatches == 0 ? "passed  " : "FAILED  ") << names[static_cast<int>(set)] << " depth matches scalar (" << mismatches << " pixels differ)" << std::endl;
+		passed &= mismatches == 0;
+	}
+	return passed;
+}
+
+int main() {
+	Engine::ThreadPool workers;
+	bool passed = true;
+
+	// The occluder ends past the center of pixel 100, so the pixel is only partly covered
+	{
+		OcclusionRasterizer rasterizer(workers);
+		rasterizer.Begin(glm::mat4(1.0f));
+		AddWall(rasterizer, 100.7f, 0.2f);
+		rasterizer.Rasterize();
+
+		passed &= Check("box just beyond the occluder's edge", true, rasterizer.IsVisible(Box(rasterizer, 100.75f, 100.95f, 0.5f, 0.6f)));
+		passed &= Check("box behind the occluder", false, rasterizer.IsVisible(Box(rasterizer, 40.0f, 60.0f, 0.5f, 0.6f)));
+		passed &= Check("box in front of the occluder", true, rasterizer.IsVisible(Box(rasterizer, 40.0f, 60.0f, 0.1f, 0.15f)));
+	}
+
+	// Triangles of every size and slope, some past the buffer's edges
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> coordinate(-1.5f, 1.5f);
+		std::uniform_real_distribution<float> depth(0.05f, 0.95f);
+
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		for (uint32_t i = 0; i < 3 * 500; i++) {
+			positions.push_back({ coordinate(random), coordinate(random), depth(random) });
+			indices.push_back(i);
+		}
+		passed &= CheckInstructionSets(workers, positions, indices);
+	}
+
+	return passed ? 0 : 1;
+}
\ No newline at end of file
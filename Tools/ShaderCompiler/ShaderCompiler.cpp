@@ -0,0 +1,642 @@
+/*
+	Offline shader build: GLSL -> optimized SPIR-V plus reflection, run by Project3's pre-build step
+
+	Usage:
+		ShaderCompiler <shader directory> [--release] [--force]
+
+		Every .vert .frag .comp .geom .tesc .tese in the directory becomes <name>.spv next to it (Triangle.frag ->
+		Triangle.frag.spv, the paths the engine loads). Each shader goes through
+
+			glslc -O                 (-g as well outside of --release)
+			spirv-opt -O
+			spirv-opt --strip-debug --strip-nonsemantic    only with --release, names and line info are dropped
+
+		and gets <name>.spv.json describing its stage, descriptor bindings, push constant size, specialization constants
+		and interface locations, read from the optimized module so bindings the optimizer removed aren't listed.
+
+		A shader is only rebuilt when the hash of its source, the files it #includes and the build mode differs from the
+		one recorded in .shadercache, or when its outputs are missing. --force rebuilds everything.
+
+		glslc and spirv-opt are taken from $VULKAN_SDK when it is set, from the PATH otherwise. Exits with 1 when any
+		shader fails so the build stops.
+*/
+
+//std
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+// Goes into every hash, bump it when the flags below change so everything is rebuilt
+static const char* BuildVersion = "ShaderCompiler 1";
+
+static const char* ShaderExtensions[] = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+
+static bool ReadBytes(const fs::path& path, std::vector<char>& bytes) {
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	bytes.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(bytes.data(), bytes.size());
+	return true;
+}
+
+// FNV-1a, only has to notice edits
+static void HashBytes(uint64_t& hash, const char* data, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ull;
+	}
+}
+
+// The source and everything it pulls in through #include "...", each file once
+static bool HashSource(uint64_t& hash, const fs::path& path, std::set<fs::path>& visited) {
+	fs::path normal = fs::absolute(path).lexically_normal();
+	if (!visited.insert(normal).second) {
+		return true;
+	}
+
+	std::vector<char> bytes;
+	if (!ReadBytes(normal, bytes)) {
+		std::cerr << "can't read " << normal.string() << std::endl;
+		return false;
+	}
+	HashBytes(hash, bytes.data(), bytes.size());
+
+	std::istringstream lines(std::string(bytes.begin(), bytes.end()));
+	std::string line;
+	while (std::getline(lines, line)) {
+		size_t directive = line.find("#include");
+		if (directive == std::string::npos) {
+			continue;
+		}
+		size_t open = line.find('"', directive);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos) {
+			continue;
+		}
+		if (!HashSource(hash, normal.parent_path() / line.substr(open + 1, close - open - 1), visited)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::string ToolPath(const char* tool) {
+	std::string name = tool;
+#ifdef _WIN32
+	name += ".exe";
+#endif
+
+	if (const char* sdk = std::getenv("VULKAN_SDK")) {
+		// Bin on Windows, bin everywhere else
+		for (const char* bin : { "Bin", "bin" }) {
+			fs::path candidate = fs::path(sdk) / bin / name;
+			if (fs::exists(candidate)) {
+				return candidate.string();
+			}
+		}
+	}
+	return name;
+}
+
+static bool Run(const std::vector<std::string>& arguments) {
+	std::string command;
+	for (const auto& argument : arguments) {
+		command += (command.empty() ? "\"" : " \"") + argument + "\"";
+	}
+#ifdef _WIN32
+	// cmd strips the outer quotes when the line starts with one
+	command = "\"" + command + "\"";
+#endif
+	return std::system(command.c_str()) == 0;
+}
+
+/*
+	Just enough of a SPIR-V parser to list what a pipeline layout has to provide
+*/
+namespace Reflection {
+	enum Op : uint32_t {
+		OpName = 5,
+		OpEntryPoint = 15,
+		OpExecutionMode = 16,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpSpecConstantTrue = 48,
+		OpSpecConstantFalse = 49,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum Decoration : uint32_t {
+		SpecId = 1,
+		Block = 2,
+		BufferBlock = 3,
+		ArrayStride = 6,
+		MatrixStride = 7,
+		BuiltIn = 11,
+		Location = 30,
+		Binding = 33,
+		DescriptorSet = 34,
+		Offset = 35
+	};
+
+	enum StorageClass : uint32_t {
+		UniformConstant = 0,
+		Input = 1,
+		Uniform = 2,
+		Output = 3,
+		PushConstant = 9,
+		StorageBuffer = 12
+	};
+
+	struct Type {
+		uint32_t op = 0;
+		std::vector<uint32_t> operands;
+	};
+
+	struct Variable {
+		uint32_t id;
+		uint32_t type;
+		uint32_t storage;
+	};
+
+	struct Module {
+		std::map<uint32_t, std::string> names;
+		std::map<uint32_t, Type> types;
+		std::map<uint32_t, uint32_t> constants;
+		std::map<uint32_t, std::map<uint32_t, uint32_t>> decorations;
+		std::map<uint32_t, std::map<uint32_t, std::map<uint32_t, uint32_t>>> memberDecorations;
+		std::vector<Variable> variables;
+		// id, type, default
+		std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t>>> specConstants;
+		uint32_t executionModel = UINT32_MAX;
+		std::string entryPoint;
+		uint32_t localSize[3] = {};
+	};
+
+	static std::string ReadString(const uint32_t* words, uint32_t count) {
+		std::string result;
+		for (uint32_t i = 0; i < count; i++) {
+			for (int byte = 0; byte < 4; byte++) {
+				char c = static_cast<char>((words[i] >> (byte * 8)) & 0xff);
+				if (c == 0) {
+					return result;
+				}
+				result += c;
+			}
+		}
+		return result;
+	}
+
+	static bool Parse(const std::vector<char>& bytes, Module& module) {
+		if (bytes.size() < 20 || bytes.size() % 4 != 0) {
+			return false;
+		}
+		std::vector<uint32_t> words(bytes.size() / 4);
+		memcpy(words.data(), bytes.data(), bytes.size());
+		if (words[0] != 0x07230203) {
+			return false;
+		}
+
+		for (size_t i = 5; i < words.size();) {
+			uint32_t count = words[i] >> 16;
+			uint32_t op = words[i] & 0xffff;
+			if (count == 0 || i + count > words.size()) {
+				return false;
+			}
+			const uint32_t* operands = &words[i + 1];
+			uint32_t operandCount = count - 1;
+
+			switch (op) {
+			case OpName:
+				module.names[operands[0]] = ReadString(operands + 1, operandCount - 1);
+				break;
+			case OpEntryPoint:
+				// The first one, every shader here has a single entry point
+				if (module.executionModel == UINT32_MAX) {
+					module.executionModel = operands[0];
+					module.entryPoint = ReadString(operands + 2, operandCount - 2);
+				}
+				break;
+			case OpExecutionMode:
+				// LocalSize
+				if (operands[1] == 17 && operandCount >= 5) {
+					module.localSize[0] = operands[2];
+					module.localSize[1] = operands[3];
+					module.localSize[2] = operands[4];
+				}
+				break;
+			case OpTypeBool: case OpTypeInt: case OpTypeFloat: case OpTypeVector: case OpTypeMatrix: case OpTypeImage:
+			case OpTypeSampler: case OpTypeSampledImage: case OpTypeArray: case OpTypeRuntimeArray: case OpTypeStruct: case OpTypePointer:
+				module.types[operands[0]] = { op, std::vector<uint32_t>(operands + 1, operands + operandCount) };
+				break;
+			case OpConstant:
+				module.constants[operands[1]] = operands[2];
+				break;
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+				module.specConstants.push_back({ operands[1], { operands[0], op == OpSpecConstantTrue } });
+				break;
+			case OpSpecConstant:
+				module.specConstants.push_back({ operands[1], { operands[0], operands[2] } });
+				break;
+			case OpVariable:
+				module.variables.push_back({ operands[1], operands[0], operands[2] });
+				break;
+			case OpDecorate:
+				module.decorations[operands[0]][operands[1]] = operandCount > 2 ? operands[2] : 0;
+				break;
+			case OpMemberDecorate:
+				module.memberDecorations[operands[0]][operands[1]][operands[2]] = operandCount > 3 ? operands[3] : 0;
+				break;
+			}
+			i += count;
+		}
+		return module.executionModel != UINT32_MAX;
+	}
+
+	static bool Decorated(const Module& module, uint32_t id, uint32_t decoration, uint32_t* value = nullptr) {
+		auto found = module.decorations.find(id);
+		if (found == module.decorations.end()) {
+			return false;
+		}
+		auto entry = found->second.find(decoration);
+		if (entry == found->second.end()) {
+			return false;
+		}
+		if (value) {
+			*value = entry->second;
+		}
+		return true;
+	}
+
+	static uint32_t MemberDecoration(const Module& module, uint32_t structId, uint32_t member, uint32_t decoration) {
+		auto found = module.memberDecorations.find(structId);
+		if (found == module.memberDecorations.end()) {
+			return 0;
+		}
+		auto members = found->second.find(member);
+		if (members == found->second.end()) {
+			return 0;
+		}
+		auto entry = members->second.find(decoration);
+		return entry == members->second.end() ? 0 : entry->second;
+	}
+
+	// Bytes the type takes in an explicitly laid out block, 0 for runtime arrays
+	static uint32_t SizeOf(const Module& module, uint32_t typeId, uint32_t matrixStride = 0) {
+		auto found = module.types.find(typeId);
+		if (found == module.types.end()) {
+			return 0;
+		}
+		const Type& type = found->second;
+
+		switch (type.op) {
+		case OpTypeBool:
+			return 4;
+		case OpTypeInt:
+		case OpTypeFloat:
+			return type.operands[0] / 8;
+		case OpTypeVector:
+			return SizeOf(module, type.operands[0]) * type.operands[1];
+		case OpTypeMatrix:
+			return (matrixStride ? matrixStride : SizeOf(module, type.operands[0])) * type.operands[1];
+		case OpTypeArray: {
+			uint32_t stride = 0;
+			Decorated(module, typeId, ArrayStride, &stride);
+			auto length = module.constants.find(type.operands[1]);
+			return stride * (length == module.constants.end() ? 0 : length->second);
+		}
+		case OpTypeStruct: {
+			uint32_t size = 0;
+			for (uint32_t member = 0; member < type.operands.size(); member++) {
+				uint32_t offset = MemberDecoration(module, typeId, member, Offset);
+				uint32_t memberSize = SizeOf(module, type.operands[member], MemberDecoration(module, typeId, member, MatrixStride));
+				size = std::max(size, offset + memberSize);
+			}
+			return size;
+		}
+		}
+		return 0;
+	}
+
+	static const char* StageName(uint32_t executionModel) {
+		switch (executionModel) {
+		case 0: return "vertex";
+		case 1: return "tessellation_control";
+		case 2: return "tessellation_evaluation";
+		case 3: return "geometry";
+		case 4: return "fragment";
+		case 5: return "compute";
+		}
+		return "unknown";
+	}
+
+	static std::string Quoted(const std::string& text) {
+		std::string result = "\"";
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+			}
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	static std::string NameOf(const Module& module, uint32_t id, uint32_t fallback) {
+		auto found = module.names.find(id);
+		if (found != module.names.end() && !found->second.empty()) {
+			return found->second;
+		}
+		found = module.names.find(fallback);
+		return found != module.names.end() ? found->second : "";
+	}
+
+	static std::string ToJson(const Module& module) {
+		std::ostringstream json;
+		json << "{\n";
+		json << "\t\"stage\": \"" << StageName(module.executionModel) << "\",\n";
+		json << "\t\"entryPoint\": " << Quoted(module.entryPoint) << ",\n";
+		if (module.executionModel == 5) {
+			json << "\t\"localSize\": [" << module.localSize[0] << ", " << module.localSize[1] << ", " << module.localSize[2] << "],\n";
+		}
+
+		std::vector<std::string> bindings;
+		std::vector<std::string> inputs;
+		std::vector<std::string> outputs;
+		uint32_t pushConstantSize = 0;
+
+		for (const Variable& variable : module.variables) {
+			auto pointer = module.types.find(variable.type);
+			if (pointer == module.types.end() || pointer->second.op != OpTypePointer) {
+				continue;
+			}
+			uint32_t pointee = pointer->second.operands[1];
+
+			if (variable.storage == PushConstant) {
+				pushConstantSize = std::max(pushConstantSize, SizeOf(module, pointee));
+				continue;
+			}
+
+			if (variable.storage == Input || variable.storage == Output) {
+				uint32_t location;
+				if (!Decorated(module, variable.id, Location, &location) || Decorated(module, variable.id, BuiltIn)) {
+					continue;
+				}
+				std::string entry = "{ \"location\": " + std::to_string(location) + ", \"name\": " + Quoted(NameOf(module, variable.id, 0)) + " }";
+				(variable.storage == Input ? inputs : outputs).push_back(entry);
+				continue;
+			}
+
+			uint32_t set, binding;
+			if (!Decorated(module, variable.id, DescriptorSet, &set) || !Decorated(module, variable.id, Binding, &binding)) {
+				continue;
+			}
+
+			// Arrays of descriptors
+			uint32_t descriptorCount = 1;
+			uint32_t element = pointee;
+			auto type = module.types.find(element);
+			if (type != module.types.end() && type->second.op == OpTypeArray) {
+				auto length = module.constants.find(type->second.operands[1]);
+				descriptorCount = length == module.constants.end() ? 1 : length->second;
+				element = type->second.operands[0];
+			}
+			else if (type != module.types.end() && type->second.op == OpTypeRuntimeArray) {
+				descriptorCount = 0;
+				element = type->second.operands[0];
+			}
+			type = module.types.find(element);
+			uint32_t elementOp = type == module.types.end() ? 0 : type->second.op;
+
+			const char* descriptorType = "unknown";
+			if (variable.storage == StorageBuffer || (variable.storage == Uniform && Decorated(module, element, BufferBlock))) {
+				descriptorType = "storage_buffer";
+			}
+			else if (variable.storage == Uniform) {
+				descriptorType = "uniform_buffer";
+			}
+			else if (elementOp == OpTypeSampledImage) {
+				descriptorType = "combined_image_sampler";
+			}
+			else if (elementOp == OpTypeSampler) {
+				descriptorType = "sampler";
+			}
+			else if (elementOp == OpTypeImage) {
+				// Dim Buffer is a texel buffer, Sampled 2 means read and written without a sampler
+				bool texelBuffer = type->second.operands[1] == 5;
+				bool storage = type->second.operands[5] == 2;
+				descriptorType = texelBuffer ? (storage ? "storage_texel_buffer" : "uniform_texel_buffer") : (storage ? "storage_image" : "sampled_image");
+			}
+
+			std::ostringstream entry;
+			entry << "{ \"set\": " << set << ", \"binding\": " << binding << ", \"type\": \"" << descriptorType << "\", \"count\": " << descriptorCount
+				<< ", \"name\": " << Quoted(NameOf(module, variable.id, element)) << " }";
+			bindings.push_back(entry.str());
+		}
+
+		auto writeList = [&](const char* name, const std::vector<std::string>& entries, bool last = false) {
+			json << "\t\"" << name << "\": [";
+			for (size_t i = 0; i < entries.size(); i++) {
+				json << (i ? ",\n\t\t" : "\n\t\t") << entries[i];
+			}
+			json << (entries.empty() ? "]" : "\n\t]") << (last ? "\n" : ",\n");
+		};
+
+		writeList("bindings", bindings);
+		json << "\t\"pushConstantSize\": " << pushConstantSize << ",\n";
+
+		std::vector<std::string> specConstants;
+		for (const auto& constant : module.specConstants) {
+			uint32_t id;
+			if (!Decorated(module, constant.first, SpecId, &id)) {
+				continue;
+			}
+			auto type = module.types.find(constant.second.first);
+			uint32_t typeOp = type == module.types.end() ? 0 : type->second.op;
+			std::string value;
+			if (typeOp == OpTypeBool) {
+				value = constant.second.second ? "true" : "false";
+			}
+			else if (typeOp == OpTypeFloat) {
+				float number;
+				memcpy(&number, &constant.second.second, sizeof(number));
+				value = std::to_string(number);
+			}
+			else if (typeOp == OpTypeInt && type->second.operands[1]) {
+				value = std::to_string(static_cast<int32_t>(constant.second.second));
+			}
+			else {
+				value = std::to_string(constant.second.second);
+			}
+			specConstants.push_back("{ \"id\": " + std::to_string(id) + ", \"name\": " + Quoted(NameOf(module, constant.first, 0)) + ", \"default\": " + value + " }");
+		}
+		writeList("specializationConstants", specConstants);
+		writeList("inputs", inputs);
+		writeList("outputs", outputs, true);
+		json << "}\n";
+		return json.str();
+	}
+}
+
+static std::map<std::string, std::string> ReadCache(const fs::path& path) {
+	std::map<std::string, std::string> cache;
+	std::ifstream file(path);
+	std::string name, hash;
+	while (file >> name >> hash) {
+		cache[name] = hash;
+	}
+	return cache;
+}
+
+static bool BuildShader(const fs::path& source, bool release, const std::string& glslc, const std::string& spirvOpt) {
+	fs::path output = source.string() + ".spv";
+	fs::path compiled = source.string() + ".unopt.spv";
+	fs::path optimized = release ? fs::path(source.string() + ".opt.spv") : output;
+
+	std::vector<std::string> compile = { glslc, "-O", "--target-env=vulkan1.0", source.string(), "-o", compiled.string() };
+	if (!release) {
+		compile.insert(compile.begin() + 2, "-g");
+	}
+
+	bool built = Run(compile) && Run({ spirvOpt, "-O", compiled.string(), "-o", optimized.string() });
+	if (built && release) {
+		built = Run({ spirvOpt, "--strip-debug", "--strip-nonsemantic", optimized.string(), "-o", output.string() });
+	}
+
+	// Reflected before stripping so bindings keep their names
+	std::vector<char> unoptimizedBytes, bytes;
+	Reflection::Module module;
+	if (built) {
+		ReadBytes(compiled, unoptimizedBytes);
+		if (!ReadBytes(optimized, bytes) || !Reflection::Parse(bytes, module)) {
+			std::cerr << "can't reflect " << optimized.string() << std::endl;
+			built = false;
+		}
+	}
+	if (built) {
+		std::ofstream(source.string() + ".spv.json") << Reflection::ToJson(module);
+		printf("%-28s %7zu -> %7ju bytes\n", source.filename().string().c_str(), unoptimizedBytes.size(), static_cast<uintmax_t>(fs::file_size(output)));
+	}
+
+	std::error_code ignored;
+	fs::remove(compiled, ignored);
+	if (release) {
+		fs::remove(optimized, ignored);
+	}
+	return built;
+}
+
+int main(int argc, char** argv) {
+	fs::path directory;
+	bool release = false;
+	bool force = false;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--release") {
+			release = true;
+		}
+		else if (argument == "--force") {
+			force = true;
+		}
+		else if (directory.empty()) {
+			directory = argument;
+		}
+		else {
+			directory.clear();
+			break;
+		}
+	}
+	if (directory.empty() || !fs::is_directory(directory)) {
+		std::cerr << "usage: ShaderCompiler <shader directory> [--release] [--force]" << std::endl;
+		return 1;
+	}
+
+	std::string glslc = ToolPath("glslc");
+	std::string spirvOpt = ToolPath("spirv-opt");
+
+	fs::path cachePath = directory / ".shadercache";
+	std::map<std::string, std::string> cache = force ? std::map<std::string, std::string>{} : ReadCache(cachePath);
+
+	std::vector<fs::path> sources;
+	for (const auto& file : fs::directory_iterator(directory)) {
+		std::string extension = file.path().extension().string();
+		if (file.is_regular_file() && std::find(std::begin(ShaderExtensions), std::end(ShaderExtensions), extension) != std::end(ShaderExtensions)) {
+			sources.push_back(file.path());
+		}
+	}
+	std::sort(sources.begin(), sources.end());
+
+	uint32_t built = 0;
+	uint32_t skipped = 0;
+	uint32_t failed = 0;
+	for (const fs::path& source : sources) {
+		std::string name = source.filename().string();
+
+		uint64_t hash = 0xcbf29ce484222325ull;
+		HashBytes(hash, BuildVersion, strlen(BuildVersion));
+		HashBytes(hash, release ? "release" : "debug", release ? 7 : 5);
+		std::set<fs::path> visited;
+		if (!HashSource(hash, source, visited)) {
+			failed++;
+			continue;
+		}
+		char hashText[17];
+		snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(hash));
+
+		auto cached = cache.find(name);
+		bool upToDate = cached != cache.end() && cached->second == hashText && fs::exists(source.string() + ".spv") && fs::exists(source.string() + ".spv.json");
+		if (upToDate) {
+			skipped++;
+			continue;
+		}
+
+		if (BuildShader(source, release, glslc, spirvOpt)) {
+			cache[name] = hashText;
+			built++;
+		}
+		else {
+			std::cerr << "failed to build " << name << std::endl;
+			cache.erase(name);
+			failed++;
+		}
+	}
+
+	std::ofstream cacheFile(cachePath);
+	for (const auto& [name, hash] : cache) {
+		if (fs::exists(directory / name)) {
+			cacheFile << name << " " << hash << "\n";
+		}
+	}
+
+	printf("%u built, %u up to date, %u failed (%s)\n", built, skipped, failed, release ? "release" : "debug");
+	return failed ? 1 : 0;
+}
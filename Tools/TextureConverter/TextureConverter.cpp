@@ -0,0 +1,443 @@
+/*
+	Offline texture converter: image (png/jpg/tga/...) -> KTX2 with a pre-built, block compressed mip chain
+
+	Usage:
+		TextureConverter <input image> <output.ktx2> [bc1 | bc3 | bc5] [--linear]
+
+		bc1      - RGB, 4 bits per texel (default)
+		bc3      - RGBA, 8 bits per texel
+		bc5      - two channel (RG) for normal maps, always linear
+		--linear - treat the color data as linear instead of sRGB
+
+	The engine loads the result through Engine::LoadKTX2 and uploads the blocks as-is.
+	BC7 / ETC2 / ASTC files produced by other tools (toktx, compressonator) load the same way.
+*/
+
+#include "../../Project3/Engine/KTX2.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+//std
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+
+enum class BlockFormat {
+	BC1,
+	BC3,
+	BC5
+};
+
+struct Image {
+	uint32_t width;
+	uint32_t height;
+	std::vector<unsigned char> pixels;	// RGBA8
+};
+
+static float SrgbToLinear(unsigned char value) {
+	float c = value / 255.0f;
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static unsigned char LinearToSrgb(float value) {
+	float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return static_cast<unsigned char>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static Image Downsample(const Image& src, bool srgb) {
+	Image dst;
+	dst.width = std::max(src.width / 2, 1u);
+	dst.height = std::max(src.height / 2, 1u);
+	dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+	for (uint32_t y = 0; y < dst.height; y++) {
+		uint32_t y0 = std::min(y * 2, src.height - 1);
+		uint32_t y1 = std::min(y * 2 + 1, src.height - 1);
+		for (uint32_t x = 0; x < dst.width; x++) {
+			uint32_t x0 = std::min(x * 2, src.width - 1);
+			uint32_t x1 = std::min(x * 2 + 1, src.width - 1);
+
+			const unsigned char* p[4] = {
+				&src.pixels[(y0 * src.width + x0) * 4],
+				&src.pixels[(y0 * src.width + x1) * 4],
+				&src.pixels[(y1 * src.width + x0) * 4],
+				&src.pixels[(y1 * src.width + x1) * 4]
+			};
+			unsigned char* out = &dst.pixels[(y * dst.width + x) * 4];
+
+			for (int c = 0; c < 4; c++) {
+				if (srgb && c < 3) {
+					float sum = SrgbToLinear(p[0][c]) + SrgbToLinear(p[1][c]) + SrgbToLinear(p[2][c]) + SrgbToLinear(p[3][c]);
+					out[c] = LinearToSrgb(sum * 0.25f);
+				}
+				else {
+					out[c] = static_cast<unsigned char>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+				}
+			}
+		}
+	}
+
+	return dst;
+}
+
+static uint16_t PackRGB565(const float color[3]) {
+	uint16_t r = static_cast<uint16_t>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	uint16_t g = static_cast<uint16_t>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+	uint16_t b = static_cast<uint16_t>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, float color[3]) {
+	color[0] = static_cast<float>((packed >> 11) & 31) * 255.0f / 31.0f;
+	color[1] = static_cast<float>((packed >> 5) & 63) * 255.0f / 63.0f;
+	color[2] = static_cast<float>(packed & 31) * 255.0f / 31.0f;
+}
+
+// Color endpoints along the principal axis of the block (range fit), 4 color mode
+static void EncodeBC1Block(const unsigned char block[16][4], unsigned char out[8]) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			mean[c] += block[i][c] / 16.0f;
+		}
+	}
+
+	float cov[6] = { 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+		cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+	}
+
+	// Power iteration for the principal axis
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+		};
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+		if (length < 1e-6f) {
+			break;
+		}
+		for (int c = 0; c < 3; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	float minProj = 1e30f, maxProj = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float proj = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+		minProj = std::min(minProj, proj);
+		maxProj = std::max(maxProj, proj);
+	}
+
+	float maxColor[3], minColor[3];
+	for (int c = 0; c < 3; c++) {
+		maxColor[c] = mean[c] + axis[c] * maxProj;
+		minColor[c] = mean[c] + axis[c] * minProj;
+	}
+
+	uint16_t color0 = PackRGB565(maxColor);
+	uint16_t color1 = PackRGB565(minColor);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		float palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = 1e30f;
+			for (int p = 0; p < 4; p++) {
+				float dr = block[i][0] - palette[p][0];
+				float dg = block[i][1] - palette[p][1];
+				float db = block[i][2] - palette[p][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+
+	out[0] = static_cast<unsigned char>(color0 & 0xFF);
+	out[1] = static_cast<unsigned char>(color0 >> 8);
+	out[2] = static_cast<unsigned char>(color1 & 0xFF);
+	out[3] = static_cast<unsigned char>(color1 >> 8);
+	memcpy(out + 4, &indices, 4);
+}
+
+// Single channel block (BC4 layout), used for BC3 alpha and both BC5 channels
+static void EncodeBC4Block(const unsigned char block[16][4], int channel, unsigned char out[8]) {
+	unsigned char maxValue = 0, minValue = 255;
+	for (int i = 0; i < 16; i++) {
+		maxValue = std::max(maxValue, block[i][channel]);
+		minValue = std::min(minValue, block[i][channel]);
+	}
+
+	out[0] = maxValue;
+	out[1] = minValue;
+
+	uint64_t indices = 0;
+	if (maxValue != minValue) {
+		// 8 value mode: a0, a1, then 6 interpolants from a0 to a1
+		float palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int p = 1; p < 7; p++) {
+			palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7.0f;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = 1e30f;
+			for (int p = 0; p < 8; p++) {
+				float distance = std::abs(block[i][channel] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (i * 3);
+		}
+	}
+
+	for (int b = 0; b < 6; b++) {
+		out[2 + b] = static_cast<unsigned char>((indices >> (b * 8)) & 0xFF);
+	}
+}
+
+static uint32_t BlockBytes(BlockFormat format) {
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+static std::vector<unsigned char> CompressLevel(const Image& image, BlockFormat format) {
+	uint32_t blocksX = (image.width + 3) / 4;
+	uint32_t blocksY = (image.height + 3) / 4;
+	std::vector<unsigned char> out(static_cast<size_t>(blocksX) * blocksY * BlockBytes(format));
+
+	unsigned char block[16][4];
+	unsigned char* dst = out.data();
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			// Edge blocks repeat the last row / column
+			for (uint32_t i = 0; i < 16; i++) {
+				uint32_t x = std::min(bx * 4 + i % 4, image.width - 1);
+				uint32_t y = std::min(by * 4 + i / 4, image.height - 1);
+				memcpy(block[i], &image.pixels[(y * image.width + x) * 4], 4);
+			}
+
+			switch (format) {
+			case BlockFormat::BC1:
+				EncodeBC1Block(block, dst);
+				break;
+			case BlockFormat::BC3:
+				EncodeBC4Block(block, 3, dst);
+				EncodeBC1Block(block, dst + 8);
+				break;
+			case BlockFormat::BC5:
+				EncodeBC4Block(block, 0, dst);
+				EncodeBC4Block(block, 1, dst + 8);
+				break;
+			}
+			dst += BlockBytes(format);
+		}
+	}
+
+	return out;
+}
+
+static VkFormat ToVkFormat(BlockFormat format, bool srgb) {
+	switch (format) {
+	case BlockFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BlockFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	default: return VK_FORMAT_BC5_UNORM_BLOCK;
+	}
+}
+
+// Basic data format descriptor (KTX2 spec section 3.10 / Khronos Data Format spec)
+static std::vector<uint32_t> BuildDFD(BlockFormat format, bool srgb) {
+	struct Sample { uint32_t bitOffset; uint32_t channel; };
+	std::vector<Sample> samples;
+	uint32_t colorModel;
+
+	switch (format) {
+	case BlockFormat::BC1:
+		colorModel = 128;							// KHR_DF_MODEL_BC1A
+		samples = { { 0, 0 } };						// KHR_DF_CHANNEL_BC1A_COLOR
+		break;
+	case BlockFormat::BC3:
+		colorModel = 130;							// KHR_DF_MODEL_BC3
+		samples = { { 0, 15 }, { 64, 0 } };		// KHR_DF_CHANNEL_BC3_ALPHA, KHR_DF_CHANNEL_BC3_COLOR
+		break;
+	default:
+		colorModel = 132;							// KHR_DF_MODEL_BC5
+		samples = { { 0, 0 }, { 64, 1 } };			// KHR_DF_CHANNEL_BC5_RED, KHR_DF_CHANNEL_BC5_GREEN
+		break;
+	}
+
+	uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	std::vector<uint32_t> dfd;
+	dfd.push_back(4 + blockSize);								// dfdTotalSize
+	dfd.push_back(0);											// vendorId | descriptorType
+	dfd.push_back(2 | (blockSize << 16));						// versionNumber | descriptorBlockSize
+	dfd.push_back(colorModel | (1 << 8) | ((srgb ? 2u : 1u) << 16));	// model | BT709 primaries | transfer | flags
+	dfd.push_back(3 | (3 << 8));								// 4x4x1x1 texel block
+	dfd.push_back(BlockBytes(format));							// bytesPlane0
+	dfd.push_back(0);
+
+	for (const auto& sample : samples) {
+		dfd.push_back(sample.bitOffset | (63u << 16) | (sample.channel << 24));
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(0xFFFFFFFF);
+	}
+
+	return dfd;
+}
+
+static void WriteKTX2(const std::string& path, VkFormat vkFormat, const std::vector<uint32_t>& dfd, uint32_t width, uint32_t height, const std::vector<std::vector<unsigned char>>& levels, uint32_t alignment) {
+	const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+	const uint32_t headerSize = 80;
+	const uint32_t levelIndexSize = 24 * levelCount;
+	const uint32_t dfdOffset = headerSize + levelIndexSize;
+	const uint32_t dfdSize = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	// Level data goes smallest mip first, each level aligned to the block size
+	std::vector<uint64_t> levelOffsets(levelCount);
+	uint64_t offset = dfdOffset + dfdSize;
+	for (int32_t level = static_cast<int32_t>(levelCount) - 1; level >= 0; level--) {
+		offset = (offset + alignment - 1) / alignment * alignment;
+		levelOffsets[level] = offset;
+		offset += levels[level].size();
+	}
+
+	std::vector<unsigned char> file(static_cast<size_t>(offset), 0);
+	auto write32 = [&](size_t at, uint32_t value) { memcpy(&file[at], &value, 4); };
+	auto write64 = [&](size_t at, uint64_t value) { memcpy(&file[at], &value, 8); };
+
+	memcpy(file.data(), Engine::KTX2Identifier, sizeof(Engine::KTX2Identifier));
+	write32(12, static_cast<uint32_t>(vkFormat));
+	write32(16, 1);				// typeSize
+	write32(20, width);
+	write32(24, height);
+	write32(28, 0);				// pixelDepth
+	write32(32, 0);				// layerCount
+	write32(36, 1);				// faceCount
+	write32(40, levelCount);
+	write32(44, 0);				// supercompressionScheme
+	write32(48, dfdOffset);
+	write32(52, dfdSize);
+	write32(56, 0);				// kvdByteOffset
+	write32(60, 0);				// kvdByteLength
+	write64(64, 0);				// sgdByteOffset
+	write64(72, 0);				// sgdByteLength
+
+	for (uint32_t level = 0; level < levelCount; level++) {
+		size_t at = headerSize + level * 24;
+		write64(at, levelOffsets[level]);
+		write64(at + 8, levels[level].size());
+		write64(at + 16, levels[level].size());
+		memcpy(&file[static_cast<size_t>(levelOffsets[level])], levels[level].data(), levels[level].size());
+	}
+
+	memcpy(&file[dfdOffset], dfd.data(), dfdSize);
+
+	std::ofstream File(path, std::ios::binary);
+	if (!File.is_open()) {
+		throw std::runtime_error("failed to open output file: " + path);
+	}
+	File.write(reinterpret_cast<const char*>(file.data()), file.size());
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Usage: TextureConverter <input image> <output.ktx2> [bc1 | bc3 | bc5] [--linear]" << std::endl;
+		return 1;
+	}
+
+	std::string input = argv[1];
+	std::string output = argv[2];
+	BlockFormat format = BlockFormat::BC1;
+	bool srgb = true;
+
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "bc1") format = BlockFormat::BC1;
+		else if (arg == "bc3") format = BlockFormat::BC3;
+		else if (arg == "bc5") format = BlockFormat::BC5;
+		else if (arg == "--linear") srgb = false;
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	if (format == BlockFormat::BC5) {
+		srgb = false;
+	}
+
+	try
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load image: " + input);
+		}
+
+		Image level;
+		level.width = static_cast<uint32_t>(width);
+		level.height = static_cast<uint32_t>(height);
+		level.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(pixels);
+
+		uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+		std::vector<std::vector<unsigned char>> levels;
+		size_t compressedSize = 0;
+		for (uint32_t i = 0; i < mipLevels; i++) {
+			levels.push_back(CompressLevel(level, format));
+			compressedSize += levels.back().size();
+
+			if (i + 1 < mipLevels) {
+				level = Downsample(level, srgb);
+			}
+		}
+
+		WriteKTX2(output, ToVkFormat(format, srgb), BuildDFD(format, srgb), static_cast<uint32_t>(width), static_cast<uint32_t>(height), levels, BlockBytes(format));
+
+		auto end = std::chrono::high_resolution_clock::now();
+		size_t uncompressedSize = static_cast<size_t>(width) * height * 4;
+		std::cout << output << ": " << width << "x" << height << ", " << mipLevels << " mips, "
+			<< compressedSize / 1024 << " KB (RGBA8 level 0 alone: " << uncompressedSize / 1024 << " KB), "
+			<< std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count() << " ms" << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}